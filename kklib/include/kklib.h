@@ -76,6 +76,12 @@ typedef enum kk_tag_e {
   KK_TAG_EVV_VECTOR,  // evidence vector (used in std/core/hnd)
   KK_TAG_NOTHING,     // used to avoid allocation for unnested maybe-like types
   KK_TAG_JUST,
+  KK_TAG_BYTES_ROPE,  // concatenation of two byte sequences (flattened on demand)
+  KK_TAG_BYTES_SLICE, // slice of a (normal) byte sequence
+  KK_TAG_UVECTOR,     // a vector of unboxed values (see `kklib/uvector.h`)
+  KK_TAG_HAMT,        // persistent hash map (see `kklib/hashmap.h`)
+  KK_TAG_HAMT_NODE,   // node of a persistent hash map
+  KK_TAG_SWISS,       // hash table (see `kklib/hashmap.h`)
   // raw tags have a free function together with a `void*` to the data
   KK_TAG_CPTR_RAW,    // full void* (must be first, see kk_tag_is_raw())
   KK_TAG_BYTES_RAW,   // pointer to byte buffer
@@ -83,7 +89,9 @@ typedef enum kk_tag_e {
   // strings are represented by bytes but guarantee valid utf-8 encoding
   KK_TAG_STRING_SMALL = KK_TAG_BYTES_SMALL, // utf-8 encoded string of at most 7 bytes.
   KK_TAG_STRING       = KK_TAG_BYTES,       // utf-8 encoded string ending with a zero byte.
-  KK_TAG_STRING_RAW   = KK_TAG_BYTES_RAW    // pointer to a valid utf-8 string
+  KK_TAG_STRING_RAW   = KK_TAG_BYTES_RAW,   // pointer to a valid utf-8 string
+  KK_TAG_STRING_ROPE  = KK_TAG_BYTES_ROPE,  // concatenation of two valid utf-8 strings
+  KK_TAG_STRING_SLICE = KK_TAG_BYTES_SLICE  // slice of a valid utf-8 string (at code point boundaries)
 } kk_tag_t;
 
 static inline bool kk_tag_is_raw(kk_tag_t tag) {
@@ -111,6 +119,15 @@ static inline bool kk_refcount_is_unique_or_thread_shared(kk_refcount_t rc) {
   return ((int32_t)rc <= 0);
 }
 
+// Immortal blocks are never freed and skip reference counting altogether; this includes static data
+// and long-lived data promoted with `kk_block_make_immortal`. (This is also the "stuck" reference
+// count that a non-thread-shared reference count reaches on overflow, see `refcount.c`).
+#define KK_REFCOUNT_IMMORTAL  KK_U32(0x80000000)
+
+static inline bool kk_refcount_is_immortal(kk_refcount_t rc) {
+  return (rc == KK_REFCOUNT_IMMORTAL);
+}
+
 
 
 // Every heap block starts with a 64-bit header with a reference count, tag, and scan fields count.
@@ -124,7 +141,7 @@ typedef struct kk_header_s {
 
 #define KK_SCAN_FSIZE_MAX (0xFF)
 #define KK_HEADER(scan_fsize,tag)         { scan_fsize, 0, tag, ATOMIC_VAR_INIT(0) }                // start with refcount of 0
-#define KK_HEADER_STATIC(scan_fsize,tag)  { scan_fsize, 0, tag, ATOMIC_VAR_INIT(KK_U32(0x80000000)) } // start with a stuck refcount (RC_STUCK)
+#define KK_HEADER_STATIC(scan_fsize,tag)  { scan_fsize, 0, tag, ATOMIC_VAR_INIT(KK_REFCOUNT_IMMORTAL) } // static data is immortal
 
 static inline void kk_header_init(kk_header_t* h, kk_ssize_t scan_fsize, kk_tag_t tag) {
   kk_assert_internal(scan_fsize >= 0 && scan_fsize <= KK_SCAN_FSIZE_MAX);
@@ -354,7 +371,43 @@ typedef struct kk_box_any_s {
 // Workers run in a task_group
 typedef struct kk_task_group_s kk_task_group_t;
 
-//A yield context allows up to 8 continuations to be stored in-place
+// Allocation regions (see `region.c`)
+typedef struct kk_region_s kk_region_t;
+
+// Deferred drops of thread-shared blocks (see `refcount.c`)
+typedef struct kk_drop_deferred_s kk_drop_deferred_t;
+
+// Allocation and reference count statistics per context (only if compiled with KK_STATS, see `kk_stats_print`)
+#if KK_STATS
+#define KK_STATS_USER_TAGS  (64)    // user tags >= 63 are counted together
+#define KK_STATS_TAGS       (KK_STATS_USER_TAGS + (KK_TAG_LAST - KK_TAG_MAX - 1))
+
+typedef struct kk_stats_s {
+  int64_t allocs[KK_STATS_TAGS];  // allocated blocks per tag (including reused blocks)
+  int64_t frees[KK_STATS_TAGS];   // freed blocks per tag (including blocks that become a reuse token)
+  int64_t atomic_dup;             // atomic increments of thread-shared reference counts
+  int64_t atomic_drop;            // atomic decrements of thread-shared reference counts
+  int64_t reuse_hit;              // `kk_block_drop_reuse` returned a block for reuse
+  int64_t reuse_miss;             // `kk_block_drop_reuse` returned `kk_reuse_null`
+  int64_t alloc_reused;           // `kk_block_alloc_at` with a reused block
+  int64_t mark_shared;            // calls to `kk_block_mark_shared` on a non-shared block
+  int64_t mark_shared_blocks;     // total blocks marked as thread-shared
+  int64_t mark_shared_max;        // maximal blocks marked in a single call
+} kk_stats_t;
+
+static inline kk_ssize_t kk_stats_tag_index(kk_tag_t tag) {
+  if (tag > KK_TAG_MAX) return (KK_STATS_USER_TAGS + (tag - KK_TAG_MAX - 1));
+  return (tag < KK_STATS_USER_TAGS ? (kk_ssize_t)tag : KK_STATS_USER_TAGS - 1);
+}
+
+#define kk_stats_inc(ctx,field)          ((ctx)->stats.field++)
+#define kk_stats_tag_inc(ctx,field,tag)  ((ctx)->stats.field[kk_stats_tag_index(tag)]++)
+#else
+#define kk_stats_inc(ctx,field)
+#define kk_stats_tag_inc(ctx,field,tag)
+#endif
+
+// A yield context stores up to 8 continuations in-place and grows a buffer for more
 #define KK_YIELD_CONT_MAX (8)
 
 typedef enum kk_yield_kind_e {
@@ -367,10 +420,12 @@ typedef struct kk_yield_s {
   int32_t       marker;          // marker of the handler to yield to
   kk_function_t clause;          // the operation clause to execute when the handler is found
   kk_ssize_t    conts_count;     // number of continuations in `conts`
-  kk_function_t conts[KK_YIELD_CONT_MAX]; // fixed array of continuations. The final continuation `k` is
-                                          // composed as `fN ○ ... ○ f2 ○ f1` if `conts = { f1, f2, ..., fN }`
-                                          // if the array becomes full, a fresh array is allocated and the first
-                                          // entry points to its composition.
+  kk_ssize_t    conts_size;      // available entries in `conts`
+  kk_function_t* conts;          // array of continuations. The final continuation `k` is
+                                 // composed as `fN ○ ... ○ f2 ○ f1` if `conts = { f1, f2, ..., fN }`.
+                                 // Points to `conts_inline` or, if that becomes full, to a growing heap allocated 
+                                 // array that is reused by later yields (and freed with the context).
+  kk_function_t conts_inline[KK_YIELD_CONT_MAX];
 } kk_yield_t;
 
 extern kk_ptr_t kk_evv_empty_singleton;
@@ -385,14 +440,27 @@ typedef struct kk_context_s {
   kk_yield_t     yield;            // inlined yield structure (for efficiency)
   int32_t        marker_unique;    // unique marker generation
   kk_block_t*    delayed_free;     // list of blocks that still need to be freed
+  kk_ssize_t     delayed_free_budget;  // if > 0, free at most this many blocks per drop or allocation
+  kk_usecs_t     delayed_free_usecs;   // if > 0, free for at most this many micro-seconds per drop or allocation
+  kk_ssize_t     delayed_free_count;   // current number of pending structures in `delayed_free`
+  kk_ssize_t     delayed_free_peak;    // the maximal `delayed_free_count` 
+  int64_t        delayed_free_steps;   // total number of incremental free steps
+  int64_t        delayed_free_freed;   // total number of blocks freed through `delayed_free`
+  kk_drop_deferred_t* drop_deferred;   // buffered drops of thread-shared blocks (if enabled)
   kk_integer_t   unique;           // thread local unique number generation
   size_t         thread_id;        // unique thread id
   kk_box_any_t   kk_box_any;       // used when yielding as a value of any type
   kk_function_t  log;              // logging function
   kk_function_t  out;              // std output
+  struct kk_output_s* out_buf;     // buffered std output (see `kk_output_write`), initialized on demand
+  struct kk_profile_s* profile;    // sampling profiler shadow stack (or NULL if not profiling)
   kk_task_group_t* task_group;     // task group for managing threads. NULL for the main thread.
+  void*          task_current;     // state of the task that is running (for cancellation, see `thread.c`), or NULL
+  kk_region_t*   region;           // current allocation region (or NULL)
   
   struct kk_random_ctx_s* srandom_ctx; // strong random using chacha20, initialized on demand
+  uint64_t                hash_seed;   // per process hash seed (see `hash.h`), initialized on demand
+  struct kk_evloop_s*     evloop;      // event loop for asynchronous I/O, initialized on demand
   kk_ssize_t     argc;             // command line argument count 
   const char**   argv;             // command line arguments
   kk_timer_t     process_start;    // time at start of the process
@@ -401,17 +469,62 @@ typedef struct kk_context_s {
   kk_duration_t  timer_delta;      // applied timer delta (to ensure monotonicity)
   int64_t        time_freq;        // unix time frequency
   kk_duration_t  time_unix_prev;   // last requested unix time
+  #if KK_STATS
+  kk_stats_t     stats;            // allocation and reference count statistics
+  struct kk_context_s* stats_next; // all contexts are linked to aggregate the statistics
+  #endif
 } kk_context_t;
 
 // Get the current (thread local) runtime context (should always equal the `_ctx` parameter)
 kk_decl_export kk_context_t* kk_get_context(void);
 kk_decl_export void          kk_free_context(void);
 
+// Register a function that is called in every thread that frees its context (at most `KK_THREAD_DONE_MAX`),
+// for libraries that keep thread local state. Registering the same function again has no effect.
+typedef void (kk_thread_done_fun_t)(kk_context_t* ctx);
+#define KK_THREAD_DONE_MAX  (8)
+kk_decl_export bool          kk_thread_done_register(kk_thread_done_fun_t* fun);
+
 kk_decl_export kk_context_t* kk_main_start(int argc, char** argv);
 kk_decl_export void          kk_main_end(kk_context_t* ctx);
 
 kk_decl_export void          kk_debugger_break(kk_context_t* ctx);
 
+#if KK_STATS
+kk_decl_export void          kk_stats_print(kk_context_t* ctx);
+#endif
+
+// Runtime statistics that can be polled while running (see `kk_runtime_stats` and `std/os/process`)
+typedef struct kk_runtime_stats_s {
+  kk_msecs_t  user_time;
+  kk_msecs_t  sys_time;
+  size_t      rss;              // current resident set size (0 if unknown)
+  size_t      peak_rss;
+  size_t      peak_commit;
+  size_t      page_faults;
+  size_t      page_reclaims;
+  size_t      heap_committed;   // committed memory of the heap of the current thread (mimalloc only)
+  size_t      heap_used;        // bytes in use in the heap of the current thread (mimalloc only)
+  int64_t     heap_blocks;      // blocks in use in the heap of the current thread (mimalloc only)
+  kk_ssize_t  delayed_free;     // blocks pending in the delayed free list of the current thread
+  int64_t     live_blocks;      // live blocks of all threads (KK_STATS only, -1 otherwise)
+  int64_t     shared_blocks;    // blocks that were marked as thread-shared (KK_STATS only, -1 otherwise)
+  kk_ssize_t  task_workers;     // see `kk_task_stats_t`
+  kk_ssize_t  task_sleeping;
+  kk_ssize_t  task_queued;
+  int64_t     task_executed;
+  kk_usecs_t  task_busy;
+  kk_usecs_t  task_idle;
+  int64_t     promise_waits;
+  kk_usecs_t  promise_wait;
+} kk_runtime_stats_t;
+
+kk_decl_export void       kk_runtime_stats(kk_runtime_stats_t* stats, kk_context_t* ctx);
+
+// Live blocks per tag (KK_STATS only). Writes at most `max` entries for the tags with live blocks and
+// returns the number of entries; the name is NULL for user tags.
+kk_decl_export kk_ssize_t kk_runtime_stats_live(kk_ssize_t* tags, const char** names, int64_t* live, kk_ssize_t max, kk_context_t* ctx);
+
 // The current context is passed as a _ctx parameter in the generated code
 #define kk_context()  _ctx
 
@@ -441,18 +554,52 @@ static inline int32_t kk_marker_unique(kk_context_t* ctx) {
 kk_decl_export void kk_block_mark_shared( kk_block_t* b, kk_context_t* ctx );
 kk_decl_export void kk_box_mark_shared( kk_box_t b, kk_context_t* ctx );
 kk_decl_export void kk_box_mark_shared_recx(kk_box_t b, kk_context_t* ctx);
+kk_decl_export void kk_block_drop_set_parallel(kk_ssize_t latency_budget, kk_context_t* ctx);
+kk_decl_export void kk_block_mark_set_parallel(kk_ssize_t threshold, kk_context_t* ctx);
+kk_decl_export void     kk_block_make_immortal(kk_block_t* b, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_box_make_immortal(kk_box_t b, kk_context_t* ctx);
+kk_decl_export void kk_block_drop_set_deferred(bool enable, kk_context_t* ctx);
+kk_decl_export void kk_block_drop_set_prefetch(bool enable, kk_context_t* ctx);
+kk_decl_export bool kk_block_drop_deferred_flush(kk_context_t* ctx);
+kk_decl_export void kk_block_free_delayed_set(kk_ssize_t max_blocks, kk_usecs_t max_usecs, kk_context_t* ctx);
+kk_decl_export void kk_block_free_delayed(kk_context_t* ctx);
+kk_decl_export void kk_block_free_delayed_all(kk_context_t* ctx);
 
 /*--------------------------------------------------------------------------------------
   Allocation
 --------------------------------------------------------------------------------------*/
 
+// Allocation regions: while a region is active, small allocations are bump allocated
+// in an arena and freeing inside the region only updates a counter. Memory is reclaimed
+// when the region is popped (or when the last block that escaped the region is freed). 
+kk_decl_export void  kk_region_push(kk_context_t* ctx);
+kk_decl_export void  kk_region_pop(kk_context_t* ctx);
+kk_decl_export bool  kk_region_is_active(kk_context_t* ctx);
+kk_decl_export void* kk_region_malloc(kk_ssize_t sz, kk_context_t* ctx);
+kk_decl_export void* kk_region_realloc(void* p, kk_ssize_t sz, kk_context_t* ctx);
+kk_decl_export void  kk_region_free(const void* p, kk_context_t* ctx);
+
+#if (KK_INTPTR_SIZE >= 8)
+#define KK_REGION_ARENA_SIZE  (KK_IZ(4)*1024*1024*1024)   // reserved address space
+#else
+#define KK_REGION_ARENA_SIZE  (KK_IZ(256)*1024*1024)
+#endif
+
+extern uintptr_t kk_region_arena_base;
+
+static inline bool kk_is_region_ptr(const void* p) {
+  return (((uintptr_t)p & ~((uintptr_t)KK_REGION_ARENA_SIZE - 1)) == kk_region_arena_base);
+}
+
 #ifdef KK_MIMALLOC
 #ifdef KK_MIMALLOC_INLINE
   static inline void* kk_malloc_small(kk_ssize_t sz, kk_context_t* ctx) {
+    if (kk_unlikely(ctx->region != NULL)) return kk_region_malloc(sz, ctx);
     return kk_mi_heap_malloc_small_inline(ctx->heap, (size_t)sz);
   }
 #else
   static inline void* kk_malloc_small(kk_ssize_t sz, kk_context_t* ctx) {
+    if (kk_unlikely(ctx->region != NULL)) return kk_region_malloc(sz, ctx);
     return mi_heap_malloc_small(ctx->heap, (size_t)sz);
   } 
 #endif
@@ -468,12 +615,20 @@ static inline void* kk_zalloc(kk_ssize_t sz, kk_context_t* ctx) {
 
 static inline void* kk_realloc(void* p, kk_ssize_t sz, kk_context_t* ctx) {
   kk_unused(ctx);
+  if (kk_unlikely(kk_is_region_ptr(p))) return kk_region_realloc(p, sz, ctx);
   return mi_heap_realloc(ctx->heap, p, (size_t)sz);
 }
 
+// The usable size of an allocated block (at least the requested size), or 0 if unknown
+static inline kk_ssize_t kk_malloc_usable_size(const void* p) {
+  if (kk_unlikely(kk_is_region_ptr(p))) return 0;
+  return (kk_ssize_t)mi_usable_size(p);
+}
+
 static inline void kk_free(const void* p, kk_context_t* ctx) {
   // mi_unsafe_free_with_threadid((void*)p, ctx->thread_id);
   kk_unused(ctx);
+  if (kk_unlikely(kk_is_region_ptr(p))) { kk_region_free(p, ctx); return; }
   mi_free((void*)p);
 }
 
@@ -487,6 +642,7 @@ static inline void* kk_malloc(kk_ssize_t sz, kk_context_t* ctx) {
 }
 
 static inline void* kk_malloc_small(kk_ssize_t sz, kk_context_t* ctx) {
+  if (kk_unlikely(ctx->region != NULL)) return kk_region_malloc(sz, ctx);
   return kk_malloc(sz,ctx);
 }
 
@@ -497,11 +653,33 @@ static inline void* kk_zalloc(kk_ssize_t sz, kk_context_t* ctx) {
 
 static inline void* kk_realloc(void* p, kk_ssize_t sz, kk_context_t* ctx) {
   kk_unused(ctx);
+  if (kk_unlikely(kk_is_region_ptr(p))) return kk_region_realloc(p, sz, ctx);
   return realloc(p, (size_t)sz);
 }
 
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+// The usable size of an allocated block (at least the requested size), or 0 if unknown
+static inline kk_ssize_t kk_malloc_usable_size(const void* p) {
+  if (kk_unlikely(kk_is_region_ptr(p))) return 0;
+  #if defined(__GLIBC__)
+  return (kk_ssize_t)malloc_usable_size((void*)p);
+  #elif defined(__APPLE__)
+  return (kk_ssize_t)malloc_size(p);
+  #elif defined(_WIN32)
+  return (kk_ssize_t)_msize((void*)p);
+  #else
+  return 0;
+  #endif
+}
+
 static inline void kk_free(const void* p, kk_context_t* ctx) {
   kk_unused(ctx);
+  if (kk_unlikely(kk_is_region_ptr(p))) { kk_region_free(p, ctx); return; }
   free((void*)p);
 }
 
@@ -531,15 +709,26 @@ typedef kk_block_t* kk_reuse_t;
 
 #define kk_reuse_null  ((kk_reuse_t)NULL)
 
+// Profile reuse per allocation site (only if compiled with KK_STATS_REUSE; see `kk_reuse_sites_print`)
+#if KK_STATS_REUSE
+kk_decl_export void kk_reuse_site_alloc(const char* file, int line, bool reused);
+kk_decl_export void kk_reuse_site_drop(const char* file, int line);
+kk_decl_export void kk_reuse_sites_print(kk_context_t* ctx);
+#endif
+
 static inline kk_block_t* kk_block_alloc_at(kk_reuse_t at, kk_ssize_t size, kk_ssize_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize >= 0 && scan_fsize < KK_SCAN_FSIZE_MAX);
+  if (kk_unlikely(ctx->delayed_free != NULL)) { kk_block_free_delayed(ctx); }
   kk_block_t* b;
   if (at==kk_reuse_null) {
     b = (kk_block_t*)kk_malloc_small(size, ctx);
+    kk_stats_tag_inc(ctx, allocs, tag);
   }
   else {
     kk_assert_internal(kk_block_is_unique(at)); // TODO: check usable size of `at`
     b = at;
+    kk_stats_tag_inc(ctx, allocs, tag);
+    kk_stats_inc(ctx, alloc_reused);
   }
   kk_block_init(b, size, scan_fsize, tag);
   return b;
@@ -547,20 +736,26 @@ static inline kk_block_t* kk_block_alloc_at(kk_reuse_t at, kk_ssize_t size, kk_s
 
 static inline kk_block_t* kk_block_alloc(kk_ssize_t size, kk_ssize_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize >= 0 && scan_fsize < KK_SCAN_FSIZE_MAX);
+  if (kk_unlikely(ctx->delayed_free != NULL)) { kk_block_free_delayed(ctx); }
   kk_block_t* b = (kk_block_t*)kk_malloc_small(size, ctx);
+  kk_stats_tag_inc(ctx, allocs, tag);
   kk_block_init(b, size, scan_fsize, tag);
   return b;
 }
 
 static inline kk_block_t* kk_block_alloc_any(kk_ssize_t size, kk_ssize_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize >= 0 && scan_fsize < KK_SCAN_FSIZE_MAX);
+  if (kk_unlikely(ctx->delayed_free != NULL)) { kk_block_free_delayed(ctx); }
   kk_block_t* b = (kk_block_t*)kk_malloc(size, ctx);
+  kk_stats_tag_inc(ctx, allocs, tag);
   kk_block_init(b, size, scan_fsize, tag);
   return b;
 }
 
 static inline kk_block_large_t* kk_block_large_alloc(kk_ssize_t size, kk_ssize_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_block_large_t* b = (kk_block_large_t*)kk_malloc(size, ctx);
+  kk_probe2(large_alloc, size, tag);
+  kk_stats_tag_inc(ctx, allocs, tag);
   kk_block_large_init(b, size, scan_fsize, tag);
   return b;
 }
@@ -577,12 +772,21 @@ static inline kk_block_t* kk_block_assertx(kk_block_t* b, kk_tag_t tag) {
 }
 
 static inline void kk_block_free(kk_block_t* b, kk_context_t* ctx) {
+  kk_stats_tag_inc(ctx, frees, kk_block_tag(b));
   kk_block_set_invalid(b);
   kk_free(b, ctx);
 }
 
 #define kk_block_alloc_as(struct_tp,scan_fsize,tag,ctx)        ((struct_tp*)kk_block_alloc_at(kk_reuse_null, sizeof(struct_tp),scan_fsize,tag,ctx))
+#if KK_STATS_REUSE
+static inline kk_block_t* kk_block_alloc_at_site(kk_reuse_t at, kk_ssize_t size, kk_ssize_t scan_fsize, kk_tag_t tag, const char* file, int line, kk_context_t* ctx) {
+  kk_reuse_site_alloc(file, line, at != kk_reuse_null);
+  return kk_block_alloc_at(at, size, scan_fsize, tag, ctx);
+}
+#define kk_block_alloc_at_as(struct_tp,at,scan_fsize,tag,ctx)  ((struct_tp*)kk_block_alloc_at_site(at, sizeof(struct_tp),scan_fsize,tag,__FILE__,__LINE__,ctx))
+#else
 #define kk_block_alloc_at_as(struct_tp,at,scan_fsize,tag,ctx)  ((struct_tp*)kk_block_alloc_at(at, sizeof(struct_tp),scan_fsize,tag,ctx))
+#endif
 
 #define kk_block_as(tp,b)             ((tp)((void*)(b)))
 #define kk_block_assert(tp,b,tag)     ((tp)kk_block_assertx(b,tag))
@@ -610,6 +814,7 @@ static inline kk_block_t* kk_block_dup(kk_block_t* b) {
   kk_assert_internal(kk_block_is_valid(b));
   const kk_refcount_t rc = kk_block_refcount(b);
   if (kk_unlikely(kk_refcount_is_thread_shared(rc))) {  // (signed)rc < 0 
+    if (kk_refcount_is_immortal(rc)) return b;          // static or immortal
     return kk_block_check_dup(b, rc);                   // thread-shared or sticky (overflow) ?
   }
   else {
@@ -623,6 +828,7 @@ static inline void kk_block_drop(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
   const kk_refcount_t rc = kk_block_refcount(b);
   if (kk_refcount_is_unique_or_thread_shared(rc)) {  // (signed)rc <= 0
+    if (kk_refcount_is_immortal(rc)) return;  // static or immortal
     kk_block_check_drop(b, rc, ctx);    // thread-shared, sticky (overflowed), or can be freed?
   }
   else {
@@ -638,6 +844,7 @@ static inline void kk_block_decref(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
   const kk_refcount_t rc = b->header.refcount;  
   if (kk_unlikely(kk_refcount_is_unique_or_thread_shared(rc))) {  // (signed)rc <= 0
+    if (kk_refcount_is_immortal(rc)) return;  // static or immortal
     kk_block_check_decref(b, rc, ctx);  // thread-shared, sticky (overflowed), or can be freed? 
   }
   else {
@@ -654,6 +861,7 @@ static inline kk_reuse_t kk_block_drop_reuse(kk_block_t* b, kk_context_t* ctx) {
   }
   else {
     kk_block_refcount_set(b, rc-1);
+    kk_stats_inc(ctx, reuse_miss);
     return kk_reuse_null;
   }
 }
@@ -673,6 +881,7 @@ static inline void kk_block_dropi(kk_block_t* b, kk_context_t* ctx) {
     kk_block_free(b,ctx);
   }
   else if (kk_unlikely(kk_refcount_is_thread_shared(rc))) {  // (signed)rc < 0
+    if (kk_refcount_is_immortal(rc)) return;                 // static or immortal
     kk_block_check_drop(b, rc, ctx);                         // thread-share or sticky (overflowed) ?    
   }
   else {
@@ -709,6 +918,7 @@ static inline void kk_block_dropn(kk_block_t* b, kk_ssize_t scan_fsize, kk_conte
     kk_block_free(b,ctx);
   }
   else if (kk_unlikely(kk_refcount_is_thread_shared(rc))) {  // (signed)rc < 0
+    if (kk_refcount_is_immortal(rc)) return;                 // static or immortal
     kk_block_check_drop(b, rc, ctx);                         // thread-shared, sticky (overflowed)?
   }
   else {
@@ -730,7 +940,9 @@ static inline kk_reuse_t kk_block_dropn_reuse(kk_block_t* b, kk_ssize_t scan_fsi
     return b;
   }
   else if (kk_unlikely(kk_refcount_is_thread_shared(rc))) {  // (signed)rc < 0
-    kk_block_check_drop(b, rc, ctx);                         // thread-shared or sticky (overflowed)?
+    if (!kk_refcount_is_immortal(rc)) {                      // static or immortal?
+      kk_block_check_drop(b, rc, ctx);                       // thread-shared or sticky (overflowed)?
+    }
     return kk_reuse_null;
   }
   else {
@@ -759,6 +971,14 @@ static inline void kk_reuse_drop(kk_reuse_t r, kk_context_t* ctx) {
   }
 }
 
+#if KK_STATS_REUSE
+static inline void kk_reuse_drop_site(kk_reuse_t r, const char* file, int line, kk_context_t* ctx) {
+  if (r != NULL) { kk_reuse_site_drop(file, line); }
+  kk_reuse_drop(r, ctx);
+}
+#define kk_reuse_drop(r,ctx)  kk_reuse_drop_site(r,__FILE__,__LINE__,ctx)
+#endif
+
 
 /*--------------------------------------------------------------------------------------
   Datatype and Constructor macros
@@ -995,8 +1215,14 @@ typedef enum kk_unit_e {
 #include "kklib/bytes.h"
 #include "kklib/string.h"
 #include "kklib/random.h"
+#include "kklib/uvector.h"
+#include "kklib/hash.h"
+#include "kklib/hashmap.h"
+#include "kklib/image.h"
+#include "kklib/profile.h"
 #include "kklib/os.h"
 #include "kklib/thread.h"
+#include "kklib/evloop.h"
 
 
 /*----------------------------------------------------------------------
@@ -1154,7 +1380,8 @@ static inline kk_function_t kk_function_dup(kk_function_t f) {
 
 typedef struct kk_vector_large_s {  // always use a large block for a vector so the offset to the elements is fixed
   struct kk_block_large_s _base;
-  kk_box_t                vec[1];               // vec[(large_)scan_fsize - 1]
+  kk_box_t                capacity;             // boxed capacity of `vec` (a value so it is skipped when scanning)
+  kk_box_t                vec[1];               // vec[(large_)scan_fsize - 2], followed by unused entries up to the capacity
 } *kk_vector_large_t;
 
 
@@ -1187,8 +1414,9 @@ static inline kk_vector_t kk_vector_alloc_uninit(kk_ssize_t length, kk_box_t** b
   else {
     kk_vector_large_t v = (kk_vector_large_t)kk_block_large_alloc(
         kk_ssizeof(struct kk_vector_large_s) + (length-1)*kk_ssizeof(kk_box_t),  // length-1 as the vector_large_s already includes one element 
-        length + 1, // +1 to include the kk_large_scan_fsize field itself 
+        length + 2, // +2 to include the kk_large_scan_fsize and capacity fields
         KK_TAG_VECTOR, ctx);
+    v->capacity = kk_intf_box(length);
     if (buf != NULL) *buf = &v->vec[0];
     return kk_datatype_from_base(&v->_base);
   }
@@ -1212,8 +1440,8 @@ static inline kk_box_t* kk_vector_buf_borrow(kk_vector_t vd, kk_ssize_t* len) {
   }
   else {
     if (len != NULL) {
-      *len = (kk_ssize_t)kk_intf_unbox(v->_base.large_scan_fsize) - 1;  // exclude the large scan_fsize field itself
-      kk_assert_internal(*len + 1 == kk_block_scan_fsize(&v->_base._block));
+      *len = (kk_ssize_t)kk_intf_unbox(v->_base.large_scan_fsize) - 2;  // exclude the large scan_fsize and capacity fields
+      kk_assert_internal(*len + 2 == kk_block_scan_fsize(&v->_base._block));
       kk_assert_internal(*len > 0);
     }
     return &(v->vec[0]);
@@ -1261,6 +1489,8 @@ typedef struct kk_ref_s {
 kk_decl_export kk_box_t  kk_ref_get_thread_shared(kk_ref_t r, kk_context_t* ctx);
 kk_decl_export kk_box_t  kk_ref_swap_thread_shared_borrow(kk_ref_t r, kk_box_t value);
 kk_decl_export kk_unit_t kk_ref_vector_assign_borrow(kk_ref_t r, kk_integer_t idx, kk_box_t value, kk_context_t* ctx);
+kk_decl_export bool      kk_ref_compare_exchange_borrow(kk_ref_t r, kk_box_t expected, kk_box_t desired, kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_ref_fetch_update_borrow(kk_ref_t r, kk_function_t f, kk_context_t* ctx);
 
 static inline kk_decl_const kk_box_t kk_ref_box(kk_ref_t r, kk_context_t* ctx) {
   kk_unused(ctx);
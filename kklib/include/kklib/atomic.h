@@ -30,17 +30,27 @@
 #define kk_atomic_store_relaxed(p,x)        kk_atomic(store_explicit)(p,x,kk_memory_order(relaxed))
 #define kk_atomic_store_release(p,x)        kk_atomic(store_explicit)(p,x,kk_memory_order(release))
 
+#define kk_atomic_load_seq_cst(p)           kk_atomic(load_explicit)(p,kk_memory_order(seq_cst))
+#define kk_atomic_store_seq_cst(p,x)        kk_atomic(store_explicit)(p,x,kk_memory_order(seq_cst))
+
 #define kk_atomic_fence_acquire()           kk_atomic(thread_fence)(kk_memory_order(acquire))
+#define kk_atomic_fence_release()           kk_atomic(thread_fence)(kk_memory_order(release))
+#define kk_atomic_fence_seq_cst()           kk_atomic(thread_fence)(kk_memory_order(seq_cst))
 
 #define kk_atomic_cas_weak_relaxed(p,exp,des)   kk_atomic(compare_exchange_weak_explicit)(p,exp,des,kk_memory_order(relaxed),kk_memory_order(relaxed))
 #define kk_atomic_cas_weak_acq_rel(p,exp,des)   kk_atomic(compare_exchange_weak_explicit)(p,exp,des,kk_memory_order(acq_rel),kk_memory_order(acquire))
 #define kk_atomic_cas_strong_relaxed(p,exp,des) kk_atomic(compare_exchange_strong_explicit)(p,exp,des,kk_memory_order(relaxed),kk_memory_order(relaxed))
 #define kk_atomic_cas_strong_acq_rel(p,exp,des) kk_atomic(compare_exchange_strong_explicit)(p,exp,des,kk_memory_order(acq_rel),kk_memory_order(acquire))
+#define kk_atomic_cas_strong_seq_cst(p,exp,des) kk_atomic(compare_exchange_strong_explicit)(p,exp,des,kk_memory_order(seq_cst),kk_memory_order(relaxed))
+
+#define kk_atomic_exchange_acq_rel(p,x)     kk_atomic(exchange_explicit)(p,x,kk_memory_order(acq_rel))
 
 #define kk_atomic_add_relaxed(p,x)          kk_atomic(fetch_add_explicit)(p,x,kk_memory_order(relaxed))
 #define kk_atomic_add_release(p,x)          kk_atomic(fetch_add_explicit)(p,x,kk_memory_order(release))
 #define kk_atomic_sub_relaxed(p,x)          kk_atomic(fetch_sub_explicit)(p,x,kk_memory_order(relaxed))
 #define kk_atomic_sub_release(p,x)          kk_atomic(fetch_sub_explicit)(p,x,kk_memory_order(release))
+#define kk_atomic_add_acq_rel(p,x)          kk_atomic(fetch_add_explicit)(p,x,kk_memory_order(acq_rel))
+#define kk_atomic_sub_acq_rel(p,x)          kk_atomic(fetch_sub_explicit)(p,x,kk_memory_order(acq_rel))
 
 #define kk_atomic_inc_relaxed(p)            kk_atomic_add_relaxed(p,1)
 #define kk_atomic_inc_release(p)            kk_atomic_add_release(p,1)
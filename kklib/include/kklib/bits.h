@@ -24,6 +24,10 @@
 #endif
 #endif
 
+#if defined(KK_ARCH_X64_SIMD)
+extern bool kk_has_ssse3;  // initialized in init.c
+extern bool kk_has_avx2;
+#endif
 
 #if (KK_INTX_SIZE==4)
 #define kk_bitsx(name)  kk_bits_##name##32
@@ -381,7 +385,7 @@ static inline kk_uintx_t kk_bits_bswap(kk_uintx_t u) {
   Endian neutral
 ------------------------------------------------------------------ */
 
-#if defined(KK_IS_LITTLE_ENDIAN)
+#if defined(KK_ARCH_LITTLE_ENDIAN)
 #define KK_BITS_BSWAP_IF_BE(b,u) (u)
 #define KK_BITS_BSWAP_IF_LE(b,u) kk_bits_bswap##b(u)
 #else
@@ -508,6 +512,33 @@ static inline bool kk_bits_count_is_even(kk_uintx_t x) {
   return kk_bitsx(count_is_even)(x);
 }
 
+/* ---------------------------------------------------------------
+  Full multiplication: returns the low 64 bits of `x*y` and the high 64 bits in `*hi`
+------------------------------------------------------------------ */
+
+#if (KK_INTPTR_SIZE >= 8) && defined(__GNUC__)
+static inline uint64_t kk_bits_umul128(uint64_t x, uint64_t y, uint64_t* hi) {
+  __extension__ typedef unsigned __int128 kk_uint128_t;
+  const kk_uint128_t r = (kk_uint128_t)x * y;
+  *hi = (uint64_t)(r >> 64);
+  return (uint64_t)r;
+}
+#elif defined(_MSC_VER) && defined(_M_X64)
+static inline uint64_t kk_bits_umul128(uint64_t x, uint64_t y, uint64_t* hi) {
+  return _umul128(x, y, hi);
+}
+#else
+static inline uint64_t kk_bits_umul128(uint64_t x, uint64_t y, uint64_t* hi) {
+  const uint64_t hx = (x >> 32), lx = (uint32_t)x;
+  const uint64_t hy = (y >> 32), ly = (uint32_t)y;
+  const uint64_t rh = hx*hy, rm0 = hx*ly, rm1 = hy*lx, rl = lx*ly;
+  const uint64_t t  = rl + (rm0 << 32);
+  const uint64_t lo = t + (rm1 << 32);
+  *hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl ? 1 : 0) + (lo < t ? 1 : 0);
+  return lo;
+}
+#endif
+
 /* ---------------------------------------------------------------
   Digits in a decimal representation
 ------------------------------------------------------------------ */
@@ -219,7 +219,33 @@ static inline kk_box_t kk_int16_box(int16_t i, kk_context_t* ctx) {
 }
 #endif
 
-#if (KK_INTPTR_SIZE == 8) && KK_BOX_DOUBLE64
+#if (KK_INTPTR_SIZE == 8) && (KK_BOX_DOUBLE64 == 1)
+kk_decl_export kk_box_t kk_double_box_slow(double d, kk_context_t* ctx);
+kk_decl_export double   kk_double_unbox_slow(kk_box_t b, kk_context_t* ctx);
+
+// Strategy A1 with an inline fast path: we rotate the sign and exponent into the low 12 bits
+// and for exponents in [0x201,0x5FE] (absolute values in [2^-510,2^512)) the 10-bit boxed
+// exponent is `exp - 0x200` at bits 1 to 10 which comes down to `u + exp - 0x3FF`.
+// Zero, subnormals, infinities, NaN, and doubles outside the range use `kk_double_box_slow`.
+static inline kk_box_t kk_double_box(double d, kk_context_t* ctx) {
+  const uint64_t u = kk_bits_rotl64(kk_bits_from_double(d), 12);
+  const uint64_t exp = (u & 0x7FF);
+  if (kk_likely(exp - 0x201 < 0x3FE)) {
+    kk_box_t b = { (uintptr_t)(u + exp - 0x3FF) };
+    return b;
+  }
+  return kk_double_box_slow(d, ctx);
+}
+
+static inline double kk_double_unbox(kk_box_t b, kk_context_t* ctx) {
+  const uint64_t exp10 = ((uint64_t)b.box & 0x7FF) >> 1;
+  if (kk_likely(kk_box_is_value(b) && exp10 - 1 < 0x3FE)) {
+    const uint64_t u = (uint64_t)b.box - (exp10 + 0x200) + 0x3FF;
+    return kk_bits_to_double(kk_bits_rotr64(u, 12));
+  }
+  return kk_double_unbox_slow(b, ctx);
+}
+#elif (KK_INTPTR_SIZE == 8) && KK_BOX_DOUBLE64
 kk_decl_export kk_box_t kk_double_box(double d, kk_context_t* ctx);
 kk_decl_export double   kk_double_unbox(kk_box_t b, kk_context_t* ctx);
 #else
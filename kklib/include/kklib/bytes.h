@@ -17,6 +17,10 @@
   - small byte sequence of at most 7 bytes (ending in a zero byte not included in the length)
   - normal sequence of bytes (ending in a zero byte not included in the length)
   - raw bytes, pointing to an (external) sequence of bytes.
+  - rope bytes, the concatenation of two byte sequences. This makes repeated concatenation
+    linear: the bytes are only copied into a single (normal) sequence once they are accessed.
+  - slice bytes, a sub-sequence that shares the bytes of a normal sequence. As this is not
+    necessarily followed by a zero byte, use `kk_bytes_cbuf_borrow` when a C string is needed.
   
   These are not necessarily canonical (e.g. a normal or small bytes can have length 0 instead of being an empty singleton)
 -------------------------------------------------------------------------------------------------------------*/
@@ -57,6 +61,32 @@ typedef struct kk_bytes_raw_s {
   kk_ssize_t        clength;
 } *kk_bytes_raw_t;
 
+// A rope is only created by `kk_bytes_cat` when the result is at least `KK_BYTES_ROPE_MIN` bytes,
+// and its `right` part is never a rope itself (so flattening only iterates along the left spine).
+// The `flat` field is initially empty and set to the flattened normal bytes on the first borrow.
+#define KK_BYTES_ROPE_MIN  (256)
+typedef struct kk_bytes_rope_s {
+  struct kk_bytes_s _base;
+  _Atomic(uintptr_t) flat;    // `kk_bytes_t`: empty or the flattened bytes (set atomically if the rope is thread-shared)
+  kk_bytes_t left;
+  kk_bytes_t right;
+  kk_ssize_t length;          // total length of `left` and `right` (not scanned)
+} *kk_bytes_rope_t;
+#define KK_BYTES_ROPE_SCAN_FSIZE  (3)
+
+// A slice is only created by `kk_bytes_slice_borrow` for at least `KK_BYTES_SLICE_MIN` bytes
+// (from where a slice takes less space than a copy) and its `parent` is always normal bytes.
+// The `cstr` field is initially empty and set to a zero terminated copy on demand.
+#define KK_BYTES_SLICE_MIN  (32)
+typedef struct kk_bytes_slice_s {
+  struct kk_bytes_s _base;
+  kk_bytes_t parent;
+  _Atomic(uintptr_t) cstr;    // `kk_bytes_t`: empty or a zero terminated copy (set atomically if the slice is thread-shared)
+  const uint8_t* buf;         // points into `parent` (not scanned)
+  kk_ssize_t length;
+} *kk_bytes_slice_t;
+#define KK_BYTES_SLICE_SCAN_FSIZE  (2)
+
 // Define bytes literals
 #define kk_define_bytes_literal(decl,name,len,init) \
   static struct { struct kk_bytes_s _base; kk_ssize_t length; uint8_t buf[len+1]; } _static_##name = \
@@ -120,6 +150,9 @@ static inline kk_bytes_t kk_bytes_alloc_raw_len(kk_ssize_t len, const uint8_t* p
   return kk_datatype_from_base(&br->_base);
 }
 
+kk_decl_export const uint8_t* kk_bytes_rope_flatten(kk_bytes_rope_t rope);
+kk_decl_export const char*    kk_bytes_slice_cstr(kk_bytes_slice_t slice);
+
 // Get access to the bytes via a pointer (and retrieve the length as well)
 static inline const uint8_t* kk_bytes_buf_borrow(const kk_bytes_t b, kk_ssize_t* len) {
   static const uint8_t empty[16] = { 0 };
@@ -146,6 +179,16 @@ static inline const uint8_t* kk_bytes_buf_borrow(const kk_bytes_t b, kk_ssize_t*
     if (len != NULL) *len = bn->length;
     return &bn->buf[0];
   }
+  else if (tag == KK_TAG_BYTES_ROPE) {
+    kk_bytes_rope_t rope = kk_datatype_as_assert(kk_bytes_rope_t, b, KK_TAG_BYTES_ROPE);
+    if (len != NULL) *len = rope->length;
+    return kk_bytes_rope_flatten(rope);
+  }
+  else if (tag == KK_TAG_BYTES_SLICE) {
+    kk_bytes_slice_t slice = kk_datatype_as_assert(kk_bytes_slice_t, b, KK_TAG_BYTES_SLICE);
+    if (len != NULL) *len = slice->length;
+    return slice->buf;
+  }
   else {
     kk_bytes_raw_t br = kk_datatype_as_assert(kk_bytes_raw_t, b, KK_TAG_BYTES_RAW);
     if (len != NULL) *len = br->clength;
@@ -153,10 +196,22 @@ static inline const uint8_t* kk_bytes_buf_borrow(const kk_bytes_t b, kk_ssize_t*
   }
 }
 
+// Get access to the bytes as a zero terminated C string (and retrieve the length as well)
 static inline const char* kk_bytes_cbuf_borrow(const kk_bytes_t b, kk_ssize_t* len) {
+  if (kk_unlikely(kk_datatype_has_tag(b, KK_TAG_BYTES_SLICE))) {
+    kk_bytes_slice_t slice = kk_datatype_as_assert(kk_bytes_slice_t, b, KK_TAG_BYTES_SLICE);
+    if (len != NULL) *len = slice->length;
+    return kk_bytes_slice_cstr(slice);
+  }
   return (const char*)kk_bytes_buf_borrow(b, len);
 }
 
+// Can we update the bytes in-place? (only for unique small or normal bytes)
+static inline bool kk_bytes_is_unique_mutable(kk_bytes_t b) {
+  return (kk_datatype_is_ptr(b) && kk_datatype_is_unique(b) &&
+          (kk_datatype_has_tag(b, KK_TAG_BYTES) || kk_datatype_has_tag(b, KK_TAG_BYTES_SMALL)));
+}
+
 
 
 /*--------------------------------------------------------------------------------------------------
@@ -164,6 +219,9 @@ static inline const char* kk_bytes_cbuf_borrow(const kk_bytes_t b, kk_ssize_t* l
 --------------------------------------------------------------------------------------------------*/
 
 static inline kk_ssize_t kk_decl_pure kk_bytes_len_borrow(const kk_bytes_t b) {
+  if (kk_datatype_has_tag(b, KK_TAG_BYTES_ROPE)) {  // don't flatten
+    return kk_datatype_as_assert(kk_bytes_rope_t, b, KK_TAG_BYTES_ROPE)->length;
+  }
   kk_ssize_t len;
   kk_bytes_buf_borrow(b, &len);
   return len;
@@ -180,7 +238,7 @@ static inline bool kk_bytes_is_empty(kk_bytes_t s, kk_context_t* ctx) {
 }
 
 static inline kk_bytes_t kk_bytes_copy(kk_bytes_t b, kk_context_t* ctx) {
-  if (kk_datatype_is_singleton(b) || kk_datatype_is_unique(b)) {
+  if (kk_datatype_is_singleton(b) || kk_bytes_is_unique_mutable(b)) {
     return b;
   }
   else {
@@ -240,6 +298,7 @@ static inline int kk_memcmp(const void* s, const void* t, kk_ssize_t len) {
 kk_decl_export kk_ssize_t kk_decl_pure kk_bytes_count_pattern_borrow(kk_bytes_t str, kk_bytes_t pattern);
 
 kk_decl_export kk_bytes_t kk_bytes_cat(kk_bytes_t s1, kk_bytes_t s2, kk_context_t* ctx);
+kk_decl_export kk_bytes_t kk_bytes_slice_borrow(kk_bytes_t b, kk_ssize_t start, kk_ssize_t len, kk_context_t* ctx);
 kk_decl_export kk_bytes_t kk_bytes_cat_from_buf(kk_bytes_t s1, kk_ssize_t len2, const uint8_t* buf2, kk_context_t* ctx);
 
 kk_decl_export kk_vector_t kk_bytes_splitv(kk_bytes_t s, kk_bytes_t sep, kk_context_t* ctx);
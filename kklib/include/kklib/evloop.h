@@ -0,0 +1,38 @@
+#pragma once
+#ifndef KK_EVLOOP_H
+#define KK_EVLOOP_H
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Event loop for asynchronous I/O (see `evloop.c`)
+
+  Each thread has its own event loop that is created on demand. Operations on a file
+  descriptor are submitted with a Koka callback that is called from `kk_evloop_run` once the
+  operation completes; the callback typically resumes the continuation of an `await`.
+  At most one read (or accept) and one write can be outstanding per file descriptor.
+  Submitting returns `0` on success or an error code (and never calls the callback directly).
+
+  - read:   `cb : (err : int, chunk : string) -> io ()` where `chunk` is empty at the end of the input.
+  - write:  `cb : (err : int, written : int) -> io ()`.
+  - accept: `cb : (err : int, fd : int) -> io ()`.
+  - timer:  `cb : () -> io ()`.
+--------------------------------------------------------------------------------------*/
+
+kk_decl_export int  kk_evloop_read(int fd, kk_ssize_t max, kk_function_t cb, kk_context_t* ctx);
+kk_decl_export int  kk_evloop_write(int fd, kk_bytes_t content, kk_function_t cb, kk_context_t* ctx);
+kk_decl_export int  kk_evloop_accept(int fd, kk_function_t cb, kk_context_t* ctx);
+kk_decl_export int  kk_evloop_timer(kk_msecs_t timeout, kk_function_t cb, kk_context_t* ctx);
+
+kk_decl_export kk_ssize_t kk_evloop_poll(kk_msecs_t timeout, kk_context_t* ctx);  // returns the number of completed operations
+kk_decl_export int        kk_evloop_run(kk_context_t* ctx);                       // run until no operations are outstanding
+kk_decl_export kk_ssize_t kk_evloop_pending(kk_context_t* ctx);
+
+kk_decl_export void kk_evloop_free(kk_context_t* ctx);
+
+#endif // include guard
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef KK_HASH_H
+#define KK_HASH_H
+
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Hashing of bytes, strings, and integers (see `hash.c`), used by the hash maps in `hashmap.h`.
+  Hashes are 64-bit and based on wyhash. They are seeded with a random per process seed
+  (from `kk_srandom`) so an adversary cannot easily construct colliding keys; as such,
+  hashes are only stable within one process.
+--------------------------------------------------------------------------------------*/
+
+// Multiply to 128 bits: `*a` becomes the low half and `*b` the high half of `*a * *b`
+static inline void kk_hash_mum(uint64_t* a, uint64_t* b) {
+  *a = kk_bits_umul128(*a, *b, b);
+}
+
+// Multiply to 128 bits and fold the result by xor'ing the high and low half
+static inline uint64_t kk_hash_wymix(uint64_t a, uint64_t b) {
+  kk_hash_mum(&a, &b);
+  return (a ^ b);
+}
+
+#define KK_HASH_SECRET0  KK_U64(0x2d358dccaa6c78a5)
+#define KK_HASH_SECRET1  KK_U64(0x8bb84b93962eacc9)
+#define KK_HASH_SECRET2  KK_U64(0x4b33a62ed433d4a3)
+#define KK_HASH_SECRET3  KK_U64(0x4d5a2da51de1aa47)
+
+kk_decl_export uint64_t kk_hash_seed_init(kk_context_t* ctx);
+kk_decl_export uint64_t kk_hash_process_seed_get(kk_context_t* ctx);
+kk_decl_export bool     kk_hash_process_seed_set(uint64_t seed, kk_context_t* ctx);
+kk_decl_export uint64_t kk_hash_buf(const uint8_t* buf, kk_ssize_t len, uint64_t seed);
+kk_decl_export uint64_t kk_hash_bigint_borrow(kk_integer_t i, kk_context_t* ctx);
+
+// The per process hash seed (never 0)
+static inline uint64_t kk_hash_seed(kk_context_t* ctx) {
+  const uint64_t seed = ctx->hash_seed;
+  return (kk_likely(seed != 0) ? seed : kk_hash_seed_init(ctx));
+}
+
+// Hash a single word in one multiply
+static inline uint64_t kk_hash_word(uint64_t w, uint64_t seed) {
+  return kk_hash_wymix(w ^ KK_HASH_SECRET1, seed ^ KK_HASH_SECRET0);
+}
+
+static inline uint64_t kk_hash_bytes_borrow(kk_bytes_t b, kk_context_t* ctx) {
+  const uint64_t seed = kk_hash_seed(ctx);
+  if (kk_datatype_has_tag(b, KK_TAG_BYTES_SMALL)) {
+    // the padded small bytes are hashed as one word (and `kk_hash_buf` pads short buffers in the same way)
+    const kk_bytes_small_t bs = kk_datatype_as_assert(kk_bytes_small_t, b, KK_TAG_BYTES_SMALL);
+    return kk_hash_word(bs->u.buf_value, seed);
+  }
+  kk_ssize_t len;
+  const uint8_t* buf = kk_bytes_buf_borrow(b, &len);
+  return kk_hash_buf(buf, len, seed);
+}
+
+static inline uint64_t kk_hash_string_borrow(kk_string_t s, kk_context_t* ctx) {
+  return kk_hash_bytes_borrow(s.bytes, ctx);
+}
+
+static inline uint64_t kk_hash_integer_borrow(kk_integer_t i, kk_context_t* ctx) {
+  if (kk_likely(kk_is_smallint(i))) return kk_hash_word((uint64_t)kk_smallint_from_integer(i), kk_hash_seed(ctx));
+  return kk_hash_bigint_borrow(i, ctx);
+}
+
+#endif // include guard
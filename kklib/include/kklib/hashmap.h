@@ -0,0 +1,111 @@
+#pragma once
+#ifndef KK_HASHMAP_H
+#define KK_HASHMAP_H
+
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Hash maps with `int` or `string` keys (see `hashmap.c`, `std/data/map`, and `std/data/dict`)
+
+  - A HAMT (hash array mapped trie) is a persistent map. Each node has a 32-bit bitmap of the
+    entries stored inline and one of the child nodes, indexed by popcount (as in CHAMP).
+    An update copies the path to the key, except for nodes that are unique which are updated
+    in place. The root block holds the count and the top node.
+  - A Swiss table is an open-addressing hash table with a control byte per slot that holds
+    7 bits of the hash; a group of 16 control bytes is probed at once. It is meant for single
+    owner use: updates are in place when the table is unique and copy the whole table otherwise.
+
+  Both store their keys and values as (scanned) boxed fields. The key type is not stored
+  but passed to each operation (as the Koka wrappers know it statically).
+  All functions consume the map and return the updated map, except the `_borrow` ones.
+  Insertion consumes the key and value; the key is borrowed for a removal or lookup.
+--------------------------------------------------------------------------------------*/
+
+typedef enum kk_hash_key_e {
+  KK_HASH_KEY_INT,
+  KK_HASH_KEY_STRING
+} kk_hash_key_t;
+
+static inline uint64_t kk_hash_key_borrow(kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  if (kind == KK_HASH_KEY_INT) return kk_hash_integer_borrow(kk_integer_unbox(key), ctx);
+                          else return kk_hash_string_borrow(kk_string_unbox(key), ctx);
+}
+
+static inline bool kk_hash_key_eq_borrow(kk_box_t key1, kk_box_t key2, kk_hash_key_t kind, kk_context_t* ctx) {
+  if (key1.box == key2.box) return true;
+  if (kind == KK_HASH_KEY_INT) return kk_integer_eq_borrow(kk_integer_unbox(key1), kk_integer_unbox(key2), ctx);
+                          else return kk_string_is_eq_borrow(kk_string_unbox(key1), kk_string_unbox(key2));
+}
+
+// Called for each entry when iterating through a map (with borrowed key and value)
+typedef void (kk_hashmap_visit_fun_t)(kk_box_t key, kk_box_t value, void* arg, kk_context_t* ctx);
+
+
+/*--------------------------------------------------------------------------------------
+  HAMT
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_hamt_s {
+  kk_block_t  _block;
+  kk_box_t    root;     // the top `kk_hamt_node_t`
+  kk_ssize_t  count;    // number of entries
+} *kk_hamt_t;
+
+static inline kk_hamt_t kk_hamt_unbox_borrow(kk_box_t m) {
+  return kk_basetype_unbox_as_assert(kk_hamt_t, m, KK_TAG_HAMT);
+}
+
+static inline kk_ssize_t kk_hamt_count_borrow(kk_box_t m) {
+  return kk_hamt_unbox_borrow(m)->count;
+}
+
+kk_decl_export kk_box_t  kk_hamt_empty(kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_hamt_insert(kk_box_t m, kk_box_t key, kk_box_t value, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_hamt_remove(kk_box_t m, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export kk_box_t* kk_hamt_lookup_borrow(kk_box_t m, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export void      kk_hamt_foreach_borrow(kk_box_t m, kk_hashmap_visit_fun_t* visit, void* arg, kk_context_t* ctx);
+
+
+/*--------------------------------------------------------------------------------------
+  Swiss table
+--------------------------------------------------------------------------------------*/
+
+#define KK_SWISS_GROUP  (16)
+
+typedef struct kk_swiss_s {
+  kk_block_large_t  _block;    // the scan size is `1 + 2*capacity`
+  kk_box_t          slots[1];  // key/value pairs (an empty slot has `kk_box_null` fields); followed by a `kk_swiss_info_t`
+} *kk_swiss_t;
+
+typedef struct kk_swiss_info_s {
+  kk_ssize_t  capacity;        // number of slots (a power of 2, at least `KK_SWISS_GROUP`)
+  kk_ssize_t  count;           // number of entries
+  kk_ssize_t  free;            // number of entries that can be inserted before we need to resize
+  uint8_t     ctrl[1];         // `capacity + KK_SWISS_GROUP` control bytes (the last group mirrors the first)
+} kk_swiss_info_t;
+
+static inline kk_swiss_t kk_swiss_unbox_borrow(kk_box_t d) {
+  return kk_basetype_unbox_as_assert(kk_swiss_t, d, KK_TAG_SWISS);
+}
+
+static inline kk_swiss_info_t* kk_swiss_info(kk_swiss_t t) {
+  return (kk_swiss_info_t*)&t->slots[kk_block_scan_fsize(&t->_block._block) - 1];
+}
+
+static inline kk_ssize_t kk_swiss_count_borrow(kk_box_t d) {
+  return kk_swiss_info(kk_swiss_unbox_borrow(d))->count;
+}
+
+kk_decl_export kk_box_t  kk_swiss_empty(kk_ssize_t capacity, kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_swiss_insert(kk_box_t d, kk_box_t key, kk_box_t value, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_swiss_remove(kk_box_t d, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export kk_box_t* kk_swiss_lookup_borrow(kk_box_t d, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx);
+kk_decl_export void      kk_swiss_foreach_borrow(kk_box_t d, kk_hashmap_visit_fun_t* visit, void* arg, kk_context_t* ctx);
+
+#endif // include guard
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef KK_IMAGE_H
+#define KK_IMAGE_H
+
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Heap images (see `image.c`, and `kk_os_write_image_file`/`kk_os_read_image_file` in `os.c`)
+
+  An image is a serialized copy of the blocks reachable from a root value that can be
+  mapped back into memory directly. The blocks keep their header (tag and `scan_fsize`)
+  and layout but are immortal, so reference counting never writes to them. Pointers are
+  stored relative to a preferred base address: if the image is mapped at that address it
+  can be used as is, and otherwise it is relocated once in a single pass.
+  An image is only valid for the same build of a program (as constructor tags and layouts
+  are not checked), and it cannot contain mutable references, functions, or C pointers.
+--------------------------------------------------------------------------------------*/
+
+#define KK_IMAGE_MAGIC    KK_U64(0x31676D696B6B)  // "kkimg1"
+#define KK_IMAGE_VERSION  (1)
+
+typedef struct kk_image_header_s {
+  uint64_t    magic;
+  uint32_t    version;
+  uint16_t    intptr_size;  // `KK_INTPTR_SIZE` of the writer
+  uint16_t    intf_size;    // `KK_INTF_SIZE` of the writer
+  uint64_t    base;         // preferred address of the image; block pointers are relative to it
+  uint64_t    size;         // total size of the image in bytes
+  uint64_t    count;        // number of blocks
+  uint64_t    hash_seed;    // the process hash seed if the image contains hash maps (or 0)
+  kk_box_t    root;         // the root value (a pointer is relative to `base`)
+  uint64_t    reserved;
+} kk_image_header_t;
+
+// Each block in an image is preceded by its size in bytes (a multiple of 8)
+#define KK_IMAGE_ALIGN  (8)
+
+// Create an image of the blocks reachable from `root` (borrowed) in a fresh `kk_malloc`'d buffer.
+kk_decl_export int kk_image_create(kk_box_t root, uint8_t** image, kk_ssize_t* len, kk_context_t* ctx);
+
+// Load an image in place (at `image` of `len` bytes) and return its root. The memory must
+// be writable if it is not at the preferred `kk_image_base` (as the pointers are relocated)
+// and should stay valid for the rest of the process.
+kk_decl_export int kk_image_load(uint8_t* image, kk_ssize_t len, kk_box_t* root, kk_context_t* ctx);
+
+// The preferred address of an image (or NULL if the header is invalid)
+kk_decl_export void* kk_image_base(const uint8_t* image, kk_ssize_t len);
+
+#endif // include guard
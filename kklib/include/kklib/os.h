@@ -24,19 +24,34 @@ kk_decl_export kk_vector_t kk_os_get_env(kk_context_t* ctx);
 
 kk_decl_export int  kk_os_read_line(kk_string_t* result, kk_context_t* ctx);
 kk_decl_export int  kk_os_read_text_file(kk_string_t path, kk_string_t* result, kk_context_t* ctx);
+kk_decl_export int  kk_os_read_text_file_mapped(kk_string_t path, kk_string_t* result, kk_context_t* ctx);
 kk_decl_export int  kk_os_write_text_file(kk_string_t path, kk_string_t content, kk_context_t* ctx);
+kk_decl_export int  kk_os_write_image_file(kk_string_t path, kk_box_t root, kk_context_t* ctx);
+kk_decl_export int  kk_os_read_image_file(kk_string_t path, kk_box_t* root, kk_context_t* ctx);
+
+kk_decl_export int  kk_os_file_open(kk_string_t path, bool write, bool append, kk_box_t* file, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_read_chunk(kk_box_t file, kk_ssize_t max, bool text, kk_bytes_t* chunk, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_write(kk_box_t file, kk_bytes_t content, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_flush(kk_box_t file, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_close(kk_box_t file, kk_context_t* ctx);
 
 kk_decl_export int  kk_os_ensure_dir(kk_string_t dir, int mode, kk_context_t* ctx);
 kk_decl_export int  kk_os_copy_file(kk_string_t from, kk_string_t to, bool preserve_mtime, kk_context_t* ctx);
 kk_decl_export bool kk_os_is_directory(kk_string_t path, kk_context_t* ctx);
 kk_decl_export bool kk_os_is_file(kk_string_t path, kk_context_t* ctx);
 kk_decl_export int  kk_os_list_directory(kk_string_t dir, kk_vector_t* contents, kk_context_t* ctx);
+kk_decl_export int  kk_os_list_directory_info(kk_string_t dir, bool with_stat, kk_vector_t* names, kk_vector_t* infos, kk_context_t* ctx);
+kk_decl_export int  kk_os_walk_directory(kk_string_t dir, kk_ssize_t max_depth, bool with_stat, bool parallel, kk_vector_t* names, kk_vector_t* infos, kk_context_t* ctx);
 
 kk_decl_export int  kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_context_t* ctx);
 kk_decl_export int  kk_os_run_system(kk_string_t cmd, kk_context_t* ctx);
+kk_decl_export int  kk_os_process_open(kk_string_t cmd, kk_box_t* file, kk_context_t* ctx);
+kk_decl_export int  kk_os_process_close(kk_box_t file, int* exit_code, kk_context_t* ctx);
 
 kk_decl_export kk_secs_t  kk_timer_ticks(kk_asecs_t* atto_secs, kk_context_t* ctx);
 kk_decl_export kk_asecs_t kk_timer_resolution(kk_context_t* ctx);
+kk_decl_export int64_t    kk_timer_fast_ticks(kk_context_t* ctx);  // raw ticks at `kk_timer_fast_freq` ticks per second
+kk_decl_export int64_t    kk_timer_fast_freq(kk_context_t* ctx);
 
 kk_decl_export kk_secs_t  kk_time_unix_now(kk_asecs_t* atto_secs, kk_context_t* ctx);
 kk_decl_export kk_asecs_t kk_time_resolution(kk_context_t* ctx);
@@ -46,6 +61,7 @@ kk_decl_export kk_string_t kk_cc_name(kk_context_t* ctx);
 kk_decl_export kk_string_t kk_os_name(kk_context_t* ctx);
 kk_decl_export kk_string_t kk_cpu_arch(kk_context_t* ctx);
 kk_decl_export int         kk_cpu_count(kk_context_t* ctx);
+kk_decl_export int         kk_cpu_numa_nodes(int* cpu_node, int cpu_count, kk_context_t* ctx);
 kk_decl_export bool        kk_cpu_is_little_endian(kk_context_t* ctx);
 
 kk_decl_export bool kk_os_set_stack_size( kk_ssize_t stack_size );
@@ -150,6 +150,7 @@
 #define kk_decl_noinline   __attribute__((noinline))
 #define kk_decl_align(a)   __attribute__((aligned(a)))
 #define kk_decl_thread     __thread
+#define kk_prefetchw(p)    __builtin_prefetch((p),1,3)  // prefetch for writing
 #elif defined(_MSC_VER)
 #pragma warning(disable:4214)  // using bit field types other than int
 #pragma warning(disable:4101)  // unreferenced local variable
@@ -164,6 +165,12 @@
 #define kk_decl_noinline   __declspec(noinline)
 #define kk_decl_align(a)   __declspec(align(a))
 #define kk_decl_thread     __declspec(thread)
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define kk_prefetchw(p)    _mm_prefetch((const char*)(p),_MM_HINT_T0)
+#else
+#define kk_prefetchw(p)    ((void)(p))
+#endif
 #ifndef __cplusplus
 #error "when using cl (the Microsoft Visual C++ compiler), use the /TP option to always compile in C++ mode."
 #endif
@@ -175,6 +182,21 @@
 #define kk_decl_noinline   
 #define kk_decl_align(a)   
 #define kk_decl_thread     __thread
+#define kk_prefetchw(p)    ((void)(p))
+#endif
+
+// Static probes (USDT) in the `koka` provider for tracing with bpftrace, SystemTap, or DTrace;
+// only enabled when KK_PROBES is defined. A probe site is a single `nop` (and its arguments
+// are only evaluated into registers) so it costs (nearly) nothing when no tracer is attached.
+#if defined(KK_PROBES) && KK_PROBES
+#include <sys/sdt.h>
+#define kk_probe(name)           DTRACE_PROBE(koka,name)
+#define kk_probe1(name,a)        DTRACE_PROBE1(koka,name,a)
+#define kk_probe2(name,a,b)      DTRACE_PROBE2(koka,name,a,b)
+#else
+#define kk_probe(name)
+#define kk_probe1(name,a)
+#define kk_probe2(name,a,b)
 #endif
 
 // Assertions; kk_assert_internal is only enabled when KK_DEBUG_FULL is defined
@@ -395,5 +417,19 @@ static inline intptr_t    kk_shlp(intptr_t i, intptr_t shift)   { return (intptr
 // the size of function pointer: `void (*f)(void)`
 #define KK_FUNPTR_SIZE    KK_INTPTR_SIZE    
 
+// Vector instructions: on x64 we detect SSSE3 and AVX2 at runtime (in `kklib_init`) and
+// compile kernels that use them with `kk_decl_target`; NEON is always available on arm64.
+#if ((defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)) || (defined(_MSC_VER) && defined(_M_X64))
+#define KK_ARCH_X64_SIMD    1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define KK_ARCH_ARM64_SIMD  1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define kk_decl_target(isa)  __attribute__((target(isa)))
+#else
+#define kk_decl_target(isa)
+#endif
+
 
 #endif // include guard
@@ -18,6 +18,7 @@ kk_timer_t kk_timer_start(void);
 kk_usecs_t kk_timer_end(kk_timer_t start);
 void       kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, 
                            size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit);
+size_t     kk_process_current_rss(void);   // 0 if unknown
 
 
 #endif // include guard
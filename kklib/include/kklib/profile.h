@@ -0,0 +1,57 @@
+#pragma once
+#ifndef KK_PROFILE_H
+#define KK_PROFILE_H
+
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Sampling profiler (see `profile.c`)
+
+  Enabled with the `--kkprofile[=<file>]` option. A `SIGPROF` timer samples each running
+  thread at `KK_PROFILE_HZ`; a sample records the handler tags in the current evidence
+  vector together with a shadow stack of function names maintained by `kk_profile_enter`
+  and `kk_profile_leave`; the compiler emits these around each function body when
+  compiling with `--fprofile`. At the end of `main` the samples are written in folded stack
+  format (as used by `flamegraph.pl` and `pprof`). When the profiler is not enabled the
+  shadow stack operations are just a test of `ctx->profile`. The profiler is not supported
+  on Windows.
+--------------------------------------------------------------------------------------*/
+
+#define KK_PROFILE_HZ       (100)   // samples per second
+#define KK_PROFILE_DEPTH    (32)    // maximal shadow stack frames recorded in a sample
+
+typedef struct kk_profile_s {
+  volatile kk_ssize_t   depth;                     // current shadow stack depth (can exceed `KK_PROFILE_DEPTH`)
+  const char* volatile  frames[KK_PROFILE_DEPTH];  // function names, outermost first
+  struct kk_profile_samples_s* samples;            // aggregated samples (only updated by the signal handler)
+  struct kk_profile_s*  next;                      // all thread profiles are linked
+} kk_profile_t;
+
+kk_decl_export bool kk_profile_start(const char* fname, kk_context_t* ctx);
+kk_decl_export void kk_profile_thread_init(kk_context_t* ctx);
+kk_decl_export void kk_profile_end(kk_context_t* ctx);
+kk_decl_export bool kk_profile_is_enabled(void);
+
+// Push a function on the shadow stack; `name` must be a static string
+static inline void kk_profile_enter(const char* name, kk_context_t* ctx) {
+  kk_profile_t* p = ctx->profile;
+  if (kk_likely(p == NULL)) return;
+  const kk_ssize_t d = p->depth;
+  if (d < KK_PROFILE_DEPTH) { p->frames[d] = name; }
+  p->depth = d + 1;  // only visible to the signal handler once the frame is written
+}
+
+static inline void kk_profile_leave(kk_context_t* ctx) {
+  kk_profile_t* p = ctx->profile;
+  if (kk_likely(p == NULL)) return;
+  const kk_ssize_t d = p->depth;
+  if (d > 0) { p->depth = d - 1; }
+}
+
+#endif // include guard
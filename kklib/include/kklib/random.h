@@ -10,9 +10,13 @@
   found in the LICENSE file at the root of this distribution.
 ---------------------------------------------------------------------------*/
 
+// Number of chacha20 blocks generated per round (so they can be computed in parallel with SIMD instructions)
+#define KK_SRANDOM_BLOCKS   (8)
+#define KK_SRANDOM_WORDS    (16*KK_SRANDOM_BLOCKS)
+
 // Strong random state based on chacha20.
 typedef struct kk_random_ctx_s {
-  uint32_t output[16]; // current output
+  uint32_t output[KK_SRANDOM_WORDS]; // current output
   uint32_t input[16];  // current state
   int32_t  used;       // how many output fields are already used?
   bool     is_strong;  // initialized from strong random source?
@@ -24,9 +28,9 @@ kk_decl_export kk_random_ctx_t* kk_srandom_round(kk_context_t* ctx);
 // Initial randomness comes from the OS.
 static inline uint32_t kk_srandom_uint32(kk_context_t* ctx) {
   kk_random_ctx_t* rnd = ctx->srandom_ctx;
-  if (kk_unlikely(rnd == NULL || rnd->used >= 16)) {
+  if (kk_unlikely(rnd == NULL || rnd->used >= KK_SRANDOM_WORDS)) {
     rnd = kk_srandom_round(ctx);
-    kk_assert_internal(rnd != NULL && rnd->used >= 0 && rnd->used < 16);
+    kk_assert_internal(rnd != NULL && rnd->used >= 0 && rnd->used < KK_SRANDOM_WORDS);
   }
   uint32_t x = rnd->output[rnd->used];
   rnd->output[rnd->used++] = 0; // clear after use
@@ -36,13 +40,14 @@ static inline uint32_t kk_srandom_uint32(kk_context_t* ctx) {
 static inline uint64_t kk_srandom_uint64(kk_context_t* ctx) {
   // return (((uint64_t)kk_srandom_uint32(ctx) << 32) | kk_srandom_uint32(ctx));
   kk_random_ctx_t* rnd = ctx->srandom_ctx;
-  if (kk_unlikely(rnd == NULL || rnd->used >= 15)) {
+  if (kk_unlikely(rnd == NULL || rnd->used >= KK_SRANDOM_WORDS - 1)) {
     rnd = kk_srandom_round(ctx);
-    kk_assert_internal(rnd != NULL && rnd->used >= 0 && rnd->used < 15);
+    kk_assert_internal(rnd != NULL && rnd->used >= 0 && rnd->used < KK_SRANDOM_WORDS - 1);
   }
-  uint64_t* p = (uint64_t*)&rnd->output[rnd->used];
-  uint64_t x = *p;
-  *p = 0;
+  uint32_t* p = &rnd->output[rnd->used];  // `used` may be odd so we cannot read a `uint64_t` directly
+  uint64_t x = ((uint64_t)p[1] << 32) | p[0];
+  p[0] = 0;
+  p[1] = 0;
   rnd->used += 2;
   return x;
 }
@@ -56,5 +61,66 @@ kk_decl_export int32_t  kk_srandom_range_int32(int32_t min, int32_t max, kk_cont
 kk_decl_export uint32_t kk_srandom_range_uint32(uint32_t max, kk_context_t* ctx);             // unbiased range
 kk_decl_export double   kk_srandom_double(kk_context_t* ctx);
 
+// Fill buffers with strong random data in one call
+kk_decl_export void        kk_srandom_buf(void* buf, kk_ssize_t len, kk_context_t* ctx);
+kk_decl_export kk_bytes_t  kk_srandom_bytes(kk_ssize_t len, kk_context_t* ctx);
+kk_decl_export kk_vector_t kk_srandom_vector_double(kk_ssize_t len, kk_context_t* ctx);  // in the range [0,1)
+
+
+/*--------------------------------------------------------------------------------------
+  Fast pseudo random numbers using sfc32 (see `random.c`). Deterministic given the
+  initial seed but not secure. The state is updated in place and new states can be
+  split off.
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_prandom_s {
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t counter;
+} kk_prandom_t;
+
+static inline uint32_t kk_prandom_uint32(kk_prandom_t* rnd) {
+  const uint32_t x = rnd->a + rnd->b + rnd->counter;
+  rnd->counter++;
+  rnd->a = rnd->b ^ (rnd->b >> 9);
+  rnd->b = rnd->c + (rnd->c << 3);
+  rnd->c = kk_bits_rotl32(rnd->c, 21) + x;
+  return x;
+}
+
+static inline uint64_t kk_prandom_uint64(kk_prandom_t* rnd) {
+  const uint32_t lo = kk_prandom_uint32(rnd);
+  const uint32_t hi = kk_prandom_uint32(rnd);
+  return (((uint64_t)hi << 32) | lo);
+}
+
+// Use 52 random bits to generate a double in the range [0,1)
+static inline double kk_prandom_double(kk_prandom_t* rnd) {
+  const uint64_t x = KK_U64(0x3FF0000000000000) | kk_shr64(kk_prandom_uint64(rnd), 12);
+  return (kk_bits_to_double(x) - 1.0);
+}
+
+kk_decl_export uint32_t kk_prandom_range_uint32_slow(kk_prandom_t* rnd, uint32_t max, uint64_t m);
+
+// Unbiased integer in the range [0,max) (by Daniel Lemire)
+static inline uint32_t kk_prandom_range_uint32(kk_prandom_t* rnd, uint32_t max) {
+  const uint64_t m = (uint64_t)kk_prandom_uint32(rnd) * (uint64_t)max;
+  if (kk_unlikely((uint32_t)m < max)) return kk_prandom_range_uint32_slow(rnd, max, m);
+  return (uint32_t)(m >> 32);
+}
+
+kk_decl_export void        kk_prandom_init(kk_prandom_t* rnd, uint32_t seed_lo, uint32_t seed_hi);
+kk_decl_export void        kk_prandom_split(kk_prandom_t* rnd, kk_prandom_t* split);
+kk_decl_export void        kk_prandom_buf(kk_prandom_t* rnd, void* buf, kk_ssize_t len);
+kk_decl_export int32_t     kk_prandom_range_int32(kk_prandom_t* rnd, int32_t min, int32_t max);  // unbiased range
+kk_decl_export kk_vector_t kk_prandom_vector_double(kk_prandom_t* rnd, kk_ssize_t len, kk_context_t* ctx);  // in the range [0,1)
+
+// Boxed states for Koka (see `std/num/random`)
+kk_decl_export kk_box_t kk_prandom_box_create(int32_t seed_lo, int32_t seed_hi, kk_context_t* ctx);
+
+static inline kk_prandom_t* kk_prandom_unbox_borrow(kk_box_t rnd) {
+  return (kk_prandom_t*)(kk_basetype_unbox_as_assert(kk_cptr_raw_t, rnd, KK_TAG_CPTR_RAW)->cptr);
+}
 
 #endif // include guard
@@ -22,6 +22,8 @@
   - small string of at most 7 utf-8 bytes
   - normal string of utf-8 bytes
   - raw string pointing to a buffer of utf-8 bytes
+  - rope string: the concatenation of two strings (see `bytes.h`)
+  - slice string: a substring that shares the bytes of a normal string (see `bytes.h`)
   
   These are not necessarily canonical (e.g. a normal or small string can have length 0 besides being empty)
 
@@ -233,7 +235,7 @@ static inline const uint8_t* kk_string_buf_borrow(const kk_string_t str, kk_ssiz
 }
 
 static inline const char* kk_string_cbuf_borrow(const kk_string_t str, kk_ssize_t* len) {
-  return (const char*)kk_string_buf_borrow(str, len);
+  return kk_bytes_cbuf_borrow(str.bytes, len);
 }
 
 static inline int kk_string_cmp_cstr_borrow(const kk_string_t s, const char* t) {
@@ -292,6 +294,20 @@ static inline const uint8_t* kk_utf8_prev(const uint8_t* s) {
   return s;
 }
 
+// Return the length of a trailing incomplete utf-8 sequence in `s` (at most 3 bytes), or 0.
+// This is used to split a stream of bytes into chunks at code point boundaries.
+static inline kk_ssize_t kk_utf8_incomplete_tail(const uint8_t* s, kk_ssize_t len) {
+  for (kk_ssize_t i = len - 1; i >= 0 && i >= len - 3; i--) {
+    const uint8_t c = s[i];
+    if (c < 0x80) break;
+    if (!kk_utf8_is_cont(c)) {
+      const kk_ssize_t need = (c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2));
+      return (i + need > len ? len - i : 0);
+    }
+  }
+  return 0;
+}
+
 // utf-8 valitating read.
 kk_decl_export kk_char_t kk_utf8_read_validate(const uint8_t* s, kk_ssize_t* count, kk_ssize_t* vcount, bool qutf8_identity );
 
@@ -449,6 +465,7 @@ kk_decl_export int kk_string_icmp(kk_string_t str1, kk_string_t str2, kk_context
 kk_decl_export kk_string_t kk_string_from_char(kk_char_t c, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_string_from_chars(kk_vector_t v, kk_context_t* ctx);
 kk_decl_export kk_vector_t kk_string_to_chars(kk_string_t s, kk_context_t* ctx);
+kk_decl_export kk_string_t kk_string_cat_n(kk_ssize_t n, const kk_string_t* ss, kk_string_t sep, kk_context_t* ctx);
 
 kk_decl_export kk_string_t kk_integer_to_string(kk_integer_t x, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_integer_to_hex_string(kk_integer_t x, bool use_capitals, kk_context_t* ctx);
@@ -461,15 +478,74 @@ kk_decl_export kk_string_t  kk_string_to_lower(kk_string_t strs, kk_context_t* c
 kk_decl_export kk_string_t  kk_string_trim_left(kk_string_t strs, kk_context_t* ctx);
 kk_decl_export kk_string_t  kk_string_trim_right(kk_string_t strs, kk_context_t* ctx);
 
+// Console output is buffered per thread and written to the output sink at newlines (see `string.c`).
+// The sink receives `len` bytes (possibly containing zeros) for the standard output, or standard error if `is_err` is set.
+typedef void (kk_output_sink_t)(const char* buf, kk_ssize_t len, bool is_err, void* arg);
+
+kk_decl_export void        kk_output_set_sink(kk_output_sink_t* sink, void* arg);  // use `NULL` for the default (`stdout`/`stderr`)
+kk_decl_export void        kk_output_write(const char* s, kk_ssize_t len, kk_context_t* ctx);
+kk_decl_export void        kk_output_write_err(const char* s, kk_ssize_t len, kk_context_t* ctx);
+kk_decl_export void        kk_output_flush(kk_context_t* ctx);
+kk_decl_export void        kk_output_free(kk_context_t* ctx);
+
 kk_decl_export kk_unit_t   kk_println(kk_string_t s, kk_context_t* ctx);
 kk_decl_export kk_unit_t   kk_print(kk_string_t s, kk_context_t* ctx);
 kk_decl_export kk_unit_t   kk_trace(kk_string_t s, kk_context_t* ctx);
 kk_decl_export kk_unit_t   kk_trace_any(kk_string_t s, kk_box_t x, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_show_any(kk_box_t x, kk_context_t* ctx);
 
+#define KK_DOUBLE_SHOW_MAX   (384)   // large enough for `%.48f` of any double
+kk_decl_export kk_ssize_t  kk_double_show_buf(double d, int32_t prec, char spec, char* buf);
+kk_decl_export bool        kk_double_parse(const char* s, kk_ssize_t len, double* result, kk_ssize_t* plen);
+
 kk_decl_export kk_string_t kk_double_show_fixed(double d, int32_t prec, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_double_show_exp(double d, int32_t prec, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_double_show(double d, int32_t prec, kk_context_t* ctx);
 
 
+/*--------------------------------------------------------------------------------------------------
+  String builder: append strings, characters, or bytes to a buffer that grows by doubling
+  and is converted to a string in-place at the end.
+  Use as:
+    kk_string_builder_t sb;
+    kk_string_builder_init(&sb, 0, ctx);
+    kk_string_builder_append(&sb, s, ctx);
+    ...
+    kk_string_t s = kk_string_builder_finish(&sb, ctx);
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_string_builder_s {
+  kk_bytes_t  buf;          // owned normal bytes of `capacity` length
+  uint8_t*    p;            // the bytes of `buf`
+  kk_ssize_t  len;          // used bytes
+  kk_ssize_t  capacity;
+} kk_string_builder_t;
+
+kk_decl_export void kk_string_builder_init(kk_string_builder_t* sb, kk_ssize_t capacity, kk_context_t* ctx);
+kk_decl_export void kk_string_builder_grow(kk_string_builder_t* sb, kk_ssize_t extra, kk_context_t* ctx);
+kk_decl_export kk_string_t kk_string_builder_finish(kk_string_builder_t* sb, kk_context_t* ctx);        // the appended bytes must be valid utf-8
+kk_decl_export kk_string_t kk_string_builder_finish_qutf8(kk_string_builder_t* sb, kk_context_t* ctx);  // convert invalid sequences
+
+// Append (qutf-8) bytes.
+static inline void kk_string_builder_append_buf(kk_string_builder_t* sb, kk_ssize_t len, const uint8_t* s, kk_context_t* ctx) {
+  if (kk_unlikely(sb->len + len > sb->capacity)) kk_string_builder_grow(sb, len, ctx);
+  kk_memcpy(sb->p + sb->len, s, len);
+  sb->len += len;
+}
+
+static inline void kk_string_builder_append(kk_string_builder_t* sb, kk_string_t s, kk_context_t* ctx) {
+  kk_ssize_t len;
+  const uint8_t* buf = kk_string_buf_borrow(s, &len);
+  kk_string_builder_append_buf(sb, len, buf, ctx);
+  kk_string_drop(s, ctx);
+}
+
+static inline void kk_string_builder_append_char(kk_string_builder_t* sb, kk_char_t c, kk_context_t* ctx) {
+  if (kk_unlikely(sb->len + 4 > sb->capacity)) kk_string_builder_grow(sb, 4, ctx);
+  kk_ssize_t count;
+  kk_utf8_write(c, sb->p + sb->len, &count);
+  sb->len += count;
+}
+
+
 #endif // include guard
@@ -16,17 +16,53 @@
 typedef kk_box_t  kk_promise_t;
 
 kk_decl_export kk_box_t     kk_promise_get( kk_promise_t pr, kk_context_t* ctx );
+kk_decl_export bool         kk_promise_available( kk_promise_t pr, kk_context_t* ctx );
+kk_decl_export void         kk_promise_cancel( kk_promise_t pr, kk_context_t* ctx );
 
 /*--------------------------------------------------------------------------------------
    Tasks
 --------------------------------------------------------------------------------------*/
 
 kk_decl_export kk_promise_t kk_task_schedule( kk_function_t fun, kk_context_t* ctx );
+kk_decl_export void         kk_task_schedule_detached( kk_function_t fun, kk_context_t* ctx );
+kk_decl_export bool         kk_task_is_cancelled( kk_context_t* ctx );
 // kk_decl_export kk_promise_t kk_task_schedule_n( kk_ssize_t count, kk_ssize_t stride, kk_function_t fun, kk_function_t combine, kk_context_t* ctx );
 
 kk_decl_export void kk_task_set_default_concurrency(kk_ssize_t thread_count, kk_context_t* ctx);
+kk_decl_export void kk_task_set_pinning(bool pin, kk_context_t* ctx);
+
+typedef struct kk_task_stats_s {
+  kk_ssize_t  workers;        // worker threads (0 if no task was scheduled yet)
+  kk_ssize_t  sleeping;       // workers waiting for a task
+  kk_ssize_t  queued;         // tasks in the injection queue and the worker deques
+  int64_t     executed;       // tasks executed by the workers
+  kk_usecs_t  busy;           // total time the workers spent executing tasks
+  kk_usecs_t  idle;           // total time the workers spent looking for tasks or sleeping
+  int64_t     promise_waits;  // `kk_promise_get` calls on a pending promise
+  kk_usecs_t  promise_wait;   // total time spent in those calls (including running other tasks)
+} kk_task_stats_t;
+
+kk_decl_export void kk_task_stats( kk_task_stats_t* stats, kk_context_t* ctx );
 // kk_decl_export void kk_task_group_free( kk_task_group_t* tg, kk_context_t* ctx );
 
+/*--------------------------------------------------------------------------------------
+   Parallel operations over vectors (with a chunk size, or 0 to choose one based on the concurrency)
+--------------------------------------------------------------------------------------*/
+
+kk_decl_export kk_vector_t kk_vector_parallel_map( kk_vector_t v, kk_function_t f, kk_ssize_t chunk, kk_context_t* ctx );
+kk_decl_export void        kk_vector_parallel_for( kk_vector_t v, kk_function_t f, kk_ssize_t chunk, kk_context_t* ctx );
+kk_decl_export kk_box_t    kk_vector_parallel_reduce( kk_vector_t v, kk_box_t init, kk_function_t f, kk_function_t combine, kk_ssize_t chunk, kk_context_t* ctx );
+
+// Sort a vector in place if it is unique (see `sort.c`); large vectors are sorted in parallel
+kk_decl_export kk_vector_t kk_vector_sort( kk_vector_t v, kk_function_t lt, kk_context_t* ctx );  // with `lt : (a,a) -> bool`
+kk_decl_export kk_vector_t kk_vector_sort_int( kk_vector_t v, kk_context_t* ctx );
+kk_decl_export kk_vector_t kk_vector_sort_float64( kk_vector_t v, kk_context_t* ctx );
+
+typedef void (kk_task_raw_fun_t)(void* env, kk_ssize_t i, kk_context_t* ctx);
+
+kk_decl_export kk_ssize_t  kk_task_concurrency( kk_context_t* ctx );
+kk_decl_export void        kk_task_parallel_for_raw( kk_ssize_t n, kk_task_raw_fun_t* fun, void* env, kk_context_t* ctx );
+
 /*--------------------------------------------------------------------------------------
    Lvars
 --------------------------------------------------------------------------------------*/
@@ -36,5 +72,17 @@ kk_decl_export kk_lvar_t kk_lvar_alloc( kk_box_t init, kk_context_t* ctx );
 kk_decl_export void      kk_lvar_put( kk_lvar_t lvar, kk_box_t val, kk_function_t monotonic_combine, kk_context_t* ctx );
 kk_decl_export kk_box_t  kk_lvar_get( kk_lvar_t lvar, kk_box_t bot, kk_function_t is_gte, kk_context_t* ctx );
 
+/*--------------------------------------------------------------------------------------
+   Channels
+--------------------------------------------------------------------------------------*/
+typedef kk_box_t kk_channel_t;
+
+kk_decl_export kk_channel_t kk_channel_alloc( kk_ssize_t capacity, kk_context_t* ctx );
+kk_decl_export void         kk_channel_send( kk_channel_t ch, kk_box_t v, kk_context_t* ctx );
+kk_decl_export bool         kk_channel_try_send( kk_channel_t ch, kk_box_t v, kk_context_t* ctx );
+kk_decl_export kk_box_t     kk_channel_recv( kk_channel_t ch, kk_context_t* ctx );
+kk_decl_export bool         kk_channel_try_recv( kk_channel_t ch, kk_box_t* v, kk_context_t* ctx );
+kk_decl_export void         kk_channel_send_vector( kk_channel_t ch, kk_vector_t v, kk_context_t* ctx );
+kk_decl_export kk_vector_t  kk_channel_recv_vector( kk_channel_t ch, kk_ssize_t max, kk_context_t* ctx );
 
 #endif // include guard
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef KK_UVECTOR_H
+#define KK_UVECTOR_H
+
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Unboxed vectors (see `vector.c` and `std/data/uvector`)
+
+  An unboxed vector stores `float64`, `int64`, `int32`, or `uint8` elements contiguously
+  without boxing. The block has no scanned fields so dropping it never traverses the
+  elements. In Koka an unboxed vector is passed as a `kk_box_t` (of type `any`).
+  Updates are in-place if the vector is unique and copy the vector otherwise.
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_uvector_s {
+  kk_block_t  _block;
+  kk_ssize_t  length;      // number of elements
+  kk_ssize_t  elem_size;   // size of an element in bytes
+  uint64_t    data[1];     // the elements (aligned to 8 bytes)
+} *kk_uvector_t;
+
+static inline kk_uvector_t kk_uvector_unbox_borrow(kk_box_t v) {
+  return kk_basetype_unbox_as_assert(kk_uvector_t, v, KK_TAG_UVECTOR);
+}
+
+static inline kk_ssize_t kk_uvector_len_borrow(kk_box_t v) {
+  return kk_uvector_unbox_borrow(v)->length;
+}
+
+static inline void* kk_uvector_buf_borrow(kk_box_t v, kk_ssize_t* len) {
+  kk_uvector_t u = kk_uvector_unbox_borrow(v);
+  if (len != NULL) *len = u->length;
+  return &u->data[0];
+}
+
+kk_decl_export kk_box_t kk_uvector_alloc_uninit(kk_ssize_t len, kk_ssize_t elem_size, void** buf, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_uvector_copy(kk_box_t v, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_uvector_slice(kk_box_t v, kk_ssize_t start, kk_ssize_t len, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_uvector_append(kk_box_t v, kk_box_t w, kk_context_t* ctx);
+
+// Ensure `v` is unique so it can be updated in place
+static inline kk_box_t kk_uvector_unique(kk_box_t v, kk_context_t* ctx) {
+  if (kk_likely(kk_block_is_unique(&kk_uvector_unbox_borrow(v)->_block))) return v;
+  return kk_uvector_copy(v, ctx);
+}
+
+// Elements of a `uint8` vector are clamped to [0,255]
+static inline uint8_t kk_uint8_clamp32(int32_t i) {
+  return (uint8_t)(i < 0 ? 0 : (i > 255 ? 255 : i));
+}
+
+// Define the element operations for each element type
+#define kk_uvector_decl(name,tp) \
+  static inline tp kk_uvector_##name##_at_borrow(kk_box_t v, kk_ssize_t i) { \
+    kk_ssize_t len; \
+    const tp* p = (const tp*)kk_uvector_buf_borrow(v, &len); \
+    kk_assert(i >= 0 && i < len); \
+    return p[i]; \
+  } \
+  static inline kk_box_t kk_uvector_##name##_set(kk_box_t v, kk_ssize_t i, tp x, kk_context_t* ctx) { \
+    v = kk_uvector_unique(v, ctx); \
+    kk_ssize_t len; \
+    tp* p = (tp*)kk_uvector_buf_borrow(v, &len); \
+    kk_assert(i >= 0 && i < len); \
+    p[i] = x; \
+    return v; \
+  } \
+  kk_decl_export kk_box_t    kk_uvector_##name##_alloc(kk_ssize_t len, tp init, kk_context_t* ctx); \
+  kk_decl_export kk_box_t    kk_uvector_##name##_fill(kk_box_t v, tp x, kk_context_t* ctx); \
+  kk_decl_export kk_box_t    kk_uvector_##name##_map(kk_box_t v, kk_function_t f, kk_context_t* ctx); \
+  kk_decl_export kk_box_t    kk_uvector_##name##_init(kk_ssize_t len, kk_function_t f, kk_context_t* ctx); \
+  kk_decl_export kk_box_t    kk_uvector_##name##_from_vector(kk_vector_t v, kk_context_t* ctx); \
+  kk_decl_export kk_vector_t kk_uvector_##name##_to_vector(kk_box_t v, kk_context_t* ctx);
+
+kk_uvector_decl(float64, double)
+kk_uvector_decl(int64, int64_t)
+kk_uvector_decl(int32, int32_t)
+kk_uvector_decl(uint8, uint8_t)
+
+// Sums and dot products; integer results wrap around
+kk_decl_export double  kk_uvector_float64_sum_borrow(kk_box_t v);
+kk_decl_export double  kk_uvector_float64_dot_borrow(kk_box_t v, kk_box_t w);
+kk_decl_export int64_t kk_uvector_int64_sum_borrow(kk_box_t v);
+kk_decl_export int64_t kk_uvector_int64_dot_borrow(kk_box_t v, kk_box_t w);
+kk_decl_export int64_t kk_uvector_int32_sum_borrow(kk_box_t v);
+kk_decl_export int64_t kk_uvector_int32_dot_borrow(kk_box_t v, kk_box_t w);
+kk_decl_export int64_t kk_uvector_uint8_sum_borrow(kk_box_t v);
+
+// Element-wise `a*v` and `a*v + w` for float64 vectors (where `w` is updated in place if unique)
+kk_decl_export kk_box_t kk_uvector_float64_scale(kk_box_t v, double a, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_uvector_float64_axpy(double a, kk_box_t v, kk_box_t w, kk_context_t* ctx);
+
+#endif // include guard
@@ -22,13 +22,21 @@
 #include "bits.c"
 #include "box.c"
 #include "bytes.c"
+#include "double.c"
+#include "evloop.c"
+#include "hash.c"
+#include "hashmap.c"
+#include "image.c"
 #include "init.c"
 #include "integer.c"
 #include "os.c"
 #include "process.c"
+#include "profile.c"
 #include "random.c"
 #include "ref.c"
 #include "refcount.c"
+#include "region.c"
+#include "sort.c"
 #include "string.c"
 #include "thread.c"
 #include "time.c"
@@ -316,8 +316,8 @@ double kk_double_unbox(kk_box_t b, kk_context_t* ctx) {
   // if (isnan(d)) { kk_debugger_break(ctx); }
   return d;
 }
-#else  // heap allocate when the exponent is between 0x200 and 0x5FF.
-kk_box_t kk_double_box(double d, kk_context_t* ctx) {
+#else  // heap allocate when the exponent is between 0x200 and 0x5FF (the common case is inline in `box.h`)
+kk_box_t kk_double_box_slow(double d, kk_context_t* ctx) {
   kk_unused(ctx);
   uint64_t u = kk_bits_from_double(d);
   u = kk_bits_rotl64(u, 12);
@@ -342,7 +342,7 @@ kk_box_t kk_double_box(double d, kk_context_t* ctx) {
   return b;
 }
 
-double kk_double_unbox(kk_box_t b, kk_context_t* ctx) {
+double kk_double_unbox_slow(kk_box_t b, kk_context_t* ctx) {
   kk_unused(ctx);
   if (kk_box_is_value(b)) {
     // expand 10-bit exponent to 11-bits again
@@ -67,6 +67,13 @@ kk_bytes_t kk_bytes_adjust_length(kk_bytes_t b, kk_ssize_t newlen, kk_context_t*
     // kk_assert_internal(kk_bytes_is_valid(kk_bytes_dup(s),ctx));
     return b;
   }
+  else if (len > newlen && kk_datatype_is_unique(b) && kk_datatype_has_tag(b, KK_TAG_BYTES_SMALL)) {
+    // small bytes in place: end with a zero followed by 0xFF bytes
+    kk_bytes_small_t sb = kk_datatype_as_assert(kk_bytes_small_t, b, KK_TAG_BYTES_SMALL);
+    sb->u.buf[newlen] = 0;
+    for (kk_ssize_t i = newlen + 1; i <= KK_BYTES_SMALL_MAX; i++) { sb->u.buf[i] = 0xFF; }
+    return b;
+  }
   else if (newlen < len) {
     // full copy
     kk_bytes_t tb = kk_bytes_alloc_dupn(newlen, s, ctx);
@@ -90,15 +97,108 @@ kk_bytes_t kk_bytes_adjust_length(kk_bytes_t b, kk_ssize_t newlen, kk_context_t*
   Compare
 --------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------
+  Search for a pattern. Single byte patterns use `memchr` (which is vectorized in all C libraries we
+  target). For longer patterns we use the "generic SIMD" algorithm of Wojciech Muła: compare a block of
+  positions at once against the first and last byte of the pattern, and only do a full comparison
+  at positions where both match (which filters out almost all candidate positions in practice).
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(KK_ARCH_X64_SIMD)
+#include <immintrin.h>
+#elif defined(KK_ARCH_ARM64_SIMD)
+#include <arm_neon.h>
+#endif
+
+// scalar search; find the first byte using memchr and then compare the rest
+static const uint8_t* kk_memmem_scalar(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  kk_assert_internal(patlen >= 2 && patlen <= plen);
+  const uint8_t* const end = p + (plen - (patlen - 1));
+  while (p < end) {
+    p = (const uint8_t*)memchr(p, pat[0], (size_t)(end - p));
+    if (p == NULL) return NULL;
+    if (kk_memcmp(p + 1, pat + 1, patlen - 1) == 0) return p;
+    p++;
+  }
+  return NULL;
+}
+
+#if defined(KK_ARCH_X64_SIMD)
+
+// SSE2 is always available on x64
+static const uint8_t* kk_memmem_sse2(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  const __m128i first = _mm_set1_epi8((char)pat[0]);
+  const __m128i last  = _mm_set1_epi8((char)pat[patlen - 1]);
+  kk_ssize_t i = 0;
+  for (; i + (patlen - 1) + 16 <= plen; i += 16) {
+    const __m128i bfirst = _mm_loadu_si128((const __m128i*)(p + i));
+    const __m128i blast  = _mm_loadu_si128((const __m128i*)(p + i + patlen - 1));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bfirst, first), _mm_cmpeq_epi8(blast, last)));
+    while (mask != 0) {
+      const kk_ssize_t j = i + kk_bits_ctz32(mask);
+      if (kk_memcmp(p + j + 1, pat + 1, patlen - 2) == 0) return (p + j);
+      mask &= (mask - 1);  // clear lowest bit
+    }
+  }
+  if (i + patlen > plen) return NULL;
+  return kk_memmem_scalar(p + i, plen - i, pat, patlen);
+}
+
+kk_decl_target("avx2") static const uint8_t* kk_memmem_avx2(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  const __m256i first = _mm256_set1_epi8((char)pat[0]);
+  const __m256i last  = _mm256_set1_epi8((char)pat[patlen - 1]);
+  kk_ssize_t i = 0;
+  for (; i + (patlen - 1) + 32 <= plen; i += 32) {
+    const __m256i bfirst = _mm256_loadu_si256((const __m256i*)(p + i));
+    const __m256i blast  = _mm256_loadu_si256((const __m256i*)(p + i + patlen - 1));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bfirst, first), _mm256_cmpeq_epi8(blast, last)));
+    while (mask != 0) {
+      const kk_ssize_t j = i + kk_bits_ctz32(mask);
+      if (kk_memcmp(p + j + 1, pat + 1, patlen - 2) == 0) return (p + j);
+      mask &= (mask - 1);
+    }
+  }
+  if (i + patlen > plen) return NULL;
+  return kk_memmem_scalar(p + i, plen - i, pat, patlen);
+}
+
+static const uint8_t* kk_memmem_simd(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  if (kk_has_avx2) return kk_memmem_avx2(p, plen, pat, patlen);
+  return kk_memmem_sse2(p, plen, pat, patlen);
+}
+
+#elif defined(KK_ARCH_ARM64_SIMD)
+
+static const uint8_t* kk_memmem_simd(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  const uint8x16_t first = vdupq_n_u8(pat[0]);
+  const uint8x16_t last  = vdupq_n_u8(pat[patlen - 1]);
+  kk_ssize_t i = 0;
+  for (; i + (patlen - 1) + 16 <= plen; i += 16) {
+    const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(p + i), first), vceqq_u8(vld1q_u8(p + i + patlen - 1), last));
+    // narrow to a 64-bit mask with 4 bits per byte
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask != 0) {
+      const kk_ssize_t j = i + (kk_bits_ctz64(mask) / 4);
+      if (kk_memcmp(p + j + 1, pat + 1, patlen - 2) == 0) return (p + j);
+      mask &= ~(KK_U64(0xF) << (4 * (j - i)));
+    }
+  }
+  if (i + patlen > plen) return NULL;
+  return kk_memmem_scalar(p + i, plen - i, pat, patlen);
+}
+
+#else
+
+static const uint8_t* kk_memmem_simd(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
+  return kk_memmem_scalar(p, plen, pat, patlen);
+}
+#endif
+
 const uint8_t* kk_memmem(const uint8_t* p, kk_ssize_t plen, const uint8_t* pat, kk_ssize_t patlen) {
-  // todo: optimize search algo?
   kk_assert(p != NULL && pat != NULL);
   if (plen <= 0 || patlen <= 0 || patlen > plen) return NULL;
-  const uint8_t* end = p + (plen - (patlen-1));
-  for (; p < end; p++) {
-    if (kk_memcmp(p, pat, patlen) == 0) return p;
-  }
-  return NULL;
+  if (patlen == 1) return (const uint8_t*)memchr(p, pat[0], (size_t)plen);
+  return kk_memmem_simd(p, plen, pat, patlen);
 }
 
 int kk_bytes_cmp_borrow(kk_bytes_t b1, kk_bytes_t b2) {
@@ -136,20 +236,197 @@ kk_ssize_t kk_decl_pure kk_bytes_count_pattern_borrow(kk_bytes_t b, kk_bytes_t p
   if (patlen <= 0)  return kk_bytes_len_borrow(b);
   if (patlen > len) return 0;
   
-  //todo: optimize by doing backward Boyer-Moore? or use forward Knuth-Morris-Pratt?
+  // count non-overlapping occurrences
   kk_ssize_t count = 0;
-  const uint8_t* end = s + (len - (patlen - 1));
-  for (const uint8_t* p = s; p < end; p++) {
-    if (kk_memcmp(p, pat, patlen) == 0) {
-      count++;
-      p += (patlen - 1);
-    }    
+  const uint8_t* const end = s + len;
+  const uint8_t* p = s;
+  while ((p = kk_memmem(p, end - p, pat, patlen)) != NULL) {
+    count++;
+    p += patlen;
   }
   return count;
 }
 
 
+/*--------------------------------------------------------------------------------------------------
+  Ropes
+--------------------------------------------------------------------------------------------------*/
+
+static kk_bytes_t kk_bytes_rope_alloc(kk_bytes_t left, kk_bytes_t right, kk_ssize_t length, kk_context_t* ctx) {
+  kk_assert_internal(!kk_datatype_has_tag(right, KK_TAG_BYTES_ROPE));
+  kk_bytes_rope_t rope = kk_block_alloc_as(struct kk_bytes_rope_s, KK_BYTES_ROPE_SCAN_FSIZE, KK_TAG_BYTES_ROPE, ctx);
+  kk_atomic_store_relaxed(&rope->flat, kk_bytes_empty().dbox);
+  rope->left = left;
+  rope->right = right;
+  rope->length = length;
+  return kk_datatype_from_base(&rope->_base);
+}
+
+static const uint8_t* kk_bytes_rope_flat_borrow(kk_bytes_rope_t rope) {
+  const kk_bytes_t flat = { kk_atomic_load_acquire(&rope->flat) };
+  return (kk_datatype_is_singleton(flat) ? NULL : kk_bytes_buf_borrow(flat, NULL));
+}
+
+// Copy the rope bytes into `buf` starting at the end; only the left parts can be ropes.
+static void kk_bytes_rope_copy(kk_bytes_rope_t rope, uint8_t* buf) {
+  uint8_t* p = buf + rope->length;
+  while (true) {
+    const uint8_t* flat = kk_bytes_rope_flat_borrow(rope);
+    if (flat != NULL) {
+      kk_memcpy(p - rope->length, flat, rope->length);
+      return;
+    }
+    kk_ssize_t rlen;
+    const uint8_t* r = kk_bytes_buf_borrow(rope->right, &rlen);
+    p -= rlen;
+    kk_memcpy(p, r, rlen);
+    if (!kk_datatype_has_tag(rope->left, KK_TAG_BYTES_ROPE)) break;
+    rope = kk_datatype_as_assert(kk_bytes_rope_t, rope->left, KK_TAG_BYTES_ROPE);
+  }
+  kk_ssize_t llen;
+  const uint8_t* l = kk_bytes_buf_borrow(rope->left, &llen);
+  kk_assert_internal(p - llen == buf);
+  kk_memcpy(buf, l, llen);
+}
+
+// Set a lazily computed (initially empty) field of `owner` to the normal bytes `value` and return its buffer.
+// If `owner` is thread-shared, another thread may set it concurrently in which case we use that value instead.
+static const uint8_t* kk_bytes_lazy_set(kk_block_t* owner, _Atomic(uintptr_t)* field, kk_bytes_t value, kk_context_t* ctx) {
+  if (kk_block_is_thread_shared(owner)) {
+    kk_block_mark_shared(kk_datatype_as_ptr(value), ctx);
+    uintptr_t expected = kk_bytes_empty().dbox;
+    if (!kk_atomic_cas_strong_acq_rel(field, &expected, value.dbox)) {
+      kk_bytes_drop(value, ctx);  // another thread was first
+      value.dbox = expected;
+    }
+  }
+  else {
+    kk_atomic_store_relaxed(field, value.dbox);
+  }
+  return kk_bytes_buf_borrow(value, NULL);
+}
+
+// Flatten a rope on the first borrow (and return the flattened bytes).
+const uint8_t* kk_bytes_rope_flatten(kk_bytes_rope_t rope) {
+  const uint8_t* flatbuf = kk_bytes_rope_flat_borrow(rope);
+  if (kk_likely(flatbuf != NULL)) return flatbuf;
+  kk_context_t* ctx = kk_get_context();  // borrowing has no context
+  uint8_t* buf;
+  kk_bytes_t flat = kk_bytes_alloc_buf(rope->length, &buf, ctx);
+  kk_assert_internal(kk_datatype_has_tag(flat, KK_TAG_BYTES));
+  kk_bytes_rope_copy(rope, buf);
+  flatbuf = kk_bytes_lazy_set(&rope->_base._block, &rope->flat, flat, ctx);
+  if (!kk_block_is_thread_shared(&rope->_base._block)) {
+    // thread local: we can release the parts directly
+    // (if thread-shared, the parts stay alive until the rope is freed)
+    kk_bytes_drop(rope->left, ctx);
+    kk_bytes_drop(rope->right, ctx);
+    rope->left = kk_bytes_empty();
+    rope->right = kk_bytes_empty();
+  }
+  return flatbuf;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Slices
+--------------------------------------------------------------------------------------------------*/
+
+// Return `len` bytes starting at `start` in `b`; shares the bytes of `b` if possible.
+kk_bytes_t kk_bytes_slice_borrow(kk_bytes_t b, kk_ssize_t start, kk_ssize_t len, kk_context_t* ctx) {
+  kk_ssize_t blen;
+  const uint8_t* s = kk_bytes_buf_borrow(b, &blen);   // flattens a rope
+  kk_assert(start >= 0 && len >= 0 && start + len <= blen);
+  if (len < KK_BYTES_SLICE_MIN) {
+    return kk_bytes_alloc_dupn(len, s + start, ctx);
+  }
+  if (start == 0 && len == blen) {
+    return kk_bytes_dup(b);
+  }
+  // find the normal bytes that contain `s`
+  kk_bytes_t parent;
+  const kk_tag_t tag = kk_datatype_tag(b);
+  if (tag == KK_TAG_BYTES) {
+    parent = b;
+  }
+  else if (tag == KK_TAG_BYTES_SLICE) {
+    parent = kk_datatype_as_assert(kk_bytes_slice_t, b, KK_TAG_BYTES_SLICE)->parent;
+  }
+  else if (tag == KK_TAG_BYTES_ROPE) {
+    parent.dbox = kk_atomic_load_acquire(&kk_datatype_as_assert(kk_bytes_rope_t, b, KK_TAG_BYTES_ROPE)->flat);
+  }
+  else {
+    return kk_bytes_alloc_dupn(len, s + start, ctx);  // raw bytes may be freed externally
+  }
+  kk_assert_internal(kk_datatype_has_tag(parent, KK_TAG_BYTES));
+  kk_bytes_slice_t slice = kk_block_alloc_as(struct kk_bytes_slice_s, KK_BYTES_SLICE_SCAN_FSIZE, KK_TAG_BYTES_SLICE, ctx);
+  slice->parent = kk_bytes_dup(parent);
+  kk_atomic_store_relaxed(&slice->cstr, kk_bytes_empty().dbox);
+  slice->buf = s + start;
+  slice->length = len;
+  return kk_datatype_from_base(&slice->_base);
+}
+
+// Return a zero terminated C string for a slice
+const char* kk_bytes_slice_cstr(kk_bytes_slice_t slice) {
+  if (slice->buf[slice->length] == 0) {
+    return (const char*)slice->buf;  // already zero terminated (as at the end of the parent)
+  }
+  const kk_bytes_t cstr = { kk_atomic_load_acquire(&slice->cstr) };
+  if (kk_likely(!kk_datatype_is_singleton(cstr))) {
+    return kk_bytes_cbuf_borrow(cstr, NULL);
+  }
+  kk_context_t* ctx = kk_get_context();  // borrowing has no context
+  kk_bytes_t copy = kk_bytes_alloc_dupn(slice->length, slice->buf, ctx);
+  return (const char*)kk_bytes_lazy_set(&slice->_base._block, &slice->cstr, copy, ctx);
+}
+
+
+// Can we append in place to `b`? (i.e. it is unique normal bytes)
+static inline bool kk_bytes_can_append_in_place(kk_bytes_t b) {
+  return (kk_datatype_has_tag(b, KK_TAG_BYTES) && kk_datatype_is_unique(b));
+}
+
+// Append `len2` bytes at `s2` in place to unique normal bytes `b1`.
+// If the usable size of the block is too small it is reallocated with 50% slack
+// so repeated appends (like `s := s ++ t` in a loop) take amortized linear time.
+static kk_bytes_t kk_bytes_append_in_place(kk_bytes_t b1, kk_ssize_t len2, const uint8_t* s2, kk_context_t* ctx) {
+  kk_assert_internal(kk_bytes_can_append_in_place(b1));
+  kk_bytes_normal_t nb = kk_datatype_as_assert(kk_bytes_normal_t, b1, KK_TAG_BYTES);
+  const kk_ssize_t len1 = nb->length;
+  const kk_ssize_t len  = len1 + len2;
+  const kk_ssize_t size = kk_ssizeof(struct kk_bytes_normal_s) + len;  // including the 0 terminator
+  if (kk_malloc_usable_size(nb) < size) {
+    nb = (kk_bytes_normal_t)kk_block_realloc(&nb->_base._block, size + (len/2), ctx);
+  }
+  kk_memcpy(&nb->buf[len1], s2, len2);
+  nb->length = len;
+  nb->buf[len] = 0;
+  return kk_datatype_from_base(&nb->_base);
+}
+
 kk_bytes_t kk_bytes_cat(kk_bytes_t b1, kk_bytes_t b2, kk_context_t* ctx) {
+  const kk_ssize_t rlen1 = kk_bytes_len_borrow(b1);
+  const kk_ssize_t rlen2 = kk_bytes_len_borrow(b2);
+  if (rlen2 == 0) {
+    kk_bytes_drop(b2, ctx);
+    return b1;
+  }
+  else if (rlen1 == 0) {
+    kk_bytes_drop(b1, ctx);
+    return b2;
+  }
+  else if (kk_bytes_can_append_in_place(b1)) {
+    // `b1` is unique: append in place (instead of a rope or a full copy)
+    kk_ssize_t len2;
+    const uint8_t* s2 = kk_bytes_buf_borrow(b2, &len2);
+    kk_bytes_t t = kk_bytes_append_in_place(b1, len2, s2, ctx);
+    kk_bytes_drop(b2, ctx);
+    return t;
+  }
+  else if (rlen1 + rlen2 >= KK_BYTES_ROPE_MIN && !kk_datatype_has_tag(b2, KK_TAG_BYTES_ROPE)) {
+    return kk_bytes_rope_alloc(b1, b2, rlen1 + rlen2, ctx);  // concatenate in O(1)
+  }
   kk_ssize_t len1;
   const uint8_t* s1 = kk_bytes_buf_borrow(b1, &len1);
   kk_ssize_t len2;
@@ -166,6 +443,7 @@ kk_bytes_t kk_bytes_cat(kk_bytes_t b1, kk_bytes_t b2, kk_context_t* ctx) {
 
 kk_bytes_t kk_bytes_cat_from_buf(kk_bytes_t b1, kk_ssize_t len2, const uint8_t* b2, kk_context_t* ctx) {
   if (b2 == NULL || len2 <= 0) return b1;
+  if (kk_bytes_can_append_in_place(b1)) return kk_bytes_append_in_place(b1, len2, b2, ctx);
   kk_ssize_t len1;
   const uint8_t* s1 = kk_bytes_buf_borrow(b1,&len1);
   uint8_t* p;
@@ -190,11 +468,28 @@ kk_vector_t kk_bytes_splitv_atmost(kk_bytes_t b, kk_bytes_t sepb, kk_ssize_t n,
   kk_ssize_t seplen;
   const uint8_t* sep = kk_bytes_buf_borrow(sepb, &seplen);
 
-  // count parts
+  // count parts and remember the separator positions so we search only once
+  const uint8_t* seps_local[64];
+  const uint8_t** seps = seps_local;
+  kk_ssize_t seps_size = 64;
+  kk_ssize_t seps_count = 0;  // the first `seps_count` separator positions (at most `count-1`)
   kk_ssize_t count = 1;
   if (seplen > 0) {    
     const uint8_t* p = s;
     while (count < n && (p = kk_memmem(p, end - p, sep, seplen)) != NULL) {
+      if (seps_count == seps_size && seps_count == count - 1) {
+        // grow the positions buffer (if that fails we search again for the remaining parts)
+        const uint8_t** nseps = (const uint8_t**)kk_malloc(2 * seps_size * kk_ssizeof(const uint8_t*), ctx);
+        if (nseps != NULL) {
+          kk_memcpy((void*)nseps, (const void*)seps, seps_count * kk_ssizeof(const uint8_t*));
+          if (seps != seps_local) kk_free((void*)seps, ctx);
+          seps = nseps;
+          seps_size *= 2;
+        }
+      }
+      if (seps_count < seps_size) {
+        seps[seps_count++] = p;
+      }
       p += seplen;
       count++;
     }
@@ -202,6 +497,7 @@ kk_vector_t kk_bytes_splitv_atmost(kk_bytes_t b, kk_bytes_t sepb, kk_ssize_t n,
   else if (n > 1) {
     count = len;
     if (count > n) count = n;
+    if (count < 1) count = 1;
   }
   kk_assert_internal(count >= 1 && count <= n);
   
@@ -211,7 +507,10 @@ kk_vector_t kk_bytes_splitv_atmost(kk_bytes_t b, kk_bytes_t sepb, kk_ssize_t n,
   const uint8_t* p = s;
   for (kk_ssize_t i = 0; i < (count-1) && p < end; i++) {
     const uint8_t* r;
-    if (seplen > 0) {
+    if (i < seps_count) {
+      r = seps[i];
+    }
+    else if (seplen > 0) {
       r = kk_memmem(p, end - p,  sep, seplen);
     }
     else {
@@ -219,11 +518,12 @@ kk_vector_t kk_bytes_splitv_atmost(kk_bytes_t b, kk_bytes_t sepb, kk_ssize_t n,
     }
     kk_assert_internal(r != NULL && r >= p && r < end);    
     const kk_ssize_t partlen = (r - p);
-    v[i] = kk_bytes_box(kk_bytes_alloc_dupn(partlen, p, ctx));
+    v[i] = kk_bytes_box(kk_bytes_slice_borrow(b, p - s, partlen, ctx));
     p = r + seplen;  // advance
   }
   kk_assert_internal(p <= end);
-  v[count-1] = kk_bytes_box(kk_bytes_alloc_dupn(end - p, p, ctx));  // todo: share bytes if p == s ?
+  v[count-1] = kk_bytes_box(kk_bytes_slice_borrow(b, p - s, end - p, ctx));
+  if (seps != seps_local) kk_free((void*)seps, ctx);
   kk_bytes_drop(b,ctx);
   kk_bytes_drop(sepb, ctx);
   return vec;
@@ -247,7 +547,7 @@ kk_bytes_t kk_bytes_replace_atmost(kk_bytes_t s, kk_bytes_t pat, kk_bytes_t rep,
     const uint8_t* const pend = p + plen;
     // if unique s && |rep| == |pat|, update in-place
     // TODO: if unique s & |rep| <= |pat|, maybe update in-place if not too much waste?
-    if (kk_datatype_is_unique(s) && ppat_len == prep_len) {
+    if (kk_bytes_is_unique_mutable(s) && ppat_len == prep_len) {
       kk_ssize_t count = 0;
       while (count < n && p < pend) {
         const uint8_t* r = kk_memmem(p, pend - p, ppat, ppat_len);
@@ -0,0 +1,573 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Event loop for asynchronous I/O (see `evloop.h`)
+
+  This is a readiness based loop using `epoll` on Linux and `kqueue` on macOS and the BSD's:
+  once a file descriptor is ready the operation is performed (non-blocking) and the callback is
+  called. Regular files are always ready and are completed on the next poll without waiting.
+  Callbacks are Koka functions (usually resuming an `await-evloop` in `std/async/evloop`) and
+  may raise an exception: after each callback we check `kk_yielding` and return to Koka.
+  (A completion based backend like `io_uring` or IOCP fits the same interface but is not
+  implemented yet; on other platforms, including Windows, submitting an operation returns `ENOSYS`.)
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(__linux__)
+#define KK_EVLOOP_EPOLL   1
+#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define KK_EVLOOP_KQUEUE  1
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+#if defined(KK_EVLOOP_EPOLL) || defined(KK_EVLOOP_KQUEUE)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+typedef enum kk_evkind_e {
+  KK_EV_NONE,
+  KK_EV_READ,
+  KK_EV_ACCEPT,
+  KK_EV_WRITE
+} kk_evkind_t;
+
+// An outstanding operation
+typedef struct kk_evreq_s {
+  kk_evkind_t   kind;
+  kk_function_t cb;
+  kk_ssize_t    max;         // read: the maximal chunk size
+  kk_bytes_t    content;     // write: the bytes to write
+  kk_ssize_t    written;     // write: bytes written so far
+} kk_evreq_t;
+
+// The state per file descriptor
+typedef struct kk_evfd_s {
+  kk_evreq_t  in;            // read or accept
+  kk_evreq_t  out;           // write
+  bool        registered;    // registered with the poll descriptor
+  bool        always_ready;  // cannot be polled (like regular files)
+  int         pending_len;   // incomplete utf-8 sequence at the end of the previous read
+  uint8_t     pending[4];
+} kk_evfd_t;
+
+typedef struct kk_evtimer_s {
+  kk_usecs_t    due;
+  int64_t       seq;         // to keep timers with the same due time in order
+  kk_function_t cb;
+} kk_evtimer_t;
+
+typedef struct kk_evloop_s {
+  int           pollfd;      // epoll or kqueue descriptor
+  kk_evfd_t*    fds;         // indexed by file descriptor
+  int           fds_count;
+  kk_ssize_t    pending;     // number of outstanding operations
+  kk_evtimer_t* timers;      // binary min-heap on `due` (and `seq`)
+  kk_ssize_t    timer_count;
+  kk_ssize_t    timer_cap;
+  int64_t       timer_seq;
+  int*          ready;       // always ready file descriptors with an outstanding operation
+  kk_ssize_t    ready_count;
+  kk_ssize_t    ready_cap;
+} kk_evloop_t;
+
+#define KK_EVLOOP_EVENTS  (256)  // maximal events per poll
+
+static kk_evloop_t* kk_evloop_get(kk_context_t* ctx, int* err) {
+  kk_evloop_t* loop = ctx->evloop;
+  if (kk_likely(loop != NULL)) return loop;
+  #if defined(KK_EVLOOP_EPOLL)
+  const int pollfd = epoll_create1(EPOLL_CLOEXEC);
+  #else
+  const int pollfd = kqueue();
+  #endif
+  if (pollfd < 0) {
+    *err = errno;
+    return NULL;
+  }
+  loop = (kk_evloop_t*)kk_zalloc(kk_ssizeof(kk_evloop_t), ctx);
+  if (loop == NULL) {
+    close(pollfd);
+    *err = ENOMEM;
+    return NULL;
+  }
+  loop->pollfd = pollfd;
+  ctx->evloop = loop;
+  return loop;
+}
+
+static kk_evfd_t* kk_evloop_fd(kk_evloop_t* loop, int fd, kk_context_t* ctx) {
+  if (fd >= loop->fds_count) {
+    int newcount = (loop->fds_count < 64 ? 64 : 2*loop->fds_count);
+    if (newcount <= fd) newcount = fd + 1;
+    kk_evfd_t* fds = (kk_evfd_t*)kk_realloc(loop->fds, newcount * kk_ssizeof(kk_evfd_t), ctx);
+    if (fds == NULL) return NULL;
+    kk_memset(fds + loop->fds_count, 0, (newcount - loop->fds_count) * kk_ssizeof(kk_evfd_t));
+    loop->fds = fds;
+    loop->fds_count = newcount;
+  }
+  return &loop->fds[fd];
+}
+
+static bool kk_evloop_push_ready(kk_evloop_t* loop, int fd, kk_context_t* ctx) {
+  for (kk_ssize_t i = 0; i < loop->ready_count; i++) {
+    if (loop->ready[i] == fd) return true;
+  }
+  if (loop->ready_count >= loop->ready_cap) {
+    const kk_ssize_t newcap = (loop->ready_cap < 16 ? 16 : 2*loop->ready_cap);
+    int* ready = (int*)kk_realloc(loop->ready, newcap * kk_ssizeof(int), ctx);
+    if (ready == NULL) return false;
+    loop->ready = ready;
+    loop->ready_cap = newcap;
+  }
+  loop->ready[loop->ready_count++] = fd;
+  return true;
+}
+
+// Update the registration of `fd` to the outstanding operations
+static int kk_evloop_update(kk_evloop_t* loop, int fd, kk_evfd_t* evfd, kk_context_t* ctx) {
+  if (evfd->always_ready) {
+    if (evfd->in.kind == KK_EV_NONE && evfd->out.kind == KK_EV_NONE) return 0;
+    return (kk_evloop_push_ready(loop, fd, ctx) ? 0 : ENOMEM);
+  }
+  const bool want_in = (evfd->in.kind != KK_EV_NONE);
+  const bool want_out = (evfd->out.kind != KK_EV_NONE);
+  int err = 0;
+  #if defined(KK_EVLOOP_EPOLL)
+  struct epoll_event ev = { 0 };
+  ev.events = (want_in ? EPOLLIN : 0) | (want_out ? EPOLLOUT : 0);
+  ev.data.fd = fd;
+  int res;
+  if (!want_in && !want_out) {
+    res = (evfd->registered ? epoll_ctl(loop->pollfd, EPOLL_CTL_DEL, fd, &ev) : 0);
+    evfd->registered = false;
+  }
+  else if (evfd->registered) {
+    res = epoll_ctl(loop->pollfd, EPOLL_CTL_MOD, fd, &ev);
+  }
+  else {
+    res = epoll_ctl(loop->pollfd, EPOLL_CTL_ADD, fd, &ev);
+    if (res == 0) evfd->registered = true;
+  }
+  if (res < 0) err = errno;
+  #else
+  struct kevent ev[2];
+  EV_SET(&ev[0], fd, EVFILT_READ, (want_in ? EV_ADD : EV_DELETE), 0, 0, NULL);
+  EV_SET(&ev[1], fd, EVFILT_WRITE, (want_out ? EV_ADD : EV_DELETE), 0, 0, NULL);
+  if (!evfd->registered) {
+    // only add
+    if (want_in && kevent(loop->pollfd, &ev[0], 1, NULL, 0, NULL) < 0) err = errno;
+    if (err == 0 && want_out && kevent(loop->pollfd, &ev[1], 1, NULL, 0, NULL) < 0) err = errno;
+    if (err == 0) evfd->registered = true;
+  }
+  else {
+    // deleting a filter that was not added returns ENOENT which we ignore
+    if (kevent(loop->pollfd, &ev[0], 1, NULL, 0, NULL) < 0 && errno != ENOENT) err = errno;
+    if (err == 0 && kevent(loop->pollfd, &ev[1], 1, NULL, 0, NULL) < 0 && errno != ENOENT) err = errno;
+    if (!want_in && !want_out) evfd->registered = false;
+  }
+  #endif
+  if (err == EPERM || err == EINVAL) {
+    // cannot be polled: regular files are always ready
+    evfd->always_ready = true;
+    return kk_evloop_update(loop, fd, evfd, ctx);
+  }
+  return err;
+}
+
+static int kk_evloop_set_nonblocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0) return errno;
+  if ((flags & O_NONBLOCK) != 0) return 0;
+  return (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ? errno : 0);
+}
+
+// Submit an operation on `fd`
+static int kk_evloop_submit(int fd, bool out, kk_evreq_t req, kk_context_t* ctx) {
+  int err = 0;
+  kk_evloop_t* loop = kk_evloop_get(ctx, &err);
+  if (loop == NULL) return err;
+  if (fd < 0) return EBADF;
+  kk_evfd_t* evfd = kk_evloop_fd(loop, fd, ctx);
+  if (evfd == NULL) return ENOMEM;
+  kk_evreq_t* slot = (out ? &evfd->out : &evfd->in);
+  if (slot->kind != KK_EV_NONE) return EBUSY;
+  if (!evfd->registered && !evfd->always_ready) {
+    err = kk_evloop_set_nonblocking(fd);
+    if (err != 0) return err;
+  }
+  *slot = req;
+  err = kk_evloop_update(loop, fd, evfd, ctx);
+  if (err != 0) {
+    slot->kind = KK_EV_NONE;
+    return err;
+  }
+  loop->pending++;
+  return 0;
+}
+
+kk_decl_export int kk_evloop_read(int fd, kk_ssize_t max, kk_function_t cb, kk_context_t* ctx) {
+  kk_evreq_t req = { KK_EV_READ, cb, (max < 64 ? 64 : max), kk_bytes_empty(), 0 };
+  const int err = kk_evloop_submit(fd, false, req, ctx);
+  if (err != 0) kk_function_drop(cb, ctx);
+  return err;
+}
+
+kk_decl_export int kk_evloop_accept(int fd, kk_function_t cb, kk_context_t* ctx) {
+  kk_evreq_t req = { KK_EV_ACCEPT, cb, 0, kk_bytes_empty(), 0 };
+  const int err = kk_evloop_submit(fd, false, req, ctx);
+  if (err != 0) kk_function_drop(cb, ctx);
+  return err;
+}
+
+kk_decl_export int kk_evloop_write(int fd, kk_bytes_t content, kk_function_t cb, kk_context_t* ctx) {
+  kk_evreq_t req = { KK_EV_WRITE, cb, 0, content, 0 };
+  const int err = kk_evloop_submit(fd, true, req, ctx);
+  if (err != 0) {
+    kk_bytes_drop(content, ctx);
+    kk_function_drop(cb, ctx);
+  }
+  return err;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Timers
+--------------------------------------------------------------------------------------------------*/
+
+static bool kk_evtimer_before(const kk_evtimer_t* t1, const kk_evtimer_t* t2) {
+  return (t1->due < t2->due || (t1->due == t2->due && t1->seq < t2->seq));
+}
+
+static void kk_evtimer_swap(kk_evtimer_t* timers, kk_ssize_t i, kk_ssize_t j) {
+  const kk_evtimer_t t = timers[i];
+  timers[i] = timers[j];
+  timers[j] = t;
+}
+
+kk_decl_export int kk_evloop_timer(kk_msecs_t timeout, kk_function_t cb, kk_context_t* ctx) {
+  int err = 0;
+  kk_evloop_t* loop = kk_evloop_get(ctx, &err);
+  if (loop != NULL && loop->timer_count >= loop->timer_cap) {
+    const kk_ssize_t newcap = (loop->timer_cap < 16 ? 16 : 2*loop->timer_cap);
+    kk_evtimer_t* timers = (kk_evtimer_t*)kk_realloc(loop->timers, newcap * kk_ssizeof(kk_evtimer_t), ctx);
+    if (timers == NULL) {
+      err = ENOMEM;
+    }
+    else {
+      loop->timers = timers;
+      loop->timer_cap = newcap;
+    }
+  }
+  if (loop == NULL || err != 0) {
+    kk_function_drop(cb, ctx);
+    return (err != 0 ? err : ENOMEM);
+  }
+  // push and sift up
+  kk_evtimer_t* timers = loop->timers;
+  kk_ssize_t i = loop->timer_count++;
+  timers[i].due = kk_timer_start() + (timeout < 0 ? 0 : timeout) * 1000;
+  timers[i].seq = loop->timer_seq++;
+  timers[i].cb = cb;
+  while (i > 0) {
+    const kk_ssize_t parent = (i - 1) / 2;
+    if (!kk_evtimer_before(&timers[i], &timers[parent])) break;
+    kk_evtimer_swap(timers, i, parent);
+    i = parent;
+  }
+  loop->pending++;
+  return 0;
+}
+
+static kk_evtimer_t kk_evtimer_pop(kk_evloop_t* loop) {
+  kk_evtimer_t* timers = loop->timers;
+  const kk_evtimer_t top = timers[0];
+  const kk_ssize_t n = --loop->timer_count;
+  timers[0] = timers[n];
+  // sift down
+  kk_ssize_t i = 0;
+  while (true) {
+    kk_ssize_t min = i;
+    const kk_ssize_t l = 2*i + 1;
+    const kk_ssize_t r = l + 1;
+    if (l < n && kk_evtimer_before(&timers[l], &timers[min])) min = l;
+    if (r < n && kk_evtimer_before(&timers[r], &timers[min])) min = r;
+    if (min == i) break;
+    kk_evtimer_swap(timers, i, min);
+    i = min;
+  }
+  return top;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Completion
+--------------------------------------------------------------------------------------------------*/
+
+static void kk_evloop_call_int(kk_function_t cb, int err, kk_ssize_t value, kk_context_t* ctx) {
+  kk_function_call(kk_unit_t, (kk_function_t, kk_integer_t, kk_integer_t, kk_context_t*), cb,
+                   (cb, kk_integer_from_int(err, ctx), kk_integer_from_ssize_t(value, ctx), ctx));
+}
+
+static void kk_evloop_call_string(kk_function_t cb, int err, kk_string_t s, kk_context_t* ctx) {
+  kk_function_call(kk_unit_t, (kk_function_t, kk_integer_t, kk_string_t, kk_context_t*), cb,
+                   (cb, kk_integer_from_int(err, ctx), s, ctx));
+}
+
+// Try to complete the read or accept on `fd`; returns true if it was completed.
+static bool kk_evloop_complete_in(kk_evloop_t* loop, int fd, kk_context_t* ctx) {
+  kk_evfd_t* evfd = &loop->fds[fd];
+  kk_evreq_t req = evfd->in;
+  if (req.kind == KK_EV_ACCEPT) {
+    #if defined(__linux__)
+    int newfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    #else
+    int newfd = accept(fd, NULL, NULL);
+    if (newfd >= 0) kk_evloop_set_nonblocking(newfd);
+    #endif
+    if (newfd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return false;
+    const int err = (newfd < 0 ? errno : 0);
+    evfd->in.kind = KK_EV_NONE;
+    kk_evloop_update(loop, fd, evfd, ctx);
+    loop->pending--;
+    kk_evloop_call_int(req.cb, err, newfd, ctx);
+    return true;
+  }
+  else if (req.kind == KK_EV_READ) {
+    uint8_t* buf;
+    kk_bytes_t chunk = kk_bytes_alloc_buf(req.max, &buf, ctx);
+    const kk_ssize_t npending = evfd->pending_len;
+    kk_memcpy(buf, evfd->pending, npending);
+    const ssize_t n = read(fd, buf + npending, (size_t)(req.max - npending));
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      kk_bytes_drop(chunk, ctx);
+      return false;
+    }
+    const int err = (n < 0 ? errno : 0);
+    kk_ssize_t len = npending + (n < 0 ? 0 : n);
+    if (n > 0) {
+      // keep a trailing incomplete utf-8 sequence for the next read
+      const kk_ssize_t tail = kk_utf8_incomplete_tail(buf, len);
+      if (tail == len) {
+        evfd->pending_len = (int)len;
+        kk_memcpy(evfd->pending, buf, len);
+        kk_bytes_drop(chunk, ctx);
+        return false;  // wait for more
+      }
+      evfd->pending_len = (int)tail;
+      kk_memcpy(evfd->pending, buf + len - tail, tail);
+      len -= tail;
+    }
+    else {
+      evfd->pending_len = 0;  // end of input or error: return the pending bytes as is
+    }
+    chunk = kk_bytes_adjust_length(chunk, len, ctx);
+    evfd->in.kind = KK_EV_NONE;
+    kk_evloop_update(loop, fd, evfd, ctx);
+    loop->pending--;
+    kk_evloop_call_string(req.cb, err, kk_string_convert_from_qutf8(chunk, ctx), ctx);
+    return true;
+  }
+  return false;
+}
+
+// Try to complete (or progress) the write on `fd`; returns true if it was completed.
+static bool kk_evloop_complete_out(kk_evloop_t* loop, int fd, kk_context_t* ctx) {
+  kk_evfd_t* evfd = &loop->fds[fd];
+  if (evfd->out.kind != KK_EV_WRITE) return false;
+  kk_ssize_t len;
+  const uint8_t* buf = kk_bytes_buf_borrow(evfd->out.content, &len);
+  int err = 0;
+  while (evfd->out.written < len) {
+    const ssize_t n = write(fd, buf + evfd->out.written, (size_t)(len - evfd->out.written));
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return false;  // wait until writable again
+      err = errno;
+      break;
+    }
+    evfd->out.written += n;
+  }
+  kk_evreq_t req = evfd->out;
+  evfd->out.kind = KK_EV_NONE;
+  evfd->out.content = kk_bytes_empty();
+  kk_evloop_update(loop, fd, evfd, ctx);
+  loop->pending--;
+  kk_bytes_drop(req.content, ctx);
+  kk_evloop_call_int(req.cb, err, req.written, ctx);
+  return true;
+}
+
+// Run expired timers; returns the number of timers run and sets `wait` to the
+// milliseconds until the next timer is due (or leaves it as is if there is no timer)
+static kk_ssize_t kk_evloop_run_timers(kk_evloop_t* loop, kk_msecs_t* wait, kk_context_t* ctx) {
+  kk_ssize_t count = 0;
+  while (loop->timer_count > 0) {
+    const kk_usecs_t now = kk_timer_start();
+    if (loop->timers[0].due > now) {
+      const kk_msecs_t next = (loop->timers[0].due - now + 999) / 1000;
+      if (*wait < 0 || next < *wait) *wait = next;
+      break;
+    }
+    kk_evtimer_t t = kk_evtimer_pop(loop);
+    loop->pending--;
+    kk_function_call(kk_unit_t, (kk_function_t, kk_context_t*), t.cb, (t.cb, ctx));
+    count++;
+    if (kk_yielding(ctx)) break;
+  }
+  return count;
+}
+
+// Poll for at most `timeout` milliseconds (or indefinitely if negative) and complete
+// the ready operations. A callback can raise an exception (which yields): in that case
+// we return right away and the remaining ready operations are completed on the next poll.
+kk_decl_export kk_ssize_t kk_evloop_poll(kk_msecs_t timeout, kk_context_t* ctx) {
+  kk_evloop_t* loop = ctx->evloop;
+  if (loop == NULL || loop->pending == 0) return 0;
+  kk_ssize_t count = kk_evloop_run_timers(loop, &timeout, ctx);
+  if (kk_yielding(ctx)) return count;
+  // always ready descriptors
+  if (loop->ready_count > 0) {
+    timeout = 0;
+    const kk_ssize_t n = loop->ready_count;
+    int* ready = (int*)kk_malloc(n * kk_ssizeof(int), ctx);
+    kk_memcpy(ready, loop->ready, n * kk_ssizeof(int));
+    loop->ready_count = 0;
+    for (kk_ssize_t i = 0; i < n; i++) {
+      const int fd = ready[i];
+      if (!kk_yielding(ctx)) {
+        if (kk_evloop_complete_in(loop, fd, ctx)) count++;
+        if (!kk_yielding(ctx) && kk_evloop_complete_out(loop, fd, ctx)) count++;
+      }
+      kk_evloop_update(loop, fd, &loop->fds[fd], ctx);  // re-queue if still outstanding
+    }
+    kk_free(ready, ctx);
+    if (kk_yielding(ctx)) return count;
+  }
+  if (count > 0) timeout = 0;
+  // poll
+  const int ms = (timeout < 0 ? -1 : (timeout > INT32_MAX ? INT32_MAX : (int)timeout));
+  #if defined(KK_EVLOOP_EPOLL)
+  struct epoll_event events[KK_EVLOOP_EVENTS];
+  const int n = epoll_wait(loop->pollfd, events, KK_EVLOOP_EVENTS, ms);
+  for (int i = 0; i < n; i++) {
+    const int fd = events[i].data.fd;
+    const uint32_t mask = events[i].events;
+    if ((mask & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 && kk_evloop_complete_in(loop, fd, ctx)) count++;
+    if (kk_yielding(ctx)) return count;  // the other events are level triggered and reported again
+    if ((mask & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0 && kk_evloop_complete_out(loop, fd, ctx)) count++;
+    if (kk_yielding(ctx)) return count;
+  }
+  #else
+  struct kevent events[KK_EVLOOP_EVENTS];
+  struct timespec ts;
+  if (ms >= 0) {
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+  }
+  const int n = kevent(loop->pollfd, NULL, 0, events, KK_EVLOOP_EVENTS, (ms < 0 ? NULL : &ts));
+  for (int i = 0; i < n; i++) {
+    const int fd = (int)events[i].ident;
+    if (events[i].filter == EVFILT_READ && kk_evloop_complete_in(loop, fd, ctx)) count++;
+    if (events[i].filter == EVFILT_WRITE && kk_evloop_complete_out(loop, fd, ctx)) count++;
+    if (kk_yielding(ctx)) return count;  // the other events are level triggered and reported again
+  }
+  #endif
+  count += kk_evloop_run_timers(loop, &timeout, ctx);
+  return count;
+}
+
+kk_decl_export int kk_evloop_run(kk_context_t* ctx) {
+  while (ctx->evloop != NULL && ctx->evloop->pending > 0 && !kk_yielding(ctx)) {
+    kk_evloop_poll(-1, ctx);
+  }
+  return 0;
+}
+
+kk_decl_export kk_ssize_t kk_evloop_pending(kk_context_t* ctx) {
+  return (ctx->evloop == NULL ? 0 : ctx->evloop->pending);
+}
+
+kk_decl_export void kk_evloop_free(kk_context_t* ctx) {
+  kk_evloop_t* loop = ctx->evloop;
+  if (loop == NULL) return;
+  ctx->evloop = NULL;
+  // drop outstanding operations without calling them
+  for (int fd = 0; fd < loop->fds_count; fd++) {
+    kk_evfd_t* evfd = &loop->fds[fd];
+    if (evfd->in.kind != KK_EV_NONE) kk_function_drop(evfd->in.cb, ctx);
+    if (evfd->out.kind != KK_EV_NONE) {
+      kk_function_drop(evfd->out.cb, ctx);
+      kk_bytes_drop(evfd->out.content, ctx);
+    }
+  }
+  for (kk_ssize_t i = 0; i < loop->timer_count; i++) {
+    kk_function_drop(loop->timers[i].cb, ctx);
+  }
+  close(loop->pollfd);
+  kk_free(loop->fds, ctx);
+  kk_free(loop->timers, ctx);
+  kk_free(loop->ready, ctx);
+  kk_free(loop, ctx);
+}
+
+#else
+
+/*--------------------------------------------------------------------------------------------------
+  Unsupported platform
+--------------------------------------------------------------------------------------------------*/
+
+kk_decl_export int kk_evloop_read(int fd, kk_ssize_t max, kk_function_t cb, kk_context_t* ctx) {
+  kk_unused(fd); kk_unused(max);
+  kk_function_drop(cb, ctx);
+  return ENOSYS;
+}
+
+kk_decl_export int kk_evloop_accept(int fd, kk_function_t cb, kk_context_t* ctx) {
+  kk_unused(fd);
+  kk_function_drop(cb, ctx);
+  return ENOSYS;
+}
+
+kk_decl_export int kk_evloop_write(int fd, kk_bytes_t content, kk_function_t cb, kk_context_t* ctx) {
+  kk_unused(fd);
+  kk_bytes_drop(content, ctx);
+  kk_function_drop(cb, ctx);
+  return ENOSYS;
+}
+
+kk_decl_export int kk_evloop_timer(kk_msecs_t timeout, kk_function_t cb, kk_context_t* ctx) {
+  kk_unused(timeout);
+  kk_function_drop(cb, ctx);
+  return ENOSYS;
+}
+
+kk_decl_export kk_ssize_t kk_evloop_poll(kk_msecs_t timeout, kk_context_t* ctx) {
+  kk_unused(timeout); kk_unused(ctx);
+  return 0;
+}
+
+kk_decl_export int kk_evloop_run(kk_context_t* ctx) {
+  kk_unused(ctx);
+  return 0;
+}
+
+kk_decl_export kk_ssize_t kk_evloop_pending(kk_context_t* ctx) {
+  kk_unused(ctx);
+  return 0;
+}
+
+kk_decl_export void kk_evloop_free(kk_context_t* ctx) {
+  kk_unused(ctx);
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Hashing (see `kklib/hash.h`)
+  This is wyhash (final version 4, by Wang Yi) which consumes 48 bytes at a time in three
+  independent multiply chains (that the processor can execute in parallel), and 16 bytes at a
+  time for the remainder. Buffers of at most `KK_BYTES_SMALL_MAX` bytes are padded to a
+  single word as in a `kk_bytes_small_t` so all representations of the same bytes hash the same.
+--------------------------------------------------------------------------------------------------*/
+
+static _Atomic(uintptr_t) kk_hash_process_seed;  // = 0
+
+uint64_t kk_hash_seed_init(kk_context_t* ctx) {
+  uintptr_t s = kk_atomic_load_acquire(&kk_hash_process_seed);
+  if (s == 0) {
+    // the first thread to get here determines the seed for the process
+    uintptr_t expected = 0;
+    const uintptr_t fresh = ((uintptr_t)kk_srandom_uint64(ctx) | 1);
+    s = (kk_atomic_cas_strong_acq_rel(&kk_hash_process_seed, &expected, fresh) ? fresh : expected);
+  }
+  uint64_t seed = (uint64_t)s;
+  seed ^= kk_hash_wymix(seed ^ KK_HASH_SECRET0, KK_HASH_SECRET1);
+  if (seed == 0) { seed = KK_HASH_SECRET2; }  // 0 means uninitialized
+  ctx->hash_seed = seed;
+  return seed;
+}
+
+// The process seed (initializing it if needed); this is stored in heap images with hash maps (see `image.c`)
+uint64_t kk_hash_process_seed_get(kk_context_t* ctx) {
+  kk_hash_seed(ctx);
+  return (uint64_t)kk_atomic_load_acquire(&kk_hash_process_seed);
+}
+
+// Use `seed` as the process seed so hash maps from a heap image can be used. This fails
+// if the process seed is already initialized to another value (when some hash was already computed).
+bool kk_hash_process_seed_set(uint64_t seed, kk_context_t* ctx) {
+  uintptr_t expected = 0;
+  if (seed == 0 || (uint64_t)(uintptr_t)seed != seed) return false;
+  if (!kk_atomic_cas_strong_acq_rel(&kk_hash_process_seed, &expected, (uintptr_t)seed) && expected != (uintptr_t)seed) return false;
+  ctx->hash_seed = 0;  // derive it again from the process seed
+  return true;
+}
+
+static inline uint64_t kk_hash_read64(const uint8_t* p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+static inline uint64_t kk_hash_read32(const uint8_t* p) {
+  uint32_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+uint64_t kk_hash_buf(const uint8_t* p, kk_ssize_t len, uint64_t seed) {
+  if (len <= KK_BYTES_SMALL_MAX) {
+    // pad as in `kk_bytes_small_t`: the bytes, an ending zero, and trailing 0xFF bytes
+    uint8_t buf[KK_BYTES_SMALL_MAX+1];
+    memset(buf, 0xFF, sizeof(buf));
+    if (len > 0) { memcpy(buf, p, (size_t)len); }
+    buf[len] = 0;
+    return kk_hash_word(kk_hash_read64(buf), seed);
+  }
+  uint64_t a;
+  uint64_t b;
+  if (len <= 16) {
+    a = (kk_hash_read32(p) << 32) | kk_hash_read32(p + ((len >> 3) << 2));
+    b = (kk_hash_read32(p + len - 4) << 32) | kk_hash_read32(p + len - 4 - ((len >> 3) << 2));
+  }
+  else {
+    kk_ssize_t i = len;
+    if (i >= 48) {
+      uint64_t seed1 = seed;
+      uint64_t seed2 = seed;
+      do {
+        seed  = kk_hash_wymix(kk_hash_read64(p) ^ KK_HASH_SECRET1, kk_hash_read64(p + 8) ^ seed);
+        seed1 = kk_hash_wymix(kk_hash_read64(p + 16) ^ KK_HASH_SECRET2, kk_hash_read64(p + 24) ^ seed1);
+        seed2 = kk_hash_wymix(kk_hash_read64(p + 32) ^ KK_HASH_SECRET3, kk_hash_read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = kk_hash_wymix(kk_hash_read64(p) ^ KK_HASH_SECRET1, kk_hash_read64(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    a = kk_hash_read64(p + i - 16);
+    b = kk_hash_read64(p + i - 8);
+  }
+  a ^= KK_HASH_SECRET1;
+  b ^= seed;
+  kk_hash_mum(&a, &b);
+  return kk_hash_wymix(a ^ KK_HASH_SECRET0 ^ (uint64_t)len, b ^ KK_HASH_SECRET1);
+}
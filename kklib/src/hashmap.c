@@ -0,0 +1,595 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  HAMT (see `kklib/hashmap.h`)
+
+  A node has `2*popcount(datamap)` fields with key/value pairs followed by `popcount(nodemap)`
+  child nodes; the bitmaps are stored after the (scanned) fields. Each level uses 5 bits of the
+  64-bit hash. Below the last level (`shift >= 64`) we have collision nodes that hold at most
+  `KK_HAMT_COLLISION_MAX` entries in a list, followed by an optional next collision node
+  (with `nodemap == 1`). A child node with a single entry is always inlined in its parent
+  so the trie stays canonical after a removal.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_HAMT_BITS            (5)
+#define KK_HAMT_MASK            (31)
+#define KK_HAMT_COLLISION_MAX   (16)
+
+typedef struct kk_hamt_node_s {
+  kk_block_t  _block;      // the scan size is `2*entries + children`
+  kk_box_t    fields[1];   // key/value pairs followed by child nodes; followed by the datamap and nodemap
+} *kk_hamt_node_t;
+
+static inline kk_box_t hamt_node_box(kk_hamt_node_t n) {
+  return kk_ptr_box(&n->_block);
+}
+
+static inline kk_hamt_node_t hamt_node_unbox(kk_box_t b) {
+  return kk_basetype_unbox_as_assert(kk_hamt_node_t, b, KK_TAG_HAMT_NODE);
+}
+
+static inline kk_ssize_t hamt_node_fields(kk_hamt_node_t n) {
+  return kk_block_scan_fsize(&n->_block);
+}
+
+static inline uint32_t* hamt_node_maps(kk_hamt_node_t n) {
+  return (uint32_t*)&n->fields[hamt_node_fields(n)];
+}
+
+static inline kk_ssize_t hamt_index(uint32_t map, uint32_t bit) {
+  return (kk_ssize_t)kk_bits_count32(map & (bit - 1));
+}
+
+static inline uint32_t hamt_bit(uint64_t h, int shift) {
+  return (KK_U32(1) << ((h >> shift) & KK_HAMT_MASK));
+}
+
+static inline kk_ssize_t hamt_node_size(kk_ssize_t fields) {
+  return (kk_ssizeof(kk_block_t) + fields*kk_ssizeof(kk_box_t) + 2*kk_ssizeof(uint32_t));
+}
+
+static kk_hamt_node_t hamt_node_alloc(kk_ssize_t fields, uint32_t datamap, uint32_t nodemap, kk_context_t* ctx) {
+  kk_hamt_node_t n = (kk_hamt_node_t)kk_block_alloc(hamt_node_size(fields), fields, KK_TAG_HAMT_NODE, ctx);
+  uint32_t* maps = hamt_node_maps(n);
+  maps[0] = datamap;
+  maps[1] = nodemap;
+  return n;
+}
+
+// Take field `i` out of `n`: this moves the field if `n` is unique and duplicates it otherwise.
+static inline kk_box_t hamt_node_take(kk_hamt_node_t n, bool unique, kk_ssize_t i) {
+  kk_box_t b = n->fields[i];
+  return (unique ? b : kk_box_dup(b));
+}
+
+// Release a node whose fields were moved out (if unique) or duplicated (if shared)
+static inline void hamt_node_release(kk_hamt_node_t n, bool unique, kk_context_t* ctx) {
+  if (unique) kk_block_free(&n->_block, ctx);
+         else kk_block_drop(&n->_block, ctx);
+}
+
+// Create a new node from `n` without the `del` fields starting at `del_at` but with the `ins` fields
+// at `ins_at` (an index in the new node). The deleted fields must have been taken already.
+static kk_hamt_node_t hamt_node_edit(kk_hamt_node_t n, bool unique, kk_ssize_t del_at, kk_ssize_t del,
+                                     kk_ssize_t ins_at, const kk_box_t* ins, kk_ssize_t ins_count,
+                                     uint32_t datamap, uint32_t nodemap, kk_context_t* ctx) {
+  const kk_ssize_t fields = hamt_node_fields(n);
+  if (unique && (del == 0 || ins_count == 0)) {
+    // only insert or only delete: resize in place
+    if (del == 0) {
+      n = (kk_hamt_node_t)kk_block_realloc(&n->_block, hamt_node_size(fields + ins_count), ctx);
+      kk_memmove(&n->fields[ins_at + ins_count], &n->fields[ins_at], (fields - ins_at)*kk_ssizeof(kk_box_t));
+      for (kk_ssize_t j = 0; j < ins_count; j++) { n->fields[ins_at + j] = ins[j]; }
+    }
+    else {
+      kk_memmove(&n->fields[del_at], &n->fields[del_at + del], (fields - del_at - del)*kk_ssizeof(kk_box_t));
+    }
+    n->_block.header.scan_fsize = (uint8_t)(fields - del + ins_count);
+    uint32_t* maps = hamt_node_maps(n);
+    maps[0] = datamap;
+    maps[1] = nodemap;
+    return n;
+  }
+  kk_hamt_node_t m = hamt_node_alloc(fields - del + ins_count, datamap, nodemap, ctx);
+  kk_ssize_t dst = 0;
+  for (kk_ssize_t src = 0; src <= fields; src++) {
+    if (dst == ins_at) {
+      for (kk_ssize_t j = 0; j < ins_count; j++) { m->fields[dst++] = ins[j]; }
+      ins_at = -1;
+    }
+    if (src == fields) break;
+    if (src >= del_at && src < del_at + del) continue;
+    m->fields[dst++] = hamt_node_take(n, unique, src);
+  }
+  kk_assert_internal(dst == hamt_node_fields(m));
+  hamt_node_release(n, unique, ctx);
+  return m;
+}
+
+static kk_hamt_node_t hamt_node_unique(kk_hamt_node_t n, bool unique, kk_context_t* ctx) {
+  if (unique) return n;
+  const uint32_t* maps = hamt_node_maps(n);
+  return hamt_node_edit(n, false, 0, 0, 0, NULL, 0, maps[0], maps[1], ctx);
+}
+
+// Create a node with two entries with different keys
+static kk_hamt_node_t hamt_node_pair(kk_box_t key1, kk_box_t value1, uint64_t h1,
+                                     kk_box_t key2, kk_box_t value2, uint64_t h2, int shift, kk_context_t* ctx) {
+  if (shift >= 64) {
+    kk_hamt_node_t n = hamt_node_alloc(4, 0, 0, ctx);
+    n->fields[0] = key1; n->fields[1] = value1;
+    n->fields[2] = key2; n->fields[3] = value2;
+    return n;
+  }
+  const uint32_t bit1 = hamt_bit(h1, shift);
+  const uint32_t bit2 = hamt_bit(h2, shift);
+  if (bit1 == bit2) {
+    kk_hamt_node_t n = hamt_node_alloc(1, 0, bit1, ctx);
+    n->fields[0] = hamt_node_box(hamt_node_pair(key1, value1, h1, key2, value2, h2, shift + KK_HAMT_BITS, ctx));
+    return n;
+  }
+  kk_hamt_node_t n = hamt_node_alloc(4, bit1 | bit2, 0, ctx);
+  const kk_ssize_t i = (bit1 < bit2 ? 0 : 2);
+  n->fields[i] = key1;   n->fields[i+1] = value1;
+  n->fields[2-i] = key2; n->fields[3-i] = value2;
+  return n;
+}
+
+static kk_hamt_node_t hamt_collision_insert(kk_hamt_node_t n, uint64_t h, kk_box_t key, kk_box_t value, kk_hash_key_t kind, bool* added, kk_context_t* ctx) {
+  const bool unique = kk_block_is_unique(&n->_block);
+  const kk_ssize_t fields = hamt_node_fields(n);
+  const bool has_next = (hamt_node_maps(n)[1] != 0);
+  const kk_ssize_t entries = (has_next ? fields - 1 : fields);
+  for (kk_ssize_t i = 0; i < entries; i += 2) {
+    if (kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx)) {
+      n = hamt_node_unique(n, unique, ctx);
+      kk_box_drop(key, ctx);
+      kk_box_drop(n->fields[i+1], ctx);
+      n->fields[i+1] = value;
+      return n;
+    }
+  }
+  if (has_next) {
+    n = hamt_node_unique(n, unique, ctx);
+    n->fields[fields-1] = hamt_node_box(hamt_collision_insert(hamt_node_unbox(n->fields[fields-1]), h, key, value, kind, added, ctx));
+    return n;
+  }
+  *added = true;
+  if (entries < 2*KK_HAMT_COLLISION_MAX) {
+    const kk_box_t ins[2] = { key, value };
+    return hamt_node_edit(n, unique, 0, 0, entries, ins, 2, 0, 0, ctx);
+  }
+  else {
+    kk_hamt_node_t next = hamt_node_alloc(2, 0, 0, ctx);
+    next->fields[0] = key;
+    next->fields[1] = value;
+    const kk_box_t ins[1] = { hamt_node_box(next) };
+    return hamt_node_edit(n, unique, 0, 0, entries, ins, 1, 0, 1, ctx);
+  }
+}
+
+static kk_hamt_node_t hamt_insert(kk_hamt_node_t n, uint64_t h, int shift, kk_box_t key, kk_box_t value, kk_hash_key_t kind, bool* added, kk_context_t* ctx) {
+  if (shift >= 64) return hamt_collision_insert(n, h, key, value, kind, added, ctx);
+  const bool unique = kk_block_is_unique(&n->_block);
+  const uint32_t* maps = hamt_node_maps(n);
+  const uint32_t datamap = maps[0];
+  const uint32_t nodemap = maps[1];
+  const uint32_t bit = hamt_bit(h, shift);
+  const kk_ssize_t dfields = 2*(kk_ssize_t)kk_bits_count32(datamap);
+  if ((datamap & bit) != 0) {
+    const kk_ssize_t i = 2*hamt_index(datamap, bit);
+    if (kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx)) {
+      // update the value
+      n = hamt_node_unique(n, unique, ctx);
+      kk_box_drop(key, ctx);
+      kk_box_drop(n->fields[i+1], ctx);
+      n->fields[i+1] = value;
+      return n;
+    }
+    // push the existing entry down into a new child node together with the new entry
+    const kk_box_t key0   = hamt_node_take(n, unique, i);
+    const kk_box_t value0 = hamt_node_take(n, unique, i+1);
+    const uint64_t h0 = kk_hash_key_borrow(key0, kind, ctx);
+    const kk_box_t ins[1] = { hamt_node_box(hamt_node_pair(key0, value0, h0, key, value, h, shift + KK_HAMT_BITS, ctx)) };
+    *added = true;
+    return hamt_node_edit(n, unique, i, 2, dfields - 2 + hamt_index(nodemap, bit), ins, 1, datamap ^ bit, nodemap | bit, ctx);
+  }
+  else if ((nodemap & bit) != 0) {
+    const kk_ssize_t i = dfields + hamt_index(nodemap, bit);
+    n = hamt_node_unique(n, unique, ctx);
+    n->fields[i] = hamt_node_box(hamt_insert(hamt_node_unbox(n->fields[i]), h, shift + KK_HAMT_BITS, key, value, kind, added, ctx));
+    return n;
+  }
+  else {
+    const kk_box_t ins[2] = { key, value };
+    *added = true;
+    return hamt_node_edit(n, unique, 0, 0, 2*hamt_index(datamap, bit), ins, 2, datamap | bit, nodemap, ctx);
+  }
+}
+
+// Remove a key that is known to be present
+static kk_hamt_node_t hamt_collision_remove(kk_hamt_node_t n, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  const bool unique = kk_block_is_unique(&n->_block);
+  const kk_ssize_t fields = hamt_node_fields(n);
+  const uint32_t has_next = hamt_node_maps(n)[1];
+  const kk_ssize_t entries = (has_next != 0 ? fields - 1 : fields);
+  for (kk_ssize_t i = 0; i < entries; i += 2) {
+    if (kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx)) {
+      kk_box_drop(hamt_node_take(n, unique, i), ctx);
+      kk_box_drop(hamt_node_take(n, unique, i+1), ctx);
+      if (entries == 2 && has_next != 0) {
+        // only the next node remains
+        kk_box_t next = hamt_node_take(n, unique, fields - 1);
+        hamt_node_release(n, unique, ctx);
+        return hamt_node_unbox(next);
+      }
+      return hamt_node_edit(n, unique, i, 2, -1, NULL, 0, 0, has_next, ctx);
+    }
+  }
+  kk_assert_internal(has_next != 0);
+  kk_hamt_node_t next = hamt_collision_remove(hamt_node_unbox(hamt_node_take(n, unique, fields - 1)), key, kind, ctx);
+  if (hamt_node_fields(next) == 0) {
+    hamt_node_release(next, kk_block_is_unique(&next->_block), ctx);
+    return hamt_node_edit(n, unique, fields - 1, 1, -1, NULL, 0, 0, 0, ctx);
+  }
+  const kk_box_t ins[1] = { hamt_node_box(next) };
+  if (unique) { n->fields[fields-1] = ins[0]; return n; }
+  return hamt_node_edit(n, unique, fields - 1, 1, fields - 1, ins, 1, 0, has_next, ctx);
+}
+
+static kk_hamt_node_t hamt_remove(kk_hamt_node_t n, uint64_t h, int shift, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  if (shift >= 64) return hamt_collision_remove(n, key, kind, ctx);
+  const bool unique = kk_block_is_unique(&n->_block);
+  const uint32_t* maps = hamt_node_maps(n);
+  const uint32_t datamap = maps[0];
+  const uint32_t nodemap = maps[1];
+  const uint32_t bit = hamt_bit(h, shift);
+  if ((datamap & bit) != 0) {
+    const kk_ssize_t i = 2*hamt_index(datamap, bit);
+    kk_assert_internal(kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx));
+    kk_box_drop(hamt_node_take(n, unique, i), ctx);
+    kk_box_drop(hamt_node_take(n, unique, i+1), ctx);
+    return hamt_node_edit(n, unique, i, 2, -1, NULL, 0, datamap ^ bit, nodemap, ctx);
+  }
+  kk_assert_internal((nodemap & bit) != 0);
+  const kk_ssize_t i = 2*(kk_ssize_t)kk_bits_count32(datamap) + hamt_index(nodemap, bit);
+  kk_hamt_node_t child = hamt_remove(hamt_node_unbox(hamt_node_take(n, unique, i)), h, shift + KK_HAMT_BITS, key, kind, ctx);
+  if (hamt_node_fields(child) == 2 && hamt_node_maps(child)[1] == 0) {
+    // inline a child with a single entry
+    const bool child_unique = kk_block_is_unique(&child->_block);
+    const kk_box_t ins[2] = { hamt_node_take(child, child_unique, 0), hamt_node_take(child, child_unique, 1) };
+    hamt_node_release(child, child_unique, ctx);
+    return hamt_node_edit(n, unique, i, 1, 2*hamt_index(datamap, bit), ins, 2, datamap | bit, nodemap ^ bit, ctx);
+  }
+  const kk_box_t ins[1] = { hamt_node_box(child) };
+  if (unique) { n->fields[i] = ins[0]; return n; }
+  return hamt_node_edit(n, unique, i, 1, i, ins, 1, datamap, nodemap, ctx);
+}
+
+static kk_box_t* hamt_lookup(kk_hamt_node_t n, uint64_t h, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  for (int shift = 0; shift < 64; shift += KK_HAMT_BITS) {
+    const uint32_t* maps = hamt_node_maps(n);
+    const uint32_t bit = hamt_bit(h, shift);
+    if ((maps[0] & bit) != 0) {
+      const kk_ssize_t i = 2*hamt_index(maps[0], bit);
+      return (kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx) ? &n->fields[i+1] : NULL);
+    }
+    if ((maps[1] & bit) == 0) return NULL;
+    n = hamt_node_unbox(n->fields[2*(kk_ssize_t)kk_bits_count32(maps[0]) + hamt_index(maps[1], bit)]);
+  }
+  // collision nodes
+  while (true) {
+    const kk_ssize_t fields = hamt_node_fields(n);
+    const bool has_next = (hamt_node_maps(n)[1] != 0);
+    const kk_ssize_t entries = (has_next ? fields - 1 : fields);
+    for (kk_ssize_t i = 0; i < entries; i += 2) {
+      if (kk_hash_key_eq_borrow(n->fields[i], key, kind, ctx)) return &n->fields[i+1];
+    }
+    if (!has_next) return NULL;
+    n = hamt_node_unbox(n->fields[fields-1]);
+  }
+}
+
+static void hamt_foreach(kk_hamt_node_t n, kk_hashmap_visit_fun_t* visit, void* arg, kk_context_t* ctx) {
+  // this also holds for collision nodes (which have an empty datamap and at most one child)
+  const kk_ssize_t fields = hamt_node_fields(n);
+  const kk_ssize_t entries = fields - (kk_ssize_t)kk_bits_count32(hamt_node_maps(n)[1]);
+  for (kk_ssize_t i = 0; i < entries; i += 2) {
+    visit(n->fields[i], n->fields[i+1], arg, ctx);
+  }
+  for (kk_ssize_t i = entries; i < fields; i++) {
+    hamt_foreach(hamt_node_unbox(n->fields[i]), visit, arg, ctx);
+  }
+}
+
+static kk_hamt_t hamt_alloc(kk_box_t root, kk_ssize_t count, kk_context_t* ctx) {
+  kk_hamt_t t = kk_block_alloc_as(struct kk_hamt_s, 1, KK_TAG_HAMT, ctx);
+  t->root = root;
+  t->count = count;
+  return t;
+}
+
+static kk_hamt_t hamt_unique(kk_box_t m, kk_context_t* ctx) {
+  kk_hamt_t t = kk_hamt_unbox_borrow(m);
+  if (kk_block_is_unique(&t->_block)) return t;
+  kk_hamt_t u = hamt_alloc(kk_box_dup(t->root), t->count, ctx);
+  kk_box_drop(m, ctx);
+  return u;
+}
+
+kk_box_t kk_hamt_empty(kk_context_t* ctx) {
+  return kk_ptr_box(&hamt_alloc(hamt_node_box(hamt_node_alloc(0, 0, 0, ctx)), 0, ctx)->_block);
+}
+
+kk_box_t kk_hamt_insert(kk_box_t m, kk_box_t key, kk_box_t value, kk_hash_key_t kind, kk_context_t* ctx) {
+  const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+  kk_hamt_t t = hamt_unique(m, ctx);
+  bool added = false;
+  t->root = hamt_node_box(hamt_insert(hamt_node_unbox(t->root), h, 0, key, value, kind, &added, ctx));
+  if (added) t->count++;
+  return kk_ptr_box(&t->_block);
+}
+
+kk_box_t* kk_hamt_lookup_borrow(kk_box_t m, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+  return hamt_lookup(hamt_node_unbox(kk_hamt_unbox_borrow(m)->root), h, key, kind, ctx);
+}
+
+kk_box_t kk_hamt_remove(kk_box_t m, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  if (kk_hamt_lookup_borrow(m, key, kind, ctx) == NULL) return m;
+  const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+  kk_hamt_t t = hamt_unique(m, ctx);
+  t->root = hamt_node_box(hamt_remove(hamt_node_unbox(t->root), h, 0, key, kind, ctx));
+  t->count--;
+  return kk_ptr_box(&t->_block);
+}
+
+void kk_hamt_foreach_borrow(kk_box_t m, kk_hashmap_visit_fun_t* visit, void* arg, kk_context_t* ctx) {
+  hamt_foreach(hamt_node_unbox(kk_hamt_unbox_borrow(m)->root), visit, arg, ctx);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Swiss table (see `kklib/hashmap.h`)
+
+  A control byte is `KK_SWISS_EMPTY`, `KK_SWISS_DELETED`, or the low 7 bits of the hash of a
+  full slot; the other bits select the start position of the probe sequence. We match a group of
+  16 control bytes at once (with SSE2 on x64 and with 64-bit bit tricks otherwise) and probe
+  groups in a triangular sequence which visits every group if the capacity is a power of 2.
+  The maximum load is 7/8 so there is always an empty slot that ends a probe sequence.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_SWISS_EMPTY    (0x80)
+#define KK_SWISS_DELETED  (0xFE)
+
+#if defined(KK_ARCH_X64_SIMD)
+#include <immintrin.h>
+
+// bit `i` is set if `ctrl[i] == c`
+static inline uint32_t swiss_match(const uint8_t* ctrl, uint8_t c) {
+  const __m128i g = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+}
+
+static inline uint32_t swiss_match_empty(const uint8_t* ctrl) {
+  return swiss_match(ctrl, KK_SWISS_EMPTY);
+}
+
+// empty and deleted bytes are the only ones with the high bit set
+static inline uint32_t swiss_match_free(const uint8_t* ctrl) {
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+}
+
+#else
+
+#define KK_SWISS_LSB  KK_U64(0x0101010101010101)
+#define KK_SWISS_MSB  KK_U64(0x8080808080808080)
+
+static inline uint64_t swiss_read64(const uint8_t* p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+// compress the high bits of each byte of `x` (which has only high bits set) into 8 bits
+static inline uint32_t swiss_movemask(uint64_t x) {
+  return (uint32_t)(((x >> 7) * KK_U64(0x0102040810204080)) >> 56);
+}
+
+// may have false positives (for a byte `c+1` right after a byte `c`) which are filtered out by the caller
+static inline uint32_t swiss_match8(uint64_t w, uint8_t c) {
+  const uint64_t x = w ^ (KK_SWISS_LSB * c);
+  return swiss_movemask((x - KK_SWISS_LSB) & ~x & KK_SWISS_MSB);
+}
+
+static inline uint32_t swiss_match(const uint8_t* ctrl, uint8_t c) {
+  return (swiss_match8(swiss_read64(ctrl), c) | (swiss_match8(swiss_read64(ctrl + 8), c) << 8));
+}
+
+// exact: an empty byte (0x80) has the high bit set and bit 1 clear (unlike a deleted byte 0xFE)
+static inline uint32_t swiss_match_empty8(uint64_t w) {
+  return swiss_movemask(w & ~(w << 6) & KK_SWISS_MSB);
+}
+
+static inline uint32_t swiss_match_empty(const uint8_t* ctrl) {
+  return (swiss_match_empty8(swiss_read64(ctrl)) | (swiss_match_empty8(swiss_read64(ctrl + 8)) << 8));
+}
+
+static inline uint32_t swiss_match_free(const uint8_t* ctrl) {
+  return (swiss_movemask(swiss_read64(ctrl) & KK_SWISS_MSB) | (swiss_movemask(swiss_read64(ctrl + 8) & KK_SWISS_MSB) << 8));
+}
+#endif
+
+static inline uint8_t swiss_h2(uint64_t h) {
+  return (uint8_t)(h & 0x7F);
+}
+
+static inline kk_ssize_t swiss_h1(uint64_t h) {
+  return (kk_ssize_t)(h >> 7);
+}
+
+// the maximum number of entries for a given capacity (7/8)
+static inline kk_ssize_t swiss_max_count(kk_ssize_t capacity) {
+  return (capacity - capacity/8);
+}
+
+// set the control byte at `i` and its mirror in the last group
+static inline void swiss_set_ctrl(kk_swiss_info_t* info, kk_ssize_t i, uint8_t c) {
+  info->ctrl[i] = c;
+  info->ctrl[((i - KK_SWISS_GROUP) & (info->capacity - 1)) + KK_SWISS_GROUP] = c;
+}
+
+static kk_swiss_t swiss_alloc(kk_ssize_t capacity, kk_context_t* ctx) {
+  kk_assert_internal(capacity >= KK_SWISS_GROUP && (capacity & (capacity - 1)) == 0);
+  const kk_ssize_t size = kk_ssizeof(kk_block_large_t) + 2*capacity*kk_ssizeof(kk_box_t) +
+                          kk_ssizeof(kk_swiss_info_t) + capacity + KK_SWISS_GROUP;
+  kk_swiss_t t = (kk_swiss_t)kk_block_large_alloc(size, 1 + 2*capacity, KK_TAG_SWISS, ctx);
+  for (kk_ssize_t i = 0; i < 2*capacity; i++) {
+    t->slots[i] = kk_box_null;
+  }
+  kk_swiss_info_t* info = kk_swiss_info(t);
+  info->capacity = capacity;
+  info->count = 0;
+  info->free = swiss_max_count(capacity);
+  kk_memset(&info->ctrl[0], KK_SWISS_EMPTY, capacity + KK_SWISS_GROUP);
+  return t;
+}
+
+static kk_ssize_t swiss_find(kk_swiss_t t, uint64_t h, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  const kk_swiss_info_t* info = kk_swiss_info(t);
+  const kk_ssize_t mask = info->capacity - 1;
+  const uint8_t h2 = swiss_h2(h);
+  kk_ssize_t pos = swiss_h1(h) & mask;
+  kk_ssize_t step = 0;
+  while (true) {
+    uint32_t m = swiss_match(&info->ctrl[pos], h2);
+    while (m != 0) {
+      const kk_ssize_t i = (pos + kk_bits_ctz32(m)) & mask;
+      if (info->ctrl[i] == h2 && kk_hash_key_eq_borrow(t->slots[2*i], key, kind, ctx)) return i;
+      m &= (m - 1);
+    }
+    if (swiss_match_empty(&info->ctrl[pos]) != 0) return -1;
+    step += KK_SWISS_GROUP;
+    pos = (pos + step) & mask;
+  }
+}
+
+// find the first empty or deleted slot in the probe sequence of `h`
+static kk_ssize_t swiss_find_free(const kk_swiss_info_t* info, uint64_t h) {
+  const kk_ssize_t mask = info->capacity - 1;
+  kk_ssize_t pos = swiss_h1(h) & mask;
+  kk_ssize_t step = 0;
+  while (true) {
+    const uint32_t m = swiss_match_free(&info->ctrl[pos]);
+    if (m != 0) return ((pos + kk_bits_ctz32(m)) & mask);
+    step += KK_SWISS_GROUP;
+    pos = (pos + step) & mask;
+  }
+}
+
+// Move the entries of a unique table into a new table of the given capacity (which also removes all deleted slots)
+static kk_swiss_t swiss_rehash(kk_swiss_t t, kk_ssize_t capacity, kk_hash_key_t kind, kk_context_t* ctx) {
+  kk_assert_internal(kk_block_is_unique(&t->_block._block));
+  kk_swiss_t u = swiss_alloc(capacity, ctx);
+  kk_swiss_info_t* uinfo = kk_swiss_info(u);
+  const kk_swiss_info_t* info = kk_swiss_info(t);
+  for (kk_ssize_t i = 0; i < info->capacity; i++) {
+    if (info->ctrl[i] < KK_SWISS_EMPTY) {
+      const kk_box_t key = t->slots[2*i];
+      const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+      const kk_ssize_t j = swiss_find_free(uinfo, h);
+      swiss_set_ctrl(uinfo, j, swiss_h2(h));
+      u->slots[2*j] = key;
+      u->slots[2*j+1] = t->slots[2*i+1];
+    }
+  }
+  uinfo->count = info->count;
+  uinfo->free -= info->count;
+  kk_block_free(&t->_block._block, ctx);
+  return u;
+}
+
+static kk_swiss_t swiss_unique(kk_box_t d, kk_context_t* ctx) {
+  kk_swiss_t t = kk_swiss_unbox_borrow(d);
+  if (kk_block_is_unique(&t->_block._block)) return t;
+  const kk_swiss_info_t* info = kk_swiss_info(t);
+  kk_swiss_t u = swiss_alloc(info->capacity, ctx);
+  for (kk_ssize_t i = 0; i < 2*info->capacity; i++) {
+    u->slots[i] = kk_box_dup(t->slots[i]);  // empty slots contain `kk_box_null` which is not a pointer
+  }
+  kk_memcpy(kk_swiss_info(u), info, kk_ssizeof(kk_swiss_info_t) + info->capacity + KK_SWISS_GROUP);
+  kk_box_drop(d, ctx);
+  return u;
+}
+
+static kk_ssize_t swiss_capacity_for(kk_ssize_t count) {
+  kk_ssize_t capacity = KK_SWISS_GROUP;
+  while (swiss_max_count(capacity) < count) { capacity *= 2; }
+  return capacity;
+}
+
+kk_box_t kk_swiss_empty(kk_ssize_t capacity, kk_context_t* ctx) {
+  return kk_ptr_box(&swiss_alloc(swiss_capacity_for(capacity), ctx)->_block._block);
+}
+
+kk_box_t kk_swiss_insert(kk_box_t d, kk_box_t key, kk_box_t value, kk_hash_key_t kind, kk_context_t* ctx) {
+  const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+  kk_swiss_t t = swiss_unique(d, ctx);
+  const kk_ssize_t i = swiss_find(t, h, key, kind, ctx);
+  if (i >= 0) {
+    kk_box_drop(key, ctx);
+    kk_box_drop(t->slots[2*i+1], ctx);
+    t->slots[2*i+1] = value;
+    return kk_ptr_box(&t->_block._block);
+  }
+  kk_swiss_info_t* info = kk_swiss_info(t);
+  if (info->free == 0) {
+    // grow if more than half full, otherwise just clean up the deleted slots
+    const kk_ssize_t capacity = (info->count >= swiss_max_count(info->capacity)/2 ? 2*info->capacity : info->capacity);
+    t = swiss_rehash(t, capacity, kind, ctx);
+    info = kk_swiss_info(t);
+  }
+  const kk_ssize_t j = swiss_find_free(info, h);
+  if (info->ctrl[j] == KK_SWISS_EMPTY) info->free--;
+  swiss_set_ctrl(info, j, swiss_h2(h));
+  t->slots[2*j] = key;
+  t->slots[2*j+1] = value;
+  info->count++;
+  return kk_ptr_box(&t->_block._block);
+}
+
+kk_box_t kk_swiss_remove(kk_box_t d, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  const uint64_t h = kk_hash_key_borrow(key, kind, ctx);
+  const kk_ssize_t i = swiss_find(kk_swiss_unbox_borrow(d), h, key, kind, ctx);
+  if (i < 0) return d;
+  kk_swiss_t t = swiss_unique(d, ctx);  // keeps the slot positions
+  kk_swiss_info_t* info = kk_swiss_info(t);
+  kk_box_drop(t->slots[2*i], ctx);
+  kk_box_drop(t->slots[2*i+1], ctx);
+  t->slots[2*i] = kk_box_null;
+  t->slots[2*i+1] = kk_box_null;
+  swiss_set_ctrl(info, i, KK_SWISS_DELETED);
+  info->count--;
+  return kk_ptr_box(&t->_block._block);
+}
+
+kk_box_t* kk_swiss_lookup_borrow(kk_box_t d, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx) {
+  kk_swiss_t t = kk_swiss_unbox_borrow(d);
+  const kk_ssize_t i = swiss_find(t, kk_hash_key_borrow(key, kind, ctx), key, kind, ctx);
+  return (i < 0 ? NULL : &t->slots[2*i+1]);
+}
+
+void kk_swiss_foreach_borrow(kk_box_t d, kk_hashmap_visit_fun_t* visit, void* arg, kk_context_t* ctx) {
+  kk_swiss_t t = kk_swiss_unbox_borrow(d);
+  const kk_swiss_info_t* info = kk_swiss_info(t);
+  for (kk_ssize_t i = 0; i < info->capacity; i++) {
+    if (info->ctrl[i] < KK_SWISS_EMPTY) visit(t->slots[2*i], t->slots[2*i+1], arg, ctx);
+  }
+}
@@ -0,0 +1,341 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Heap images (see `kklib/image.h`)
+  An image is created by a traversal that copies each reachable block once (so sharing is kept)
+  and maps the original blocks to their offset in the image; afterwards the pointer fields of
+  the copies are rewritten using this map. Bytes that are not stored inline (ropes, slices, and
+  raw bytes) are copied as normal bytes so an image never contains C pointers or fields that are
+  updated lazily. The size of most blocks is not in the header, so we use the usable size of
+  the allocation which includes any raw fields after the scanned fields. Blocks of an image that
+  was loaded before are not allocated though (and immortal): for those we use the size that
+  precedes each block in the image, and we record the loaded images to recognize them.
+  Hash maps depend on the process hash seed, which is therefore stored in the image and adopted
+  by the process that loads it.
+--------------------------------------------------------------------------------------------------*/
+
+#if KK_INTPTR_SIZE >= 8
+#define KK_IMAGE_BASE  KK_UP(0x600000000000)   // preferred address (usually unused on 64-bit platforms)
+#else
+#define KK_IMAGE_BASE  KK_UP(0)                // always relocate on 32-bit platforms
+#endif
+
+static inline kk_ssize_t kk_image_align(kk_ssize_t size) {
+  return ((size + KK_IMAGE_ALIGN - 1) & ~(kk_ssize_t)(KK_IMAGE_ALIGN - 1));
+}
+
+typedef struct kk_image_entry_s {
+  const kk_block_t* block;   // original block (or NULL if empty)
+  kk_ssize_t        offset;  // its offset in the image
+} kk_image_entry_t;
+
+typedef struct kk_image_s {
+  uint8_t*          buf;
+  kk_ssize_t        len;
+  kk_ssize_t        cap;
+  kk_image_entry_t* map;       // open addressing map from original blocks to their offset
+  kk_ssize_t        map_size;  // a power of 2
+  kk_ssize_t        map_count;
+  kk_block_t**      stack;     // original blocks whose children still need to be visited
+  kk_ssize_t        sp;
+  kk_ssize_t        stack_size;
+  bool              has_hash;  // does the image contain hash maps?
+} kk_image_t;
+
+static size_t kk_image_map_index(const kk_image_t* img, const kk_block_t* b) {
+  uint64_t h = (uint64_t)((uintptr_t)b >> 3) * KK_U64(0x9E3779B97F4A7C15);
+  h ^= (h >> 29);
+  return (size_t)(h & (uint64_t)(img->map_size - 1));
+}
+
+// Find the entry of `b` (or the empty entry where it should be inserted)
+static kk_image_entry_t* kk_image_map_find(const kk_image_t* img, const kk_block_t* b) {
+  size_t i = kk_image_map_index(img, b);
+  while (img->map[i].block != NULL && img->map[i].block != b) {
+    i = (i + 1) & (size_t)(img->map_size - 1);
+  }
+  return &img->map[i];
+}
+
+static bool kk_image_map_grow(kk_image_t* img, kk_context_t* ctx) {
+  kk_image_entry_t* old = img->map;
+  const kk_ssize_t oldsize = img->map_size;
+  const kk_ssize_t newsize = (oldsize == 0 ? 1024 : 2*oldsize);
+  kk_image_entry_t* map = (kk_image_entry_t*)kk_malloc(newsize * kk_ssizeof(kk_image_entry_t), ctx);
+  if (map == NULL) return false;
+  memset(map, 0, (size_t)newsize * sizeof(kk_image_entry_t));
+  img->map = map;
+  img->map_size = newsize;
+  for (kk_ssize_t i = 0; i < oldsize; i++) {
+    if (old[i].block != NULL) { *kk_image_map_find(img, old[i].block) = old[i]; }
+  }
+  if (old != NULL) { kk_free(old, ctx); }
+  return true;
+}
+
+// Reserve `n` bytes at the end of the image and return their offset (or -1 when out of memory)
+static kk_ssize_t kk_image_reserve(kk_image_t* img, kk_ssize_t n, kk_context_t* ctx) {
+  if (img->len + n > img->cap) {
+    kk_ssize_t newcap = (img->cap == 0 ? 64*1024 : 2*img->cap);
+    while (newcap < img->len + n) { newcap *= 2; }
+    uint8_t* buf = (uint8_t*)kk_realloc(img->buf, newcap, ctx);
+    if (buf == NULL) return -1;
+    img->buf = buf;
+    img->cap = newcap;
+  }
+  const kk_ssize_t offset = img->len;
+  memset(img->buf + offset, 0, (size_t)n);
+  img->len += n;
+  return offset;
+}
+
+// The loaded images (which stay valid for the rest of the process)
+typedef struct kk_image_loaded_s {
+  struct kk_image_loaded_s* next;
+  const uint8_t*            start;
+  kk_ssize_t                len;
+} kk_image_loaded_t;
+
+static _Atomic(uintptr_t) kk_images_loaded;  // kk_image_loaded_t*
+
+static void kk_image_loaded_add(const uint8_t* image, kk_ssize_t len, kk_context_t* ctx) {
+  kk_image_loaded_t* loaded = (kk_image_loaded_t*)kk_malloc(kk_ssizeof(kk_image_loaded_t), ctx);
+  if (loaded == NULL) return;  // its blocks cannot be copied into a new image (see `kk_image_block_size`)
+  loaded->start = image;
+  loaded->len = len;
+  uintptr_t head = kk_atomic_load_relaxed(&kk_images_loaded);
+  do {
+    loaded->next = (kk_image_loaded_t*)head;
+  } while (!kk_atomic_cas_weak_acq_rel(&kk_images_loaded, &head, (uintptr_t)loaded));
+}
+
+// The size of a block in a loaded image as stored in front of it (or 0 if it is not in a loaded image)
+static kk_ssize_t kk_image_loaded_block_size(const kk_block_t* b) {
+  const uint8_t* p = (const uint8_t*)b;
+  for (const kk_image_loaded_t* loaded = (const kk_image_loaded_t*)kk_atomic_load_acquire(&kk_images_loaded); loaded != NULL; loaded = loaded->next) {
+    if (p >= loaded->start + sizeof(kk_image_header_t) + KK_IMAGE_ALIGN && p < loaded->start + loaded->len) {
+      return *((const kk_ssize_t*)(p - KK_IMAGE_ALIGN));
+    }
+  }
+  return 0;
+}
+
+// The size of a block in bytes, or -1 if it cannot be part of an image (and 0 if unknown)
+static kk_ssize_t kk_image_block_size(kk_block_t* b) {
+  switch (kk_block_tag(b)) {
+    case KK_TAG_BYTES_SMALL:
+      return kk_ssizeof(struct kk_bytes_small_s);
+    case KK_TAG_BYTES:
+      return (kk_ssize_t)offsetof(struct kk_bytes_normal_s, buf) + ((kk_bytes_normal_t)b)->length + 1;  // including the ending zero
+    case KK_TAG_VECTOR:
+      return kk_ssizeof(kk_block_t) + kk_block_scan_fsize(b)*kk_ssizeof(kk_box_t);  // without the unused capacity
+    case KK_TAG_OPEN:         // matched by the address of the tag string
+    case KK_TAG_REF:          // mutable
+    case KK_TAG_FUNCTION:     // code pointer
+    case KK_TAG_CFUNPTR:
+    case KK_TAG_EVV_VECTOR:
+    case KK_TAG_CPTR_RAW:
+      return -1;
+    default:
+      if (kk_refcount_is_immortal(kk_block_refcount(b))) {
+        // not allocated: either in a loaded image or static
+        const kk_ssize_t size = kk_image_loaded_block_size(b);
+        if (size > 0) return size;
+        if (b->header.scan_fsize == 0) return kk_ssizeof(kk_block_t);   // a static singleton (see `kk_define_static_datatype`)
+        return -1;  // a static block with fields (whose size we do not know)
+      }
+      return kk_malloc_usable_size(b);   // includes the raw fields
+  }
+}
+
+// Copy bytes that are not stored inline as normal bytes
+static int kk_image_add_bytes(kk_image_t* img, kk_block_t* b, kk_ssize_t* offset, kk_context_t* ctx) {
+  kk_ssize_t len;
+  const uint8_t* p = kk_bytes_buf_borrow(kk_datatype_from_ptr(b), &len);
+  const kk_ssize_t size = (kk_ssize_t)offsetof(struct kk_bytes_normal_s, buf) + len + 1;
+  const kk_ssize_t ofs = kk_image_reserve(img, KK_IMAGE_ALIGN + kk_image_align(size), ctx);
+  if (ofs < 0) return ENOMEM;
+  *((kk_ssize_t*)(img->buf + ofs)) = kk_image_align(size);
+  kk_bytes_normal_t bn = (kk_bytes_normal_t)(img->buf + ofs + KK_IMAGE_ALIGN);
+  kk_header_init(&bn->_base._block.header, 0, KK_TAG_BYTES);
+  kk_block_refcount_set(&bn->_base._block, KK_REFCOUNT_IMMORTAL);
+  bn->length = len;
+  if (len > 0) { memcpy(bn->buf, p, (size_t)len); }
+  bn->buf[len] = 0;
+  *offset = ofs + KK_IMAGE_ALIGN;
+  return 0;
+}
+
+// Add a block to the image (if it is not yet present)
+static int kk_image_add(kk_image_t* img, kk_block_t* b, kk_context_t* ctx) {
+  if (2*(img->map_count + 1) > img->map_size && !kk_image_map_grow(img, ctx)) return ENOMEM;
+  kk_image_entry_t* entry = kk_image_map_find(img, b);
+  if (entry->block != NULL) return 0;  // already present
+  const kk_tag_t tag = kk_block_tag(b);
+  kk_ssize_t offset;
+  if (tag == KK_TAG_BYTES_ROPE || tag == KK_TAG_BYTES_SLICE || tag == KK_TAG_BYTES_RAW) {
+    const int err = kk_image_add_bytes(img, b, &offset, ctx);
+    if (err != 0) return err;
+  }
+  else {
+    const kk_ssize_t size = kk_image_block_size(b);
+    if (size < 0) return ENOTSUP;
+    if (size == 0) return ENOSYS;  // the allocator does not tell us the block size
+    const kk_ssize_t asize = kk_image_align(size);
+    const kk_ssize_t ofs = kk_image_reserve(img, KK_IMAGE_ALIGN + asize, ctx);
+    if (ofs < 0) return ENOMEM;
+    *((kk_ssize_t*)(img->buf + ofs)) = asize;
+    offset = ofs + KK_IMAGE_ALIGN;
+    kk_block_t* copy = (kk_block_t*)(img->buf + offset);
+    memcpy(copy, b, (size_t)size);
+    kk_block_refcount_set(copy, KK_REFCOUNT_IMMORTAL);
+    if (tag == KK_TAG_VECTOR) {
+      ((kk_vector_large_t)copy)->capacity = kk_intf_box(kk_block_scan_fsize(b) - 2);
+    }
+    else if (tag == KK_TAG_HAMT || tag == KK_TAG_HAMT_NODE || tag == KK_TAG_SWISS) {
+      img->has_hash = true;
+    }
+    if (b->header.scan_fsize > 0) {
+      // visit the children later
+      if (img->sp >= img->stack_size) {
+        const kk_ssize_t newsize = (img->stack_size == 0 ? 1024 : 2*img->stack_size);
+        kk_block_t** stack = (kk_block_t**)kk_realloc(img->stack, newsize * kk_ssizeof(kk_block_t*), ctx);
+        if (stack == NULL) return ENOMEM;
+        img->stack = stack;
+        img->stack_size = newsize;
+      }
+      img->stack[img->sp++] = b;
+    }
+  }
+  // `entry` is still valid as the map did not change
+  entry->block = b;
+  entry->offset = offset;
+  img->map_count++;
+  return 0;
+}
+
+// Rewrite the pointer fields of all blocks to be relative to the base
+static void kk_image_rewrite_fields(kk_image_t* img) {
+  kk_ssize_t ofs = kk_ssizeof(kk_image_header_t);
+  while (ofs < img->len) {
+    const kk_ssize_t size = *((kk_ssize_t*)(img->buf + ofs));
+    kk_block_t* b = (kk_block_t*)(img->buf + ofs + KK_IMAGE_ALIGN);
+    const kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
+    for (kk_ssize_t i = 0; i < scan_fsize; i++) {
+      kk_box_t v = kk_block_field(b, i);
+      if (kk_box_is_non_null_ptr(v)) {
+        const kk_image_entry_t* entry = kk_image_map_find(img, kk_ptr_unbox(v));
+        kk_assert_internal(entry->block != NULL);
+        kk_block_field_set(b, i, kk_ptr_box((kk_block_t*)(KK_IMAGE_BASE + (uintptr_t)entry->offset)));
+      }
+    }
+    ofs += KK_IMAGE_ALIGN + size;
+  }
+}
+
+kk_decl_export int kk_image_create(kk_box_t root, uint8_t** image, kk_ssize_t* len, kk_context_t* ctx) {
+  kk_image_t img;
+  memset(&img, 0, sizeof(img));
+  int err = (kk_image_reserve(&img, kk_ssizeof(kk_image_header_t), ctx) < 0 ? ENOMEM : 0);
+  if (err == 0 && kk_box_is_non_null_ptr(root)) {
+    err = kk_image_add(&img, kk_ptr_unbox(root), ctx);
+    while (err == 0 && img.sp > 0) {
+      kk_block_t* b = img.stack[--img.sp];
+      const kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
+      for (kk_ssize_t i = 0; err == 0 && i < scan_fsize; i++) {
+        kk_box_t v = kk_block_field(b, i);
+        if (kk_box_is_non_null_ptr(v)) { err = kk_image_add(&img, kk_ptr_unbox(v), ctx); }
+      }
+    }
+  }
+  if (err == 0) {
+    kk_image_rewrite_fields(&img);
+    kk_image_header_t* header = (kk_image_header_t*)img.buf;
+    header->magic = KK_IMAGE_MAGIC;
+    header->version = KK_IMAGE_VERSION;
+    header->intptr_size = KK_INTPTR_SIZE;
+    header->intf_size = KK_INTF_SIZE;
+    header->base = KK_IMAGE_BASE;
+    header->size = (uint64_t)img.len;
+    header->count = (uint64_t)img.map_count;
+    header->hash_seed = (img.has_hash ? kk_hash_process_seed_get(ctx) : 0);
+    if (kk_box_is_non_null_ptr(root)) {
+      header->root = kk_ptr_box((kk_block_t*)(KK_IMAGE_BASE + (uintptr_t)kk_image_map_find(&img, kk_ptr_unbox(root))->offset));
+    }
+    else {
+      header->root = root;
+    }
+    *image = img.buf;
+    *len = img.len;
+  }
+  else if (img.buf != NULL) {
+    kk_free(img.buf, ctx);
+  }
+  if (img.map != NULL) { kk_free(img.map, ctx); }
+  if (img.stack != NULL) { kk_free(img.stack, ctx); }
+  return err;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Loading
+--------------------------------------------------------------------------------------------------*/
+
+static const kk_image_header_t* kk_image_header(const uint8_t* image, kk_ssize_t len) {
+  if (len < kk_ssizeof(kk_image_header_t)) return NULL;
+  const kk_image_header_t* header = (const kk_image_header_t*)image;
+  if (header->magic != KK_IMAGE_MAGIC || header->version != KK_IMAGE_VERSION ||
+      header->intptr_size != KK_INTPTR_SIZE || header->intf_size != KK_INTF_SIZE ||
+      header->size != (uint64_t)len) return NULL;
+  return header;
+}
+
+kk_decl_export void* kk_image_base(const uint8_t* image, kk_ssize_t len) {
+  const kk_image_header_t* header = kk_image_header(image, len);
+  return (header == NULL ? NULL : (void*)(uintptr_t)header->base);
+}
+
+// Relocate a pointer field (or return false if it does not point to the start of a block in the image)
+static bool kk_image_relocate_box(kk_box_t* v, uintptr_t base, uintptr_t delta, kk_ssize_t len) {
+  if (!kk_box_is_non_null_ptr(*v)) return true;
+  const uintptr_t p = (uintptr_t)kk_ptr_unbox(*v);
+  if (p < base + sizeof(kk_image_header_t) || p - base >= (uintptr_t)len || (p % KK_IMAGE_ALIGN) != 0) return false;
+  *v = kk_ptr_box((kk_block_t*)(p + delta));
+  return true;
+}
+
+kk_decl_export int kk_image_load(uint8_t* image, kk_ssize_t len, kk_box_t* root, kk_context_t* ctx) {
+  const kk_image_header_t* header = kk_image_header(image, len);
+  if (header == NULL) return EINVAL;
+  if (header->hash_seed != 0 && !kk_hash_process_seed_set(header->hash_seed, ctx)) return EEXIST;
+  const uintptr_t base = (uintptr_t)header->base;
+  kk_box_t r = header->root;
+  if ((uintptr_t)image != base) {
+    // relocate all pointer fields (and validate the block layout while at it)
+    const uintptr_t delta = (uintptr_t)image - base;
+    kk_ssize_t ofs = kk_ssizeof(kk_image_header_t);
+    while (ofs < len) {
+      if (len - ofs < KK_IMAGE_ALIGN + kk_ssizeof(kk_block_t)) return EINVAL;
+      const kk_ssize_t size = *((kk_ssize_t*)(image + ofs));
+      if (size < kk_ssizeof(kk_block_t) || size > len - ofs - KK_IMAGE_ALIGN) return EINVAL;
+      kk_block_t* b = (kk_block_t*)(image + ofs + KK_IMAGE_ALIGN);
+      const kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
+      if (scan_fsize < 0 || scan_fsize > (size - kk_ssizeof(kk_block_t)) / kk_ssizeof(kk_box_t)) return EINVAL;
+      for (kk_ssize_t i = 0; i < scan_fsize; i++) {
+        if (!kk_image_relocate_box(&((kk_block_fields_t*)b)->fields[i], base, delta, len)) return EINVAL;
+      }
+      ofs += KK_IMAGE_ALIGN + size;
+    }
+    if (!kk_image_relocate_box(&r, base, delta, len)) return EINVAL;
+  }
+  kk_image_loaded_add(image, len, ctx);
+  *root = r;
+  return 0;
+}
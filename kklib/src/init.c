@@ -87,8 +87,8 @@ typedef enum kk_log_level_e {
 } kk_log_level_t;
 
 static void kk_log_message(kk_log_level_t level, const char* msg, kk_context_t* ctx) {
-  kk_unused(ctx); kk_unused(level);
-  fputs(msg,stderr); // TODO: use ctx->log
+  kk_unused(level);
+  kk_output_write_err(msg, (kk_ssize_t)strlen(msg), ctx); // TODO: use ctx->log
 }
 
 static void kk_log_message_fmt(kk_context_t* ctx, kk_log_level_t level, const char* fmt, va_list args) {
@@ -151,6 +151,11 @@ bool kk_has_lzcnt = false;
 bool kk_has_tzcnt = false;
 #endif
 
+#if defined(KK_ARCH_X64_SIMD)
+bool kk_has_ssse3 = false;  // used for utf-8 validation in string.c
+bool kk_has_avx2 = false;
+#endif
+
 static void kklib_init(void) {
   if (process_initialized) return;
   process_initialized = true;
@@ -173,6 +178,17 @@ static void kklib_init(void) {
   kk_has_lzcnt  = ((cpu_info[2] & (KK_I32(1)<<5)) != 0);   // abm: https://en.wikipedia.org/wiki/X86_Bit_manipulation_instruction_set
   __cpuid(cpu_info, 7);
   kk_has_tzcnt = ((cpu_info[1] & (KK_I32(1)<<3)) != 0);    // bmi1: https://en.wikipedia.org/wiki/X86_Bit_manipulation_instruction_set
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+  __cpuid(cpu_info, 1);
+  kk_has_ssse3 = ((cpu_info[2] & (KK_I32(1)<<9)) != 0);
+  const bool os_avx = ((cpu_info[2] & (KK_I32(1)<<27)) != 0 && (_xgetbv(0) & 6) == 6);  // osxsave and ymm state enabled
+  __cpuid(cpu_info, 7);
+  kk_has_avx2 = (os_avx && (cpu_info[1] & (KK_I32(1)<<5)) != 0);
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  __builtin_cpu_init();
+  kk_has_ssse3 = __builtin_cpu_supports("ssse3");
+  kk_has_avx2  = __builtin_cpu_supports("avx2");
 #endif
   atexit(&kklib_done);  
 }
@@ -190,6 +206,287 @@ static struct { kk_block_t _block; kk_integer_t cfc; } kk_evv_empty_static = {
 };
 kk_ptr_t kk_evv_empty_singleton = &kk_evv_empty_static._block;
 
+#if KK_STATS
+/*--------------------------------------------------------------------------------------------------
+  Statistics: all contexts are linked in a global list so `kk_stats_print` can aggregate
+  the counters of all threads. The counters of a freed context are added to `kk_stats_retired`.
+--------------------------------------------------------------------------------------------------*/
+static kk_context_t*      kk_stats_contexts;
+static kk_stats_t         kk_stats_retired;
+static _Atomic(uintptr_t) kk_stats_lock;
+
+static void kk_stats_lock_acquire(void) {
+  uintptr_t expect = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&kk_stats_lock, &expect, 1)) { expect = 0; }
+}
+
+static void kk_stats_lock_release(void) {
+  kk_atomic_store_release(&kk_stats_lock, 0);
+}
+
+static void kk_stats_add(kk_stats_t* total, const kk_stats_t* stats) {
+  for (kk_ssize_t i = 0; i < KK_STATS_TAGS; i++) {
+    total->allocs[i] += stats->allocs[i];
+    total->frees[i]  += stats->frees[i];
+  }
+  total->atomic_dup   += stats->atomic_dup;
+  total->atomic_drop  += stats->atomic_drop;
+  total->reuse_hit    += stats->reuse_hit;
+  total->reuse_miss   += stats->reuse_miss;
+  total->alloc_reused += stats->alloc_reused;
+  total->mark_shared  += stats->mark_shared;
+  total->mark_shared_blocks += stats->mark_shared_blocks;
+  if (stats->mark_shared_max > total->mark_shared_max) total->mark_shared_max = stats->mark_shared_max;
+}
+
+static void kk_stats_register(kk_context_t* ctx) {
+  kk_stats_lock_acquire();
+  ctx->stats_next = kk_stats_contexts;
+  kk_stats_contexts = ctx;
+  kk_stats_lock_release();
+}
+
+static void kk_stats_unregister(kk_context_t* ctx) {
+  kk_stats_lock_acquire();
+  for (kk_context_t** p = &kk_stats_contexts; *p != NULL; p = &(*p)->stats_next) {
+    if (*p == ctx) { *p = ctx->stats_next; break; }
+  }
+  kk_stats_add(&kk_stats_retired, &ctx->stats);
+  kk_stats_lock_release();
+}
+
+static const char* kk_stats_tag_name(kk_ssize_t i) {
+  if (i < KK_STATS_USER_TAGS - 1) return NULL;
+  if (i == KK_STATS_USER_TAGS - 1) return "user (>= 63)";
+  switch ((kk_tag_t)(i - KK_STATS_USER_TAGS + KK_TAG_MAX + 1)) {
+    case KK_TAG_OPEN:        return "open";
+    case KK_TAG_BOX:         return "box";
+    case KK_TAG_BOX_ANY:     return "box-any";
+    case KK_TAG_REF:         return "ref";
+    case KK_TAG_FUNCTION:    return "function";
+    case KK_TAG_BIGINT:      return "bigint";
+    case KK_TAG_BYTES_SMALL: return "bytes-small";
+    case KK_TAG_BYTES:       return "bytes";
+    case KK_TAG_VECTOR:      return "vector";
+    case KK_TAG_INT64:       return "int64";
+    case KK_TAG_DOUBLE:      return "double";
+    case KK_TAG_INT32:       return "int32";
+    case KK_TAG_FLOAT:       return "float";
+    case KK_TAG_INT16:       return "int16";
+    case KK_TAG_CFUNPTR:     return "cfunptr";
+    case KK_TAG_INTPTR:      return "intptr";
+    case KK_TAG_EVV_VECTOR:  return "evv-vector";
+    case KK_TAG_NOTHING:     return "nothing";
+    case KK_TAG_JUST:        return "just";
+    case KK_TAG_CPTR_RAW:    return "cptr-raw";
+    case KK_TAG_BYTES_RAW:   return "bytes-raw";
+    case KK_TAG_BYTES_ROPE:  return "bytes-rope";
+    case KK_TAG_BYTES_SLICE: return "bytes-slice";
+    case KK_TAG_UVECTOR:     return "uvector";
+    case KK_TAG_HAMT:        return "hamt";
+    case KK_TAG_HAMT_NODE:   return "hamt-node";
+    case KK_TAG_SWISS:       return "swiss";
+    default:                 return "special";
+  }
+}
+
+// Aggregate the statistics of all (live and freed) contexts
+static void kk_stats_total(kk_stats_t* total) {
+  kk_stats_lock_acquire();
+  *total = kk_stats_retired;
+  for (kk_context_t* c = kk_stats_contexts; c != NULL; c = c->stats_next) {
+    kk_stats_add(total, &c->stats);
+  }
+  kk_stats_lock_release();
+}
+
+// Print the aggregated statistics of all (live and freed) contexts
+kk_decl_export void kk_stats_print(kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_stats_t total;
+  kk_stats_total(&total);
+  kk_info_message("%-14s %14s %14s %14s\n", "tag", "allocs", "frees", "live");
+  for (kk_ssize_t i = 0; i < KK_STATS_TAGS; i++) {
+    if (total.allocs[i] == 0 && total.frees[i] == 0) continue;
+    const char* name = kk_stats_tag_name(i);
+    char buf[16];
+    if (name == NULL) { snprintf(buf, sizeof(buf), "%d", (int)i); name = buf; }
+    kk_info_message("%-14s %14lld %14lld %14lld\n", name, (long long)total.allocs[i], (long long)total.frees[i],
+                    (long long)(total.allocs[i] - total.frees[i]));
+  }
+  const int64_t reuses = total.reuse_hit + total.reuse_miss;
+  kk_info_message("reuse: %lld hits, %lld misses (%lld%%), %lld reused allocations\n",
+                  (long long)total.reuse_hit, (long long)total.reuse_miss,
+                  (long long)(reuses == 0 ? 0 : (100*total.reuse_hit)/reuses), (long long)total.alloc_reused);
+  kk_info_message("atomic refcount: %lld dups, %lld drops\n", (long long)total.atomic_dup, (long long)total.atomic_drop);
+  kk_info_message("mark shared: %lld calls, %lld blocks, max %lld blocks in a single call\n",
+                  (long long)total.mark_shared, (long long)total.mark_shared_blocks, (long long)total.mark_shared_max);
+}
+#endif
+
+/*--------------------------------------------------------------------------------------------------
+  Runtime statistics
+--------------------------------------------------------------------------------------------------*/
+
+#ifdef KK_MIMALLOC
+typedef struct kk_heap_usage_s {
+  size_t  committed;
+  size_t  used;
+  int64_t blocks;
+} kk_heap_usage_t;
+
+static bool kk_heap_area_visit(const mi_heap_t* heap, const mi_heap_area_t* area, void* block, size_t block_size, void* arg) {
+  kk_unused(heap); kk_unused(block); kk_unused(block_size);
+  kk_heap_usage_t* usage = (kk_heap_usage_t*)arg;
+  usage->committed += area->committed;
+  usage->used      += area->used * area->block_size;
+  usage->blocks    += (int64_t)area->used;
+  return true;
+}
+#endif
+
+kk_decl_export void kk_runtime_stats(kk_runtime_stats_t* stats, kk_context_t* ctx) {
+  memset(stats, 0, sizeof(*stats));
+  kk_process_info(&stats->user_time, &stats->sys_time, &stats->peak_rss, &stats->page_faults, &stats->page_reclaims, &stats->peak_commit);
+  stats->rss = kk_process_current_rss();
+  #ifdef KK_MIMALLOC
+  // only visits the heap areas (not every block) so this is cheap enough to poll
+  kk_heap_usage_t usage = { 0, 0, 0 };
+  mi_heap_visit_blocks(ctx->heap, false, &kk_heap_area_visit, &usage);
+  stats->heap_committed = usage.committed;
+  stats->heap_used      = usage.used;
+  stats->heap_blocks    = usage.blocks;
+  #endif
+  stats->delayed_free = ctx->delayed_free_count;
+  #if KK_STATS
+  kk_stats_t total;
+  kk_stats_total(&total);
+  for (kk_ssize_t i = 0; i < KK_STATS_TAGS; i++) {
+    stats->live_blocks += total.allocs[i] - total.frees[i];
+  }
+  stats->shared_blocks = total.mark_shared_blocks;
+  #else
+  stats->live_blocks = -1;
+  stats->shared_blocks = -1;
+  #endif
+  kk_task_stats_t tasks;
+  kk_task_stats(&tasks, ctx);
+  stats->task_workers  = tasks.workers;
+  stats->task_sleeping = tasks.sleeping;
+  stats->task_queued   = tasks.queued;
+  stats->task_executed = tasks.executed;
+  stats->task_busy     = tasks.busy;
+  stats->task_idle     = tasks.idle;
+  stats->promise_waits = tasks.promise_waits;
+  stats->promise_wait  = tasks.promise_wait;
+}
+
+kk_decl_export kk_ssize_t kk_runtime_stats_live(kk_ssize_t* tags, const char** names, int64_t* live, kk_ssize_t max, kk_context_t* ctx) {
+  kk_unused(ctx);
+  #if KK_STATS
+  kk_stats_t total;
+  kk_stats_total(&total);
+  kk_ssize_t count = 0;
+  for (kk_ssize_t i = 0; i < KK_STATS_TAGS && count < max; i++) {
+    const int64_t n = total.allocs[i] - total.frees[i];
+    if (n == 0) continue;
+    tags[count]  = i;
+    names[count] = kk_stats_tag_name(i);
+    live[count]  = n;
+    count++;
+  }
+  return count;
+  #else
+  kk_unused(tags); kk_unused(names); kk_unused(live); kk_unused(max);
+  return 0;
+  #endif
+}
+
+#if KK_STATS_REUSE
+/*--------------------------------------------------------------------------------------------------
+  Reuse profiling: a global hash table of allocation sites (`kk_block_alloc_at_as`) and of sites
+  that free an unused reuse token (`kk_reuse_drop`). Generated constructor functions are inlined
+  at their call sites but we can only record the definition site, so allocation sites correspond
+  to constructors. Entries are claimed by a CAS on the key and counted with relaxed atomics.
+--------------------------------------------------------------------------------------------------*/
+#define KK_REUSE_SITES  (4096)
+
+typedef struct kk_reuse_site_s {
+  _Atomic(uintptr_t) key;
+  const char*        file;
+  int                line;
+  _Atomic(int64_t)   fresh;     // allocated with `kk_reuse_null`
+  _Atomic(int64_t)   reused;    // allocated in a reused block
+  _Atomic(int64_t)   unused;    // a reuse token was freed without being used
+} kk_reuse_site_t;
+
+static kk_reuse_site_t kk_reuse_sites[KK_REUSE_SITES];
+
+static kk_reuse_site_t* kk_reuse_site_find(const char* file, int line) {
+  const uintptr_t key = ((uintptr_t)file ^ ((uintptr_t)line * 0x9E3779B1UL)) | 1;
+  uintptr_t i = (key ^ (key >> 15)) % KK_REUSE_SITES;
+  for (kk_ssize_t n = 0; n < KK_REUSE_SITES; n++, i = (i+1) % KK_REUSE_SITES) {
+    kk_reuse_site_t* site = &kk_reuse_sites[i];
+    uintptr_t k = kk_atomic_load_relaxed(&site->key);
+    if (k == key) return site;
+    if (k == 0) {
+      if (kk_atomic_cas_strong_relaxed(&site->key, &k, key)) {
+        site->file = file;
+        site->line = line;
+        return site;
+      }
+      if (k == key) return site;
+    }
+  }
+  return NULL;  // table is full
+}
+
+kk_decl_export void kk_reuse_site_alloc(const char* file, int line, bool reused) {
+  kk_reuse_site_t* site = kk_reuse_site_find(file, line);
+  if (site == NULL) return;
+  if (reused) { kk_atomic_inc_relaxed(&site->reused); }
+         else { kk_atomic_inc_relaxed(&site->fresh); }
+}
+
+kk_decl_export void kk_reuse_site_drop(const char* file, int line) {
+  kk_reuse_site_t* site = kk_reuse_site_find(file, line);
+  if (site != NULL) { kk_atomic_inc_relaxed(&site->unused); }
+}
+
+// sort by the number of lost reuse opportunities: fresh allocations plus unused reuse tokens
+static int64_t kk_reuse_site_lost(const kk_reuse_site_t* site) {
+  return (kk_atomic_load_relaxed(&site->fresh) + kk_atomic_load_relaxed(&site->unused));
+}
+
+static int kk_reuse_site_compare(const void* p1, const void* p2) {
+  const int64_t x = kk_reuse_site_lost(*(const kk_reuse_site_t**)p1);
+  const int64_t y = kk_reuse_site_lost(*(const kk_reuse_site_t**)p2);
+  return (x < y ? 1 : (x > y ? -1 : 0));
+}
+
+// Print the reuse statistics of all sites, sorted by lost reuse opportunities
+kk_decl_export void kk_reuse_sites_print(kk_context_t* ctx) {
+  kk_unused(ctx);
+  static kk_reuse_site_t* sites[KK_REUSE_SITES];
+  kk_ssize_t count = 0;
+  for (kk_ssize_t i = 0; i < KK_REUSE_SITES; i++) {
+    if (kk_reuse_sites[i].file != NULL) { sites[count++] = &kk_reuse_sites[i]; }
+  }
+  if (count == 0) return;
+  qsort(sites, (size_t)count, sizeof(kk_reuse_site_t*), &kk_reuse_site_compare);
+  kk_info_message("%12s %12s %6s %12s   %s\n", "fresh", "reused", "reuse", "unused", "site");
+  for (kk_ssize_t i = 0; i < count; i++) {
+    const kk_reuse_site_t* site = sites[i];
+    const int64_t fresh  = kk_atomic_load_relaxed(&site->fresh);
+    const int64_t reused = kk_atomic_load_relaxed(&site->reused);
+    const int64_t unused = kk_atomic_load_relaxed(&site->unused);
+    const int64_t total  = fresh + reused;
+    kk_info_message("%12lld %12lld %5lld%% %12lld   %s:%d\n", (long long)fresh, (long long)reused,
+                    (long long)(total == 0 ? 0 : (100*reused)/total), (long long)unused, site->file, site->line);
+  }
+}
+#endif
+
 // Get the thread local context (also initializes on demand)
 kk_context_t* kk_get_context(void) {
   kk_context_t* ctx = context;
@@ -205,19 +502,64 @@ kk_context_t* kk_get_context(void) {
   ctx->evv = kk_block_dup(kk_evv_empty_singleton);
   ctx->thread_id = (size_t)(&context);
   ctx->unique = kk_integer_one;
+  ctx->yield.conts = ctx->yield.conts_inline;
+  ctx->yield.conts_size = KK_YIELD_CONT_MAX;
   context = ctx;
   ctx->kk_box_any = kk_block_alloc_as(struct kk_box_any_s, 0, KK_TAG_BOX_ANY, ctx);  
   ctx->kk_box_any->_unused = kk_integer_zero;
+  #if KK_STATS
+  kk_stats_register(ctx);
+  #endif
+  if (kk_unlikely(kk_profile_is_enabled())) {
+    kk_profile_thread_init(ctx);
+  }
   // todo: register a thread_done function to release the context on thread terminatation.
   return ctx;
 }
 
+static _Atomic(uintptr_t) kk_thread_done_funs[KK_THREAD_DONE_MAX];  // kk_thread_done_fun_t*
+
+bool kk_thread_done_register(kk_thread_done_fun_t* fun) {
+  for (size_t i = 0; i < KK_THREAD_DONE_MAX; i++) {
+    uintptr_t expected = 0;
+    if (kk_atomic_cas_strong_acq_rel(&kk_thread_done_funs[i], &expected, (uintptr_t)fun)) return true;
+    if (expected == (uintptr_t)fun) return true;  // already registered
+  }
+  return false;
+}
+
+static void kk_thread_done_call(kk_context_t* ctx) {
+  for (size_t i = 0; i < KK_THREAD_DONE_MAX; i++) {
+    kk_thread_done_fun_t* fun = (kk_thread_done_fun_t*)kk_atomic_load_acquire(&kk_thread_done_funs[i]);
+    if (fun == NULL) break;
+    fun(ctx);
+  }
+}
+
 void kk_free_context(void) {
   if (context != NULL) {
+    kk_thread_done_call(context);
+    kk_output_free(context);
     kk_block_drop(context->evv, context);
+    kk_evloop_free(context);
     kk_basetype_free(context->kk_box_any,context);
     // kk_basetype_drop_assert(context->kk_box_any, KK_TAG_BOX_ANY, context);
-    // TODO: process delayed_free
+    do {
+      kk_block_free_delayed_all(context);
+    } while (kk_block_drop_deferred_flush(context));  // applying deferred drops may delay frees again
+    if (context->drop_deferred != NULL) {
+      kk_free(context->drop_deferred,context);
+    }
+    if (context->srandom_ctx != NULL) {
+      memset(context->srandom_ctx, 0, sizeof(*context->srandom_ctx));  // do not leave the key behind
+      kk_free(context->srandom_ctx,context);
+    }
+    if (context->yield.conts != context->yield.conts_inline) {
+      kk_free(context->yield.conts,context);
+    }
+    #if KK_STATS
+    kk_stats_unregister(context);
+    #endif
 #ifdef KK_MIMALLOC
     // mi_heap_t* heap = context->heap;
     mi_free(context);
@@ -243,6 +585,9 @@ kk_decl_export kk_context_t* kk_main_start(int argc, char** argv) {
       if (strcmp(arg, "--kktime")==0) {
         ctx->process_start = kk_timer_start();
       }
+      else if (strncmp(arg, "--kkprofile", 11)==0 && (arg[11]==0 || arg[11]=='=')) {
+        kk_profile_start(arg[11]=='=' ? arg + 12 : NULL, ctx);
+      }
       else {
         break;
       }
@@ -258,6 +603,8 @@ kk_decl_export kk_context_t* kk_main_start(int argc, char** argv) {
 }
 
 kk_decl_export void  kk_main_end(kk_context_t* ctx) {
+  kk_output_flush(ctx);
+  kk_profile_end(ctx);
   if (ctx->process_start != 0) {  // started with --kktime option
     kk_usecs_t wall_time = kk_timer_end(ctx->process_start);
     kk_msecs_t user_time;
@@ -267,12 +614,24 @@ kk_decl_export void  kk_main_end(kk_context_t* ctx) {
     size_t page_reclaim;
     size_t peak_commit;
     kk_process_info(&user_time, &sys_time, &peak_rss, &page_faults, &page_reclaim, &peak_commit);
-    kk_info_message("elapsed: %ld.%03lds, user: %ld.%03lds, sys: %ld.%03lds, rss: %lu%s\n", 
+    kk_info_message("elapsed: %ld.%03lds, user: %ld.%03lds, sys: %ld.%03lds, rss: %lu%s, faults: %lu/%lu\n", 
                     (long)(wall_time/1000000), (long)((wall_time%1000000)/1000), 
                     user_time/1000, user_time%1000, sys_time/1000, sys_time%1000, 
                     (peak_rss > 10*1024*1024 ? peak_rss/(1024*1024) : peak_rss/1024),
-                    (peak_rss > 10*1024*1024 ? "mb" : "kb") );
+                    (peak_rss > 10*1024*1024 ? "mb" : "kb"),
+                    (unsigned long)page_faults, (unsigned long)page_reclaim );
+    if (ctx->delayed_free_steps > 0) {
+      kk_info_message("delayed free: %lld blocks in %lld steps, peak backlog: %lld, pending: %lld\n",
+                      (long long)ctx->delayed_free_freed, (long long)ctx->delayed_free_steps, 
+                      (long long)ctx->delayed_free_peak, (long long)ctx->delayed_free_count );
+    }
   }
+  #if KK_STATS
+  kk_stats_print(ctx);
+  #endif
+  #if KK_STATS_REUSE
+  kk_reuse_sites_print(ctx);
+  #endif
 }
 
 
@@ -17,7 +17,7 @@ Big integers. For our purposes, we need an implementation that does not
 have to be the fastest possible; we instead aim for portable, simple,
 well performing, and with fast conversion to/from decimal strings.
 Still, it performs quite respectable and does have various optimizations
-including Karatsuba multiplication.
+including Karatsuba, Toom-3, and NTT based multiplication.
 
   Big integers are arrays of `digits` with a `count` and `is_neg` flag.
   For a number `n` we have:
@@ -315,6 +315,7 @@ static kk_bigint_t* bigint_push(kk_bigint_t* x, kk_digit_t d, kk_context_t* ctx)
 // Bigint to integer. Possibly converting to a small int.
 static kk_integer_t integer_bigint(kk_bigint_t* x, kk_context_t* ctx) {
   if (x->count==0) {
+    drop_bigint(x,ctx);
     return kk_integer_zero;
   }
   else if (x->count==1
@@ -330,6 +331,7 @@ static kk_integer_t integer_bigint(kk_bigint_t* x, kk_context_t* ctx) {
     return kk_integer_from_small(i);
   }
   else {
+    kk_probe1(bigint, x->count);  // a result that needs a bigint
     return bigint_as_integer_(x);
   }
 }
@@ -513,6 +515,52 @@ static kk_string_t kk_int_to_string(kk_intx_t n, kk_context_t* ctx) {
 /*----------------------------------------------------------------------
   Parse an integer
 ----------------------------------------------------------------------*/
+
+// Are the 8 bytes in `x` all decimal digits?
+static inline bool kk_parse_is_digits8(uint64_t x) {
+  return (((x & KK_U64(0xF0F0F0F0F0F0F0F0)) | (((x + KK_U64(0x0606060606060606)) & KK_U64(0xF0F0F0F0F0F0F0F0)) >> 4)) == KK_U64(0x3333333333333333));
+}
+
+static inline uint64_t kk_parse_read8(const char* p) {
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  return kk_bits_bswap_from_le64(x);  // the first digit in the lowest byte
+}
+
+// Convert 8 digits at once with SWAR multiplies: pairs first, then quads, and the final 8 digits.
+// see <https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/>
+static inline uint32_t kk_parse_digits8(uint64_t x) {
+  x -= KK_U64(0x3030303030303030);
+  x = (x * 10) + (x >> 8);
+  x = (((x & KK_U64(0x000000FF000000FF)) * KK_U64(0x000F424000000064))          // 100 + (1000000 << 32)
+      + (((x >> 16) & KK_U64(0x000000FF000000FF)) * KK_U64(0x0000271000000001)))  // 1 + (10000 << 32)
+      >> 32;
+  return (uint32_t)x;
+}
+
+// Fast path for plain decimal digits `s` of length `len <= 19`, 8 digits at a time.
+static inline bool kk_integer_parse_digits(const char* s, kk_ssize_t len, bool is_neg, kk_integer_t* res, kk_context_t* ctx) {
+  kk_assert_internal(len > 0 && len <= 19);
+  uint64_t x = 0;
+  kk_ssize_t n = len % 8;
+  if (n > 0) {
+    // pad the first partial chunk with leading zeros
+    char buf[8] = { '0', '0', '0', '0', '0', '0', '0', '0' };
+    memcpy(buf + 8 - n, s, (size_t)n);
+    const uint64_t w = kk_parse_read8(buf);
+    if (!kk_parse_is_digits8(w)) return false;
+    x = kk_parse_digits8(w);
+  }
+  for (; n < len; n += 8) {
+    const uint64_t w = kk_parse_read8(s + n);
+    if (!kk_parse_is_digits8(w)) return false;
+    x = (x * 100000000) + kk_parse_digits8(w);
+  }
+  if (x > INT64_MAX) return false;
+  *res = kk_integer_from_int64(is_neg ? -(int64_t)x : (int64_t)x, ctx);
+  return true;
+}
+
 kk_decl_export bool kk_integer_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
   kk_assert_internal(s!=NULL && res != NULL);
   if (res==NULL) return false;
@@ -530,6 +578,9 @@ kk_decl_export bool kk_integer_parse(const char* s, kk_integer_t* res, kk_contex
     return kk_integer_hex_parse(s, res, ctx);
   }
   if (!kk_ascii_is_digit(s[i])) return false;  // must start with a digit
+  // fast path for at most 19 plain digits (without underscores, fraction, or exponent)
+  const kk_ssize_t len = kk_sstrlen(s + i);
+  if (len <= 19 && kk_integer_parse_digits(s + i, len, is_neg, res, ctx)) return true;
   // significant
   for (; s[i] != 0; i++) {
     char c = s[i];
@@ -621,6 +672,16 @@ kk_decl_export bool kk_integer_parse(const char* s, kk_integer_t* res, kk_contex
     kk_digit_t d = 0;
     // read a full digit
     for (kk_ssize_t j = 0; j < chunk; ) {
+      if (j + 8 <= chunk && end - p >= 8) {
+        const uint64_t w = kk_parse_read8(p);
+        if (kk_parse_is_digits8(w)) {  // 8 digits at once
+          d = (d * 100000000) + kk_parse_digits8(w); kk_assert_internal(d<BASE);
+          p += 8;
+          digits += 8;
+          j += 8;
+          continue;
+        }
+      }
       char c = (p < end ? *p++ : '0'); // fill out with zeros
       if (kk_ascii_is_digit(c)) {
         digits++;
@@ -636,7 +697,7 @@ kk_decl_export bool kk_integer_parse(const char* s, kk_integer_t* res, kk_contex
   // set the final zeros
   kk_assert_internal(k == 0 || zero_digits / LOG_BASE == k);
   for (kk_ssize_t j = 0; j < k; j++) { b->digits[j] = 0; }
-  *res = integer_bigint(b, ctx);
+  *res = integer_bigint(kk_bigint_trim(b, true, ctx), ctx);  // trim any leading zeros
   return true;
 }
 
@@ -654,6 +715,13 @@ kk_integer_t kk_integer_from_str(const char* num, kk_context_t* ctx) {
 
 static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context_t* ctx);
 static kk_bigint_t* kk_bigint_add_abs_small(kk_bigint_t* x, kk_digit_t y, kk_context_t* ctx);
+static kk_bigint_t* kk_bigint_from_hex_digits(const uint8_t* h, kk_ssize_t n, bool is_neg, kk_context_t* ctx);
+
+#define KK_HEX_PARSE_DC_THRESHOLD  (4096)  // in hex digits
+
+static uint8_t kk_hex_digit_value(char c) {
+  return (uint8_t)(kk_ascii_is_digit(c) ? c - '0' : 10 + (kk_ascii_is_lower(c) ? c - 'a' : c - 'A'));
+}
 
 bool kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
   kk_assert_internal(s!=NULL && res != NULL);
@@ -706,6 +774,20 @@ bool kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
     return true;
   }
   
+  // large numbers are converted divide-and-conquer
+  if (hdigits >= KK_HEX_PARSE_DC_THRESHOLD) {
+    uint8_t* h = (uint8_t*)kk_malloc(hdigits, ctx);
+    if (h != NULL) {
+      kk_ssize_t n = 0;
+      for (const char* p = start; p < end; p++) {
+        if (kk_ascii_is_hexdigit(*p)) { h[n++] = kk_hex_digit_value(*p); }
+      }
+      *res = integer_bigint(kk_bigint_from_hex_digits(h, n, is_neg, ctx), ctx);
+      kk_free(h, ctx);
+      return true;
+    }
+  }
+
   // otherwise construct a big int
   const kk_ssize_t count = (kk_ssize_t)(ceil((double)hdigits * KK_LOG16_DIV_LOG10)) + 1; // conservatively overallocate to max needed.
   kk_extra_t ecount = (count >= MAX_EXTRA ? MAX_EXTRA-1 : (kk_extra_t)count);
@@ -948,29 +1030,512 @@ static kk_bigint_t* kk_bigint_sub_abs(kk_bigint_t* x, kk_bigint_t* y, kk_context
 }
 
 /*----------------------------------------------------------------------
-  Multiply & Sqr. including Karatsuba multiplication
+  Multiply & Sqr.
+
+  Large multiplications work directly on digit arrays:
+  - below `KK_KARATSUBA_THRESHOLD` digits we use the schoolbook method;
+  - Karatsuba and Toom-3 recurse within a single scratch buffer
+    allocated up front (see `digits_mul_scratch`);
+  - unbalanced operands are multiplied in chunks of the shorter one;
+  - huge operands use a number theoretic transform (NTT) modulo a
+    62-bit prime (only with 64-bit digits and 128-bit multiplication).
+  The thresholds are in digits of the shorter operand; they were tuned
+  with 64-bit digits on x64 (see `test/bench/koka/bigint-mul.kk`).
 ----------------------------------------------------------------------*/
 
+#define KK_KARATSUBA_THRESHOLD  (16)
+#define KK_TOOM3_THRESHOLD      (100)
+#define KK_NTT_THRESHOLD        (400)
+
+static void digits_zero(kk_digit_t* z, kk_ssize_t n) {
+  if (n > 0) kk_memset(z, 0, n*kk_ssizeof(kk_digit_t));
+}
+
+static void digits_copy(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t n) {
+  if (n > 0) kk_memcpy(z, x, n*kk_ssizeof(kk_digit_t));
+}
+
+// length without leading zero digits
+static kk_ssize_t digits_trim(const kk_digit_t* x, kk_ssize_t n) {
+  while (n > 0 && x[n-1] == 0) { n--; }
+  return n;
+}
+
+static int digits_compare(const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny) {
+  nx = digits_trim(x, nx);
+  ny = digits_trim(y, ny);
+  if (nx != ny) return (nx > ny ? 1 : -1);
+  for (kk_ssize_t i = nx; i > 0; ) {
+    i--;
+    if (x[i] != y[i]) return (x[i] > y[i] ? 1 : -1);
+  }
+  return 0;
+}
+
+// z[0..nz) += x[0..nx); returns the carry out
+static kk_digit_t digits_add_to(kk_digit_t* z, kk_ssize_t nz, const kk_digit_t* x, kk_ssize_t nx) {
+  kk_assert_internal(nz >= nx);
+  kk_digit_t carry = 0;
+  kk_ssize_t i;
+  for (i = 0; i < nx; i++) {
+    kk_digit_t sum = z[i] + x[i] + carry;
+    if (sum >= BASE) { sum -= BASE; carry = 1; }
+                else { carry = 0; }
+    z[i] = sum;
+  }
+  for (; carry != 0 && i < nz; i++) {
+    if (z[i] == BASE - 1) { z[i] = 0; }
+                     else { z[i]++; carry = 0; }
+  }
+  return carry;
+}
+
+// z[0..nz) -= x[0..nx) where z >= x
+static void digits_sub_from(kk_digit_t* z, kk_ssize_t nz, const kk_digit_t* x, kk_ssize_t nx) {
+  nx = digits_trim(x, nx);
+  kk_assert_internal(nz >= nx);
+  kk_digit_t borrow = 0;
+  kk_ssize_t i;
+  for (i = 0; i < nx; i++) {
+    const kk_digit_t sub = x[i] + borrow;
+    if (z[i] < sub) { z[i] = z[i] + BASE - sub; borrow = 1; }
+               else { z[i] -= sub; borrow = 0; }
+  }
+  for (; borrow != 0 && i < nz; i++) {
+    if (z[i] == 0) { z[i] = BASE - 1; }
+              else { z[i]--; borrow = 0; }
+  }
+  kk_assert_internal(borrow == 0);
+}
+
+// The following small multiplies and divides are with `y <= 16` such that
+// intermediate results fit in 64 bits (as `16*BASE + 2*BASE < 2^64`).
+#define DIGITS_SMALL_MAX  (16)
+
+// z[0..nz) += y*x[0..nx)
+static void digits_addmul_small(kk_digit_t* z, kk_ssize_t nz, const kk_digit_t* x, kk_ssize_t nx, kk_digit_t y) {
+  kk_assert_internal(nz >= nx && y <= DIGITS_SMALL_MAX);
+  kk_digit_t carry = 0;
+  kk_ssize_t i;
+  for (i = 0; i < nx; i++) {
+    const uint64_t v = ((uint64_t)x[i] * y) + z[i] + carry;
+    z[i]  = (kk_digit_t)(v % (uint64_t)BASE);
+    carry = (kk_digit_t)(v / (uint64_t)BASE);
+  }
+  for (; carry != 0 && i < nz; i++) {
+    const kk_digit_t sum = z[i] + carry;
+    if (sum >= BASE) { z[i] = sum - BASE; carry = 1; }
+                else { z[i] = sum; carry = 0; }
+  }
+  kk_assert_internal(carry == 0);
+}
+
+// z[0..nz) -= y*x[0..nx) where z >= y*x
+static void digits_submul_small(kk_digit_t* z, kk_ssize_t nz, const kk_digit_t* x, kk_ssize_t nx, kk_digit_t y) {
+  nx = digits_trim(x, nx);
+  kk_assert_internal(nz >= nx && y <= DIGITS_SMALL_MAX);
+  kk_digit_t borrow = 0;
+  kk_ssize_t i;
+  for (i = 0; i < nx; i++) {
+    const uint64_t v = ((uint64_t)x[i] * y) + borrow;
+    const kk_digit_t sub = (kk_digit_t)(v % (uint64_t)BASE);
+    kk_digit_t hi = (kk_digit_t)(v / (uint64_t)BASE);
+    if (z[i] < sub) { z[i] = z[i] + BASE - sub; hi++; }
+               else { z[i] -= sub; }
+    borrow = hi;
+  }
+  for (; borrow != 0 && i < nz; i++) {
+    if (z[i] < borrow) { z[i] = z[i] + BASE - borrow; borrow = 1; }
+                  else { z[i] -= borrow; borrow = 0; }
+  }
+  kk_assert_internal(borrow == 0);
+}
+
+// x[0..n) /= y where `y` divides x exactly
+static void digits_divexact_small(kk_digit_t* x, kk_ssize_t n, kk_digit_t y) {
+  kk_assert_internal(y <= DIGITS_SMALL_MAX);
+  uint64_t rem = 0;
+  for (kk_ssize_t i = n; i > 0; ) {
+    i--;
+    const uint64_t v = (rem * (uint64_t)BASE) + x[i];
+    x[i] = (kk_digit_t)(v / y);
+    rem  = v % y;
+  }
+  kk_assert_internal(rem == 0);
+}
+
+// z[0..nx+ny) = x*y
+static void digits_mul_school(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny) {
+  digits_zero(z, nx + ny);
+  for (kk_ssize_t i = 0; i < nx; i++) {
+    kk_digit_t dx = x[i];
+    for (kk_ssize_t j = 0; j < ny; j++) {
+      kk_digit_t dy = y[j];
+      kk_ddigit_t prod = ddigit_mul_add(dx,dy,z[i+j]);
+      kk_digit_t rem;
+      kk_digit_t carry = ddigit_cdiv(prod, BASE, &rem);
+      z[i+j]    = rem;
+      z[i+j+1] += carry;
+    }
+  }
+}
+
+static void digits_mul_rec(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_digit_t* scratch, kk_context_t* ctx);
+
+// A safe bound on the scratch digits needed by `digits_mul_rec` for operands of at most `n` digits.
+// This covers a chunk product at each level with the Toom-3 buffers over the Karatsuba split.
+static kk_ssize_t digits_mul_scratch(kk_ssize_t n) {
+  kk_ssize_t total = 0;
+  while (n >= KK_KARATSUBA_THRESHOLD) {
+    total += 2*n + 10*(((n + 2)/3) + 1);
+    n = ((n + 1)/2) + 1;
+  }
+  return total;
+}
+
+// nx >= 2*ny: multiply in chunks of `ny` digits
+static void digits_mul_unbalanced(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_digit_t* scratch, kk_context_t* ctx) {
+  kk_digit_t* t = scratch;  // 2*ny
+  scratch += 2*ny;
+  digits_mul_rec(z, x, ny, y, ny, scratch, ctx);
+  digits_zero(z + 2*ny, nx - ny);
+  for (kk_ssize_t i = ny; i < nx; i += ny) {
+    const kk_ssize_t n = (nx - i < ny ? nx - i : ny);
+    digits_mul_rec(t, x + i, n, y, ny, scratch, ctx);
+    kk_digit_t carry = digits_add_to(z + i, nx + ny - i, t, n + ny);
+    kk_assert_internal(carry == 0); kk_unused_internal(carry);
+  }
+}
+
+// nx >= ny > nx/2: with x = x1*B^m + x0 and y = y1*B^m + y0,
+//   x*y = x1*y1*B^2m + ((x0 + x1)*(y0 + y1) - x0*y0 - x1*y1)*B^m + x0*y0
+static void digits_mul_karatsuba(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_digit_t* scratch, kk_context_t* ctx) {
+  const kk_ssize_t m = (nx + 1)/2;
+  kk_assert_internal(ny >= m);
+  kk_digit_t* sx = scratch;       // m+1
+  kk_digit_t* sy = sx + (m + 1);  // m+1
+  kk_digit_t* t  = sy + (m + 1);  // 2m+2
+  scratch = t + 2*(m + 1);
+  // z = x1*y1*B^2m + x0*y0
+  digits_mul_rec(z, x, m, y, m, scratch, ctx);
+  digits_mul_rec(z + 2*m, x + m, nx - m, y + m, ny - m, scratch, ctx);
+  // t = (x0 + x1)*(y0 + y1) - x0*y0 - x1*y1
+  digits_copy(sx, x, m);
+  sx[m] = digits_add_to(sx, m, x + m, nx - m);
+  digits_copy(sy, y, m);
+  sy[m] = digits_add_to(sy, m, y + m, ny - m);
+  digits_mul_rec(t, sx, m + 1, sy, m + 1, scratch, ctx);
+  digits_sub_from(t, 2*(m + 1), z, 2*m);
+  digits_sub_from(t, 2*(m + 1), z + 2*m, nx + ny - 2*m);
+  // and add it in
+  kk_digit_t carry = digits_add_to(z + m, nx + ny - m, t, digits_trim(t, 2*(m + 1)));
+  kk_assert_internal(carry == 0); kk_unused_internal(carry);
+}
+
+// length of the i'th Toom-3 part of an `n` digit number split at `k` digits.
+static kk_ssize_t digits_toom3_part(kk_ssize_t n, kk_ssize_t k, kk_ssize_t i) {
+  const kk_ssize_t lo = i*k;
+  const kk_ssize_t hi = (i == 2 || n < (i + 1)*k ? n : (i + 1)*k);
+  return (hi > lo ? hi - lo : 0);
+}
+
+// e[0..k] = |x2*p^2 + x1*p + x0| for the point p = 1, -1, or 2; returns `true` if negative.
+static bool digits_toom3_eval(kk_digit_t* e, const kk_digit_t* x, kk_ssize_t n, kk_ssize_t k, int p) {
+  const kk_digit_t* x1 = x + k;
+  const kk_digit_t* x2 = x + 2*k;
+  const kk_ssize_t  n1 = digits_toom3_part(n, k, 1);
+  const kk_ssize_t  n2 = digits_toom3_part(n, k, 2);
+  digits_zero(e, k + 1);
+  digits_copy(e, x, digits_toom3_part(n, k, 0));
+  if (p == 2) {
+    digits_addmul_small(e, k + 1, x1, n1, 2);
+    digits_addmul_small(e, k + 1, x2, n2, 4);
+    return false;
+  }
+  digits_add_to(e, k + 1, x2, n2);
+  if (p == 1) {
+    digits_add_to(e, k + 1, x1, n1);
+    return false;
+  }
+  if (digits_compare(e, k + 1, x1, n1) >= 0) {
+    digits_sub_from(e, k + 1, x1, n1);
+    return false;
+  }
+  // e = x1 - e
+  kk_digit_t borrow = 0;
+  for (kk_ssize_t i = 0; i <= k; i++) {
+    const kk_digit_t d = (i < n1 ? x1[i] : 0);
+    const kk_digit_t sub = e[i] + borrow;
+    if (d < sub) { e[i] = d + BASE - sub; borrow = 1; }
+            else { e[i] = d - sub; borrow = 0; }
+  }
+  kk_assert_internal(borrow == 0);
+  return true;
+}
+
+// nx >= ny > 2*ceil(nx/3): with x and y split in three parts of `k` digits, the product
+// r4*B^4k + r3*B^3k + r2*B^2k + r1*B^k + r0 is interpolated from the products of the
+// parts evaluated at 0, 1, -1, 2, and infinity. As all `r_i` are non-negative we can use
+// unsigned digit arithmetic throughout.
+static void digits_mul_toom3(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_digit_t* scratch, kk_context_t* ctx) {
+  const kk_ssize_t k  = (nx + 2)/3;
+  const kk_ssize_t ek = k + 1;      // digits of an evaluated part
+  const kk_ssize_t pk = 2*ek;       // digits of a product of evaluated parts
+  const kk_ssize_t nz = nx + ny;
+  kk_assert_internal(ny > 2*k);
+  kk_digit_t* ex  = scratch;
+  kk_digit_t* ey  = ex + ek;
+  kk_digit_t* w1  = ey + ek;
+  kk_digit_t* wm1 = w1 + pk;
+  kk_digit_t* w2  = wm1 + pk;
+  kk_digit_t* r2  = w2 + pk;
+  scratch = r2 + pk;
+
+  // r0 = x0*y0, r4 = x2*y2
+  kk_digit_t* r0 = z;
+  kk_digit_t* r4 = z + 4*k;
+  const kk_ssize_t n4 = nz - 4*k;
+  digits_mul_rec(r0, x, k, y, k, scratch, ctx);
+  digits_zero(z + 2*k, 2*k);
+  digits_mul_rec(r4, x + 2*k, nx - 2*k, y + 2*k, ny - 2*k, scratch, ctx);
+
+  // w1 = x(1)*y(1), wm1 = x(-1)*y(-1), w2 = x(2)*y(2)
+  digits_toom3_eval(ex, x, nx, k, 1);
+  digits_toom3_eval(ey, y, ny, k, 1);
+  digits_mul_rec(w1, ex, ek, ey, ek, scratch, ctx);
+  const bool wm1_neg = (digits_toom3_eval(ex, x, nx, k, -1) != digits_toom3_eval(ey, y, ny, k, -1));
+  digits_mul_rec(wm1, ex, ek, ey, ek, scratch, ctx);
+  digits_toom3_eval(ex, x, nx, k, 2);
+  digits_toom3_eval(ey, y, ny, k, 2);
+  digits_mul_rec(w2, ex, ek, ey, ek, scratch, ctx);
+
+  // interpolate: r2 = (w1 + wm1)/2 - r0 - r4
+  digits_copy(r2, w1, pk);
+  if (!wm1_neg) {
+    digits_add_to(r2, pk, wm1, pk);
+    digits_sub_from(w1, pk, wm1, pk);
+  }
+  else {
+    digits_sub_from(r2, pk, wm1, pk);
+    digits_add_to(w1, pk, wm1, pk);
+  }
+  digits_divexact_small(r2, pk, 2);
+  digits_sub_from(r2, pk, r0, 2*k);
+  digits_sub_from(r2, pk, r4, n4);
+  // w1 = (w1 - wm1)/2 = r1 + r3, w2 = (w2 - r0 - 4*r2 - 16*r4)/2 = r1 + 4*r3
+  digits_divexact_small(w1, pk, 2);
+  digits_sub_from(w2, pk, r0, 2*k);
+  digits_submul_small(w2, pk, r2, pk, 4);
+  digits_submul_small(w2, pk, r4, n4, 16);
+  digits_divexact_small(w2, pk, 2);
+  // r3 = (w2 - w1)/3, r1 = w1 - r3
+  digits_sub_from(w2, pk, w1, pk);
+  digits_divexact_small(w2, pk, 3);
+  digits_sub_from(w1, pk, w2, pk);
+
+  // and add in r1, r2, and r3
+  digits_add_to(z + k, nz - k, w1, digits_trim(w1, pk));
+  digits_add_to(z + 2*k, nz - 2*k, r2, digits_trim(r2, pk));
+  digits_add_to(z + 3*k, nz - 3*k, w2, digits_trim(w2, pk));
+}
+
+
+#if (LOG_BASE==18) && defined(__SIZEOF_INT128__)
+#define KK_BIGINT_NTT  1
+
+/*----------------------------------------------------------------------
+  Number theoretic transform modulo the prime `P = 29*2^57 + 1`.
+  Each digit is split into 3 chunks of 10^6 such that every coefficient
+  of the convolution (at most `min(nx,ny)*3*10^12`) is less than `P` as
+  long as the total number of chunks is at most 2^22. All arithmetic is
+  in Montgomery form with `R = 2^64`.
+----------------------------------------------------------------------*/
+
+#define NTT_P          KK_U64(4179340454199820289)   // 29*2^57 + 1
+#define NTT_PINV       KK_U64(4179340454199820287)   // -P^-1 mod R
+#define NTT_R          KK_U64(1729382256910270460)   // R mod P
+#define NTT_R2         KK_U64(1878466934230121386)   // R^2 mod P
+#define NTT_G          KK_U64(3)                     // generator of the multiplicative group
+#define NTT_CHUNK      KK_U64(1000000)
+#define NTT_MAX_CHUNKS (KK_I64(1)<<22)
+
+static inline uint64_t ntt_redc(kk_ddigit_t t) {
+  const uint64_t m = (uint64_t)t * NTT_PINV;
+  const uint64_t r = (uint64_t)((t + (kk_ddigit_t)m * NTT_P) >> 64);
+  return (r >= NTT_P ? r - NTT_P : r);
+}
+
+static inline uint64_t ntt_mul(uint64_t x, uint64_t y) {
+  return ntt_redc((kk_ddigit_t)x * y);
+}
+
+static inline uint64_t ntt_add(uint64_t x, uint64_t y) {
+  const uint64_t r = x + y;
+  return (r >= NTT_P ? r - NTT_P : r);
+}
+
+static inline uint64_t ntt_sub(uint64_t x, uint64_t y) {
+  return (x >= y ? x - y : x + NTT_P - y);
+}
+
+static uint64_t ntt_pow(uint64_t x, uint64_t e) {
+  uint64_t r = NTT_R;  // 1
+  while (e > 0) {
+    if ((e&1) != 0) r = ntt_mul(r, x);
+    x = ntt_mul(x, x);
+    e >>= 1;
+  }
+  return r;
+}
+
+// in-place forward transform of `n` (a power of 2) elements using the twiddle factors `w[0..n/2)`
+static void ntt_transform(uint64_t* a, kk_ssize_t n, const uint64_t* w) {
+  for (kk_ssize_t i = 1, j = 0; i < n; i++) {
+    kk_ssize_t bit = n >> 1;
+    for (; (j & bit) != 0; bit >>= 1) { j ^= bit; }
+    j ^= bit;
+    if (i < j) { uint64_t t = a[i]; a[i] = a[j]; a[j] = t; }
+  }
+  for (kk_ssize_t len = 2; len <= n; len <<= 1) {
+    const kk_ssize_t half = len/2;
+    const kk_ssize_t step = n/len;
+    for (kk_ssize_t i = 0; i < n; i += len) {
+      for (kk_ssize_t j = 0; j < half; j++) {
+        const uint64_t u = a[i + j];
+        const uint64_t v = ntt_mul(a[i + j + half], w[j*step]);
+        a[i + j]        = ntt_add(u, v);
+        a[i + j + half] = ntt_sub(u, v);
+      }
+    }
+  }
+}
+
+static void ntt_split(uint64_t* a, kk_ssize_t n, const kk_digit_t* x, kk_ssize_t nx) {
+  for (kk_ssize_t i = 0; i < nx; i++) {
+    kk_digit_t d = x[i];
+    a[3*i]     = ntt_mul(d % NTT_CHUNK, NTT_R2);  d /= NTT_CHUNK;
+    a[3*i + 1] = ntt_mul(d % NTT_CHUNK, NTT_R2);  d /= NTT_CHUNK;
+    a[3*i + 2] = ntt_mul(d, NTT_R2);
+  }
+  kk_memset(a + 3*nx, 0, (n - 3*nx)*kk_ssizeof(uint64_t));
+}
+
+static bool digits_use_ntt(kk_ssize_t nx, kk_ssize_t ny) {
+  return ((nx < ny ? nx : ny) >= KK_NTT_THRESHOLD && 3*(nx + ny) <= NTT_MAX_CHUNKS);
+}
+
+// z[0..nx+ny) = x*y
+static void digits_mul_ntt(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_context_t* ctx) {
+  kk_ssize_t n = 1;
+  while (n < 3*(nx + ny)) { n *= 2; }
+  uint64_t* a = (uint64_t*)kk_malloc((2*n + n/2) * kk_ssizeof(uint64_t), ctx);
+  if (a == NULL) {
+    kk_fatal_error(ENOMEM, "out of memory multiplying big integers");
+    return;
+  }
+  uint64_t* b = a + n;
+  uint64_t* w = b + n;
+  // twiddle factors
+  const uint64_t root = ntt_pow(ntt_mul(NTT_G, NTT_R2), (NTT_P - 1) / (uint64_t)n);
+  w[0] = NTT_R;
+  for (kk_ssize_t i = 1; i < n/2; i++) { w[i] = ntt_mul(w[i-1], root); }
+  // convolve
+  ntt_split(a, n, x, nx);
+  ntt_split(b, n, y, ny);
+  ntt_transform(a, n, w);
+  ntt_transform(b, n, w);
+  for (kk_ssize_t i = 0; i < n; i++) { a[i] = ntt_mul(a[i], b[i]); }
+  ntt_transform(a, n, w);  // the inverse transform is the forward transform with a[1..n) reversed
+  for (kk_ssize_t i = 1, j = n - 1; i < j; i++, j--) { uint64_t t = a[i]; a[i] = a[j]; a[j] = t; }
+  // scale by 1/n (which also converts out of Montgomery form) and propagate carries
+  const uint64_t ninv = NTT_P - (NTT_P - 1)/(uint64_t)n;
+  uint64_t carry = 0;
+  for (kk_ssize_t i = 0; i < nx + ny; i++) {
+    kk_digit_t d = 0;
+    kk_digit_t scale = 1;
+    for (kk_ssize_t j = 0; j < 3; j++) {
+      const uint64_t c = ntt_mul(a[3*i + j], ninv) + carry;
+      d += (c % NTT_CHUNK) * scale;
+      carry = c / NTT_CHUNK;
+      scale *= NTT_CHUNK;
+    }
+    z[i] = d;
+  }
+  kk_assert_internal(carry == 0);
+  kk_free(a, ctx);
+}
+
+#else
+#define KK_BIGINT_NTT  0
+static bool digits_use_ntt(kk_ssize_t nx, kk_ssize_t ny) {
+  kk_unused(nx); kk_unused(ny);
+  return false;
+}
+#endif
+
+// z[0..nx+ny) = x*y
+static void digits_mul_rec(kk_digit_t* z, const kk_digit_t* x, kk_ssize_t nx, const kk_digit_t* y, kk_ssize_t ny, kk_digit_t* scratch, kk_context_t* ctx) {
+  if (nx < ny) {
+    const kk_digit_t* t = x; x = y; y = t;
+    kk_ssize_t n = nx; nx = ny; ny = n;
+  }
+  if (ny < KK_KARATSUBA_THRESHOLD) {
+    digits_mul_school(z, x, nx, y, ny);
+  }
+#if KK_BIGINT_NTT
+  else if (digits_use_ntt(nx, ny)) {
+    digits_mul_ntt(z, x, nx, y, ny, ctx);
+  }
+#endif
+  else if (2*ny <= nx) {
+    digits_mul_unbalanced(z, x, nx, y, ny, scratch, ctx);
+  }
+  else if (ny >= KK_TOOM3_THRESHOLD && ny > 2*((nx + 2)/3)) {
+    digits_mul_toom3(z, x, nx, y, ny, scratch, ctx);
+  }
+  else {
+    digits_mul_karatsuba(z, x, nx, y, ny, scratch, ctx);
+  }
+}
+
 static kk_bigint_t* bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
   kk_ssize_t cx = bigint_count_(x);
   kk_ssize_t cy = bigint_count_(y);
   uint8_t is_neg = (bigint_is_neg_(x) != bigint_is_neg_(y) ? 1 : 0);
   kk_ssize_t cz = cx+cy;
-  kk_bigint_t* z = bigint_alloc_zero(cz,is_neg,ctx);
-  for (kk_ssize_t i = 0; i < cx; i++) {
-    kk_digit_t dx = x->digits[i];
-    for (kk_ssize_t j = 0; j < cy; j++) {
-      kk_digit_t dy = y->digits[j];
-      kk_ddigit_t prod = ddigit_mul_add(dx,dy,z->digits[i+j]);
-      kk_digit_t rem;
-      kk_digit_t carry = ddigit_cdiv(prod, BASE, &rem);
-      z->digits[i+j]    = rem;
-      z->digits[i+j+1] += carry;
+  kk_bigint_t* z = bigint_alloc(cz,is_neg,ctx);
+  digits_mul_school(z->digits, x->digits, cx, y->digits, cy);
+  drop_bigint(x,ctx);
+  drop_bigint(y,ctx);
+  return kk_bigint_trim(z, true,ctx);
+}
+
+static kk_bigint_t* bigint_mul_large(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  kk_ssize_t cx = bigint_count_(x);
+  kk_ssize_t cy = bigint_count_(y);
+  uint8_t is_neg = (bigint_is_neg_(x) != bigint_is_neg_(y) ? 1 : 0);
+  kk_bigint_t* z = bigint_alloc(cx + cy, is_neg, ctx);
+  kk_digit_t* scratch = NULL;
+  if (!digits_use_ntt(cx, cy)) {
+    scratch = (kk_digit_t*)kk_malloc(digits_mul_scratch(cx >= cy ? cx : cy) * kk_ssizeof(kk_digit_t), ctx);
+    if (scratch == NULL) {
+      kk_fatal_error(ENOMEM, "out of memory multiplying big integers");
     }
   }
+  digits_mul_rec(z->digits, x->digits, cx, y->digits, cy, scratch, ctx);
+  if (scratch != NULL) kk_free(scratch, ctx);
   drop_bigint(x,ctx);
   drop_bigint(y,ctx);
-  return kk_bigint_trim(z, true,ctx);
+  return kk_bigint_trim(z, true, ctx);
+}
+
+static kk_bigint_t* kk_bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  if (bigint_count_(x) < KK_KARATSUBA_THRESHOLD || bigint_count_(y) < KK_KARATSUBA_THRESHOLD) {
+    return bigint_mul(x, y, ctx);
+  }
+  else {
+    return bigint_mul_large(x, y, ctx);
+  }
 }
 
 static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context_t* ctx) {
@@ -1000,56 +1565,7 @@ static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context
 
 static kk_bigint_t* kk_bigint_sqr(kk_bigint_t* x, kk_context_t* ctx) {
   dup_bigint(x);
-  return bigint_mul(x, x, ctx);
-}
-
-static kk_bigint_t* kk_bigint_shift_left(kk_bigint_t* x, kk_ssize_t digits, kk_context_t* ctx) {
-  const kk_ssize_t cx = x->count;
-  kk_bigint_t* z = bigint_alloc_reuse_(x, x->count + digits, ctx);
-  kk_memmove(&z->digits[digits], &x->digits[0], kk_ssizeof(kk_digit_t)*cx);
-  kk_memset(&z->digits[0], 0, kk_ssizeof(kk_digit_t)*digits);
-  if (z != x) drop_bigint(x, ctx);
-  return z;
-}
-
-static kk_bigint_t* kk_bigint_slice(kk_bigint_t* x, kk_ssize_t lo, kk_ssize_t hi, kk_context_t* ctx) {
-  if (lo <= 0 && bigint_is_unique_(x)) {
-    return kk_bigint_trim_to(x, hi, false, ctx);
-  }
-  if (lo >= x->count) lo = x->count;
-  if (hi > x->count)  hi = x->count;
-  const kk_ssize_t cz = hi - lo;
-  kk_bigint_t* z = bigint_alloc(cz, x->is_neg, ctx);
-  if (cz==0) {
-    z->digits[0] = 0;
-    z->count = 1;
-    z->extra--;
-  }
-  else if (lo < x->count) {
-    kk_memcpy(&z->digits[0], &x->digits[lo], kk_ssizeof(kk_digit_t)*cz);
-  }
-  return z;
-}
-
-static kk_bigint_t* bigint_mul_karatsuba(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
-  kk_ssize_t n = (x->count >= y->count ? x->count : y->count);
-  if (n <= 25) return bigint_mul(x, y, ctx);
-  n = ((n + 1) / 2);
-
-  kk_bigint_t* b = kk_bigint_slice(dup_bigint(x), n, x->count, ctx);
-  kk_bigint_t* a = kk_bigint_slice(x, 0, n, ctx);
-  kk_bigint_t* d = kk_bigint_slice(dup_bigint(y), n, y->count, ctx);
-  kk_bigint_t* c = kk_bigint_slice(y, 0, n, ctx);
-
-  kk_bigint_t* ac = bigint_mul_karatsuba(dup_bigint(a), dup_bigint(c), ctx);
-  kk_bigint_t* bd = bigint_mul_karatsuba(dup_bigint(b), dup_bigint(d), ctx);
-  kk_bigint_t* abcd = bigint_mul_karatsuba( bigint_add(a, b, b->is_neg, ctx),
-                                         bigint_add(c, d, d->is_neg, ctx), ctx);
-  kk_bigint_t* p1 = kk_bigint_shift_left(kk_bigint_sub(kk_bigint_sub(abcd, dup_bigint(ac), ac->is_neg, ctx),
-                                              dup_bigint(bd), bd->is_neg, ctx), n, ctx);
-  kk_bigint_t* p2 = kk_bigint_shift_left(bd, 2 * n, ctx);
-  kk_bigint_t* prod = bigint_add(bigint_add(ac, p1, p1->is_neg, ctx), p2, p2->is_neg, ctx);
-  return kk_bigint_trim(prod,true, ctx);
+  return kk_bigint_mul(x, x, ctx);
 }
 
 
@@ -1129,10 +1645,17 @@ static kk_bigint_t* kk_bigint_cdiv_cmod_small(kk_bigint_t* x, kk_digit_t y, kk_d
 }
 
 
+#define KK_DIV_NEWTON_THRESHOLD  (400)
+
+static kk_bigint_t* bigint_cdiv_cmod_newton(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx);
+
 static kk_bigint_t* bigint_cdiv_cmod(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx) {
   kk_ssize_t cx = bigint_count_(x);
   kk_ssize_t cy = bigint_count_(y);
   kk_assert_internal(cx >= cy);
+  if (cy >= KK_DIV_NEWTON_THRESHOLD && (cx - cy) >= KK_DIV_NEWTON_THRESHOLD) {
+    return bigint_cdiv_cmod_newton(x, y, pmod, ctx);
+  }
   uint8_t is_neg = (bigint_is_neg_(x) != bigint_is_neg_(y) ? 1 : 0);
   kk_bigint_t* z = bigint_alloc_zero(cx - cy + 1, is_neg, ctx);
   // normalize
@@ -1205,6 +1728,155 @@ static kk_bigint_t* bigint_cdiv_cmod(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t
 }
 
 
+/*----------------------------------------------------------------------
+  Division of large numbers using a Newton reciprocal.
+
+  For a divisor `y` of `n` digits we compute `inv = floor(B^2n / y)`
+  with Newton iteration, doubling the precision at each step. A number
+  `x < B^2n` is then divided as `q = floor(x*inv / B^2n)` with at most a
+  few corrections. Larger dividends are divided in blocks of `n` digits.
+  The cost is a constant number of multiplications per block which is
+  subquadratic with Karatsuba, Toom-3, and NTT multiplication.
+  All numbers in this section are non-negative.
+----------------------------------------------------------------------*/
+
+static bool bigint_is_zero_(const kk_bigint_t* x) {
+  return (x->count == 0 || (x->count == 1 && x->digits[0] == 0));
+}
+
+// trim but keep at least one digit
+static kk_bigint_t* bigint_trim_digits(kk_bigint_t* x, kk_context_t* ctx) {
+  x = kk_bigint_trim(x, true, ctx);
+  if (x->count == 0) {
+    x->count = 1;
+    x->extra--;
+    x->digits[0] = 0;
+  }
+  return x;
+}
+
+static kk_bigint_t* bigint_abs(kk_bigint_t* x, kk_context_t* ctx) {
+  return (bigint_is_neg_(x) ? bigint_neg(x, ctx) : x);
+}
+
+// B^k
+static kk_bigint_t* bigint_pow_base(kk_ssize_t k, kk_context_t* ctx) {
+  kk_bigint_t* z = bigint_alloc_zero(k + 1, false, ctx);
+  z->digits[k] = 1;
+  return z;
+}
+
+// the digits `[lo,hi)` of `x`, i.e. `(x / B^lo) % B^(hi - lo)` (keeping the sign of `x`)
+static kk_bigint_t* bigint_slice_digits(kk_bigint_t* x, kk_ssize_t lo, kk_ssize_t hi, kk_context_t* ctx) {
+  if (hi > x->count) hi = x->count;
+  if (lo > hi) lo = hi;
+  kk_bigint_t* z = bigint_alloc((hi > lo ? hi - lo : 1), bigint_is_neg_(x), ctx);
+  if (hi > lo) { digits_copy(z->digits, x->digits + lo, hi - lo); }
+          else { z->digits[0] = 0; }
+  drop_bigint(x, ctx);
+  return bigint_trim_digits(z, ctx);
+}
+
+// x*B^k + y[0..ny)
+static kk_bigint_t* bigint_shift_add_digits(kk_bigint_t* x, kk_ssize_t k, const kk_digit_t* y, kk_ssize_t ny, kk_context_t* ctx) {
+  kk_assert_internal(ny <= k);
+  kk_bigint_t* z = bigint_alloc(x->count + k, false, ctx);
+  digits_copy(z->digits, y, ny);
+  digits_zero(z->digits + ny, k - ny);
+  digits_copy(z->digits + k, x->digits, x->count);
+  drop_bigint(x, ctx);
+  return bigint_trim_digits(z, ctx);
+}
+
+static kk_bigint_t* bigint_inc(kk_bigint_t* x, kk_context_t* ctx) {
+  return kk_bigint_add_abs_small(x, 1, ctx);
+}
+
+static kk_bigint_t* bigint_dec(kk_bigint_t* x, kk_context_t* ctx) {
+  return bigint_trim_digits(kk_bigint_sub_abs(x, bigint_from_int(1, ctx), ctx), ctx);
+}
+
+// floor(B^2n / y) where `y` has `n` digits
+static kk_bigint_t* bigint_recip(kk_bigint_t* y, kk_context_t* ctx) {
+  const kk_ssize_t n = y->count;
+  if (n < KK_DIV_NEWTON_THRESHOLD) {
+    return bigint_cdiv_cmod(bigint_pow_base(2*n, ctx), y, NULL, ctx);
+  }
+  // approximate from the reciprocal of the top `h` digits where `2h >= n+3` such that
+  // the error after one Newton step is less than a few units.
+  const kk_ssize_t h = (n + 4)/2;
+  kk_bigint_t* i = bigint_recip(bigint_slice_digits(dup_bigint(y), n - h, n, ctx), ctx);
+  i = bigint_shift_add_digits(i, n - h, NULL, 0, ctx);
+  // Newton step: i = i + i*(B^2n - y*i)/B^2n
+  kk_bigint_t* e = kk_bigint_sub(bigint_pow_base(2*n, ctx), kk_bigint_mul(dup_bigint(y), dup_bigint(i), ctx), false, ctx);
+  if (!bigint_is_zero_(e)) {
+    kk_bigint_t* d = bigint_slice_digits(kk_bigint_mul(dup_bigint(i), e, ctx), 2*n, KK_SSIZE_MAX, ctx);
+    i = bigint_trim_digits(bigint_add(i, d, bigint_is_neg_(d), ctx), ctx);
+  }
+  else {
+    drop_bigint(e, ctx);
+  }
+  // and correct such that `0 <= B^2n - y*i < y`
+  kk_bigint_t* r = kk_bigint_sub(bigint_pow_base(2*n, ctx), kk_bigint_mul(dup_bigint(y), dup_bigint(i), ctx), false, ctx);
+  while (bigint_is_neg_(r) && !bigint_is_zero_(r)) {
+    i = bigint_dec(i, ctx);
+    r = bigint_add(r, dup_bigint(y), false, ctx);
+  }
+  while (bigint_compare_abs_(r, y) >= 0) {
+    i = bigint_inc(i, ctx);
+    r = kk_bigint_sub_abs(r, dup_bigint(y), ctx);
+  }
+  drop_bigint(r, ctx);
+  drop_bigint(y, ctx);
+  return i;
+}
+
+// floor(x / y) and the remainder for `x < B^2n` where `y` has `n` digits and `inv == recip(y)`; borrows `y` and `inv`
+static kk_bigint_t* bigint_cdiv_cmod_recip(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t* inv, kk_bigint_t** pmod, kk_context_t* ctx) {
+  const kk_ssize_t n = y->count;
+  kk_assert_internal(x->count <= 2*n);
+  kk_bigint_t* q = bigint_slice_digits(kk_bigint_mul(dup_bigint(x), dup_bigint(inv), ctx), 2*n, KK_SSIZE_MAX, ctx);
+  kk_bigint_t* r = kk_bigint_sub(x, kk_bigint_mul(dup_bigint(q), dup_bigint(y), ctx), false, ctx);
+  kk_assert_internal(!bigint_is_neg_(r) || bigint_is_zero_(r));  // as q <= x/y
+  while (bigint_compare_abs_(r, y) >= 0) {
+    q = bigint_inc(q, ctx);
+    r = kk_bigint_sub_abs(r, dup_bigint(y), ctx);
+  }
+  r = bigint_trim_digits(r, ctx);
+  r->is_neg = 0;
+  if (pmod != NULL) { *pmod = r; }
+               else { drop_bigint(r, ctx); }
+  return q;
+}
+
+// |x| / |y| and the remainder of the absolute values
+static kk_bigint_t* bigint_cdiv_cmod_newton(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx) {
+  x = bigint_abs(x, ctx);
+  y = bigint_abs(y, ctx);
+  const kk_ssize_t n = y->count;
+  const kk_ssize_t m = x->count;
+  kk_bigint_t* inv = bigint_recip(dup_bigint(y), ctx);
+  // divide per block of `n` digits from the top
+  kk_bigint_t* q = bigint_alloc_zero(m, false, ctx);
+  kk_bigint_t* r = bigint_alloc_zero(1, false, ctx);
+  for (kk_ssize_t j = (m - 1) / n; j >= 0; j--) {
+    const kk_ssize_t lo = j*n;
+    const kk_ssize_t hi = (lo + n > m ? m : lo + n);
+    kk_bigint_t* t = bigint_shift_add_digits(r, n, x->digits + lo, hi - lo, ctx);
+    kk_bigint_t* qj = bigint_cdiv_cmod_recip(t, y, inv, &r, ctx);
+    kk_assert_internal(qj->count <= n);
+    digits_copy(q->digits + lo, qj->digits, qj->count);
+    drop_bigint(qj, ctx);
+  }
+  drop_bigint(inv, ctx);
+  drop_bigint(x, ctx);
+  drop_bigint(y, ctx);
+  if (pmod != NULL) { *pmod = r; }
+               else { drop_bigint(r, ctx); }
+  return bigint_trim_digits(q, ctx);
+}
+
+
 /*----------------------------------------------------------------------
   Addition and substraction
 ----------------------------------------------------------------------*/
@@ -1302,16 +1974,11 @@ kk_integer_t kk_integer_sub_generic(kk_integer_t x, kk_integer_t y, kk_context_t
   return integer_bigint(kk_bigint_sub(bx, by, by->is_neg, ctx), ctx);
 }
 
-static bool use_karatsuba(kk_ssize_t i, kk_ssize_t j) {
-  return ((0.000012*(double)(i*j) - 0.0025*(double)(i+j)) >= 0.0);
-}
-
 kk_integer_t kk_integer_mul_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx) {
   kk_assert_internal(kk_is_integer(x)&&kk_is_integer(y));
   kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
   kk_bigint_t* by = kk_integer_to_bigint(y, ctx);
-  bool usek = use_karatsuba(bx->count, by->count);
-  return integer_bigint((usek ? bigint_mul_karatsuba(bx,by, ctx) : bigint_mul(bx, by, ctx)), ctx);
+  return integer_bigint(kk_bigint_mul(bx, by, ctx), ctx);
 }
 
 
@@ -1517,14 +2184,148 @@ static kk_ssize_t kk_bigint_to_hex_buf(kk_bigint_t* b, char* buf, kk_ssize_t siz
   return len;
 }
 
+/*----------------------------------------------------------------------
+  Hexadecimal conversion of large numbers is divide-and-conquer using the
+  powers `BASE_HEX^(2^k)` (and their reciprocals) computed once per
+  conversion. Numbers below `KK_HEX_DC_THRESHOLD` digits are converted per
+  hex digit, which is faster up to about `KK_HEX_TO_DC_THRESHOLD` digits.
+----------------------------------------------------------------------*/
+
+#define KK_HEX_DC_THRESHOLD     (256)
+#define KK_HEX_TO_DC_THRESHOLD  (2048)
+#define KK_HEX_POWERS_MAX       (48)
+
+typedef struct kk_hex_powers_s {
+  kk_ssize_t   count;
+  kk_bigint_t* pow[KK_HEX_POWERS_MAX];   // BASE_HEX^(2^k)
+  kk_bigint_t* inv[KK_HEX_POWERS_MAX];   // recip(pow[k]) if we divide with a Newton reciprocal (or NULL)
+} kk_hex_powers_t;
+
+static void kk_hex_powers_init(kk_hex_powers_t* hp, kk_ssize_t count, bool with_inv, kk_context_t* ctx) {
+  kk_assert_internal(count <= KK_HEX_POWERS_MAX);
+  hp->count = count;
+  for (kk_ssize_t k = 0; k < count; k++) {
+    hp->pow[k] = (k == 0 ? bigint_from_uint64(BASE_HEX, ctx) : kk_bigint_sqr(dup_bigint(hp->pow[k-1]), ctx));
+    // the top power is used for one division only so a reciprocal does not pay off
+    hp->inv[k] = (with_inv && k + 1 < count && hp->pow[k]->count >= KK_DIV_NEWTON_THRESHOLD ? bigint_recip(dup_bigint(hp->pow[k]), ctx) : NULL);
+  }
+}
+
+static void kk_hex_powers_done(kk_hex_powers_t* hp, kk_context_t* ctx) {
+  for (kk_ssize_t k = 0; k < hp->count; k++) {
+    drop_bigint(hp->pow[k], ctx);
+    if (hp->inv[k] != NULL) drop_bigint(hp->inv[k], ctx);
+  }
+}
+
+static char kk_hex_char(kk_digit_t d, char baseA) {
+  return (char)(d < 10 ? d + '0' : d - 10 + (kk_digit_t)baseA);
+}
+
+// write `x` as exactly `width` hex digits (a multiple of LOG_BASE_HEX) with leading zeros
+static void kk_bigint_to_hex_leaf(kk_bigint_t* x, char* buf, kk_ssize_t width, char baseA, kk_context_t* ctx) {
+  kk_ssize_t i = width;
+  while (i > 0) {
+    kk_digit_t mod = 0;
+    if (!bigint_is_zero_(x)) { x = kk_bigint_cdiv_cmod_small(x, BASE_HEX, &mod, ctx); }
+    for (kk_ssize_t j = 0; j < LOG_BASE_HEX; j++) {
+      buf[--i] = kk_hex_char(mod % 16, baseA);
+      mod /= 16;
+    }
+  }
+  kk_assert_internal(bigint_is_zero_(x));
+  drop_bigint(x, ctx);
+}
+
+// write `x < BASE_HEX^(2^(k+1))` as exactly `LOG_BASE_HEX*2^(k+1)` hex digits
+static void kk_bigint_to_hex_rec(kk_bigint_t* x, kk_ssize_t k, char* buf, const kk_hex_powers_t* hp, char baseA, kk_context_t* ctx) {
+  const kk_ssize_t width = (kk_ssize_t)LOG_BASE_HEX << (k + 1);
+  if (k < 0 || x->count < KK_HEX_DC_THRESHOLD) {
+    kk_bigint_to_hex_leaf(x, buf, width, baseA, ctx);
+    return;
+  }
+  // x = q*pow[k] + r
+  kk_bigint_t* pow = hp->pow[k];
+  kk_bigint_t* q;
+  kk_bigint_t* r;
+  if (bigint_compare_abs_(x, pow) < 0) {
+    q = bigint_alloc_zero(1, false, ctx);
+    r = x;
+  }
+  else if (hp->inv[k] != NULL) {
+    q = bigint_cdiv_cmod_recip(x, pow, hp->inv[k], &r, ctx);
+  }
+  else {
+    q = bigint_cdiv_cmod(x, dup_bigint(pow), &r, ctx);
+  }
+  kk_bigint_to_hex_rec(q, k - 1, buf, hp, baseA, ctx);
+  kk_bigint_to_hex_rec(r, k - 1, buf + width/2, hp, baseA, ctx);
+}
+
 static kk_string_t kk_bigint_to_hex_string(kk_bigint_t* b, bool use_capitals, kk_context_t* ctx) {
   kk_ssize_t dec_needed = kk_bigint_to_buf_(b, NULL, 0);   
   kk_ssize_t needed = (kk_ssize_t)(ceil((double)dec_needed * KK_LOG10_DIV_LOG16)) + 2; // conservative estimate
   char* s;
-  kk_string_t str = kk_unsafe_string_alloc_cbuf(needed, &s, ctx);
-  kk_ssize_t len = kk_bigint_to_hex_buf(b, s, needed, use_capitals, ctx);
-  kk_assert_internal(needed > len);
-  return kk_string_adjust_length(str, len, ctx);
+  if (b->count < KK_HEX_TO_DC_THRESHOLD) {
+    kk_string_t str = kk_unsafe_string_alloc_cbuf(needed, &s, ctx);
+    kk_ssize_t len = kk_bigint_to_hex_buf(b, s, needed, use_capitals, ctx);
+    kk_assert_internal(needed > len);
+    return kk_string_adjust_length(str, len, ctx);
+  }
+  // divide-and-conquer into a buffer of `LOG_BASE_HEX*2^(k+1) >= needed` hex digits
+  kk_ssize_t k = 0;
+  while (((kk_ssize_t)LOG_BASE_HEX << (k + 1)) < needed) { k++; }
+  const kk_ssize_t width = (kk_ssize_t)LOG_BASE_HEX << (k + 1);
+  char* buf = (char*)kk_malloc(width, ctx);
+  if (buf == NULL) {
+    kk_fatal_error(ENOMEM, "out of memory converting a big integer to hexadecimal");
+    drop_bigint(b, ctx);
+    return kk_string_empty();
+  }
+  kk_hex_powers_t hp;
+  kk_hex_powers_init(&hp, k + 1, true, ctx);
+  kk_bigint_to_hex_rec(b, k, buf, &hp, (use_capitals ? 'A' : 'a'), ctx);
+  kk_hex_powers_done(&hp, ctx);
+  kk_ssize_t start = 0;
+  while (start < width - 1 && buf[start] == '0') { start++; }
+  kk_string_t str = kk_unsafe_string_alloc_cbuf(width - start, &s, ctx);
+  kk_memcpy(s, buf + start, width - start);
+  kk_free(buf, ctx);
+  return str;
+}
+
+// the value of the hex digit values `h[0..n)` (most significant first)
+static kk_bigint_t* kk_bigint_from_hex_rec(const uint8_t* h, kk_ssize_t n, const kk_hex_powers_t* hp, kk_context_t* ctx) {
+  if (n <= LOG_BASE_HEX * KK_HEX_DC_THRESHOLD) {
+    kk_bigint_t* b = bigint_alloc_zero(1, false, ctx);
+    kk_ssize_t chunk = n%LOG_BASE_HEX; if (chunk==0) chunk = LOG_BASE_HEX;
+    for (kk_ssize_t i = 0; i < n; ) {
+      kk_digit_t d = 0;
+      for (kk_ssize_t j = 0; j < chunk; j++) { d = 16*d + h[i++]; }
+      b = kk_bigint_mul_small(b, BASE_HEX, ctx);
+      b = kk_bigint_add_abs_small(b, d, ctx);
+      chunk = LOG_BASE_HEX;
+    }
+    return b;
+  }
+  // split off the low `LOG_BASE_HEX*2^k` digits for the largest `k` where that is less than `n`
+  kk_ssize_t k = 0;
+  while (((kk_ssize_t)LOG_BASE_HEX << (k + 1)) < n) { k++; }
+  const kk_ssize_t nlo = (kk_ssize_t)LOG_BASE_HEX << k;
+  kk_bigint_t* hi = kk_bigint_from_hex_rec(h, n - nlo, hp, ctx);
+  kk_bigint_t* lo = kk_bigint_from_hex_rec(h + n - nlo, nlo, hp, ctx);
+  return bigint_add(kk_bigint_mul(hi, dup_bigint(hp->pow[k]), ctx), lo, false, ctx);
+}
+
+static kk_bigint_t* kk_bigint_from_hex_digits(const uint8_t* h, kk_ssize_t n, bool is_neg, kk_context_t* ctx) {
+  kk_ssize_t k = 0;
+  while (((kk_ssize_t)LOG_BASE_HEX << (k + 1)) < n) { k++; }
+  kk_hex_powers_t hp;
+  kk_hex_powers_init(&hp, k + 1, false, ctx);
+  kk_bigint_t* b = bigint_trim_digits(kk_bigint_from_hex_rec(h, n, &hp, ctx), ctx);
+  kk_hex_powers_done(&hp, ctx);
+  b->is_neg = (is_neg ? 1 : 0);
+  return b;
 }
 
 kk_decl_export kk_string_t kk_integer_to_hex_string(kk_integer_t x, bool use_capitals, kk_context_t* ctx) {
@@ -1728,6 +2529,34 @@ kk_integer_t kk_integer_div_pow10(kk_integer_t x, kk_integer_t p, kk_context_t*
   return d;
 }
 
+// `int_pow10_max[i] * 10^i < 2^62`: such products can be added to a small int without overflowing an `int64_t`
+#define POW10_MAX(p)  (KK_I64(0x3FFFFFFFFFFFFFFF) / KK_I64(p))
+static const int64_t int_pow10_max[19] = { POW10_MAX(1), POW10_MAX(10), POW10_MAX(100), POW10_MAX(1000), POW10_MAX(10000)
+                                         , POW10_MAX(100000), POW10_MAX(1000000), POW10_MAX(10000000), POW10_MAX(100000000)
+                                         , POW10_MAX(1000000000), POW10_MAX(10000000000), POW10_MAX(100000000000)
+                                         , POW10_MAX(1000000000000), POW10_MAX(10000000000000), POW10_MAX(100000000000000)
+                                         , POW10_MAX(1000000000000000), POW10_MAX(10000000000000000)
+                                         , POW10_MAX(100000000000000000), POW10_MAX(1000000000000000000) };
+#undef POW10_MAX
+
+// Add `x` and `y` scaled by `10^p` (with `p >= 0`); this is the addition of two decimals where `y` has
+// the larger exponent. Small integers are scaled with the table of powers and only overflow to a bigint.
+kk_integer_t kk_integer_add_pow10(kk_integer_t x, kk_integer_t y, kk_integer_t p, kk_context_t* ctx) {
+  if (kk_likely(kk_is_smallint(x) && kk_is_smallint(y) && kk_is_smallint(p))) {
+    const kk_intf_t i = kk_smallint_from_integer(p);
+    if (i >= 0 && i <= 18) {
+      const int64_t j = kk_smallint_from_integer(y);
+      if (j <= int_pow10_max[i] && j >= -int_pow10_max[i]) {
+        static const int64_t pow10[19] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+                                         , 10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000
+                                         , 1000000000000000, 10000000000000000, 100000000000000000, 1000000000000000000 };
+        return kk_integer_from_int64((int64_t)kk_smallint_from_integer(x) + j*pow10[i], ctx);
+      }
+    }
+  }
+  return kk_integer_add(x, kk_integer_mul_pow10(y, p, ctx), ctx);
+}
+
 
 /*----------------------------------------------------------------------
   clamp to smaller integers
@@ -1838,6 +2667,13 @@ int32_t kk_integer_clamp32_generic(kk_integer_t x, kk_context_t* ctx) {
   }
 }
 
+// Hash the digits of a big integer (see `hash.h`); small integers are hashed inline
+uint64_t kk_hash_bigint_borrow(kk_integer_t x, kk_context_t* ctx) {
+  kk_bigint_t* bx = kk_block_assert(kk_bigint_t*, _kk_integer_ptr(x), KK_TAG_BIGINT);
+  const uint64_t h = kk_hash_buf((const uint8_t*)&bx->digits[0], bx->count * kk_ssizeof(kk_digit_t), kk_hash_seed(ctx));
+  return (bx->is_neg ? ~h : h);
+}
+
 size_t kk_integer_clamp_size_t_generic(kk_integer_t x, kk_context_t* ctx) {
   kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
 #if (SIZE_MAX <= UINT64_MAX)
@@ -30,6 +30,8 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #endif
 
 typedef int kk_file_t;
@@ -72,6 +74,14 @@ static int kk_posix_creat(kk_string_t path, int perm, kk_file_t* f, kk_context_t
 }
 #endif
 
+static kk_file_t kk_posix_fileno(FILE* f) {
+#ifdef WIN32
+  return _fileno(f);
+#else
+  return fileno(f);
+#endif
+}
+
 static int kk_posix_close(kk_file_t f) {
 #ifdef WIN32
   return (_close(f) < 0 ? errno : 0);
@@ -146,6 +156,25 @@ static int kk_posix_read_retry(const kk_file_t inp, uint8_t* buf, const kk_ssize
   return err;
 }
 
+// Read at most `buflen` bytes with a single successful read (returning as soon as some bytes are
+// available, as for a pipe). A `read_count` of `0` means the end of the file.
+static int kk_posix_read_some(const kk_file_t inp, uint8_t* buf, const kk_ssize_t buflen, kk_ssize_t* read_count) {
+  kk_ssize_t todo = buflen;
+  #ifdef WIN32
+  if (todo > INT32_MAX) todo = INT32_MAX;
+  #endif
+  kk_ssize_t n;
+  do {
+    #ifdef WIN32
+    n = _read(inp, buf, (unsigned)(todo));
+    #else
+    n = read(inp, buf, todo);
+    #endif
+  } while (n < 0 && (errno == EAGAIN || errno == EINTR));
+  *read_count = (n < 0 ? 0 : n);
+  return (n < 0 ? errno : 0);
+}
+
 // Write at `len` bytes to `out` from `buf`. On error, `write_count` may be less than `len`.
 static int kk_posix_write_retry(const kk_file_t out, const uint8_t* buf, const kk_ssize_t len, kk_ssize_t* write_count) {
   int err = 0;
@@ -187,6 +216,26 @@ static int kk_posix_write_retry(const kk_file_t out, const uint8_t* buf, const k
   Text files
 --------------------------------------------------------------------------------------------------*/
 
+// Read `len` bytes from `f` into a fresh buffer and close `f`.
+static int kk_posix_read_text_close(kk_file_t f, kk_ssize_t len, kk_string_t* result, kk_context_t* ctx) {
+  uint8_t* cbuf;
+  kk_bytes_t buf = kk_bytes_alloc_buf(len, &cbuf, ctx);
+
+  kk_ssize_t nread;
+  int err = kk_posix_read_retry(f, cbuf, len, &nread);
+  kk_posix_close(f);
+  if (err < 0) {
+    kk_bytes_drop(buf, ctx);
+    return err;
+  }
+  if (nread < len) {
+    buf = kk_bytes_adjust_length(buf, nread, ctx);
+  }
+
+  *result = kk_string_convert_from_qutf8(buf, ctx);
+  return 0;
+}
+
 kk_decl_export int kk_os_read_text_file(kk_string_t path, kk_string_t* result, kk_context_t* ctx)
 {
   kk_file_t f;
@@ -199,22 +248,54 @@ kk_decl_export int kk_os_read_text_file(kk_string_t path, kk_string_t* result, k
     kk_posix_close(f);
     return err;
   }
-  uint8_t* cbuf;
-  kk_bytes_t buf = kk_bytes_alloc_buf(len, &cbuf, ctx);
+  return kk_posix_read_text_close(f, len, result, ctx);
+}
 
-  kk_ssize_t nread;
-  err = kk_posix_read_retry(f, cbuf, len, &nread);
-  kk_posix_close(f);
-  if (err < 0) {
-    kk_bytes_drop(buf, ctx);
+// from this size mapping a file is generally faster than reading it
+#define KK_OS_MMAP_MIN  (64*1024)
+
+#if !defined(WIN32)
+// free function of raw bytes that point to a file mapping
+static void kk_os_munmap_fun(void* p, kk_block_t* b, kk_context_t* ctx) {
+  kk_unused(ctx);
+  struct kk_bytes_raw_s* raw = (struct kk_bytes_raw_s*)b;
+  munmap(p, (size_t)raw->clength);
+}
+#endif
+
+// Read a text file by mapping it into memory: valid utf-8 is validated in place and not copied.
+// The file should not be modified while the resulting string is alive. Small files are read normally,
+// as are files whose size is a multiple of the page size (as their mapping is not followed by a zero byte).
+kk_decl_export int kk_os_read_text_file_mapped(kk_string_t path, kk_string_t* result, kk_context_t* ctx)
+{
+  kk_file_t f;
+  int err = kk_posix_open(path, O_RDONLY, 0, &f, ctx);
+  if (err != 0) return err;
+
+  kk_ssize_t len;
+  err = kk_posix_fsize(f, &len);
+  if (err != 0) {
+    kk_posix_close(f);
     return err;
   }
-  if (nread < len) {
-    buf = kk_bytes_adjust_length(buf, nread, ctx);
+#if !defined(WIN32)
+  const long pagesize = sysconf(_SC_PAGESIZE);
+  if (len >= KK_OS_MMAP_MIN && pagesize > 0 && (len % pagesize) != 0) {
+    void* p = mmap(NULL, (size_t)len, PROT_READ, MAP_PRIVATE, f, 0);
+    if (p != MAP_FAILED) {
+      kk_posix_close(f);  // the mapping stays valid
+      kk_bytes_raw_t raw = kk_block_alloc_as(struct kk_bytes_raw_s, 0, KK_TAG_BYTES_RAW, ctx);
+      raw->free = &kk_os_munmap_fun;
+      raw->cbuf = (const uint8_t*)p;
+      raw->clength = len;
+      // the tail of the last page is zero filled so the bytes can be used as a C string
+      *result = kk_string_convert_from_qutf8(kk_datatype_from_base(&raw->_base), ctx);
+      return 0;
+    }
+    // otherwise fall back to reading
   }
-
-  *result = kk_string_convert_from_qutf8(buf, ctx);
-  return 0;
+#endif
+  return kk_posix_read_text_close(f, len, result, ctx);
 }
 
 kk_decl_export int kk_os_write_text_file(kk_string_t path, kk_string_t content, kk_context_t* ctx)
@@ -239,6 +320,304 @@ kk_decl_export int kk_os_write_text_file(kk_string_t path, kk_string_t content,
 }
 
 
+/*--------------------------------------------------------------------------------------------------
+  Heap images (see `kklib/image.h`)
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(O_BINARY)
+#define KK_O_BINARY  O_BINARY
+#else
+#define KK_O_BINARY  0
+#endif
+
+// Write an image of `root` to a file
+kk_decl_export int kk_os_write_image_file(kk_string_t path, kk_box_t root, kk_context_t* ctx)
+{
+  uint8_t* image;
+  kk_ssize_t len;
+  int err = kk_image_create(root, &image, &len, ctx);
+  kk_box_drop(root, ctx);
+  if (err != 0) {
+    kk_string_drop(path, ctx);
+    return err;
+  }
+  kk_file_t f;
+  err = kk_posix_open(path, O_WRONLY | O_CREAT | O_TRUNC | KK_O_BINARY, 0644, &f, ctx);
+  if (err == 0) {
+    kk_ssize_t nwritten;
+    err = kk_posix_write_retry(f, image, len, &nwritten);
+    if (err == 0 && nwritten < len) err = EIO;
+    kk_posix_close(f);
+  }
+  kk_free(image, ctx);
+  return err;
+}
+
+// Read an image from a file and return its root. The file is mapped at the preferred address of
+// the image if possible (so there is no relocation and pages are only read on demand), and the
+// mapping is read-only once loaded. The file should not be modified while the process runs.
+kk_decl_export int kk_os_read_image_file(kk_string_t path, kk_box_t* root, kk_context_t* ctx)
+{
+  kk_file_t f;
+  int err = kk_posix_open(path, O_RDONLY | KK_O_BINARY, 0, &f, ctx);
+  if (err != 0) return err;
+  kk_ssize_t len;
+  err = kk_posix_fsize(f, &len);
+  if (err == 0 && len < kk_ssizeof(kk_image_header_t)) err = EINVAL;
+  if (err != 0) {
+    kk_posix_close(f);
+    return err;
+  }
+#if !defined(WIN32)
+  kk_image_header_t header;
+  kk_ssize_t nread;
+  err = kk_posix_read_retry(f, (uint8_t*)&header, kk_ssizeof(header), &nread);
+  if (err == 0 && nread < kk_ssizeof(header)) err = EINVAL;
+  if (err != 0) {
+    kk_posix_close(f);
+    return err;
+  }
+  void* base = kk_image_base((const uint8_t*)&header, len);
+  uint8_t* p = (uint8_t*)mmap(base, (size_t)len, PROT_READ, MAP_PRIVATE, f, 0);
+  if (p != MAP_FAILED) {
+    kk_posix_close(f);  // the mapping stays valid
+    const bool relocate = (p != (uint8_t*)base);
+    if (relocate && mprotect(p, (size_t)len, PROT_READ | PROT_WRITE) != 0) {
+      err = errno;
+    }
+    else {
+      err = kk_image_load(p, len, root, ctx);
+      if (relocate) { mprotect(p, (size_t)len, PROT_READ); }
+    }
+    if (err != 0) { munmap(p, (size_t)len); }
+    return err;
+  }
+  // otherwise fall back to reading
+  if (lseek(f, 0, SEEK_SET) != 0) {
+    err = errno;
+    kk_posix_close(f);
+    return err;
+  }
+#endif
+  // read into memory that is never freed
+  uint8_t* buf = (uint8_t*)kk_malloc(len, ctx);
+  if (buf == NULL) {
+    kk_posix_close(f);
+    return ENOMEM;
+  }
+  kk_ssize_t nread_all;
+  err = kk_posix_read_retry(f, buf, len, &nread_all);
+  if (err == 0 && nread_all < len) err = EIO;
+  kk_posix_close(f);
+  if (err == 0) { err = kk_image_load(buf, len, root, ctx); }
+  if (err != 0) { kk_free(buf, ctx); }
+  return err;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Streaming files
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_OS_FILE_CHUNK_MIN  (64)
+#define KK_OS_FILE_WBUF_SIZE  (256*1024)   // writes are flushed in blocks of this size
+
+typedef struct kk_os_file_s {
+  kk_file_t  fd;           // -1 once closed
+  FILE*      proc;         // if not NULL, `fd` is the output pipe of a process (see `kk_os_process_open`)
+  int        exit_code;    // exit code of the process once closed
+  bool       eof;
+  int        pending_len;  // incomplete utf-8 sequence at the end of the previous text chunk
+  uint8_t    pending[4];
+  kk_bytes_t chunk;        // the last chunk read (normal bytes of `chunk_cap` capacity, or empty)
+  kk_ssize_t chunk_cap;
+  uint8_t*   wbuf;         // write buffer (allocated on the first write)
+  kk_ssize_t wlen;
+} kk_os_file_t;
+
+static int kk_os_file_flush_buf(kk_os_file_t* f) {
+  if (f->wlen == 0) return 0;
+  kk_ssize_t nwritten;
+  int err = kk_posix_write_retry(f->fd, f->wbuf, f->wlen, &nwritten);
+  if (err == 0 && nwritten < f->wlen) err = EIO;
+  f->wlen = 0;
+  return err;
+}
+
+static int kk_os_file_close_fd(kk_os_file_t* f) {
+  if (f->fd < 0) return EBADF;
+  int err = kk_os_file_flush_buf(f);
+  int cerr;
+  if (f->proc != NULL) {
+    #if defined(WIN32)
+    f->exit_code = _pclose(f->proc);
+    #else
+    const int status = pclose(f->proc);
+    f->exit_code = (status >= 0 && WIFEXITED(status) ? WEXITSTATUS(status) : status);
+    #endif
+    cerr = (f->exit_code < 0 ? errno : 0);
+    f->proc = NULL;
+  }
+  else {
+    cerr = kk_posix_close(f->fd);
+  }
+  f->fd = -1;
+  return (err != 0 ? err : cerr);
+}
+
+static void kk_os_file_free_fun(void* p, kk_block_t* b, kk_context_t* ctx) {
+  kk_unused(b);
+  kk_os_file_t* f = (kk_os_file_t*)p;
+  if (f->fd >= 0) kk_os_file_close_fd(f);
+  kk_bytes_drop(f->chunk, ctx);
+  if (f->wbuf != NULL) kk_free(f->wbuf, ctx);
+  kk_free(f, ctx);
+}
+
+static kk_os_file_t* kk_os_file_unbox(kk_box_t file) {
+  return (kk_os_file_t*)kk_cptr_raw_unbox(file);
+}
+
+// Open a file for streaming reads (`write` is false), or writes (truncating the file unless `append` is true).
+kk_decl_export int kk_os_file_open(kk_string_t path, bool write, bool append, kk_box_t* file, kk_context_t* ctx) {
+  kk_file_t fd;
+  const int flags = (!write ? O_RDONLY : (O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC)));
+  int err = kk_posix_open(path, flags, 0644, &fd, ctx);
+  if (err != 0) return err;
+  kk_os_file_t* f = (kk_os_file_t*)kk_zalloc(kk_ssizeof(kk_os_file_t), ctx);
+  if (f == NULL) {
+    kk_posix_close(fd);
+    return ENOMEM;
+  }
+  f->fd = fd;
+  f->chunk = kk_bytes_empty();
+  *file = kk_cptr_raw_box(&kk_os_file_free_fun, f, ctx);
+  return 0;
+}
+
+// Get a buffer of `size` bytes for the next chunk; reuses the previous chunk if it is no longer referenced.
+static uint8_t* kk_os_file_chunk_buf(kk_os_file_t* f, kk_ssize_t size, kk_context_t* ctx) {
+  if (!kk_datatype_is_singleton(f->chunk)) {
+    if (f->chunk_cap >= size && kk_datatype_is_unique(f->chunk)) {
+      kk_bytes_normal_t nb = kk_datatype_as_assert(kk_bytes_normal_t, f->chunk, KK_TAG_BYTES);
+      nb->length = size;
+      nb->buf[size] = 0;
+      return nb->buf;
+    }
+    kk_bytes_drop(f->chunk, ctx);
+  }
+  uint8_t* buf;
+  f->chunk = kk_bytes_alloc_buf(size, &buf, ctx);
+  f->chunk_cap = size;
+  kk_assert_internal(kk_datatype_has_tag(f->chunk, KK_TAG_BYTES));
+  return buf;
+}
+
+// Return the first `len` bytes of the current chunk.
+static kk_bytes_t kk_os_file_chunk_result(kk_os_file_t* f, kk_ssize_t len) {
+  if (len == 0) return kk_bytes_empty();
+  kk_bytes_normal_t nb = kk_datatype_as_assert(kk_bytes_normal_t, f->chunk, KK_TAG_BYTES);
+  nb->length = len;   // shrink in place; the capacity is still `chunk_cap`
+  nb->buf[len] = 0;
+  return kk_bytes_dup(f->chunk);
+}
+
+// Read the next chunk of at most `max` bytes; returns empty bytes at the end of the file.
+// If `text` is true the chunk never ends inside a utf-8 sequence (except at the end of the file)
+// and can be converted using `kk_string_convert_from_qutf8`.
+kk_decl_export int kk_os_file_read_chunk(kk_box_t file, kk_ssize_t max, bool text, kk_bytes_t* chunk, kk_context_t* ctx) {
+  kk_os_file_t* f = kk_os_file_unbox(file);
+  *chunk = kk_bytes_empty();
+  int err = 0;
+  if (f->fd < 0) {
+    err = EBADF;
+  }
+  else if (!f->eof || f->pending_len > 0) {
+    if (max < KK_OS_FILE_CHUNK_MIN) max = KK_OS_FILE_CHUNK_MIN;
+    uint8_t* buf = kk_os_file_chunk_buf(f, max, ctx);
+    const kk_ssize_t npending = f->pending_len;
+    kk_memcpy(buf, f->pending, npending);
+    f->pending_len = 0;
+    kk_ssize_t len = npending;
+    kk_ssize_t cut;
+    do {
+      kk_ssize_t nread = 0;
+      if (f->eof) {
+        // no more input
+      }
+      else if (f->proc != NULL) {
+        // a pipe: return the output as soon as it is available
+        err = kk_posix_read_some(f->fd, buf + len, max - len, &nread);
+        if (err == 0 && nread == 0) f->eof = true;
+      }
+      else {
+        err = kk_posix_read_retry(f->fd, buf + len, max - len, &nread);
+        if (err == 0 && nread < max - len) f->eof = true;
+      }
+      len += nread;
+      // move a trailing incomplete utf-8 sequence to the next chunk
+      cut = (text && !f->eof ? len - kk_utf8_incomplete_tail(buf, len) : len);
+    } while (err == 0 && cut == 0 && len > 0 && !f->eof);  // a partial pipe read of just an incomplete sequence
+    if (cut < len) {
+      f->pending_len = (int)(len - cut);
+      kk_memcpy(f->pending, buf + cut, len - cut);
+      len = cut;
+    }
+    *chunk = kk_os_file_chunk_result(f, len);
+  }
+  kk_box_drop(file, ctx);
+  return err;
+}
+
+// Write bytes to a file; these are buffered and written in large blocks.
+kk_decl_export int kk_os_file_write(kk_box_t file, kk_bytes_t content, kk_context_t* ctx) {
+  kk_os_file_t* f = kk_os_file_unbox(file);
+  int err = 0;
+  kk_ssize_t len;
+  const uint8_t* buf = kk_bytes_buf_borrow(content, &len);
+  if (f->fd < 0) {
+    err = EBADF;
+  }
+  else if (f->wlen + len <= KK_OS_FILE_WBUF_SIZE) {
+    if (f->wbuf == NULL) {
+      f->wbuf = (uint8_t*)kk_malloc(KK_OS_FILE_WBUF_SIZE, ctx);
+      if (f->wbuf == NULL) err = ENOMEM;
+    }
+    if (err == 0) {
+      kk_memcpy(f->wbuf + f->wlen, buf, len);
+      f->wlen += len;
+    }
+  }
+  else {
+    // flush and write large content directly
+    err = kk_os_file_flush_buf(f);
+    if (err == 0) {
+      kk_ssize_t nwritten;
+      err = kk_posix_write_retry(f->fd, buf, len, &nwritten);
+      if (err == 0 && nwritten < len) err = EIO;
+    }
+  }
+  kk_bytes_drop(content, ctx);
+  kk_box_drop(file, ctx);
+  return err;
+}
+
+kk_decl_export int kk_os_file_flush(kk_box_t file, kk_context_t* ctx) {
+  kk_os_file_t* f = kk_os_file_unbox(file);
+  int err = (f->fd < 0 ? EBADF : kk_os_file_flush_buf(f));
+  kk_box_drop(file, ctx);
+  return err;
+}
+
+// Flush and close a file; this is also done when the file handle is freed.
+kk_decl_export int kk_os_file_close(kk_box_t file, kk_context_t* ctx) {
+  kk_os_file_t* f = kk_os_file_unbox(file);
+  int err = kk_os_file_close_fd(f);
+  kk_box_drop(file, ctx);
+  return err;
+}
+
+
 
 /*--------------------------------------------------------------------------------------------------
   Read line
@@ -247,6 +626,7 @@ kk_decl_export int kk_os_write_text_file(kk_string_t path, kk_string_t content,
 kk_decl_export int kk_os_read_line(kk_string_t* result, kk_context_t* ctx)
 {
   char buf[1024];
+  kk_output_flush(ctx);  // show any prompt first
   if (fgets(buf, 1023, stdin) == NULL) return errno;
   buf[1023] = 0;      // ensure zero termination
   const size_t len = strlen(buf);
@@ -339,8 +719,18 @@ kk_decl_export int kk_os_copy_file(kk_string_t from, kk_string_t to, bool preser
   int err = 0;
   kk_with_string_as_qutf16w_borrow(from, wfrom, ctx) {
     kk_with_string_as_qutf16w_borrow(to, wto, ctx) {
+      #if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+      // Windows 8+: use `CopyFile2` which can use block cloning (on ReFS) or offloaded copies
+      COPYFILE2_EXTENDED_PARAMETERS params = { 0 };
+      params.dwSize = sizeof(params);
+      params.dwCopyFlags = 0;
+      HRESULT hr = CopyFile2(wfrom, wto, &params);
+      if (FAILED(hr)) {
+        DWORD werr = HRESULT_CODE(hr);
+      #else
       if (!CopyFileW(wfrom, wto, FALSE)) {
         DWORD werr = GetLastError();
+      #endif
         if (werr == ERROR_FILE_NOT_FOUND) err = ENOENT;
         else if (werr == ERROR_ACCESS_DENIED) err = EPERM;
         else if (werr == ERROR_PATH_NOT_FOUND) err = ENOTDIR;
@@ -356,26 +746,73 @@ kk_decl_export int kk_os_copy_file(kk_string_t from, kk_string_t to, bool preser
 
 #if defined(__APPLE__)
 #include <copyfile.h>
+#include <sys/time.h>   // utimes
 
 #else
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#if defined(__has_include)
+#if __has_include(<linux/fs.h>)
+#include <linux/fs.h>   // FICLONE
+#endif
+#endif
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define KK_HAS_COPY_FILE_RANGE  1
+#endif
+#endif
+
+#define KK_POSIX_COPY_CHUNK  (1024*1024)
+
+// Can we fall back to a slower copy method after this error?
+static bool kk_posix_copy_unsupported(int err) {
+  return (err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP || err == ENOTTY || err == EBADF);
+}
+
 static int kk_posix_copy_file(const int inp, const int out, const kk_ssize_t estimated_len, kk_context_t* ctx) {
   int err = 0;
 
-#if defined(COPY_FR_COPY)
-  // try copy_file_range first
+#if defined(__linux__)
   if (estimated_len > 0 && estimated_len < KK_SSIZE_MAX) {  // non-regular files can report zero length but can be read anyways
-    loff_t off_in = 0;
-    loff_t off_out = 0;
-    if (copy_file_range(inp, &off_in, out, &off_out, KK_SSIZE_MAX, 0 /* flags */) < 0) {
-      err = errno;
-    };
-    if (err != EINVAL) return err;
-    // fall through if `copy_file_range` failed immediately with `EINVAL` (might be a non-seekable device?)
+    #if defined(FICLONE)
+    // try a reflink first (on btrfs, xfs, etc.) which shares the file data copy-on-write
+    if (ioctl(out, FICLONE, inp) == 0) return 0;
+    #endif
+    // next try an in-kernel copy (which uses and updates the file positions so we can continue on a fallback).
+    // We copy until EOF: after the estimated length we continue in chunks in case the file grew in the meantime.
+    kk_ssize_t todo = estimated_len;
+    #if defined(KK_HAS_COPY_FILE_RANGE)
+    for (;;) {
+      const ssize_t n = copy_file_range(inp, NULL, out, NULL, (size_t)(todo > 0 ? todo : KK_POSIX_COPY_CHUNK), 0 /* flags */);
+      if (n == 0) return 0;  // eof
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        err = errno;
+        break;
+      }
+      todo -= n;
+    }
+    if (!kk_posix_copy_unsupported(err)) return err;
     err = 0;
-  }  
+    #endif
+    // or with `sendfile`
+    for (;;) {
+      const ssize_t n = sendfile(out, inp, NULL, (size_t)(todo > 0x7FFFF000 ? 0x7FFFF000 : (todo > 0 ? todo : KK_POSIX_COPY_CHUNK)));
+      if (n == 0) return 0;  // eof
+      if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN) continue;
+        err = errno;
+        break;
+      }
+      todo -= n;
+    }
+    if (!kk_posix_copy_unsupported(err)) return err;
+    // fall through to a buffered copy from the current position
+    err = 0;
+  }
 #endif
 
-  kk_ssize_t buflen = 1024 * 1024; // max 1MiB buffer
+  kk_ssize_t buflen = KK_POSIX_COPY_CHUNK; // max 1MiB buffer
   if (buflen > estimated_len) buflen = estimated_len + 1;
   uint8_t* buf = (uint8_t*)kk_malloc(buflen, ctx);
   if (buf == NULL) return ENOMEM;
@@ -395,10 +832,38 @@ static int kk_posix_copy_file(const int inp, const int out, const kk_ssize_t est
 }
 #endif  // not __APPLE__ 
 
+#if defined(__APPLE__) && defined(COPYFILE_CLONE)
+// macOS: `copyfile` clones the file on APFS (and falls back to copying otherwise). `COPYFILE_CLONE`
+// implies `COPYFILE_EXCL` so this is only used if the target does not exist yet (and otherwise we
+// overwrite the target as usual). A clone copies the timestamps of the source so these are reset
+// if `preserve_mtime` is false.
+static bool kk_macos_clone_file(kk_string_t from, kk_string_t to, bool preserve_mtime, kk_context_t* ctx) {
+  bool cloned = false;
+  kk_with_string_as_qutf8_borrow(from, cfrom, ctx) {
+    kk_with_string_as_qutf8_borrow(to, cto, ctx) {
+      struct stat tinfo;
+      if (lstat(cto, &tinfo) != 0 && errno == ENOENT && copyfile(cfrom, cto, NULL, COPYFILE_CLONE) == 0) {
+        cloned = true;
+        if (!preserve_mtime) utimes(cto, NULL);  // set to the current time
+      }
+    }
+  }
+  return cloned;
+}
+#endif
+
 kk_decl_export int  kk_os_copy_file(kk_string_t from, kk_string_t to, bool preserve_mtime, kk_context_t* ctx) {
   int inp = 0;
   int out = 0;
 
+#if defined(__APPLE__) && defined(COPYFILE_CLONE)
+  if (kk_macos_clone_file(from, to, preserve_mtime, ctx)) {
+    kk_string_drop(from, ctx);
+    kk_string_drop(to, ctx);
+    return 0;
+  }
+#endif
+
   // stat and create/overwrite target
   struct stat finfo = { 0 };
   int err = 0;
@@ -422,7 +887,7 @@ kk_decl_export int  kk_os_copy_file(kk_string_t from, kk_string_t to, bool prese
 #if defined(__APPLE__)
   // macOS
   kk_unused(ctx);
-  if (fcopyfile(inp, out, 0, COPYFILE_ALL) != 0) {
+  if (fcopyfile(inp, out, 0, (preserve_mtime ? COPYFILE_DATA | COPYFILE_STAT : COPYFILE_DATA)) != 0) {
     err = errno;
   }
 #else 
@@ -574,7 +1039,295 @@ kk_decl_export int kk_os_list_directory(kk_string_t dir, kk_vector_t* contents,
 
   if(count != len) {
     *contents = kk_vector_realloc(vec, count, kk_box_null, ctx);
-  } 
+  }
+  else {
+    *contents = vec;
+  }
+  return err;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  List directory with metadata
+--------------------------------------------------------------------------------------------------*/
+
+// entry kinds (as in `std/os/dir/entry-kind`)
+#define KK_OS_ENTRY_OTHER    (0)
+#define KK_OS_ENTRY_FILE     (1)
+#define KK_OS_ENTRY_DIR      (2)
+#define KK_OS_ENTRY_SYMLINK  (3)
+
+typedef struct kk_os_dirlist_s {
+  kk_box_t*   names;     // owned strings: the entry paths relative to the listed directory
+  int64_t*    infos;     // 3 per entry: the kind, size, and modification time (in nanoseconds since the epoch)
+  kk_ssize_t  count;
+  kk_ssize_t  capacity;
+} kk_os_dirlist_t;
+
+// Add an entry (or return ENOMEM and drop the `name` if the entries cannot grow; the entries so far are kept)
+static int kk_os_dirlist_push(kk_os_dirlist_t* dl, kk_string_t name, int kind, int64_t size, int64_t mtime, kk_context_t* ctx) {
+  if (kk_unlikely(dl->count >= dl->capacity)) {
+    const kk_ssize_t newcap = (dl->capacity < 64 ? 64 : 2*dl->capacity);
+    kk_box_t* names = (kk_box_t*)kk_realloc(dl->names, newcap * kk_ssizeof(kk_box_t), ctx);
+    if (names == NULL) {
+      kk_string_drop(name, ctx);
+      return ENOMEM;
+    }
+    dl->names = names;
+    int64_t* infos = (int64_t*)kk_realloc(dl->infos, 3 * newcap * kk_ssizeof(int64_t), ctx);
+    if (infos == NULL) {
+      kk_string_drop(name, ctx);
+      return ENOMEM;
+    }
+    dl->infos = infos;
+    dl->capacity = newcap;
+  }
+  dl->names[dl->count] = kk_string_box(name);
+  int64_t* info = &dl->infos[3*dl->count];
+  info[0] = kind;
+  info[1] = size;
+  info[2] = mtime;
+  dl->count++;
+  return 0;
+}
+
+// Convert to a vector of names and a vector of integers (3 per name)
+static void kk_os_dirlist_done(kk_os_dirlist_t* dl, kk_vector_t* names, kk_vector_t* infos, kk_context_t* ctx) {
+  kk_box_t* v;
+  *names = kk_vector_alloc_uninit(dl->count, &v, ctx);
+  if (dl->count > 0) kk_memcpy(v, dl->names, dl->count * kk_ssizeof(kk_box_t));  // move ownership
+  *infos = kk_vector_alloc_uninit(3*dl->count, &v, ctx);
+  for (kk_ssize_t i = 0; i < 3*dl->count; i++) {
+    v[i] = kk_integer_box(kk_integer_from_int64(dl->infos[i], ctx));
+  }
+  kk_free(dl->names, ctx);
+  kk_free(dl->infos, ctx);
+  dl->names = NULL;
+  dl->infos = NULL;
+  dl->count = dl->capacity = 0;
+}
+
+// The name of a directory entry relative to the listed root
+static kk_string_t kk_os_dirlist_name(kk_string_t rel, kk_string_t name, kk_context_t* ctx) {
+  if (kk_string_is_empty_borrow(rel)) return name;
+  return kk_string_cat(kk_string_cat_from_valid_utf8(kk_string_dup(rel), "/", ctx), name, ctx);
+}
+
+#if defined(WIN32)
+// 100ns intervals since 1601 to nanoseconds since 1970
+static int64_t kk_os_filetime_ns(FILETIME ft) {
+  const int64_t t = (int64_t)(((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime);
+  return (t - KK_I64(116444736000000000)) * 100;
+}
+
+// Add the entries of `root/rel` to `dl`; uses a basic large fetch which returns the metadata directly.
+static int kk_os_dirlist_add(kk_string_t root, kk_string_t rel, bool with_stat, kk_os_dirlist_t* dl, kk_context_t* ctx) {
+  kk_unused(with_stat);
+  kk_string_t path = kk_string_dup(root);
+  if (!kk_string_is_empty_borrow(rel)) path = kk_string_cat(kk_string_cat_from_valid_utf8(path, "\\", ctx), kk_string_dup(rel), ctx);
+  path = kk_string_cat_from_valid_utf8(path, "\\*", ctx);
+  WIN32_FIND_DATAW data;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  kk_with_string_as_qutf16w_borrow(path, wpath, ctx) {
+    h = FindFirstFileExW(wpath, FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  }
+  kk_string_drop(path, ctx);
+  if (h == INVALID_HANDLE_VALUE) {
+    const DWORD werr = GetLastError();
+    return (werr == ERROR_FILE_NOT_FOUND ? 0 : (werr == ERROR_PATH_NOT_FOUND ? ENOENT : (werr == ERROR_ACCESS_DENIED ? EPERM : EINVAL)));
+  }
+  int err = 0;
+  do {
+    const wchar_t* name = data.cFileName;
+    if (wcscmp(name, L".") == 0 || wcscmp(name, L"..") == 0) continue;
+    const DWORD attr = data.dwFileAttributes;
+    const int kind = ((attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0 ? KK_OS_ENTRY_SYMLINK :
+                      ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0 ? KK_OS_ENTRY_DIR :
+                       ((attr & FILE_ATTRIBUTE_DEVICE) != 0 ? KK_OS_ENTRY_OTHER : KK_OS_ENTRY_FILE)));
+    const int64_t size = (int64_t)(((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
+    kk_string_t sname = kk_os_dirlist_name(rel, kk_string_alloc_from_qutf16w(name, ctx), ctx);
+    err = kk_os_dirlist_push(dl, sname, kind, size, kk_os_filetime_ns(data.ftLastWriteTime), ctx);
+  } while (err == 0 && FindNextFileW(h, &data));
+  FindClose(h);
+  return err;
+}
+
+#else
+// Add the entries of `root/rel` to `dl`; uses `d_type` for the kind and only calls `stat` when needed
+// (and relative to the directory so the path is not resolved again).
+static int kk_os_dirlist_add(kk_string_t root, kk_string_t rel, bool with_stat, kk_os_dirlist_t* dl, kk_context_t* ctx) {
+  kk_string_t path = kk_string_dup(root);
+  if (!kk_string_is_empty_borrow(rel)) path = kk_string_cat(kk_string_cat_from_valid_utf8(path, "/", ctx), kk_string_dup(rel), ctx);
+  DIR* d = NULL;
+  kk_with_string_as_qutf8_borrow(path, cpath, ctx) {
+    d = opendir(cpath);
+  }
+  kk_string_drop(path, ctx);
+  if (d == NULL) return errno;
+  int err = 0;
+  while (true) {
+    errno = 0;
+    const struct dirent* e = readdir(d);  // uses `getdents64` with a large buffer
+    if (e == NULL) {
+      err = errno;
+      break;
+    }
+    const char* name = e->d_name;
+    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+    int kind = -1;
+    #if defined(DT_DIR)
+    switch (e->d_type) {
+      case DT_REG: kind = KK_OS_ENTRY_FILE; break;
+      case DT_DIR: kind = KK_OS_ENTRY_DIR; break;
+      case DT_LNK: kind = KK_OS_ENTRY_SYMLINK; break;
+      case DT_UNKNOWN: break;
+      default: kind = KK_OS_ENTRY_OTHER; break;
+    }
+    #endif
+    int64_t size = 0;
+    int64_t mtime = 0;
+    if (with_stat || kind < 0) {
+      struct stat st;
+      if (fstatat(dirfd(d), name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        kind = (S_ISREG(st.st_mode) ? KK_OS_ENTRY_FILE : (S_ISDIR(st.st_mode) ? KK_OS_ENTRY_DIR :
+                (S_ISLNK(st.st_mode) ? KK_OS_ENTRY_SYMLINK : KK_OS_ENTRY_OTHER)));
+        size = (int64_t)st.st_size;
+        #if defined(__APPLE__)
+        mtime = ((int64_t)st.st_mtimespec.tv_sec * KK_I64(1000000000)) + st.st_mtimespec.tv_nsec;
+        #else
+        mtime = ((int64_t)st.st_mtim.tv_sec * KK_I64(1000000000)) + st.st_mtim.tv_nsec;
+        #endif
+      }
+      else if (kind < 0) {
+        kind = KK_OS_ENTRY_OTHER;
+      }
+    }
+    kk_string_t sname = kk_os_dirlist_name(rel, kk_string_alloc_from_qutf8(name, ctx), ctx);
+    err = kk_os_dirlist_push(dl, sname, kind, size, mtime, ctx);
+    if (err != 0) break;
+  }
+  closedir(d);
+  return err;
+}
+#endif
+
+// List a directory together with the kind of each entry, and (if `with_stat` is true) the size
+// and modification time. `infos` contains 3 integers per entry in `names`.
+kk_decl_export int kk_os_list_directory_info(kk_string_t dir, bool with_stat, kk_vector_t* names, kk_vector_t* infos, kk_context_t* ctx) {
+  kk_os_dirlist_t dl = { 0 };
+  int err = kk_os_dirlist_add(dir, kk_string_empty(), with_stat, &dl, ctx);
+  kk_string_drop(dir, ctx);
+  kk_os_dirlist_done(&dl, names, infos, ctx);
+  return err;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Walk a directory tree (in parallel)
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_OS_WALK_TASK_DEPTH  (4)   // subdirectories up to this depth are listed by separate tasks
+
+static int kk_os_walk(kk_string_t root, kk_string_t rel, kk_ssize_t depth, kk_ssize_t max_depth, bool with_stat, bool parallel, kk_os_dirlist_t* dl, kk_context_t* ctx);
+
+typedef struct kk_os_walk_task_s {
+  struct kk_function_s _base;
+  kk_string_t root;
+  kk_string_t rel;
+  kk_ssize_t  depth;       // not scanned
+  kk_ssize_t  max_depth;
+  bool        with_stat;
+} *kk_os_walk_task_t;
+
+static kk_box_t kk_os_walk_task_fun(kk_function_t fself, kk_context_t* ctx) {
+  kk_os_walk_task_t t = kk_function_as(kk_os_walk_task_t, fself);
+  kk_string_t root = kk_string_dup(t->root);
+  kk_string_t rel = kk_string_dup(t->rel);
+  const kk_ssize_t depth = t->depth;
+  const kk_ssize_t max_depth = t->max_depth;
+  const bool with_stat = t->with_stat;
+  kk_function_drop(fself, ctx);
+  kk_os_dirlist_t dl = { 0 };
+  kk_os_walk(root, rel, depth, max_depth, with_stat, true, &dl, ctx);
+  kk_string_drop(root, ctx);
+  kk_string_drop(rel, ctx);
+  // return a vector with the names and infos
+  kk_box_t* v;
+  kk_vector_t res = kk_vector_alloc_uninit(2, &v, ctx);
+  kk_vector_t names;
+  kk_vector_t infos;
+  kk_os_dirlist_done(&dl, &names, &infos, ctx);
+  v[0] = kk_vector_box(names, ctx);
+  v[1] = kk_vector_box(infos, ctx);
+  return kk_vector_box(res, ctx);
+}
+
+static kk_promise_t kk_os_walk_schedule(kk_string_t root, kk_string_t rel, kk_ssize_t depth, kk_ssize_t max_depth, bool with_stat, kk_context_t* ctx) {
+  kk_os_walk_task_t t = kk_function_alloc_as(struct kk_os_walk_task_s, 3, ctx);
+  t->_base.fun = kk_cfun_ptr_box(&kk_os_walk_task_fun, ctx);
+  t->root = root;
+  t->rel = rel;
+  t->depth = depth;
+  t->max_depth = max_depth;
+  t->with_stat = with_stat;
+  return kk_task_schedule(&t->_base, ctx);
+}
+
+// Add the entries of the task result `res` to `dl`
+static void kk_os_walk_join(kk_box_t res, kk_os_dirlist_t* dl, kk_context_t* ctx) {
+  kk_vector_t v = kk_vector_unbox(res, ctx);
+  kk_box_t* parts = kk_vector_buf_borrow(v, NULL);
+  kk_ssize_t n;
+  kk_box_t* names = kk_vector_buf_borrow(kk_vector_unbox(parts[0], ctx), &n);
+  kk_box_t* infos = kk_vector_buf_borrow(kk_vector_unbox(parts[1], ctx), NULL);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    const int err = kk_os_dirlist_push(dl, kk_string_unbox(kk_box_dup(names[i])),
+                                       (int)kk_integer_clamp_ssize_t_borrow(kk_integer_unbox(infos[3*i]), ctx),
+                                       kk_integer_clamp64_borrow(kk_integer_unbox(infos[3*i+1]), ctx),
+                                       kk_integer_clamp64_borrow(kk_integer_unbox(infos[3*i+2]), ctx), ctx);
+    if (err != 0) break;  // out of memory: like errors in subdirectories this is ignored
+  }
+  kk_vector_drop(v, ctx);
+}
+
+// Add all entries under `root/rel` to `dl` and return the error of listing `root/rel` itself
+// (errors in subdirectories are ignored).
+static int kk_os_walk(kk_string_t root, kk_string_t rel, kk_ssize_t depth, kk_ssize_t max_depth, bool with_stat, bool parallel, kk_os_dirlist_t* dl, kk_context_t* ctx) {
+  const kk_ssize_t start = dl->count;
+  const int err = kk_os_dirlist_add(root, rel, with_stat, dl, ctx);
+  const kk_ssize_t end = dl->count;
+  if (depth >= max_depth) return err;
+  kk_promise_t* promises = NULL;
+  kk_ssize_t pcount = 0;
+  for (kk_ssize_t i = start; i < end; i++) {
+    if (dl->infos[3*i] != KK_OS_ENTRY_DIR) continue;
+    kk_string_t sub = kk_string_unbox(kk_box_dup(dl->names[i]));
+    if (promises == NULL && parallel && depth < KK_OS_WALK_TASK_DEPTH) {
+      promises = (kk_promise_t*)kk_malloc((end - i) * kk_ssizeof(kk_promise_t), ctx);  // if NULL we walk sequentially
+    }
+    if (promises != NULL) {
+      promises[pcount++] = kk_os_walk_schedule(kk_string_dup(root), sub, depth + 1, max_depth, with_stat, ctx);
+    }
+    else {
+      kk_os_walk(root, sub, depth + 1, max_depth, with_stat, parallel, dl, ctx);
+      kk_string_drop(sub, ctx);
+    }
+  }
+  for (kk_ssize_t i = 0; i < pcount; i++) {
+    kk_os_walk_join(kk_promise_get(promises[i], ctx), dl, ctx);
+  }
+  if (promises != NULL) kk_free(promises, ctx);
+  return err;
+}
+
+// Recursively list all entries under a directory up to `max_depth` (where `0` lists just `dir`).
+// If `parallel` is true, subdirectories are listed by tasks in the task group (and the order of
+// the entries is not deterministic). Returns the names relative to `dir` as `kk_os_list_directory_info`.
+kk_decl_export int kk_os_walk_directory(kk_string_t dir, kk_ssize_t max_depth, bool with_stat, bool parallel, kk_vector_t* names, kk_vector_t* infos, kk_context_t* ctx) {
+  kk_os_dirlist_t dl = { 0 };
+  const int err = kk_os_walk(dir, kk_string_empty(), 0, max_depth, with_stat, parallel, &dl, ctx);
+  kk_string_drop(dir, ctx);
+  kk_os_dirlist_done(&dl, names, infos, ctx);
   return err;
 }
 
@@ -583,7 +1336,9 @@ kk_decl_export int kk_os_list_directory(kk_string_t dir, kk_vector_t* contents,
   Run system command
 --------------------------------------------------------------------------------------------------*/
 
-kk_decl_export int kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_context_t* ctx) {
+#define KK_OS_PIPE_READ_MIN  (64*1024)
+
+static FILE* kk_os_popen(kk_string_t cmd, kk_context_t* ctx) {
   FILE* f = NULL;
 #if defined(WIN32)
   kk_with_string_as_qutf16w_borrow(cmd, wcmd, ctx) {
@@ -595,21 +1350,62 @@ kk_decl_export int kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_co
   }
 #endif
   kk_string_drop(cmd, ctx);
+  return f;
+}
+
+kk_decl_export int kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_context_t* ctx) {
+  *output = kk_string_empty();
+  FILE* f = kk_os_popen(cmd, ctx);
   if (f == NULL) return errno;
-  kk_string_t out = kk_string_empty();
-  char buf[1025];
-  while (fgets(buf, 1024, f) != NULL) {
-    buf[1024] = 0; // paranoia
-    out = kk_string_cat(out, kk_string_alloc_from_qutf8(buf,ctx), ctx);  // todo: avoid allocation
+  // read directly into the (doubling) buffer of a string builder
+  const kk_file_t fd = kk_posix_fileno(f);
+  kk_string_builder_t out;
+  kk_string_builder_init(&out, KK_OS_PIPE_READ_MIN, ctx);
+  int err = 0;
+  while (true) {
+    if (out.capacity - out.len < KK_OS_PIPE_READ_MIN) kk_string_builder_grow(&out, KK_OS_PIPE_READ_MIN, ctx);
+    kk_ssize_t nread;
+    err = kk_posix_read_some(fd, out.p + out.len, out.capacity - out.len, &nread);
+    if (err != 0 || nread == 0) break;
+    out.len += nread;
   }
-  if (feof(f)) errno = 0;
 #if defined(WIN32)
   _pclose(f);
 #else
   pclose(f);
 #endif
-  *output = out;
-  return errno;
+  *output = kk_string_builder_finish_qutf8(&out, ctx);  // convert at the end as chunks may split a character
+  return err;
+}
+
+// Run a command and return a file handle to read its output in chunks as it becomes available
+// (see `kk_os_file_read_chunk`); the exit code is returned by `kk_os_process_close`.
+kk_decl_export int kk_os_process_open(kk_string_t cmd, kk_box_t* file, kk_context_t* ctx) {
+  FILE* p = kk_os_popen(cmd, ctx);
+  if (p == NULL) return errno;
+  kk_os_file_t* f = (kk_os_file_t*)kk_zalloc(kk_ssizeof(kk_os_file_t), ctx);
+  if (f == NULL) {
+    #if defined(WIN32)
+    _pclose(p);
+    #else
+    pclose(p);
+    #endif
+    return ENOMEM;
+  }
+  f->fd = kk_posix_fileno(p);
+  f->proc = p;
+  f->chunk = kk_bytes_empty();
+  *file = kk_cptr_raw_box(&kk_os_file_free_fun, f, ctx);
+  return 0;
+}
+
+// Wait for the process to finish and return its exit code.
+kk_decl_export int kk_os_process_close(kk_box_t file, int* exit_code, kk_context_t* ctx) {
+  kk_os_file_t* f = kk_os_file_unbox(file);
+  int err = kk_os_file_close_fd(f);
+  *exit_code = f->exit_code;
+  kk_box_drop(file, ctx);
+  return err;
 }
 
 kk_decl_export int kk_os_run_system(kk_string_t cmd, kk_context_t* ctx) {
@@ -1238,6 +2034,47 @@ int kk_cpu_count(kk_context_t* ctx) {
   return (cpu_count < 1 ? 1 : cpu_count);
 }
 
+// Set `cpu_node[i]` to the NUMA node of logical cpu `i` (for `0 <= i < cpu_count`) and
+// return the number of NUMA nodes (which is 1 if this cannot be determined).
+int kk_cpu_numa_nodes(int* cpu_node, int cpu_count, kk_context_t* ctx) {
+  kk_unused(ctx);
+  for (int i = 0; i < cpu_count; i++) { cpu_node[i] = 0; }
+  int node_count = 1;
+#if defined(WIN32)
+  ULONG highest = 0;
+  if (GetNumaHighestNodeNumber(&highest)) {
+    node_count = (int)highest + 1;
+    for (int i = 0; i < cpu_count && i < 64; i++) {
+      UCHAR node = 0;
+      if (GetNumaProcessorNode((UCHAR)i, &node) && node != 0xFF) { cpu_node[i] = node; }
+    }
+  }
+#elif defined(__linux__)
+  // parse `/sys/devices/system/node/node<N>/cpulist` which contains ranges like `0-3,8-11`
+  for (int node = 0; node < 1024; node++) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) break;   // (we assume nodes are numbered consecutively)
+    long lo, hi;
+    int c;
+    while (fscanf(f, "%ld", &lo) == 1) {
+      hi = lo;
+      c = fgetc(f);
+      if (c == '-') {
+        if (fscanf(f, "%ld", &hi) != 1) break;
+        c = fgetc(f);
+      }
+      for (long i = lo; i <= hi && i < cpu_count; i++) { cpu_node[i] = node; }
+      if (c != ',') break;
+    }
+    fclose(f);
+    node_count = node + 1;
+  }
+#endif
+  return node_count;
+}
+
 bool kk_cpu_is_little_endian(kk_context_t* ctx) {
   kk_unused(ctx);
   #if KK_ARCH_LITTLE_ENDIAN
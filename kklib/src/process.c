@@ -105,6 +105,12 @@ void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, siz
   *page_reclaim = 0;
 }
 
+size_t kk_process_current_rss(void) {
+  PROCESS_MEMORY_COUNTERS info;
+  GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
+  return (size_t)info.WorkingSetSize;
+}
+
 #elif !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__unix) || defined(unix) || (defined(__APPLE__) && defined(__MACH__)) || defined(__HAIKU__))
 #include <stdio.h>
 #include <unistd.h>
@@ -153,6 +159,26 @@ void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, siz
   *stime = kk_timeval_secs(&rusage.ru_stime);
 }
 
+size_t kk_process_current_rss(void) {
+#if defined(__APPLE__) && defined(__MACH__)
+  struct mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+  return (size_t)info.resident_size;
+#elif defined(__linux__)
+  // the second field of `/proc/self/statm` is the resident set size in pages
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f == NULL) return 0;
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  const int n = fscanf(f, "%lu %lu", &size, &resident);
+  fclose(f);
+  return (n == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0);
+#else
+  return 0;
+#endif
+}
+
 #else
 #if !defined(__wasi__) && !defined(__EMSCRIPTEN__)
 // WebAssembly instances are not processes
@@ -167,4 +193,8 @@ void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, siz
   *utime = 0;
   *stime = 0;
 }
+
+size_t kk_process_current_rss(void) {
+  return 0;
+}
 #endif
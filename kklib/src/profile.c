@@ -0,0 +1,262 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------
+  Sampling profiler
+
+  Native profilers cannot attribute time across handler boundaries as the
+  continuations built in `hnd-inline.c` hide the Koka call structure. Instead, a
+  `SIGPROF` interval timer interrupts the running thread which then records the
+  handler tags of its current evidence vector and its shadow stack (see `profile.h`).
+
+  The signal handler does not allocate or lock: each thread has a fixed size
+  open addressing table of distinct samples that is only updated by the signal
+  handler of that thread. Tag names are only recorded if they are static strings
+  (which is the case for all tags generated by the compiler) so they remain valid
+  until the samples are written.
+
+  The profiler is not supported on Windows (which has no `SIGPROF`): there
+  `kk_profile_start` just gives a warning.
+--------------------------------------------------------------------------------------*/
+
+#define KK_PROFILE_TAGS     (8)     // maximal handler tags recorded in a sample
+#define KK_PROFILE_SAMPLES  (1024)  // maximal distinct samples per thread
+
+typedef struct kk_profile_sample_s {
+  uint64_t     hash;        // 0 for an unused entry
+  int64_t      count;
+  int32_t      ntags;
+  int32_t      nframes;
+  bool         truncated;   // the shadow stack was deeper than `KK_PROFILE_DEPTH`
+  const char*  names[KK_PROFILE_TAGS + KK_PROFILE_DEPTH];   // tags followed by the frames
+} kk_profile_sample_t;
+
+typedef struct kk_profile_samples_s {
+  kk_context_t*        ctx;
+  int64_t              total;
+  int64_t              dropped;   // samples lost as the table was full
+  kk_profile_sample_t  entries[KK_PROFILE_SAMPLES];
+} kk_profile_samples_t;
+
+static bool                 kk_profile_enabled;
+static const char*          kk_profile_fname;
+static _Atomic(kk_profile_t*) kk_profiles;       // all thread profiles
+static _Atomic(int64_t)     kk_profile_unknown;  // samples of threads without a profile
+static kk_decl_thread kk_profile_t* kk_profile_current;
+
+kk_decl_export bool kk_profile_is_enabled(void) {
+  return kk_profile_enabled;
+}
+
+kk_decl_export void kk_profile_thread_init(kk_context_t* ctx) {
+  if (!kk_profile_enabled || ctx->profile != NULL) return;
+  kk_profile_t* p = (kk_profile_t*)kk_zalloc(kk_ssizeof(kk_profile_t), ctx);
+  p->samples = (kk_profile_samples_t*)kk_zalloc(kk_ssizeof(kk_profile_samples_t), ctx);
+  if (p->samples == NULL) {
+    kk_free(p, ctx);
+    return;
+  }
+  p->samples->ctx = ctx;
+  kk_profile_t* head = kk_atomic_load_relaxed(&kk_profiles);
+  do {
+    p->next = head;
+  } while (!kk_atomic_cas_weak_acq_rel(&kk_profiles, &head, p));
+  ctx->profile = p;
+  kk_profile_current = p;   // enable sampling of this thread
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Taking a sample (in the signal handler)
+--------------------------------------------------------------------------------------*/
+
+// The name of a handler tag if it is a static string.
+// Each evidence starts with its tag (see `Ev` in `std/core/hnd.kk`).
+static const char* kk_profile_tag_name(kk_block_t* ev) {
+  if (kk_block_scan_fsize(ev) < 1) return NULL;
+  kk_string_t tag;
+  tag.bytes = kk_datatype_unbox(kk_block_field(ev, 0));
+  if (!kk_datatype_is_ptr(tag.bytes)) return NULL;
+  kk_block_t* b = kk_datatype_as_ptr(tag.bytes);
+  if (kk_block_tag(b) != KK_TAG_STRING || !kk_refcount_is_immortal(kk_block_refcount(b))) return NULL;
+  return kk_string_cbuf_borrow(tag, NULL);
+}
+
+// Record the tags of an evidence vector (with the layout of `kk_evv_vector_s` in `std/core/hnd-inline.h`)
+static int32_t kk_profile_evv_tags(kk_block_t* evv, const char** tags) {
+  if (evv == NULL) return 0;
+  if (kk_block_tag(evv) != KK_TAG_EVV_VECTOR) {  // a single evidence
+    tags[0] = kk_profile_tag_name(evv);
+    return (tags[0] == NULL ? 0 : 1);
+  }
+  int32_t n = 0;
+  const kk_ssize_t len = kk_block_scan_fsize(evv) - 1;  // the first field is the control flow context
+  for (kk_ssize_t i = 0; i < len && n < KK_PROFILE_TAGS; i++) {
+    kk_datatype_t ev = kk_datatype_unbox(kk_block_field(evv, i + 1));
+    if (!kk_datatype_is_ptr(ev)) continue;
+    const char* name = kk_profile_tag_name(kk_datatype_as_ptr(ev));
+    if (name != NULL) { tags[n++] = name; }
+  }
+  return n;
+}
+
+static uint64_t kk_profile_hash(const char** names, int32_t count) {
+  uint64_t h = KK_U64(14695981039346656037);
+  for (int32_t i = 0; i < count; i++) {
+    h = (h ^ (uint64_t)(uintptr_t)names[i]) * KK_U64(1099511628211);
+  }
+  return (h == 0 ? 1 : h);
+}
+
+static void kk_profile_sample(kk_profile_t* p) {
+  kk_profile_samples_t* s = p->samples;
+  kk_profile_sample_t sample;
+  sample.ntags = kk_profile_evv_tags(s->ctx->evv, sample.names);
+  const kk_ssize_t depth = p->depth;
+  sample.truncated = (depth > KK_PROFILE_DEPTH);
+  sample.nframes = (int32_t)(sample.truncated ? KK_PROFILE_DEPTH : depth);
+  for (int32_t i = 0; i < sample.nframes; i++) {
+    sample.names[sample.ntags + i] = p->frames[i];
+  }
+  const int32_t count = sample.ntags + sample.nframes;
+  const uint64_t h = kk_profile_hash(sample.names, count) ^ (uint64_t)sample.ntags;
+  s->total++;
+  // find the entry with linear probing
+  for (kk_ssize_t n = 0, i = (kk_ssize_t)(h % KK_PROFILE_SAMPLES); n < KK_PROFILE_SAMPLES; n++, i = (i+1) % KK_PROFILE_SAMPLES) {
+    kk_profile_sample_t* e = &s->entries[i];
+    if (e->hash == 0) {
+      memcpy(e->names, sample.names, (size_t)count * sizeof(const char*));
+      e->ntags = sample.ntags;
+      e->nframes = sample.nframes;
+      e->truncated = sample.truncated;
+      e->count = 1;
+      e->hash = h;
+      return;
+    }
+    if (e->hash == h && e->ntags == sample.ntags && e->nframes == sample.nframes && e->truncated == sample.truncated &&
+        memcmp(e->names, sample.names, (size_t)count * sizeof(const char*)) == 0) {
+      e->count++;
+      return;
+    }
+  }
+  s->dropped++;
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Writing the samples in folded stack format: `tag;..;frame;.. count`
+  where handler tags are written as `[tag]` frames at the root.
+--------------------------------------------------------------------------------------*/
+
+static int64_t kk_profile_write(FILE* f, kk_profile_t* p) {
+  int64_t total = 0;
+  for (kk_ssize_t i = 0; i < KK_PROFILE_SAMPLES; i++) {
+    const kk_profile_sample_t* e = &p->samples->entries[i];
+    if (e->hash == 0) continue;
+    fputs("[thread]", f);
+    for (int32_t j = 0; j < e->ntags; j++) {
+      fprintf(f, ";[%s]", e->names[j]);
+    }
+    for (int32_t j = 0; j < e->nframes; j++) {
+      const char* name = e->names[e->ntags + j];
+      fprintf(f, ";%s", (name == NULL ? "?" : name));
+    }
+    fprintf(f, "%s %lld\n", (e->truncated ? ";..." : ""), (long long)e->count);
+    total += e->count;
+  }
+  return total;
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Start and stop
+--------------------------------------------------------------------------------------*/
+
+#if !defined(_WIN32)
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+#if !defined(_WIN32) && defined(ITIMER_PROF)
+static void kk_profile_signal(int sig) {
+  kk_unused(sig);
+  const int err = errno;   // preserve errno of the interrupted code
+  kk_profile_t* p = kk_profile_current;
+  if (p == NULL) {
+    kk_atomic_inc_relaxed(&kk_profile_unknown);
+  }
+  else {
+    kk_profile_sample(p);
+  }
+  errno = err;
+}
+
+static bool kk_profile_timer(long usecs) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = usecs;
+  timer.it_value = timer.it_interval;
+  return (setitimer(ITIMER_PROF, &timer, NULL) == 0);
+}
+
+kk_decl_export bool kk_profile_start(const char* fname, kk_context_t* ctx) {
+  if (kk_profile_enabled) return true;
+  kk_profile_fname = (fname == NULL || fname[0] == 0 ? "kkprofile.folded" : fname);
+  kk_profile_enabled = true;
+  kk_profile_thread_init(ctx);
+  struct sigaction act;
+  memset(&act, 0, sizeof(act));
+  act.sa_handler = &kk_profile_signal;
+  act.sa_flags = SA_RESTART;
+  sigemptyset(&act.sa_mask);
+  if (sigaction(SIGPROF, &act, NULL) != 0 || !kk_profile_timer(1000000L / KK_PROFILE_HZ)) {
+    kk_warning_message("unable to start the profiler (error %d)\n", errno);
+    kk_profile_enabled = false;
+    return false;
+  }
+  return true;
+}
+
+static void kk_profile_stop(void) {
+  kk_profile_timer(0);
+  signal(SIGPROF, SIG_IGN);  // ignore a pending signal (which would terminate by default)
+}
+
+#else
+kk_decl_export bool kk_profile_start(const char* fname, kk_context_t* ctx) {
+  kk_unused(fname); kk_unused(ctx);
+  kk_warning_message("the profiler is not supported on this platform\n");
+  return false;
+}
+
+static void kk_profile_stop(void) {
+}
+#endif
+
+// Stop sampling and write all samples. The thread profiles are not freed
+// as other threads may still be running.
+kk_decl_export void kk_profile_end(kk_context_t* ctx) {
+  kk_unused(ctx);
+  if (!kk_profile_enabled) return;
+  kk_profile_stop();
+  kk_profile_enabled = false;
+  FILE* f = fopen(kk_profile_fname, "w");
+  if (f == NULL) {
+    kk_warning_message("unable to write profile to: %s\n", kk_profile_fname);
+    return;
+  }
+  int64_t total = 0;
+  int64_t dropped = kk_atomic_load_relaxed(&kk_profile_unknown);
+  for (kk_profile_t* p = kk_atomic_load_acquire(&kk_profiles); p != NULL; p = p->next) {
+    total += kk_profile_write(f, p);
+    dropped += p->samples->dropped;
+  }
+  fclose(f);
+  kk_info_message("profile: %lld samples written to %s (%lld dropped)\n", (long long)total, kk_profile_fname, (long long)dropped);
+}
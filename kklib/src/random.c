@@ -45,43 +45,86 @@ static void pcg_init(uint64_t init, uint64_t stream, kk_pcg_ctx_t* rnd) {
 }
 
 
-/*
-// pseudo random number context (using sfc32)
-typedef struct kk_sfc_ctx_s {
-  uint32_t a;
-  uint32_t b;
-  uint32_t c;
-  uint32_t counter;
-} kk_sfc_ctx_t;
-
-// Pseudo random number using sfc32 by Chris Doty-Humphrey.
-// It is a "chaotic" pseudo random generator that uses 32-bit operations only
-// (so we can be deterministic across architectures in results and performance).
-// It has good statistical properties and passes PractRand and Big-crush.
-// It uses a 32-bit counter to guarantee a worst-case cycle
-// of 2^32. It has a 96-bit state, so the average period is 2^127.
-// The chance of a cycle of less than 2^(32+max(96-k,0)) is 2^-(32+k),
-// (e.g. the chance of a cycle of less than 2^48 is 2^-80).
-// <http://pracrand.sourceforge.net/RNG_engines.txt>
-static inline uint32_t sfc_uint32(kk_sfc_ctx_t* rnd) {
-  uint32_t x = rnd->a + rnd->b + rnd->counter;
-  rnd->counter++;
-  rnd->a = rnd->b ^ (rnd->b >> 9);
-  rnd->b = rnd->c + (rnd->c << 3);
-  rnd->c = kk_bits_rotl32(rnd->c, 21) + x;
-  return x;
-}
+/* -----------------------------------------------------------
+  Fast pseudo random numbers using sfc32 by Chris Doty-Humphrey.
+  It is a "chaotic" pseudo random generator that uses 32-bit operations only
+  (so we can be deterministic across architectures in results and performance).
+  It has good statistical properties and passes PractRand and Big-crush.
+  It uses a 32-bit counter to guarantee a worst-case cycle
+  of 2^32. It has a 96-bit state, so the average period is 2^127.
+  The chance of a cycle of less than 2^(32+max(96-k,0)) is 2^-(32+k),
+  (e.g. the chance of a cycle of less than 2^48 is 2^-80).
+  <http://pracrand.sourceforge.net/RNG_engines.txt>
+  The step function `kk_prandom_uint32` is inline in `random.h`.
+----------------------------------------------------------- */
 
-static void sfc_init(uint64_t seed, kk_sfc_ctx_t* rnd) {
+void kk_prandom_init(kk_prandom_t* rnd, uint32_t seed_lo, uint32_t seed_hi) {
   rnd->a = 0;
-  rnd->b = (uint32_t)(seed);
-  rnd->c = (uint32_t)(seed >> 32);
+  rnd->b = seed_lo;
+  rnd->c = seed_hi;
   rnd->counter = 1;
   for (size_t i = 0; i < 12; i++) {
-    sfc_uint32(rnd);
+    kk_prandom_uint32(rnd);
   }
 }
-*/
+
+// Initialize `split` from fresh output of `rnd`; both can be used independently afterwards.
+void kk_prandom_split(kk_prandom_t* rnd, kk_prandom_t* split) {
+  split->a = kk_prandom_uint32(rnd);
+  split->b = kk_prandom_uint32(rnd);
+  split->c = kk_prandom_uint32(rnd);
+  split->counter = kk_prandom_uint32(rnd) | 1;
+  for (size_t i = 0; i < 12; i++) {
+    kk_prandom_uint32(split);
+  }
+}
+
+uint32_t kk_prandom_range_uint32_slow(kk_prandom_t* rnd, uint32_t max, uint64_t m) {
+  const uint32_t threshold = (~max+1) % max;  /* 2^32 % max  ==  (2^32 - max) % max  ==  -max % max */
+  while ((uint32_t)m < threshold) {
+    m = (uint64_t)kk_prandom_uint32(rnd) * (uint64_t)max;
+  }
+  return (uint32_t)(m >> 32);
+}
+
+void kk_prandom_buf(kk_prandom_t* rnd, void* buf, kk_ssize_t len) {
+  uint8_t* p = (uint8_t*)buf;
+  for (; len >= 4; len -= 4, p += 4) {
+    const uint32_t x = kk_prandom_uint32(rnd);
+    memcpy(p, &x, 4);
+  }
+  if (len > 0) {
+    const uint32_t x = kk_prandom_uint32(rnd);
+    memcpy(p, &x, (size_t)len);
+  }
+}
+
+kk_box_t kk_prandom_box_create(int32_t seed_lo, int32_t seed_hi, kk_context_t* ctx) {
+  kk_prandom_t* rnd = (kk_prandom_t*)kk_malloc(sizeof(kk_prandom_t), ctx);
+  kk_prandom_init(rnd, (uint32_t)seed_lo, (uint32_t)seed_hi);
+  return kk_cptr_raw_box(&kk_free_fun, rnd, ctx);
+}
+
+int32_t kk_prandom_range_int32(kk_prandom_t* rnd, int32_t min, int32_t max) {
+  if (min > max) {
+    int32_t x = min;
+    min = max;
+    max = x;
+  }
+  const uint32_t delta = (uint32_t)max - (uint32_t)min;
+  if (delta == 0) return min;
+  return (int32_t)((uint32_t)min + kk_prandom_range_uint32(rnd, delta));
+}
+
+kk_vector_t kk_prandom_vector_double(kk_prandom_t* rnd, kk_ssize_t len, kk_context_t* ctx) {
+  if (len <= 0) return kk_vector_empty();
+  kk_box_t* v;
+  kk_vector_t vec = kk_vector_alloc_uninit(len, &v, ctx);
+  for (kk_ssize_t i = 0; i < len; i++) {
+    v[i] = kk_double_box(kk_prandom_double(rnd), ctx);
+  }
+  return vec;
+}
 
 
 /* ----------------------------------------------------------------------------
@@ -102,8 +145,17 @@ Position 14 to 15: the nonce.
 
 The implementation uses regular C code which compiles very well on modern compilers.
 (gcc x64 has no register spills, and clang 6+ uses SSE instructions)
+Each round generates `KK_SRANDOM_BLOCKS` consecutive blocks at once; with SSE2,
+AVX2, or NEON we compute 4 or 8 blocks in parallel (one block per vector lane)
+which gives exactly the same output as computing the blocks one at a time.
 -----------------------------------------------------------------------------*/
 
+#if defined(KK_ARCH_X64_SIMD)
+#include <immintrin.h>
+#elif defined(KK_ARCH_ARM64_SIMD)
+#include <arm_neon.h>
+#endif
+
 static inline void kk_qround(uint32_t x[16], size_t a, size_t b, size_t c, size_t d) {
   x[a] += x[b]; x[d] = kk_bits_rotl32(x[d] ^ x[a], 16);
   x[c] += x[d]; x[b] = kk_bits_rotl32(x[b] ^ x[c], 12);
@@ -151,8 +203,159 @@ static inline void kk_chacha_block(const size_t rounds, uint32_t* input, uint32_
   }
 }
 
+#if defined(KK_ARCH_X64_SIMD) || defined(KK_ARCH_ARM64_SIMD)
+
+// Get the counter and nonce words (12 to 14) of the next `n` blocks and advance the input state.
+static void kk_chacha_lanes(uint32_t* input, size_t n, uint32_t* c12, uint32_t* c13, uint32_t* c14) {
+  for (size_t i = 0; i < n; i++) {
+    c12[i] = input[12];
+    c13[i] = input[13];
+    c14[i] = input[14];
+    input[12] += 1;
+    if (input[12] == 0) {
+      input[13] += 1;
+      if (input[13] == 0) {
+        input[14] += 1;
+      }
+    }
+  }
+}
+
+// Write the words `x[i][lane]` of `n` parallel blocks to the output in block order.
+static void kk_chacha_store_lanes(const uint32_t* x, size_t n, uint32_t* output) {
+  for (size_t b = 0; b < n; b++) {
+    for (size_t i = 0; i < 16; i++) {
+      output[16*b + i] = x[n*i + b];
+    }
+  }
+}
+
+#define kk_chacha_shuffle_lanes(x, qround) \
+  for (size_t r = 0; r < rounds; r += 2) { \
+    qround(x[0], x[4], x[8],  x[12]); \
+    qround(x[1], x[5], x[9],  x[13]); \
+    qround(x[2], x[6], x[10], x[14]); \
+    qround(x[3], x[7], x[11], x[15]); \
+    qround(x[0], x[5], x[10], x[15]); \
+    qround(x[1], x[6], x[11], x[12]); \
+    qround(x[2], x[7], x[8],  x[13]); \
+    qround(x[3], x[4], x[9],  x[14]); \
+  }
+
+#endif
+
+#if defined(KK_ARCH_X64_SIMD)
+
+#define kk_rotl_sse2(v,n)  _mm_or_si128(_mm_slli_epi32(v,n), _mm_srli_epi32(v,32-(n)))
+#define kk_qround_sse2(a,b,c,d) \
+  a = _mm_add_epi32(a,b); d = kk_rotl_sse2(_mm_xor_si128(d,a),16); \
+  c = _mm_add_epi32(c,d); b = kk_rotl_sse2(_mm_xor_si128(b,c),12); \
+  a = _mm_add_epi32(a,b); d = kk_rotl_sse2(_mm_xor_si128(d,a),8);  \
+  c = _mm_add_epi32(c,d); b = kk_rotl_sse2(_mm_xor_si128(b,c),7);
+
+// compute 4 blocks in parallel (SSE2 is always available on x64)
+static void kk_chacha_blocks4_sse2(const size_t rounds, uint32_t* input, uint32_t* output) {
+  uint32_t c12[4], c13[4], c14[4];
+  __m128i s[16];
+  __m128i x[16];
+  for (size_t i = 0; i < 16; i++) { s[i] = _mm_set1_epi32((int)input[i]); }
+  kk_chacha_lanes(input, 4, c12, c13, c14);
+  s[12] = _mm_loadu_si128((const __m128i*)c12);
+  s[13] = _mm_loadu_si128((const __m128i*)c13);
+  s[14] = _mm_loadu_si128((const __m128i*)c14);
+  for (size_t i = 0; i < 16; i++) { x[i] = s[i]; }
+  kk_chacha_shuffle_lanes(x, kk_qround_sse2)
+  uint32_t out[16*4];
+  for (size_t i = 0; i < 16; i++) {
+    _mm_storeu_si128((__m128i*)&out[4*i], _mm_add_epi32(x[i], s[i]));
+  }
+  kk_chacha_store_lanes(out, 4, output);
+}
+
+#define kk_rotl_avx2(v,n)  _mm256_or_si256(_mm256_slli_epi32(v,n), _mm256_srli_epi32(v,32-(n)))
+#define kk_qround_avx2(a,b,c,d) \
+  a = _mm256_add_epi32(a,b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d,a),rot16); \
+  c = _mm256_add_epi32(c,d); b = kk_rotl_avx2(_mm256_xor_si256(b,c),12); \
+  a = _mm256_add_epi32(a,b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d,a),rot8); \
+  c = _mm256_add_epi32(c,d); b = kk_rotl_avx2(_mm256_xor_si256(b,c),7);
+
+// compute 8 blocks in parallel
+kk_decl_target("avx2") static void kk_chacha_blocks8_avx2(const size_t rounds, uint32_t* input, uint32_t* output) {
+  // rotations by 16 and 8 bits are byte shuffles
+  const __m256i rot16 = _mm256_setr_epi8(2,3,0,1, 6,7,4,5, 10,11,8,9, 14,15,12,13, 2,3,0,1, 6,7,4,5, 10,11,8,9, 14,15,12,13);
+  const __m256i rot8  = _mm256_setr_epi8(3,0,1,2, 7,4,5,6, 11,8,9,10, 15,12,13,14, 3,0,1,2, 7,4,5,6, 11,8,9,10, 15,12,13,14);
+  uint32_t c12[8], c13[8], c14[8];
+  __m256i s[16];
+  __m256i x[16];
+  for (size_t i = 0; i < 16; i++) { s[i] = _mm256_set1_epi32((int)input[i]); }
+  kk_chacha_lanes(input, 8, c12, c13, c14);
+  s[12] = _mm256_loadu_si256((const __m256i*)c12);
+  s[13] = _mm256_loadu_si256((const __m256i*)c13);
+  s[14] = _mm256_loadu_si256((const __m256i*)c14);
+  for (size_t i = 0; i < 16; i++) { x[i] = s[i]; }
+  kk_chacha_shuffle_lanes(x, kk_qround_avx2)
+  uint32_t out[16*8];
+  for (size_t i = 0; i < 16; i++) {
+    _mm256_storeu_si256((__m256i*)&out[8*i], _mm256_add_epi32(x[i], s[i]));
+  }
+  kk_chacha_store_lanes(out, 8, output);
+}
+
+static void kk_chacha_blocks(const size_t rounds, uint32_t* input, uint32_t* output) {
+  if (kk_has_avx2) {
+    kk_chacha_blocks8_avx2(rounds, input, output);
+  }
+  else {
+    kk_chacha_blocks4_sse2(rounds, input, output);
+    kk_chacha_blocks4_sse2(rounds, input, output + 4*16);
+  }
+}
+
+#elif defined(KK_ARCH_ARM64_SIMD)
+
+#define kk_rotl_neon(v,n)  vsriq_n_u32(vshlq_n_u32(v,n), v, 32-(n))
+#define kk_qround_neon(a,b,c,d) \
+  a = vaddq_u32(a,b); d = vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(veorq_u32(d,a)))); \
+  c = vaddq_u32(c,d); b = kk_rotl_neon(veorq_u32(b,c),12); \
+  a = vaddq_u32(a,b); d = kk_rotl_neon(veorq_u32(d,a),8);  \
+  c = vaddq_u32(c,d); b = kk_rotl_neon(veorq_u32(b,c),7);
+
+// compute 4 blocks in parallel
+static void kk_chacha_blocks4_neon(const size_t rounds, uint32_t* input, uint32_t* output) {
+  uint32_t c12[4], c13[4], c14[4];
+  uint32x4_t s[16];
+  uint32x4_t x[16];
+  for (size_t i = 0; i < 16; i++) { s[i] = vdupq_n_u32(input[i]); }
+  kk_chacha_lanes(input, 4, c12, c13, c14);
+  s[12] = vld1q_u32(c12);
+  s[13] = vld1q_u32(c13);
+  s[14] = vld1q_u32(c14);
+  for (size_t i = 0; i < 16; i++) { x[i] = s[i]; }
+  kk_chacha_shuffle_lanes(x, kk_qround_neon)
+  uint32_t out[16*4];
+  for (size_t i = 0; i < 16; i++) {
+    vst1q_u32(&out[4*i], vaddq_u32(x[i], s[i]));
+  }
+  kk_chacha_store_lanes(out, 4, output);
+}
+
+static void kk_chacha_blocks(const size_t rounds, uint32_t* input, uint32_t* output) {
+  kk_chacha_blocks4_neon(rounds, input, output);
+  kk_chacha_blocks4_neon(rounds, input, output + 4*16);
+}
+
+#else
+
+static void kk_chacha_blocks(const size_t rounds, uint32_t* input, uint32_t* output) {
+  for (size_t b = 0; b < KK_SRANDOM_BLOCKS; b++) {
+    kk_chacha_block(rounds, input, output + 16*b);
+  }
+}
+
+#endif
+
 static kk_decl_noinline void kk_chacha20(kk_random_ctx_t* rnd) {
-  kk_chacha_block(20, rnd->input, rnd->output);
+  kk_chacha_blocks(20, rnd->input, rnd->output);
   rnd->used = 0;
 }
 /*
@@ -182,7 +385,7 @@ static void kk_chacha_init(kk_random_ctx_t* rnd, const uint8_t key[32], uint64_t
   rnd->input[13] = 0;
   rnd->input[14] = (uint32_t)nonce;
   rnd->input[15] = (uint32_t)(nonce >> 32);
-  rnd->used = 128;
+  rnd->used = KK_SRANDOM_WORDS;
 }
 
 /*
@@ -254,11 +457,63 @@ int32_t kk_srandom_range_int32(int32_t min, int32_t max, kk_context_t* ctx) {
 --------------------------------------------------------------------------------------*/
 
 // Use 52 random bits to generate a double in the range [0,1)
-double kk_srandom_double(kk_context_t* ctx) {
-  const uint64_t x = KK_U64(0x3FF0000000000000) | kk_shr64(kk_srandom_uint64(ctx), 12);
+static inline double kk_double_from_random_bits(uint64_t r) {
+  const uint64_t x = KK_U64(0x3FF0000000000000) | kk_shr64(r, 12);
   return (kk_bits_to_double(x) - 1.0);
 }
 
+double kk_srandom_double(kk_context_t* ctx) {
+  return kk_double_from_random_bits(kk_srandom_uint64(ctx));
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Secure random: fill a buffer
+--------------------------------------------------------------------------------------*/
+
+void kk_srandom_buf(void* buf, kk_ssize_t len, kk_context_t* ctx) {
+  uint8_t* p = (uint8_t*)buf;
+  while (len > 0) {
+    kk_random_ctx_t* rnd = ctx->srandom_ctx;
+    if (rnd == NULL || rnd->used >= KK_SRANDOM_WORDS) {
+      rnd = kk_srandom_round(ctx);
+    }
+    const kk_ssize_t avail = 4*(KK_SRANDOM_WORDS - rnd->used);
+    const kk_ssize_t n = (len < avail ? len : avail);
+    const kk_ssize_t words = (n + 3)/4;
+    uint32_t* src = &rnd->output[rnd->used];
+    memcpy(p, src, (size_t)n);
+    memset(src, 0, (size_t)(4*words));  // clear after use
+    rnd->used += (int32_t)words;
+    p += n;
+    len -= n;
+  }
+}
+
+kk_bytes_t kk_srandom_bytes(kk_ssize_t len, kk_context_t* ctx) {
+  if (len <= 0) return kk_bytes_empty();
+  uint8_t* buf;
+  kk_bytes_t b = kk_bytes_alloc_buf(len, &buf, ctx);
+  kk_srandom_buf(buf, len, ctx);
+  return b;
+}
+
+kk_vector_t kk_srandom_vector_double(kk_ssize_t len, kk_context_t* ctx) {
+  if (len <= 0) return kk_vector_empty();
+  kk_box_t* v;
+  kk_vector_t vec = kk_vector_alloc_uninit(len, &v, ctx);
+  uint64_t rs[KK_SRANDOM_WORDS/2];
+  for (kk_ssize_t i = 0; i < len; ) {
+    const kk_ssize_t n = (len - i < KK_SRANDOM_WORDS/2 ? len - i : KK_SRANDOM_WORDS/2);
+    kk_srandom_buf(rs, n*8, ctx);
+    for (kk_ssize_t j = 0; j < n; j++, i++) {
+      v[i] = kk_double_box(kk_double_from_random_bits(rs[j]), ctx);
+    }
+  }
+  memset(rs, 0, sizeof(rs));
+  return vec;
+}
+
 
 
 /* ----------------------------------------------------------------------------
@@ -47,3 +47,64 @@ kk_decl_export kk_box_t kk_ref_swap_thread_shared_borrow(kk_ref_t r, kk_box_t va
 }
 
 
+// Atomically set the value to `desired` if it is (physically) equal to `expected` (consuming both).
+// For a thread-shared reference we retry while a concurrent `ref_get` holds the guard value 0.
+kk_decl_export bool kk_ref_compare_exchange_borrow(kk_ref_t r, kk_box_t expected, kk_box_t desired, kk_context_t* ctx) {
+  bool ok;
+  if (kk_likely(!kk_block_is_thread_shared(&r->_block))) {
+    ok = (kk_atomic_load_relaxed(&r->value) == expected.box);
+    if (ok) { kk_atomic_store_relaxed(&r->value, desired.box); }
+  }
+  else {
+    kk_box_mark_shared(desired, ctx);
+    uintptr_t cur;
+    do {
+      cur = expected.box;
+      ok = kk_atomic_cas_strong_acq_rel(&r->value, &cur, desired.box);
+    } while (!ok && cur == 0);
+  }
+  if (ok) {
+    kk_box_drop(expected, ctx);  // the reference held by `r`
+  }
+  else {
+    kk_box_drop(desired, ctx);
+  }
+  kk_box_drop(expected, ctx);
+  return ok;
+}
+
+// Atomically apply `f` to the value and return the previous value.
+// For a thread-shared reference `f` is applied in a CAS loop and may be called more than once.
+kk_decl_export kk_box_t kk_ref_fetch_update_borrow(kk_ref_t r, kk_function_t f, kk_context_t* ctx) {
+  kk_box_t old;
+  if (kk_likely(!kk_block_is_thread_shared(&r->_block))) {
+    old.box = kk_atomic_load_relaxed(&r->value);
+    kk_box_dup(old);
+    kk_function_dup(f);
+    kk_box_t x = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_context_t*),f,(f,old,ctx));
+    kk_atomic_store_relaxed(&r->value, x.box); // and we return the reference that was held by `r`
+  }
+  else {
+    while (true) {
+      old = kk_ref_get_thread_shared(kk_ref_dup(r), ctx);
+      kk_box_dup(old);  // keep `old` alive until the CAS so its address cannot be reused
+      kk_function_dup(f);
+      kk_box_t x = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_context_t*),f,(f,old,ctx));
+      kk_box_mark_shared(x, ctx);
+      uintptr_t cur;
+      bool ok;
+      do {
+        cur = old.box;
+        ok = kk_atomic_cas_strong_acq_rel(&r->value, &cur, x.box);
+      } while (!ok && cur == 0);
+      if (ok) {
+        kk_box_drop(old, ctx);  // the reference held by `r`
+        break;
+      }
+      kk_box_drop(x, ctx);
+      kk_box_drop(old, ctx);
+    }
+  }
+  kk_function_drop(f, ctx);
+  return old;
+}
@@ -7,9 +7,13 @@
 ---------------------------------------------------------------------------*/
 #include "kklib.h"
 
-// static void kk_block_drop_free_delayed(kk_context_t* ctx);
+static kk_decl_noinline void kk_block_drop_free_delayed(kk_block_t* b, kk_context_t* ctx);
+static bool kk_block_free_delayed_enabled(kk_context_t* ctx);
 // static kk_decl_noinline void kk_block_drop_free_rec(kk_block_t* b, kk_ssize_t scan_fsize, const kk_ssize_t depth, kk_context_t* ctx);
 static kk_decl_noinline void kk_block_drop_free_recx(kk_block_t* b, kk_context_t* ctx);
+static kk_decl_noinline void kk_block_drop_free_prefetch(kk_block_t* b, kk_context_t* ctx);
+static bool kk_block_drop_prefetch_enabled(void);
+static kk_decl_noinline void kk_block_drop_free_shared(kk_block_t* b, kk_context_t* ctx);
 
 static void kk_block_free_raw(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_tag_is_raw(kk_block_tag(b)));
@@ -28,6 +32,13 @@ static void kk_block_drop_free(kk_block_t* b, kk_context_t* ctx) {
     if (kk_unlikely(kk_tag_is_raw(kk_block_tag(b)))) { kk_block_free_raw(b,ctx); }
     kk_block_free(b,ctx); // deallocate directly if nothing to scan
   }
+  else if (kk_unlikely(kk_block_free_delayed_enabled(ctx))) {
+    kk_block_drop_free_delayed(b, ctx);  // free incrementally
+  }
+  else if (kk_unlikely(kk_block_drop_prefetch_enabled()) && 
+           !(scan_fsize == 1 || (scan_fsize == 2 && !kk_box_is_non_null_ptr(kk_block_field(b,0))))) {
+    kk_block_drop_free_prefetch(b, ctx); // free recursively while prefetching children (not for lists as those cannot be prefetched ahead)
+  }
   else {
     kk_block_drop_free_recx(b, ctx); // free recursively
     // TODO: for performance unroll one iteration for scan_fsize == 1 
@@ -89,22 +100,26 @@ static void kk_block_drop_free(kk_block_t* b, kk_context_t* ctx) {
   - see also: https://devblogs.microsoft.com/oldnewthing/20210409-00/?p=105065
 --------------------------------------------------------------------------------------*/
 
-#define RC_STUCK          KK_U32(0x80000000)
+#define RC_STUCK          KK_REFCOUNT_IMMORTAL
 #define RC_STICKY         KK_U32(0x90000000)
 #define RC_STICKY_DROP    KK_U32(0xA0000000)
 #define RC_SHARED_UNIQUE  KK_U32(0xFFFFFFFF)
 
 static inline kk_refcount_t kk_atomic_dup(kk_block_t* b) {
+  kk_stats_inc(kk_get_context(), atomic_dup);
   return kk_atomic_dec_relaxed(&b->header.refcount);
 }
 static inline kk_refcount_t kk_atomic_drop(kk_block_t* b) {
+  kk_stats_inc(kk_get_context(), atomic_drop);
   return kk_atomic_inc_release(&b->header.refcount);
 }
 static inline kk_refcount_t kk_atomic_acquire(kk_block_t* b) {
   return kk_atomic_load_acquire(&b->header.refcount);
 }
 
-static void kk_block_make_shared(kk_block_t* b) {
+static void kk_block_make_shared(kk_block_t* b, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_stats_inc(ctx, mark_shared_blocks);
   kk_refcount_t rc = kk_block_refcount(b);
   kk_assert_internal(rc <= RC_STUCK);        // not thread shared already
   rc = RC_SHARED_UNIQUE - rc;                // signed: -1 - rc
@@ -112,11 +127,143 @@ static void kk_block_make_shared(kk_block_t* b) {
   kk_block_refcount_set(b, rc);
 }
 
+
+/*--------------------------------------------------------------------------------------
+  Deferred drops of thread-shared blocks
+
+  Read-mostly structures shared by many threads cause cache-line contention
+  as every dup and drop is an atomic operation on the reference count. When enabled,
+  each thread buffers its drops of thread-shared blocks in a small set-associative table
+  and a later dup of the same block by that thread cancels the buffered drop without
+  touching the reference count. This is safe since the buffered references are still
+  counted (a block is only freed later than it could be, never earlier).
+  Entries are flushed when evicted by another block, when a worker becomes idle, and
+  when the context is freed; so at most `KK_DROP_DEFERRED_SIZE` blocks are retained per thread.
+--------------------------------------------------------------------------------------*/
+
+#define KK_DROP_DEFERRED_BITS  (12)
+#define KK_DROP_DEFERRED_SIZE  (1 << KK_DROP_DEFERRED_BITS)
+#define KK_DROP_DEFERRED_WAYS  (4)
+
+typedef struct kk_drop_deferred_entry_s {
+  kk_block_t*   block;
+  kk_refcount_t count;    // number of buffered drops
+} kk_drop_deferred_entry_t;
+
+struct kk_drop_deferred_s {
+  kk_drop_deferred_entry_t entries[KK_DROP_DEFERRED_SIZE];
+};
+
+static _Atomic(uintptr_t) drop_deferred_enabled;  // = false
+
+kk_decl_export void kk_block_drop_set_deferred(bool enable, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_atomic_store_release(&drop_deferred_enabled, (enable ? 1 : 0));
+}
+
+// The table is 4-way set associative; returns the first entry of the set for `b`.
+static inline kk_drop_deferred_entry_t* kk_drop_deferred_set(kk_drop_deferred_t* d, kk_block_t* b) {
+  const uint64_t u = (uint64_t)((uintptr_t)b >> 3);
+  const uint32_t h = (uint32_t)(u ^ (u >> 32)) * KK_U32(0x9E3779B1);  // fibonacci hashing
+  return &d->entries[(h >> (32 - KK_DROP_DEFERRED_BITS)) & ~(KK_DROP_DEFERRED_WAYS - 1)];
+}
+
+static inline kk_drop_deferred_entry_t* kk_drop_deferred_find(kk_drop_deferred_entry_t* set, kk_block_t* b) {
+  for (kk_ssize_t i = 0; i < KK_DROP_DEFERRED_WAYS; i++) {
+    if (set[i].block == b) return &set[i];
+  }
+  return NULL;
+}
+
+// Apply `n` buffered drops to a thread-shared block
+static void kk_block_drop_deferred_apply(kk_block_t* b, kk_refcount_t n, kk_context_t* ctx) {
+  if (kk_atomic_load_relaxed(&b->header.refcount) <= RC_STICKY_DROP) return;  // sticky
+  kk_stats_inc(ctx, atomic_drop);
+  const kk_refcount_t rc = kk_atomic_add_release(&b->header.refcount, n);
+  if (rc + (n - 1) == RC_SHARED_UNIQUE) {   // these were the last references?
+    kk_atomic_acquire(b);
+    kk_block_refcount_set(b,0);
+    kk_block_drop_free_shared(b, ctx);
+  }
+}
+
+// Buffer a drop of a thread-shared block; returns `false` if no buffer could be allocated.
+static kk_decl_noinline bool kk_block_drop_defer(kk_block_t* b, kk_context_t* ctx) {
+  kk_drop_deferred_t* d = ctx->drop_deferred;
+  if (d == NULL) {
+    d = (kk_drop_deferred_t*)kk_zalloc(kk_ssizeof(kk_drop_deferred_t), ctx);
+    if (d == NULL) return false;
+    ctx->drop_deferred = d;
+  }
+  kk_drop_deferred_entry_t* set = kk_drop_deferred_set(d, b);
+  kk_drop_deferred_entry_t* e = kk_drop_deferred_find(set, b);
+  if (kk_likely(e != NULL && e->count < RC_STUCK)) {
+    e->count++;
+    return true;
+  }
+  if (e == NULL) { e = kk_drop_deferred_find(set, NULL); }
+  if (e == NULL) {
+    // evict the last entry and insert in front
+    kk_drop_deferred_entry_t evict = set[KK_DROP_DEFERRED_WAYS - 1];
+    kk_memmove(&set[1], &set[0], (KK_DROP_DEFERRED_WAYS - 1) * kk_ssizeof(kk_drop_deferred_entry_t));
+    set[0].block = b;
+    set[0].count = 1;
+    kk_block_drop_deferred_apply(evict.block, evict.count, ctx);
+  }
+  else {
+    kk_block_t* old = e->block;
+    const kk_refcount_t n = e->count;
+    e->block = b;
+    e->count = 1;
+    if (old != NULL) { kk_block_drop_deferred_apply(old, n, ctx); }  // count overflow
+  }
+  return true;
+}
+
+// Cancel a buffered drop of a thread-shared block; returns `true` on success.
+static kk_decl_noinline bool kk_block_dup_deferred(kk_block_t* b) {
+  kk_drop_deferred_t* d = kk_get_context()->drop_deferred;
+  if (d == NULL) return false;
+  kk_drop_deferred_entry_t* e = kk_drop_deferred_find(kk_drop_deferred_set(d, b), b);
+  if (e == NULL) return false;
+  kk_assert_internal(e->count > 0);
+  if (--e->count == 0) { e->block = NULL; }
+  return true;
+}
+
+// Apply all buffered drops of the current thread; returns `true` if any drops were applied.
+kk_decl_export bool kk_block_drop_deferred_flush(kk_context_t* ctx) {
+  kk_drop_deferred_t* d = ctx->drop_deferred;
+  if (d == NULL) return false;
+  bool any = false;
+  bool flushed;
+  do {
+    // freeing blocks may buffer new drops so repeat until empty
+    flushed = false;
+    for (kk_ssize_t i = 0; i < KK_DROP_DEFERRED_SIZE; i++) {
+      kk_drop_deferred_entry_t* e = &d->entries[i];
+      kk_block_t* b = e->block;
+      if (b != NULL) {
+        const kk_refcount_t n = e->count;
+        e->block = NULL;
+        e->count = 0;
+        kk_block_drop_deferred_apply(b, n, ctx);
+        flushed = any = true;
+      }
+    }
+  } while (flushed);
+  return any;
+}
+
+
 // Check if a reference dup needs an atomic operation
 kk_decl_noinline kk_block_t* kk_block_check_dup(kk_block_t* b, kk_refcount_t rc0) {
   kk_assert_internal(b!=NULL);
   kk_assert_internal(kk_refcount_is_thread_shared(rc0)); // includes KK_STUCK
   if (kk_likely(rc0 > RC_STICKY)) {
+    if (kk_unlikely(kk_atomic_load_relaxed(&drop_deferred_enabled)) && kk_block_dup_deferred(b)) {
+      return b;  // cancelled a buffered drop
+    }
     kk_atomic_dup(b);
   }
   // else sticky: no longer increment (or decrement)
@@ -136,12 +283,15 @@ kk_decl_noinline void kk_block_check_drop(kk_block_t* b, kk_refcount_t rc0, kk_c
   else if (kk_unlikely(rc0 <= RC_STICKY_DROP)) {
     // sticky: do not drop further
   }
+  else if (kk_unlikely(kk_atomic_load_relaxed(&drop_deferred_enabled)) && kk_block_drop_defer(b, ctx)) {
+    // buffered
+  }
   else {
     const kk_refcount_t rc = kk_atomic_drop(b);
     if (rc == RC_SHARED_UNIQUE) {    // this was the last reference?
       kk_atomic_acquire(b);          // prevent reordering of reads/writes before this point
       kk_block_refcount_set(b,0);    // no longer shared
-      kk_block_drop_free(b, ctx);    // no more references, free it.
+      kk_block_drop_free_shared(b, ctx);  // no more references, free it (possibly in parallel).
     }
     kk_assert_internal(rc > RC_STICKY);
   }
@@ -154,6 +304,8 @@ kk_decl_noinline kk_reuse_t kk_block_check_drop_reuse(kk_block_t* b, kk_refcount
   kk_assert_internal(rc0 == 0 || kk_refcount_is_thread_shared(rc0));
   if (kk_likely(rc0==0)) {
     // no more references, reuse it.
+    kk_stats_inc(ctx, reuse_hit);
+    kk_stats_tag_inc(ctx, frees, kk_block_tag(b));
     kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
     for (kk_ssize_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
@@ -163,6 +315,7 @@ kk_decl_noinline kk_reuse_t kk_block_check_drop_reuse(kk_block_t* b, kk_refcount
   }
   else {
     // may be shared or sticky
+    kk_stats_inc(ctx, reuse_miss);
     kk_block_check_drop(b, rc0, ctx);
     return kk_reuse_null;
   }
@@ -175,6 +328,7 @@ kk_decl_noinline void kk_block_check_decref(kk_block_t* b, kk_refcount_t rc0, kk
   kk_assert_internal(kk_block_refcount(b) == rc0);
   kk_assert_internal(rc0 == 0 || kk_refcount_is_thread_shared(rc0));
   if (kk_likely(rc0==0)) {
+    kk_stats_tag_inc(ctx, frees, kk_block_tag(b));
     kk_free(b,ctx);  // no more references, free it (without dropping children!)
   }
   else if (kk_unlikely(rc0 <= RC_STICKY_DROP)) {
@@ -184,6 +338,7 @@ kk_decl_noinline void kk_block_check_decref(kk_block_t* b, kk_refcount_t rc0, kk
     const kk_refcount_t rc = kk_atomic_drop(b);
     if (rc == RC_SHARED_UNIQUE) {    // last referenc?
       kk_block_refcount_set(b,0);    // no longer shared
+      kk_stats_tag_inc(ctx, frees, kk_block_tag(b));
       kk_free(b,ctx);                // no more references, free it.
     }
   }
@@ -342,6 +497,8 @@ static kk_decl_noinline void kk_block_drop_free_recx(kk_block_t* b, kk_context_t
           goto movedown;
         }
       } while (i < scan_fsize);
+      // no children to free: free the block itself
+      kk_block_free(b,ctx);
       // goto moveup; // fallthrough
     }
     else {
@@ -384,6 +541,291 @@ static kk_decl_noinline void kk_block_drop_free_recx(kk_block_t* b, kk_context_t
 }
 
 
+//-----------------------------------------------------------------------------------------
+// Bounded freeing
+// 
+// Free a block and its children but stop after a given budget of freed blocks (or time). 
+// This is used to free large thread-shared structures in parallel, and to free structures
+// incrementally through the `delayed_free` list of the context (to bound the latency of 
+// a single drop). Blocks are visited using a small local stack of pending blocks; when 
+// the stack is full, or when the budget is exhausted, the pending blocks are linked into 
+// a list (where the link is encoded in the block header).
+// A pending block has a zero refcount and all its children are still valid.
+//-----------------------------------------------------------------------------------------
+
+#define KK_DROP_STACK_SIZE (64)
+
+// Encode the next pointer of a pending list in the block header (while keeping `scan_fsize` valid).
+// This uses the `_field_idx`, `tag`, and `refcount` fields which leaves 56 bits for the pointer.
+static void kk_block_pending_push(kk_block_t* b, kk_block_t** pending, kk_ssize_t* count) {
+  kk_assert_internal(b->header.scan_fsize > 0);
+  const uintptr_t next = (uintptr_t)(*pending);
+  #if (KK_INTPTR_SIZE > 4)
+  kk_assert((next >> 56) == 0);
+  b->header._field_idx = (uint8_t)(next >> 48);
+  b->header.tag = (uint16_t)(next >> 32);
+  #endif
+  kk_block_refcount_set(b, (kk_refcount_t)next);
+  *pending = b;
+  (*count)++;
+}
+
+static kk_block_t* kk_block_pending_pop(kk_block_t** pending, kk_ssize_t* count) {
+  kk_block_t* b = *pending;
+  kk_assert_internal(b != NULL);
+  uintptr_t next = (uintptr_t)kk_block_refcount(b);
+  #if (KK_INTPTR_SIZE > 4)
+  next |= ((uintptr_t)b->header.tag << 32) | ((uintptr_t)b->header._field_idx << 48);
+  #endif  
+  *pending = (kk_block_t*)next;
+  (*count)--;
+  // restore the header (the tag is no longer needed as raw blocks are never pending)
+  b->header._field_idx = 0;
+  b->header.tag = (uint16_t)KK_TAG_INVALID;
+  kk_block_refcount_set(b, 0);
+  return b;
+}
+
+// Free blocks from the `pending` list, and their children, until `budget` blocks are freed
+// or `usecs` micro-seconds have passed (if `usecs > 0`). Returns the number of freed blocks.
+// The `pending` list and `count` are always accessed through the pointers as they may be 
+// extended when a raw `free` function (re-entrantly) drops a structure.
+static kk_decl_noinline kk_ssize_t kk_block_drop_free_bounded(kk_block_t** pending, kk_ssize_t* count, kk_ssize_t budget, kk_usecs_t usecs, kk_context_t* ctx) {
+  kk_block_t* stack[KK_DROP_STACK_SIZE];
+  kk_ssize_t sp = 0;
+  kk_ssize_t freed = 0;
+  const kk_timer_t start = (usecs > 0 ? kk_timer_start() : 0);
+  while (freed < budget) {
+    kk_block_t* b;
+    if (sp > 0) { 
+      b = stack[--sp]; 
+    }
+    else if (*pending != NULL) {
+      b = kk_block_pending_pop(pending, count);
+    }
+    else {
+      break;  // done
+    }
+    kk_assert_internal(kk_block_refcount(b) == 0);
+    const kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
+    for (kk_ssize_t i = (b->header.scan_fsize == KK_SCAN_FSIZE_MAX ? 1 : 0); i < scan_fsize; i++) {
+      kk_block_t* child = kk_block_field_should_free(b, i, ctx);
+      if (child != NULL) {
+        if (sp < KK_DROP_STACK_SIZE) { stack[sp++] = child; }
+                                else { kk_block_pending_push(child, pending, count); }
+      }
+    }
+    kk_block_free(b, ctx);
+    freed++;
+    if (usecs > 0 && (freed % 256) == 0 && kk_timer_end(start) >= usecs) break;
+  }
+  // link remaining blocks of the stack into the pending list
+  while (sp > 0) {
+    kk_block_pending_push(stack[--sp], pending, count);
+  }
+  return freed;
+}
+
+
+//-----------------------------------------------------------------------------------------
+// Prefetching free
+//
+// The stackless `kk_block_drop_free_recx` stalls on a cache miss at every child when freeing 
+// a large cold structure. Here we keep a small ring of children that are prefetched but whose 
+// reference count is not yet examined; a child is only examined once the ring is full (or 
+// when there is nothing else to do), by which time its header has usually arrived. Children
+// that should be freed are pushed onto a local stack (and the pending list when it is full)
+// to visit their fields in turn. This is used for blocks with more than one pointer field 
+// (like tree nodes) as there is nothing to prefetch ahead in a single chain (like a list).
+// It is about 3x faster on large cold trees but 1.4x slower on trees that are in the cache
+// (or allocated in order) so it is opt-in with `kk_block_drop_set_prefetch`.
+//-----------------------------------------------------------------------------------------
+
+static _Atomic(uintptr_t) drop_prefetch_enabled;  // = false
+
+kk_decl_export void kk_block_drop_set_prefetch(bool enable, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_atomic_store_release(&drop_prefetch_enabled, (enable ? 1 : 0));
+}
+
+static bool kk_block_drop_prefetch_enabled(void) {
+  return (kk_atomic_load_relaxed(&drop_prefetch_enabled) != 0);
+}
+
+#define KK_DROP_PREFETCH_RING  (8)   // must be a power of 2
+
+// Examine a child from the ring: free it directly if it is a leaf, or return it if its fields should be visited.
+static inline kk_block_t* kk_block_should_free_prefetched(kk_block_t* child, kk_context_t* ctx) {
+  if (kk_block_decref_no_free(child)) {
+    if (child->header.scan_fsize != 0) return child;
+    if (kk_unlikely(kk_tag_is_raw(kk_block_tag(child)))) { kk_block_free_raw(child, ctx); }
+    kk_block_free(child, ctx);
+  }
+  return NULL;
+}
+
+static kk_decl_noinline void kk_block_drop_free_prefetch(kk_block_t* b, kk_context_t* ctx) {
+  kk_assert_internal(b->header.scan_fsize > 0 && kk_block_refcount(b) == 0);
+  kk_block_t* ring[KK_DROP_PREFETCH_RING];   // prefetched children (not yet examined)
+  size_t      ring_start = 0;                // index of the oldest child in the ring
+  size_t      ring_end = 0;                  // index after the newest child
+  kk_block_t* stack[KK_DROP_STACK_SIZE];     // blocks with a zero refcount whose fields still need a visit
+  kk_ssize_t  sp = 0;
+  kk_block_t* pending = NULL;                // overflow of the stack
+  kk_ssize_t  pending_count = 0;
+  while (true) {
+    // prefetch the children of `b` and free it
+    kk_assert_internal(kk_block_refcount(b) == 0);
+    if (kk_unlikely(b->header.scan_fsize == KK_SCAN_FSIZE_MAX)) {
+      kk_block_drop_free_large_rec(b, ctx);
+    }
+    else {
+      const kk_ssize_t scan_fsize = b->header.scan_fsize;
+      for (kk_ssize_t i = 0; i < scan_fsize; i++) {
+        kk_box_t v = kk_block_field(b, i);
+        if (kk_box_is_non_null_ptr(v)) {
+          if (ring_end - ring_start == KK_DROP_PREFETCH_RING) {
+            // the ring is full: examine the oldest child
+            kk_block_t* child = kk_block_should_free_prefetched(ring[ring_start++ % KK_DROP_PREFETCH_RING], ctx);
+            if (child != NULL) {
+              if (sp < KK_DROP_STACK_SIZE) { stack[sp++] = child; }
+                                      else { kk_block_pending_push(child, &pending, &pending_count); }
+            }
+          }
+          kk_block_t* child = kk_ptr_unbox(v);
+          kk_prefetchw(child);
+          ring[ring_end++ % KK_DROP_PREFETCH_RING] = child;
+        }
+      }
+      kk_block_free(b, ctx);
+    }
+    // and find the next block to visit
+    if (sp > 0) {
+      b = stack[--sp];
+    }
+    else if (pending != NULL) {
+      b = kk_block_pending_pop(&pending, &pending_count);
+    }
+    else {
+      // examine the remaining children in the ring
+      b = NULL;
+      while (b == NULL && ring_start != ring_end) {
+        b = kk_block_should_free_prefetched(ring[ring_start++ % KK_DROP_PREFETCH_RING], ctx);
+      }
+      if (b == NULL) break;  // done
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------------------
+// Incremental freeing through the `delayed_free` list
+//
+// Opt-in per thread with `kk_block_free_delayed_set`: a drop of a structure frees at
+// most `delayed_free_budget` blocks (or runs at most `delayed_free_usecs`), and the rest 
+// is freed incrementally on later allocations (or explicitly at a safe point by 
+// calling `kk_block_free_delayed`).
+//-----------------------------------------------------------------------------------------
+
+kk_decl_export void kk_block_free_delayed_set(kk_ssize_t max_blocks, kk_usecs_t max_usecs, kk_context_t* ctx) {
+  ctx->delayed_free_budget = (max_blocks < 0 ? 0 : max_blocks);
+  ctx->delayed_free_usecs  = (max_usecs < 0 ? 0 : max_usecs);
+}
+
+static bool kk_block_free_delayed_enabled(kk_context_t* ctx) {
+  return (ctx->delayed_free_budget > 0 || ctx->delayed_free_usecs > 0);
+}
+
+// Do one step of incremental freeing.
+kk_decl_export kk_decl_noinline void kk_block_free_delayed(kk_context_t* ctx) {
+  if (ctx->delayed_free == NULL) return;
+  const kk_ssize_t budget = (ctx->delayed_free_budget > 0 ? ctx->delayed_free_budget : KK_SSIZE_MAX);
+  if (ctx->delayed_free_count > ctx->delayed_free_peak) {
+    ctx->delayed_free_peak = ctx->delayed_free_count;
+  }
+  ctx->delayed_free_steps++;
+  ctx->delayed_free_freed += kk_block_drop_free_bounded(&ctx->delayed_free, &ctx->delayed_free_count, budget, ctx->delayed_free_usecs, ctx);
+}
+
+// Free all delayed blocks.
+kk_decl_export void kk_block_free_delayed_all(kk_context_t* ctx) {
+  while (ctx->delayed_free != NULL) {
+    ctx->delayed_free_freed += kk_block_drop_free_bounded(&ctx->delayed_free, &ctx->delayed_free_count, KK_SSIZE_MAX, 0, ctx);
+  }
+}
+
+static kk_decl_noinline void kk_block_drop_free_delayed(kk_block_t* b, kk_context_t* ctx) {
+  kk_block_pending_push(b, &ctx->delayed_free, &ctx->delayed_free_count);
+  kk_block_free_delayed(ctx);
+}
+
+
+//-----------------------------------------------------------------------------------------
+// Parallel freeing of thread-shared structures
+// 
+// When the last reference to a thread-shared structure is dropped, the dropping thread 
+// frees at most `drop_parallel_budget` blocks itself and hands off the rest of the structure
+// to the task group where workers free it in parallel. Disabled when the budget is <= 0.
+//-----------------------------------------------------------------------------------------
+
+static _Atomic(kk_ssize_t) drop_parallel_budget;  // = 0
+  
+#define KK_DROP_TASK_BUDGET  (16*1024)   // blocks freed per task before splitting off the rest
+
+kk_decl_export void kk_block_drop_set_parallel(kk_ssize_t latency_budget, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_atomic_store_release(&drop_parallel_budget, (latency_budget < 0 ? 0 : latency_budget));
+}
+
+typedef struct kk_drop_task_fun_s {
+  struct kk_function_s _base;
+  kk_block_t*          pending;  // not a scanned field
+} *kk_drop_task_fun_t;
+
+static void kk_block_drop_free_schedule(kk_block_t* pending, kk_context_t* ctx);
+
+static kk_box_t kk_drop_task_fun(kk_function_t fself, kk_context_t* ctx) {
+  kk_block_t* pending = kk_function_as(kk_drop_task_fun_t, fself)->pending;
+  kk_ssize_t count = 0;  // not used
+  kk_function_drop(fself, ctx);
+  while (pending != NULL) {
+    kk_block_drop_free_bounded(&pending, &count, KK_DROP_TASK_BUDGET, 0, ctx);
+    if (pending != NULL) {
+      // keep the first subtree and let other workers free the rest
+      kk_block_t* first = kk_block_pending_pop(&pending, &count);
+      if (pending != NULL) { kk_block_drop_free_schedule(pending, ctx); }
+      pending = NULL;
+      kk_block_pending_push(first, &pending, &count);
+    }
+  }
+  return kk_box_null;
+}
+
+static void kk_block_drop_free_schedule(kk_block_t* pending, kk_context_t* ctx) {
+  kk_drop_task_fun_t f = kk_function_alloc_as(struct kk_drop_task_fun_s, 1, ctx);
+  f->_base.fun = kk_cfun_ptr_box(&kk_drop_task_fun, ctx);
+  f->pending = pending;
+  kk_task_schedule_detached(&f->_base, ctx);
+}
+
+// Free a thread-shared block whose reference count dropped to zero.
+static kk_decl_noinline void kk_block_drop_free_shared(kk_block_t* b, kk_context_t* ctx) {
+  const kk_ssize_t budget = kk_atomic_load_relaxed(&drop_parallel_budget);
+  if (kk_likely(budget <= 0 || b->header.scan_fsize == 0)) {
+    kk_block_drop_free(b, ctx);
+  }
+  else {
+    kk_block_t* pending = NULL;
+    kk_ssize_t count = 0;
+    kk_block_pending_push(b, &pending, &count);
+    kk_block_drop_free_bounded(&pending, &count, budget, 0, ctx);
+    if (pending != NULL) {
+      kk_block_drop_free_schedule(pending, ctx);
+    }
+  }
+}
+
+
 //-----------------------------------------------------------------------------------------
 // Mark a block and all children recursively as thread shared
 // For marking the recursive algorithm is about twice as fast as the stackless one
@@ -407,7 +849,7 @@ static inline kk_block_t* kk_block_field_should_mark(kk_block_t* b, kk_ssize_t f
     if (!kk_block_is_thread_shared(child)) {
       if (child->header.scan_fsize == 0) {
         // mark leaf objects directly as shared
-        kk_block_make_shared(child);
+        kk_block_make_shared(child, ctx);
       }
       else {
         return child;
@@ -429,7 +871,7 @@ static kk_decl_noinline void kk_block_mark_shared_rec(kk_block_t* b, const kk_ss
     kk_assert_internal(scan_fsize > 0);
     if (scan_fsize == 1) {
       // if just one field, we can recursively scan without using stack space
-      kk_block_make_shared(b);
+      kk_block_make_shared(b, ctx);
       kk_block_t* child = kk_block_field_should_mark(b, 0, ctx);
       if (child != NULL) {
         // try to mark the child now
@@ -440,7 +882,7 @@ static kk_decl_noinline void kk_block_mark_shared_rec(kk_block_t* b, const kk_ss
     }
     else if (scan_fsize == 2 && !kk_box_is_non_null_ptr(kk_block_field(b, 0))) {
       // optimized code for lists/nodes with boxed first element
-      kk_block_make_shared(b);
+      kk_block_make_shared(b, ctx);
       kk_block_t* child = kk_block_field_should_mark(b, 1, ctx);
       if (child != NULL) {
         b = child;
@@ -451,7 +893,7 @@ static kk_decl_noinline void kk_block_mark_shared_rec(kk_block_t* b, const kk_ss
     else {
       // more than 1 field
       if (depth < MAX_RECURSE_DEPTH) {
-        kk_block_make_shared(b);
+        kk_block_make_shared(b, ctx);
         kk_ssize_t i = 0;
         if (kk_unlikely(scan_fsize >= KK_SCAN_FSIZE_MAX)) { 
           scan_fsize = (kk_ssize_t)kk_intf_unbox(kk_block_field(b, 0)); 
@@ -489,11 +931,12 @@ static kk_decl_noinline void kk_block_mark_shared_recx_large(kk_block_t* b, kk_c
   kk_assert_internal(b->header.scan_fsize == KK_SCAN_FSIZE_MAX);
   kk_ssize_t scan_fsize = kk_block_scan_fsize(b);
   for (kk_ssize_t i = 1; i < scan_fsize; i++) {  // start at 1 to skip the large scan field itself
-    if (kk_block_field_should_mark(b, i, ctx)) {
-      kk_block_mark_shared_recx(b, ctx);
+    kk_block_t* child = kk_block_field_should_mark(b, i, ctx);
+    if (child != NULL) {
+      kk_block_mark_shared_recx(child, ctx);
     }
   }
-  kk_block_make_shared(b);
+  kk_block_make_shared(b, ctx);
 }
 
 // Stackless marking by using pointer reversal
@@ -528,7 +971,7 @@ markfields:
         goto markfields;
       }
     } while (i < scan_fsize);
-    kk_block_make_shared(b);
+    kk_block_make_shared(b, ctx);
   }
 
   //--- moving back up ------------------
@@ -544,7 +987,7 @@ markfields:
     if (i >= scan_fsize) {
       kk_assert_internal(i == scan_fsize);
       // done, keep moving up
-      kk_block_make_shared(b);
+      kk_block_make_shared(b, ctx);
     }
     else {
       // mark the rest of the fields starting at `i` upto `scan_fsize`
@@ -555,17 +998,223 @@ markfields:
 }
 
 
+//-----------------------------------------------------------------------------------------
+// Parallel marking of large structures
+//
+// When enabled, marking uses an explicit stack of blocks that are already marked but whose
+// fields still need to be scanned. After visiting `mark_parallel_threshold` blocks, the bottom
+// half of the stack is split off to a task (and so on for each `KK_MARK_TASK_BUDGET` blocks).
+// Once other tasks are running, blocks are claimed with an atomic compare-and-swap on the
+// reference count so each block is marked (and scanned) exactly once. The marking thread waits
+// for all its tasks (running other tasks meanwhile) so the structure is fully marked on return.
+//-----------------------------------------------------------------------------------------
+
+static _Atomic(kk_ssize_t) mark_parallel_threshold;  // = 0
+
+#define KK_MARK_TASK_BUDGET   (16*1024)  // blocks visited per task before splitting off part of the stack
+#define KK_MARK_SPLIT_MIN     (16)       // only split if the stack has at least this many entries
+#define KK_MARK_TASKS_MAX     (16)       // maximal spawned tasks per traversal
+#define KK_MARK_STACK_SIZE    (64)
+
+kk_decl_export void kk_block_mark_set_parallel(kk_ssize_t threshold, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_atomic_store_release(&mark_parallel_threshold, (threshold < 0 ? 0 : threshold));
+}
+
+// Mark a block as shared; returns `false` if it was already marked (by another task).
+static bool kk_block_mark_claim(kk_block_t* b, bool atomic, kk_context_t* ctx) {
+  if (!atomic) {
+    if (kk_block_is_thread_shared(b)) return false;
+    kk_block_make_shared(b, ctx);
+    return true;
+  }
+  kk_refcount_t rc = kk_atomic_load_relaxed(&b->header.refcount);
+  kk_refcount_t rcs;
+  do {
+    if (kk_refcount_is_thread_shared(rc)) return false;
+    rcs = RC_SHARED_UNIQUE - rc;                 // see `kk_block_make_shared`
+    if (rcs <= RC_STICKY_DROP) rcs = RC_STICKY;
+  } while (!kk_atomic_cas_weak_relaxed(&b->header.refcount, &rc, rcs));
+  kk_stats_inc(ctx, mark_shared_blocks);
+  return true;
+}
+
+typedef struct kk_mark_stack_s {
+  kk_block_t** blocks;
+  kk_ssize_t   count;
+  kk_ssize_t   size;
+  kk_block_t*  local[KK_MARK_STACK_SIZE];
+} kk_mark_stack_t;
+
+static void kk_mark_stack_init(kk_mark_stack_t* st) {
+  st->blocks = st->local;
+  st->count = 0;
+  st->size = KK_MARK_STACK_SIZE;
+}
+
+static void kk_mark_stack_done(kk_mark_stack_t* st, kk_context_t* ctx) {
+  if (st->blocks != st->local) { kk_free(st->blocks, ctx); }
+}
+
+static bool kk_mark_stack_push(kk_mark_stack_t* st, kk_block_t* b, kk_context_t* ctx) {
+  if (kk_unlikely(st->count >= st->size)) {
+    const kk_ssize_t newsize = 2*st->size;
+    kk_block_t** blocks = (kk_block_t**)kk_malloc(newsize * kk_ssizeof(kk_block_t*), ctx);
+    if (blocks == NULL) return false;
+    kk_memcpy(blocks, st->blocks, st->count * kk_ssizeof(kk_block_t*));
+    kk_mark_stack_done(st, ctx);
+    st->blocks = blocks;
+    st->size = newsize;
+  }
+  st->blocks[st->count++] = b;
+  return true;
+}
+
+typedef struct kk_mark_task_fun_s {
+  struct kk_function_s _base;
+  kk_block_t**         blocks;  // not a scanned field
+  kk_ssize_t           count;
+} *kk_mark_task_fun_t;
+
+static void kk_block_mark_shared_par(kk_mark_stack_t* st, kk_ssize_t budget, bool atomic, kk_context_t* ctx);
+
+static kk_box_t kk_mark_task_fun(kk_function_t fself, kk_context_t* ctx) {
+  kk_mark_task_fun_t f = kk_function_as(kk_mark_task_fun_t, fself);
+  kk_mark_stack_t st;
+  kk_mark_stack_init(&st);
+  st.blocks = f->blocks;
+  st.count = st.size = f->count;
+  kk_function_drop(fself, ctx);
+  kk_block_mark_shared_par(&st, KK_MARK_TASK_BUDGET, true, ctx);
+  kk_mark_stack_done(&st, ctx);
+  return kk_box_null;
+}
+
+// Split off the bottom half of the stack (the oldest, and likely largest, subtrees) to a new task.
+static bool kk_block_mark_split(kk_mark_stack_t* st, kk_promise_t* promise, kk_context_t* ctx) {
+  const kk_ssize_t n = st->count / 2;
+  kk_block_t** blocks = (kk_block_t**)kk_malloc(n * kk_ssizeof(kk_block_t*), ctx);
+  if (blocks == NULL) return false;
+  kk_memcpy(blocks, st->blocks, n * kk_ssizeof(kk_block_t*));
+  kk_memmove(st->blocks, st->blocks + n, (st->count - n) * kk_ssizeof(kk_block_t*));
+  st->count -= n;
+  kk_mark_task_fun_t f = kk_function_alloc_as(struct kk_mark_task_fun_s, 1, ctx);
+  f->_base.fun = kk_cfun_ptr_box(&kk_mark_task_fun, ctx);
+  f->blocks = blocks;
+  f->count = n;
+  *promise = kk_task_schedule(&f->_base, ctx);
+  return true;
+}
+
+// Scan all blocks on the stack (which are already marked), splitting off tasks after `budget` visits.
+static void kk_block_mark_shared_par(kk_mark_stack_t* st, kk_ssize_t budget, bool atomic, kk_context_t* ctx) {
+  kk_promise_t promises[KK_MARK_TASKS_MAX];
+  kk_ssize_t   spawned = 0;
+  kk_ssize_t   visited = 0;
+  while (st->count > 0) {
+    kk_block_t* b = st->blocks[--st->count];
+    kk_ssize_t i = b->header.scan_fsize;
+    kk_ssize_t first = 0;
+    if (kk_unlikely(i >= KK_SCAN_FSIZE_MAX)) {
+      i = kk_block_scan_fsize(b);
+      first++;  // skip scan field
+    }
+    while (i > first) {  // push in reverse so the first field is visited first (as in `kk_block_mark_shared_rec`)
+      kk_box_t v = kk_block_field(b, --i);
+      if (!kk_box_is_non_null_ptr(v)) continue;
+      kk_block_t* child = kk_ptr_unbox(v);
+      if (!kk_block_mark_claim(child, atomic, ctx)) continue;
+      if (child->header.scan_fsize > 0 && !kk_mark_stack_push(st, child, ctx)) {
+        kk_fatal_error(ENOMEM, "out of memory while marking a structure as thread shared");
+      }
+    }
+    if (++visited >= budget && st->count >= KK_MARK_SPLIT_MIN && spawned < KK_MARK_TASKS_MAX) {
+      atomic = true;  // from now on other tasks may mark concurrently
+      visited = 0; 
+      budget = KK_MARK_TASK_BUDGET;
+      if (kk_block_mark_split(st, &promises[spawned], ctx)) { spawned++; }
+    }
+  }
+  // wait for our tasks
+  for (kk_ssize_t j = 0; j < spawned; j++) {
+    kk_box_drop(kk_promise_get(promises[j], ctx), ctx);
+  }
+}
+
 kk_decl_export void kk_block_mark_shared( kk_block_t* b, kk_context_t* ctx ) {
   if (!kk_block_is_thread_shared(b)) {
+    kk_probe2(mark_shared, b, b->header.tag);
+    #if KK_STATS
+    const int64_t marked = ctx->stats.mark_shared_blocks;
+    #endif
+    const kk_ssize_t threshold = kk_atomic_load_relaxed(&mark_parallel_threshold);
     if (b->header.scan_fsize == 0) {
-      kk_block_make_shared(b); // no scan fields
+      kk_block_make_shared(b, ctx); // no scan fields
+    }
+    else if (kk_unlikely(threshold > 0)) {
+      kk_mark_stack_t st;
+      kk_mark_stack_init(&st);
+      kk_block_make_shared(b, ctx);
+      kk_mark_stack_push(&st, b, ctx);
+      kk_block_mark_shared_par(&st, threshold, false, ctx);
+      kk_mark_stack_done(&st, ctx);
     }
     else {
       kk_block_mark_shared_rec(b, 0, ctx);
     }
+    #if KK_STATS
+    ctx->stats.mark_shared++;
+    if (ctx->stats.mark_shared_blocks - marked > ctx->stats.mark_shared_max) {
+      ctx->stats.mark_shared_max = ctx->stats.mark_shared_blocks - marked;
+    }
+    #endif
   }
 }
 
+//-----------------------------------------------------------------------------------------
+// Make a block and everything reachable from it immortal: such blocks are never freed and
+// dup/drop skip them after a single (inlined) test. Use this for long-lived data built at startup.
+// This is not thread-safe: it should not be used on data that other threads already access.
+//-----------------------------------------------------------------------------------------
+
+static inline bool kk_block_make_immortal_one(kk_block_t* b) {
+  if (kk_refcount_is_immortal(kk_block_refcount(b))) return false;
+  kk_block_refcount_set(b, RC_STUCK);
+  return true;
+}
+
+kk_decl_export void kk_block_make_immortal(kk_block_t* b, kk_context_t* ctx) {
+  if (!kk_block_make_immortal_one(b) || b->header.scan_fsize == 0) return;
+  kk_mark_stack_t st;
+  kk_mark_stack_init(&st);
+  kk_mark_stack_push(&st, b, ctx);
+  while (st.count > 0) {
+    b = st.blocks[--st.count];
+    kk_ssize_t i = b->header.scan_fsize;
+    kk_ssize_t first = 0;
+    if (kk_unlikely(i >= KK_SCAN_FSIZE_MAX)) {
+      i = kk_block_scan_fsize(b);
+      first++;  // skip scan field
+    }
+    while (i > first) {
+      kk_box_t v = kk_block_field(b, --i);
+      if (!kk_box_is_non_null_ptr(v)) continue;
+      kk_block_t* child = kk_ptr_unbox(v);
+      if (kk_block_make_immortal_one(child) && child->header.scan_fsize > 0 && !kk_mark_stack_push(&st, child, ctx)) {
+        kk_fatal_error(ENOMEM, "out of memory while making a structure immortal");
+      }
+    }
+  }
+  kk_mark_stack_done(&st, ctx);
+}
+
+kk_decl_export kk_box_t kk_box_make_immortal(kk_box_t b, kk_context_t* ctx) {
+  if (kk_box_is_non_null_ptr(b)) {
+    kk_block_make_immortal(kk_ptr_unbox(b), ctx);
+  }
+  return b;
+}
+
 kk_decl_export void kk_box_mark_shared( kk_box_t b, kk_context_t* ctx ) {
   if (kk_box_is_non_null_ptr(b)) {
     kk_block_mark_shared( kk_ptr_unbox(b), ctx );
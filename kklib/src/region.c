@@ -0,0 +1,267 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Allocation regions
+
+  While a region is active (`kk_region_push`), small allocations of the context are bump allocated
+  in chunks of a single reserved address range (the arena). Freeing a block in a region only
+  increments a counter of the chunk. When the region is popped every chunk whose blocks are all freed
+  is reused directly; chunks that still contain live blocks (that escaped the region, or that are
+  thread-shared) are pinned and released once their last live block is freed.
+
+  Each chunk counts the number of `allocated` blocks and the number of blocks freed by the
+  owning context (`local_freed`), which are both only accessed by the owner. Blocks freed by
+  other threads (or after the region is popped) are counted atomically in `remote_freed`.
+  When popping, the live count (`allocated - local_freed`) is subtracted from `remote_freed`
+  and whoever brings `remote_freed` to exactly zero releases the chunk.
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define KK_REGION_CHUNK_SHIFT    (18)                            // 256 KiB chunks
+#define KK_REGION_CHUNK_SIZE     (KK_IZ(1) << KK_REGION_CHUNK_SHIFT)
+#define KK_REGION_CHUNK_COUNT    (KK_REGION_ARENA_SIZE >> KK_REGION_CHUNK_SHIFT)
+#define KK_REGION_ALLOC_MAX      (KK_REGION_CHUNK_SIZE/64)       // larger allocations use the regular allocator
+#define KK_REGION_ALIGN          (2*KK_INTPTR_SIZE)
+#define KK_REGION_CHUNK_NONE     (UINT32_MAX)
+
+typedef struct kk_region_chunk_s {
+  _Atomic(kk_context_t*) owner;         // the owning context while the region is active (or NULL)
+  kk_ssize_t             allocated;     // allocated blocks (accessed by the owner only)
+  kk_ssize_t             local_freed;   // freed blocks by the owner (accessed by the owner only)
+  _Atomic(kk_ssize_t)    remote_freed;  // freed blocks by others; becomes <= 0 once popped
+  uint32_t               next;          // next chunk in the region or the free list
+} kk_region_chunk_t;
+
+struct kk_region_s {
+  kk_region_t*           prev;          // the region that was active before
+  uint8_t*               cur;           // bump pointer
+  uint8_t*               end;           // end of the current chunk
+  uint32_t               chunks;        // list of chunks in use by this region
+};
+
+uintptr_t                  kk_region_arena_base = 1;  // never equal to an aligned address until the arena is reserved
+static kk_region_chunk_t*  kk_region_chunks;          // chunk meta data
+static _Atomic(uintptr_t)  kk_region_arena_state;     // 0: uninitialized, 1: initializing, 2: available, 3: failed
+static _Atomic(uintptr_t)  kk_region_lock;            // spin lock for the chunk free list
+static uint32_t            kk_region_free_chunks = KK_REGION_CHUNK_NONE;
+static uint32_t            kk_region_fresh_chunks;    // number of chunks used so far
+
+
+/*--------------------------------------------------------------------------------------------------
+  Arena
+--------------------------------------------------------------------------------------------------*/
+
+// Reserve an address range of KK_REGION_ARENA_SIZE aligned to its size.
+static uint8_t* kk_region_os_reserve(void) {
+  const size_t size = (size_t)KK_REGION_ARENA_SIZE;
+#if defined(_WIN32)
+  // over-reserve to find an aligned address, and reserve exactly that
+  uint8_t* p = (uint8_t*)VirtualAlloc(NULL, 2*size, MEM_RESERVE, PAGE_NOACCESS);
+  if (p == NULL) return NULL;
+  uint8_t* aligned = (uint8_t*)(((uintptr_t)p + size - 1) & ~((uintptr_t)size - 1));
+  VirtualFree(p, 0, MEM_RELEASE);
+  return (uint8_t*)VirtualAlloc(aligned, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  #if defined(MAP_NORESERVE)
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  #else
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  #endif
+  uint8_t* p = (uint8_t*)mmap(NULL, 2*size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (p == MAP_FAILED) return NULL;
+  // trim to an aligned range
+  uint8_t* aligned = (uint8_t*)(((uintptr_t)p + size - 1) & ~((uintptr_t)size - 1));
+  if (aligned > p) { munmap(p, (size_t)(aligned - p)); }
+  uint8_t* end = p + 2*size;
+  if (end > aligned + size) { munmap(aligned + size, (size_t)(end - (aligned + size))); }
+  return aligned;
+#endif
+}
+
+static bool kk_region_os_commit(uint8_t* p, size_t size) {
+#if defined(_WIN32)
+  return (VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != NULL);
+#else
+  kk_unused(p); kk_unused(size);
+  return true;  // committed on demand by the OS
+#endif
+}
+
+static bool kk_region_arena_init(kk_context_t* ctx) {
+  uintptr_t state = kk_atomic_load_acquire(&kk_region_arena_state);
+  if (kk_likely(state == 2)) return true;
+  uintptr_t expect = 0;
+  if (state == 0 && kk_atomic_cas_strong_acq_rel(&kk_region_arena_state, &expect, 1)) {
+    uint8_t* arena = kk_region_os_reserve();
+    kk_region_chunks = (kk_region_chunk_t*)kk_zalloc(KK_REGION_CHUNK_COUNT * kk_ssizeof(kk_region_chunk_t), ctx);
+    if (arena == NULL || kk_region_chunks == NULL) {
+      kk_atomic_store_release(&kk_region_arena_state, 3);
+      return false;
+    }
+    kk_region_arena_base = (uintptr_t)arena;
+    kk_atomic_store_release(&kk_region_arena_state, 2);
+    return true;
+  }
+  // wait for another thread to finish initialization
+  while ((state = kk_atomic_load_acquire(&kk_region_arena_state)) == 1) { }
+  return (state == 2);
+}
+
+static inline uint8_t* kk_region_chunk_start(uint32_t idx) {
+  return (uint8_t*)(kk_region_arena_base + ((uintptr_t)idx << KK_REGION_CHUNK_SHIFT));
+}
+
+static inline uint32_t kk_region_chunk_index(const void* p) {
+  kk_assert_internal(kk_is_region_ptr(p));
+  return (uint32_t)(((uintptr_t)p - kk_region_arena_base) >> KK_REGION_CHUNK_SHIFT);
+}
+
+static void kk_region_lock_acquire(void) {
+  uintptr_t expect = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&kk_region_lock, &expect, 1)) { expect = 0; }
+}
+
+static void kk_region_lock_release(void) {
+  kk_atomic_store_release(&kk_region_lock, 0);
+}
+
+// Get a free chunk for the context (or KK_REGION_CHUNK_NONE if the arena is exhausted)
+static uint32_t kk_region_chunk_acquire(kk_context_t* ctx) {
+  uint32_t idx;
+  bool fresh = false;
+  kk_region_lock_acquire();
+  idx = kk_region_free_chunks;
+  if (idx != KK_REGION_CHUNK_NONE) {
+    kk_region_free_chunks = kk_region_chunks[idx].next;
+  }
+  else if (kk_region_fresh_chunks < KK_REGION_CHUNK_COUNT) {
+    idx = kk_region_fresh_chunks++;
+    fresh = true;
+  }
+  kk_region_lock_release();
+  if (idx == KK_REGION_CHUNK_NONE) return idx;
+  if (fresh && !kk_region_os_commit(kk_region_chunk_start(idx), KK_REGION_CHUNK_SIZE)) {
+    return KK_REGION_CHUNK_NONE;  // leaks the chunk index but the arena is in trouble anyways
+  }
+  kk_region_chunk_t* chunk = &kk_region_chunks[idx];
+  chunk->allocated = 0;
+  chunk->local_freed = 0;
+  kk_atomic_store_relaxed(&chunk->remote_freed, 0);
+  kk_atomic_store_relaxed(&chunk->owner, ctx);
+  return idx;
+}
+
+static void kk_region_chunk_release(uint32_t idx) {
+  kk_region_lock_acquire();
+  kk_region_chunks[idx].next = kk_region_free_chunks;
+  kk_region_free_chunks = idx;
+  kk_region_lock_release();
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Push and pop regions
+--------------------------------------------------------------------------------------------------*/
+
+void kk_region_push(kk_context_t* ctx) {
+  kk_region_t* region = (kk_region_t*)kk_malloc(kk_ssizeof(kk_region_t), ctx);
+  if (region == NULL) return;
+  region->prev = ctx->region;
+  region->cur = region->end = NULL;
+  region->chunks = KK_REGION_CHUNK_NONE;
+  if (!kk_region_arena_init(ctx)) {
+    // regions are not supported; we still push so it can be popped
+    region->cur = region->end = (uint8_t*)region;
+  }
+  ctx->region = region;
+}
+
+void kk_region_pop(kk_context_t* ctx) {
+  kk_region_t* region = ctx->region;
+  if (region == NULL) return;
+  ctx->region = region->prev;
+  uint32_t idx = region->chunks;
+  while (idx != KK_REGION_CHUNK_NONE) {
+    kk_region_chunk_t* chunk = &kk_region_chunks[idx];
+    const uint32_t next = chunk->next;
+    const kk_ssize_t live = chunk->allocated - chunk->local_freed;
+    kk_atomic_store_relaxed(&chunk->owner, NULL);   // from now on all frees are remote
+    if (kk_atomic_sub_acq_rel(&chunk->remote_freed, live) == live) {
+      kk_region_chunk_release(idx);                  // all blocks are freed
+    }
+    // otherwise the chunk is pinned until its last live block is freed
+    idx = next;
+  }
+  kk_free(region, ctx);
+}
+
+bool kk_region_is_active(kk_context_t* ctx) {
+  return (ctx->region != NULL);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Allocation
+--------------------------------------------------------------------------------------------------*/
+
+static kk_decl_noinline void* kk_region_malloc_slow(kk_region_t* region, kk_ssize_t sz, kk_context_t* ctx) {
+  if (sz > KK_REGION_ALLOC_MAX || region->cur == (uint8_t*)region) {
+    return kk_malloc(sz, ctx);  // too large, or regions are not supported
+  }
+  const uint32_t idx = kk_region_chunk_acquire(ctx);
+  if (idx == KK_REGION_CHUNK_NONE) {
+    region->cur = region->end = (uint8_t*)region;  // arena is exhausted: stop using it for this region
+    return kk_region_malloc_slow(region, sz, ctx);
+  }
+  kk_region_chunks[idx].next = region->chunks;
+  region->chunks = idx;
+  region->cur = kk_region_chunk_start(idx);
+  region->end = region->cur + KK_REGION_CHUNK_SIZE;
+  return kk_region_malloc(sz, ctx);
+}
+
+void* kk_region_malloc(kk_ssize_t sz, kk_context_t* ctx) {
+  kk_region_t* region = ctx->region;
+  kk_assert_internal(region != NULL);
+  const kk_ssize_t asize = (sz + KK_REGION_ALIGN - 1) & ~(KK_REGION_ALIGN - 1);
+  uint8_t* p = region->cur;
+  if (kk_unlikely(asize > region->end - p || sz <= 0)) {
+    return kk_region_malloc_slow(region, (sz <= 0 ? 1 : sz), ctx);
+  }
+  region->cur = p + asize;
+  kk_region_chunks[region->chunks].allocated++;   // the current chunk is always the head
+  return p;
+}
+
+void kk_region_free(const void* p, kk_context_t* ctx) {
+  kk_region_chunk_t* chunk = &kk_region_chunks[kk_region_chunk_index(p)];
+  if (ctx != NULL && kk_atomic_load_relaxed(&chunk->owner) == ctx) {
+    chunk->local_freed++;
+  }
+  else if (kk_atomic_add_acq_rel(&chunk->remote_freed, 1) == -1) {
+    kk_region_chunk_release(kk_region_chunk_index(p));   // last block of a pinned chunk
+  }
+}
+
+void* kk_region_realloc(void* p, kk_ssize_t sz, kk_context_t* ctx) {
+  // we do not know the size of `p` but can copy up to the end of its chunk
+  uint8_t* chunk_end = kk_region_chunk_start(kk_region_chunk_index(p)) + KK_REGION_CHUNK_SIZE;
+  const kk_ssize_t avail = (kk_ssize_t)(chunk_end - (uint8_t*)p);
+  void* q = (ctx != NULL && ctx->region != NULL ? kk_region_malloc(sz, ctx) : kk_malloc(sz, ctx));
+  if (q == NULL) return NULL;
+  kk_memmove(q, p, (sz < avail ? sz : avail));  // may overlap with `q` beyond the size of `p`
+  kk_region_free(p, ctx);
+  return q;
+}
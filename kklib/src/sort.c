@@ -0,0 +1,617 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Sorting vectors (see `kk_vector_sort` in `kklib/thread.h`)
+  A vector is sorted in place if it is unique (and copied first otherwise). Elements with a
+  comparison function are sorted with pattern-defeating quicksort ("Pattern-defeating Quicksort",
+  Orson Peters, 2021) that is fast on (partially) sorted inputs and falls back to heapsort on bad
+  inputs. Its partition loops are guarded at the bounds so an inconsistent comparison function
+  cannot go out of bounds. Small integers and floats are sorted with an LSD radix sort on a
+  64-bit key with the same order, skipping the byte positions where all keys are equal.
+  Above `KK_SORT_PAR_MIN` elements, chunks are sorted in parallel and then merged pairwise in
+  rounds where each task merges an equal part of the output (splitting the runs with a binary
+  search on the merge path). None of the sorts are stable.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_SORT_INSERTION_MAX   (24)       // use insertion sort below this size
+#define KK_SORT_NINTHER_MIN     (128)      // use a pseudo median of 9 as the pivot above this size
+#define KK_SORT_PARTIAL_MAX     (8)        // maximal moves of a partial insertion sort
+#define KK_SORT_RADIX_MIN       (64)       // use insertion sort on keys below this size
+#define KK_SORT_PAR_MIN         (1 << 15)  // minimal elements to sort in parallel
+#define KK_SORT_PAR_CHUNK_MIN   (1 << 12)  // minimal elements for each parallel task
+
+static int kk_sort_log2(kk_ssize_t n) {
+  int k = 0;
+  for (; n > 1; n >>= 1) { k++; }
+  return k;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Pattern-defeating quicksort on boxed elements
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_sort_cmp_s kk_sort_cmp_t;
+typedef bool (kk_sort_lt_fun_t)(const kk_sort_cmp_t* cmp, kk_box_t x, kk_box_t y, kk_context_t* ctx);
+
+struct kk_sort_cmp_s {
+  kk_sort_lt_fun_t* lt;
+  kk_function_t     fun;   // the `(a,a) -> bool` for `kk_sort_lt_fun`
+};
+
+static bool kk_sort_lt_fun(const kk_sort_cmp_t* cmp, kk_box_t x, kk_box_t y, kk_context_t* ctx) {
+  kk_function_t f = kk_function_dup(cmp->fun);
+  return kk_function_call(bool,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),f,(f,kk_box_dup(x),kk_box_dup(y),ctx));
+}
+
+static bool kk_sort_lt_integer(const kk_sort_cmp_t* cmp, kk_box_t x, kk_box_t y, kk_context_t* ctx) {
+  kk_unused(cmp);
+  return kk_integer_lt_borrow(kk_integer_unbox(x), kk_integer_unbox(y), ctx);
+}
+
+static inline bool kk_sort_less(const kk_sort_cmp_t* cmp, kk_box_t x, kk_box_t y, kk_context_t* ctx) {
+  return (cmp->lt)(cmp, x, y, ctx);
+}
+
+static inline void kk_sort_swap(kk_box_t* x, kk_box_t* y) {
+  const kk_box_t t = *x;
+  *x = *y;
+  *y = t;
+}
+
+static inline void kk_sort2(kk_box_t* x, kk_box_t* y, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  if (kk_sort_less(cmp, *y, *x, ctx)) kk_sort_swap(x, y);
+}
+
+static inline void kk_sort3(kk_box_t* x, kk_box_t* y, kk_box_t* z, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  kk_sort2(x, y, cmp, ctx);
+  kk_sort2(y, z, cmp, ctx);
+  kk_sort2(x, y, cmp, ctx);
+}
+
+static void kk_sort_insertion(kk_box_t* begin, kk_box_t* end, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  for (kk_box_t* cur = begin + 1; cur < end; cur++) {
+    kk_box_t* sift = cur;
+    if (kk_sort_less(cmp, *sift, *(sift - 1), ctx)) {
+      const kk_box_t x = *sift;
+      do {
+        *sift = *(sift - 1);
+        sift--;
+      } while (sift != begin && kk_sort_less(cmp, x, *(sift - 1), ctx));
+      *sift = x;
+    }
+  }
+}
+
+// Insertion sort that gives up after `KK_SORT_PARTIAL_MAX` moves; returns true if it sorted the elements
+static bool kk_sort_partial_insertion(kk_box_t* begin, kk_box_t* end, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  kk_ssize_t moves = 0;
+  for (kk_box_t* cur = begin + 1; cur < end; cur++) {
+    kk_box_t* sift = cur;
+    if (kk_sort_less(cmp, *sift, *(sift - 1), ctx)) {
+      const kk_box_t x = *sift;
+      do {
+        *sift = *(sift - 1);
+        sift--;
+      } while (sift != begin && kk_sort_less(cmp, x, *(sift - 1), ctx));
+      *sift = x;
+      moves += (cur - sift);
+      if (moves > KK_SORT_PARTIAL_MAX) return false;
+    }
+  }
+  return true;
+}
+
+static void kk_sort_sift_down(kk_box_t* xs, kk_ssize_t i, kk_ssize_t n, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  const kk_box_t x = xs[i];
+  kk_ssize_t child;
+  while ((child = 2*i + 1) < n) {
+    if (child + 1 < n && kk_sort_less(cmp, xs[child], xs[child + 1], ctx)) child++;
+    if (!kk_sort_less(cmp, x, xs[child], ctx)) break;
+    xs[i] = xs[child];
+    i = child;
+  }
+  xs[i] = x;
+}
+
+static void kk_sort_heap(kk_box_t* begin, kk_box_t* end, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  const kk_ssize_t n = end - begin;
+  for (kk_ssize_t i = n/2 - 1; i >= 0; i--) {
+    kk_sort_sift_down(begin, i, n, cmp, ctx);
+  }
+  for (kk_ssize_t i = n - 1; i > 0; i--) {
+    kk_sort_swap(begin, begin + i);
+    kk_sort_sift_down(begin, 0, i, cmp, ctx);
+  }
+}
+
+// Partition around the pivot `*begin`, putting elements equal to the pivot on the right.
+// Returns the final position of the pivot, and whether the elements were already partitioned.
+static kk_box_t* kk_sort_partition_right(kk_box_t* begin, kk_box_t* end, bool* already_partitioned, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  const kk_box_t pivot = *begin;
+  kk_box_t* first = begin;
+  kk_box_t* last  = end;
+  do { first++; } while (first < end && kk_sort_less(cmp, *first, pivot, ctx));
+  if (first - 1 == begin) {
+    while (first < last && !kk_sort_less(cmp, *(--last), pivot, ctx)) { }
+  }
+  else {
+    do { last--; } while (last > begin && !kk_sort_less(cmp, *last, pivot, ctx));
+  }
+  *already_partitioned = (first >= last);
+  while (first < last) {
+    kk_sort_swap(first, last);
+    do { first++; } while (first < end && kk_sort_less(cmp, *first, pivot, ctx));
+    do { last--; } while (last > begin && !kk_sort_less(cmp, *last, pivot, ctx));
+  }
+  kk_box_t* pos = first - 1;
+  *begin = *pos;
+  *pos = pivot;
+  return pos;
+}
+
+// Partition around the pivot `*begin`, putting elements equal to the pivot on the left.
+// Used when the pivot equals the element before `begin` (so there are many equal elements).
+static kk_box_t* kk_sort_partition_left(kk_box_t* begin, kk_box_t* end, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  const kk_box_t pivot = *begin;
+  kk_box_t* first = begin;
+  kk_box_t* last  = end;
+  do { last--; } while (last > begin && kk_sort_less(cmp, pivot, *last, ctx));
+  if (last + 1 == end) {
+    while (first < last && !kk_sort_less(cmp, pivot, *(++first), ctx)) { }
+  }
+  else {
+    do { first++; } while (first < end && !kk_sort_less(cmp, pivot, *first, ctx));
+  }
+  while (first < last) {
+    kk_sort_swap(first, last);
+    do { last--; } while (last > begin && kk_sort_less(cmp, pivot, *last, ctx));
+    do { first++; } while (first < end && !kk_sort_less(cmp, pivot, *first, ctx));
+  }
+  *begin = *last;
+  *last = pivot;
+  return last;
+}
+
+static void kk_sort_pdq(kk_box_t* begin, kk_box_t* end, int bad_allowed, bool leftmost, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  while (true) {
+    const kk_ssize_t size = end - begin;
+    if (size < KK_SORT_INSERTION_MAX) {
+      kk_sort_insertion(begin, end, cmp, ctx);
+      return;
+    }
+    // choose the pivot and move it to `begin`
+    const kk_ssize_t s2 = size/2;
+    if (size > KK_SORT_NINTHER_MIN) {
+      kk_sort3(begin, begin + s2, end - 1, cmp, ctx);
+      kk_sort3(begin + 1, begin + (s2 - 1), end - 2, cmp, ctx);
+      kk_sort3(begin + 2, begin + (s2 + 1), end - 3, cmp, ctx);
+      kk_sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), cmp, ctx);
+      kk_sort_swap(begin, begin + s2);
+    }
+    else {
+      kk_sort3(begin + s2, begin, end - 1, cmp, ctx);
+    }
+    // if the element before (a previous pivot) is not less, it is equal to the pivot
+    // and we put all elements equal to it on the left (which need no further sorting)
+    if (!leftmost && !kk_sort_less(cmp, *(begin - 1), *begin, ctx)) {
+      begin = kk_sort_partition_left(begin, end, cmp, ctx) + 1;
+      continue;
+    }
+    bool already_partitioned;
+    kk_box_t* pivot = kk_sort_partition_right(begin, end, &already_partitioned, cmp, ctx);
+    const kk_ssize_t lsize = pivot - begin;
+    const kk_ssize_t rsize = end - (pivot + 1);
+    if (lsize < size/8 || rsize < size/8) {
+      // highly unbalanced: switch to heapsort after too many, and otherwise break up patterns
+      if (--bad_allowed == 0) {
+        kk_sort_heap(begin, end, cmp, ctx);
+        return;
+      }
+      if (lsize >= KK_SORT_INSERTION_MAX) {
+        kk_sort_swap(begin, begin + lsize/4);
+        kk_sort_swap(pivot - 1, pivot - lsize/4);
+        if (lsize > KK_SORT_NINTHER_MIN) {
+          kk_sort_swap(begin + 1, begin + (lsize/4 + 1));
+          kk_sort_swap(begin + 2, begin + (lsize/4 + 2));
+          kk_sort_swap(pivot - 2, pivot - (lsize/4 + 1));
+          kk_sort_swap(pivot - 3, pivot - (lsize/4 + 2));
+        }
+      }
+      if (rsize >= KK_SORT_INSERTION_MAX) {
+        kk_sort_swap(pivot + 1, pivot + (1 + rsize/4));
+        kk_sort_swap(end - 1, end - rsize/4);
+        if (rsize > KK_SORT_NINTHER_MIN) {
+          kk_sort_swap(pivot + 2, pivot + (2 + rsize/4));
+          kk_sort_swap(pivot + 3, pivot + (3 + rsize/4));
+          kk_sort_swap(end - 2, end - (1 + rsize/4));
+          kk_sort_swap(end - 3, end - (2 + rsize/4));
+        }
+      }
+    }
+    else if (already_partitioned && kk_sort_partial_insertion(begin, pivot, cmp, ctx)
+                                 && kk_sort_partial_insertion(pivot + 1, end, cmp, ctx)) {
+      return;  // was (nearly) sorted already
+    }
+    // recurse on the left and iterate on the right
+    kk_sort_pdq(begin, pivot, bad_allowed, leftmost, cmp, ctx);
+    begin = pivot + 1;
+    leftmost = false;
+  }
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Radix sort on 64-bit keys
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_SORT_KEY_SIGN  KK_U64(0x8000000000000000)
+
+// Small integers are ordered as their (signed) boxed representation
+static inline uint64_t kk_sort_key_from_smallint(kk_box_t b) {
+  return ((uint64_t)(int64_t)(intptr_t)b.box ^ KK_SORT_KEY_SIGN);
+}
+
+static inline kk_box_t kk_sort_key_to_smallint(uint64_t k) {
+  kk_box_t b = { (uintptr_t)(intptr_t)(int64_t)(k ^ KK_SORT_KEY_SIGN) };
+  return b;
+}
+
+// Flip all bits of negative floats and only the sign of positive ones. This orders `-0.0` before `0.0`,
+// and NaN's at the end (or at the start if the sign bit is set).
+static inline uint64_t kk_sort_key_from_double(double d) {
+  const uint64_t u = kk_bits_from_double(d);
+  return ((u & KK_SORT_KEY_SIGN) != 0 ? ~u : (u ^ KK_SORT_KEY_SIGN));
+}
+
+static inline double kk_sort_key_to_double(uint64_t k) {
+  return kk_bits_to_double((k & KK_SORT_KEY_SIGN) != 0 ? (k ^ KK_SORT_KEY_SIGN) : ~k);
+}
+
+static void kk_sort_keys_insertion(uint64_t* keys, kk_ssize_t n) {
+  for (kk_ssize_t i = 1; i < n; i++) {
+    const uint64_t k = keys[i];
+    kk_ssize_t j = i;
+    for (; j > 0 && k < keys[j - 1]; j--) {
+      keys[j] = keys[j - 1];
+    }
+    keys[j] = k;
+  }
+}
+
+// Sort `n` keys using `tmp` (of `n` keys) as scratch space
+static void kk_sort_keys_radix(uint64_t* keys, uint64_t* tmp, kk_ssize_t n) {
+  if (n < KK_SORT_RADIX_MIN) {
+    kk_sort_keys_insertion(keys, n);
+    return;
+  }
+  // count all byte positions in one pass
+  kk_ssize_t counts[8][256];
+  kk_memset(counts, 0, kk_ssizeof(counts));
+  for (kk_ssize_t i = 0; i < n; i++) {
+    const uint64_t k = keys[i];
+    for (int d = 0; d < 8; d++) {
+      counts[d][(k >> (8*d)) & 0xFF]++;
+    }
+  }
+  uint64_t* src = keys;
+  uint64_t* dst = tmp;
+  for (int d = 0; d < 8; d++) {
+    kk_ssize_t* count = counts[d];
+    const int shift = 8*d;
+    if (count[(src[0] >> shift) & 0xFF] == n) continue;  // all keys have the same byte here
+    kk_ssize_t sum = 0;
+    for (int b = 0; b < 256; b++) {
+      const kk_ssize_t c = count[b];
+      count[b] = sum;
+      sum += c;
+    }
+    for (kk_ssize_t i = 0; i < n; i++) {
+      const uint64_t k = src[i];
+      dst[count[(k >> shift) & 0xFF]++] = k;
+    }
+    uint64_t* t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != keys) {
+    kk_memcpy(keys, src, n * kk_ssizeof(uint64_t));
+  }
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Parallel sorting: sort chunks in parallel and merge them in parallel rounds
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_sort_job_s {
+  kk_ssize_t            n;
+  kk_ssize_t            chunk;     // elements in each initially sorted chunk
+  kk_ssize_t            width;     // width of the sorted runs in the current merge round
+  kk_ssize_t            parts;     // tasks in each merge round
+  kk_ssize_t*           splits;    // split of the runs at the start of each part (`parts+1` entries)
+  bool                  in_tmp;    // are `xs` and `xs_tmp` (or `keys` and `keys_tmp`) swapped?
+  kk_box_t*             xs;        // either boxed elements with a comparison,
+  kk_box_t*             xs_tmp;
+  const kk_sort_cmp_t*  cmp;
+  uint64_t*             keys;      // or keys (if not NULL)
+  uint64_t*             keys_tmp;
+} kk_sort_job_t;
+
+// Return `i` such that `a[0,i)` and `b[0,k-i)` are the first `k` elements of the merge of `a` and `b`
+static kk_ssize_t kk_sort_corank_boxes(kk_ssize_t k, const kk_box_t* a, kk_ssize_t na, const kk_box_t* b, kk_ssize_t nb, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  kk_ssize_t lo = (k > nb ? k - nb : 0);
+  kk_ssize_t hi = (k < na ? k : na);
+  while (lo < hi) {
+    const kk_ssize_t i = lo + (hi - lo)/2;
+    if (!kk_sort_less(cmp, b[k - i - 1], a[i], ctx)) { lo = i + 1; } else { hi = i; }
+  }
+  return lo;
+}
+
+static kk_ssize_t kk_sort_corank_keys(kk_ssize_t k, const uint64_t* a, kk_ssize_t na, const uint64_t* b, kk_ssize_t nb) {
+  kk_ssize_t lo = (k > nb ? k - nb : 0);
+  kk_ssize_t hi = (k < na ? k : na);
+  while (lo < hi) {
+    const kk_ssize_t i = lo + (hi - lo)/2;
+    if (a[i] <= b[k - i - 1]) { lo = i + 1; } else { hi = i; }
+  }
+  return lo;
+}
+
+static kk_ssize_t kk_sort_part_start(kk_sort_job_t* job, kk_ssize_t part) {
+  return (kk_ssize_t)(((int64_t)part * job->n) / job->parts);
+}
+
+// Split the runs at the start of each part of the output in this round. This is done once (instead of
+// by the tasks on both sides of a part boundary) and the splits are clamped to be monotone, so that
+// the parts always form a permutation (even with an inconsistent comparison function).
+static void kk_sort_merge_splits(kk_sort_job_t* job, kk_context_t* ctx) {
+  const kk_ssize_t n = job->n;
+  const kk_ssize_t w = job->width;
+  kk_ssize_t prev_lo = -1;
+  kk_ssize_t prev_k  = 0;
+  kk_ssize_t prev_i  = 0;
+  for (kk_ssize_t part = 0; part <= job->parts; part++) {
+    const kk_ssize_t start = kk_sort_part_start(job, part);
+    const kk_ssize_t lo  = (start / (2*w)) * (2*w);
+    const kk_ssize_t mid = (lo + w > n ? n : lo + w);
+    const kk_ssize_t hi  = (mid + w > n ? n : mid + w);
+    const kk_ssize_t k   = start - lo;
+    kk_ssize_t i = 0;
+    if (lo < n) {
+      i = (job->keys != NULL ? kk_sort_corank_keys(k, job->keys_tmp + lo, mid - lo, job->keys_tmp + mid, hi - mid)
+                             : kk_sort_corank_boxes(k, job->xs_tmp + lo, mid - lo, job->xs_tmp + mid, hi - mid, job->cmp, ctx));
+    }
+    if (lo == prev_lo) {
+      if (i < prev_i) { i = prev_i; }
+      if (i > prev_i + (k - prev_k)) { i = prev_i + (k - prev_k); }
+    }
+    job->splits[part] = i;
+    prev_lo = lo;
+    prev_k  = k;
+    prev_i  = i;
+  }
+}
+
+// Merge output elements `[from,to)` of the runs `[lo,mid)` and `[mid,hi)` starting at
+// `a[i]` and ending before `a[iend]`
+static void kk_sort_merge_part(kk_sort_job_t* job, kk_ssize_t lo, kk_ssize_t mid, kk_ssize_t from, kk_ssize_t to, kk_ssize_t i, kk_ssize_t iend, kk_context_t* ctx) {
+  kk_ssize_t j = (from - lo) - i;
+  const kk_ssize_t jend = (to - lo) - iend;
+  if (job->keys != NULL) {
+    const uint64_t* src = job->keys_tmp;
+    uint64_t* const dst = job->keys + from;
+    const uint64_t* a = src + lo;
+    const uint64_t* b = src + mid;
+    kk_ssize_t o = 0;
+    while (i < iend && j < jend) {
+      dst[o++] = (b[j] < a[i] ? b[j++] : a[i++]);
+    }
+    while (i < iend) { dst[o++] = a[i++]; }
+    while (j < jend) { dst[o++] = b[j++]; }
+  }
+  else {
+    const kk_box_t* src = job->xs_tmp;
+    kk_box_t* const dst = job->xs + from;
+    const kk_box_t* a = src + lo;
+    const kk_box_t* b = src + mid;
+    kk_ssize_t o = 0;
+    while (i < iend && j < jend) {
+      dst[o++] = (kk_sort_less(job->cmp, b[j], a[i], ctx) ? b[j++] : a[i++]);
+    }
+    while (i < iend) { dst[o++] = a[i++]; }
+    while (j < jend) { dst[o++] = b[j++]; }
+  }
+}
+
+static void kk_sort_chunk_task(void* env, kk_ssize_t index, kk_context_t* ctx) {
+  kk_sort_job_t* job = (kk_sort_job_t*)env;
+  const kk_ssize_t lo = index * job->chunk;
+  const kk_ssize_t hi = (lo + job->chunk > job->n ? job->n : lo + job->chunk);
+  if (lo >= hi) return;
+  if (job->keys != NULL) {
+    kk_sort_keys_radix(job->keys + lo, job->keys_tmp + lo, hi - lo);
+  }
+  else {
+    kk_sort_pdq(job->xs + lo, job->xs + hi, kk_sort_log2(hi - lo), true, job->cmp, ctx);
+  }
+}
+
+// Merge an equal part of the output of all pairs of runs in this round
+static void kk_sort_merge_task(void* env, kk_ssize_t index, kk_context_t* ctx) {
+  kk_sort_job_t* job = (kk_sort_job_t*)env;
+  const kk_ssize_t n = job->n;
+  const kk_ssize_t w = job->width;
+  const kk_ssize_t from = kk_sort_part_start(job, index);
+  const kk_ssize_t to   = kk_sort_part_start(job, index + 1);
+  for (kk_ssize_t lo = (from / (2*w)) * (2*w); lo < to; lo += 2*w) {
+    const kk_ssize_t mid = (lo + w > n ? n : lo + w);
+    const kk_ssize_t hi  = (mid + w > n ? n : mid + w);
+    kk_sort_merge_part(job, lo, mid, (from > lo ? from : lo), (to < hi ? to : hi),
+                       (from > lo ? job->splits[index] : 0), (to < hi ? job->splits[index + 1] : mid - lo), ctx);
+  }
+}
+
+// Swap the buffers so the current runs are in the scratch buffer
+static void kk_sort_swap_buffers(kk_sort_job_t* job) {
+  kk_box_t* xs = job->xs;
+  job->xs = job->xs_tmp;
+  job->xs_tmp = xs;
+  uint64_t* keys = job->keys;
+  job->keys = job->keys_tmp;
+  job->keys_tmp = keys;
+  job->in_tmp = !job->in_tmp;
+}
+
+static void kk_sort_parallel(kk_sort_job_t* job, kk_ssize_t concurrency, kk_context_t* ctx) {
+  const kk_ssize_t n = job->n;
+  // sort a power of 2 chunks (so the merge tree is balanced)
+  kk_ssize_t chunks = 1;
+  while (chunks < 2*concurrency) { chunks *= 2; }
+  while (chunks > 2 && n / chunks < KK_SORT_PAR_CHUNK_MIN) { chunks /= 2; }
+  job->chunk = (n + chunks - 1) / chunks;
+  kk_task_parallel_for_raw(chunks, &kk_sort_chunk_task, job, ctx);
+  // and merge them
+  job->parts = 4*concurrency;
+  if (job->parts > n / KK_SORT_PAR_CHUNK_MIN) { job->parts = n / KK_SORT_PAR_CHUNK_MIN; }
+  if (job->parts < 1) { job->parts = 1; }
+  job->splits = (kk_ssize_t*)kk_malloc((job->parts + 1) * kk_ssizeof(kk_ssize_t), ctx);
+  job->in_tmp = false;
+  for (kk_ssize_t w = job->chunk; w < n; w *= 2) {
+    job->width = w;
+    kk_sort_swap_buffers(job);
+    kk_sort_merge_splits(job, ctx);
+    kk_task_parallel_for_raw(job->parts, &kk_sort_merge_task, job, ctx);
+  }
+  kk_free(job->splits, ctx);
+  if (job->in_tmp) {
+    // the result is in the scratch buffer
+    kk_sort_swap_buffers(job);
+    if (job->keys != NULL) {
+      kk_memcpy(job->keys, job->keys_tmp, n * kk_ssizeof(uint64_t));
+    }
+    else {
+      kk_memcpy(job->xs, job->xs_tmp, n * kk_ssizeof(kk_box_t));
+    }
+  }
+}
+
+static kk_ssize_t kk_sort_concurrency(kk_ssize_t n, kk_context_t* ctx) {
+  return (n < KK_SORT_PAR_MIN ? 1 : kk_task_concurrency(ctx));
+}
+
+static void kk_sort_boxes(kk_box_t* xs, kk_ssize_t n, const kk_sort_cmp_t* cmp, kk_context_t* ctx) {
+  const kk_ssize_t concurrency = kk_sort_concurrency(n, ctx);
+  if (concurrency <= 1) {
+    kk_sort_pdq(xs, xs + n, kk_sort_log2(n), true, cmp, ctx);
+    return;
+  }
+  kk_sort_job_t job;
+  kk_memset(&job, 0, kk_ssizeof(job));
+  job.n = n;
+  job.xs = xs;
+  job.xs_tmp = (kk_box_t*)kk_malloc(n * kk_ssizeof(kk_box_t), ctx);
+  job.cmp = cmp;
+  kk_sort_parallel(&job, concurrency, ctx);
+  kk_free(job.xs_tmp, ctx);
+}
+
+static void kk_sort_keys(uint64_t* keys, kk_ssize_t n, kk_context_t* ctx) {
+  uint64_t* tmp = (uint64_t*)kk_malloc(n * kk_ssizeof(uint64_t), ctx);
+  const kk_ssize_t concurrency = kk_sort_concurrency(n, ctx);
+  if (concurrency <= 1) {
+    kk_sort_keys_radix(keys, tmp, n);
+  }
+  else {
+    kk_sort_job_t job;
+    kk_memset(&job, 0, kk_ssizeof(job));
+    job.n = n;
+    job.keys = keys;
+    job.keys_tmp = tmp;
+    kk_sort_parallel(&job, concurrency, ctx);
+  }
+  kk_free(tmp, ctx);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Sorting vectors
+--------------------------------------------------------------------------------------------------*/
+
+// Return a unique vector (of length `n > 1`) and its elements
+static kk_box_t* kk_sort_vector_unique(kk_vector_t* v, kk_context_t* ctx) {
+  if (!kk_datatype_is_unique(*v)) {
+    *v = kk_vector_copy(*v, ctx);
+  }
+  return kk_vector_buf_borrow(*v, NULL);
+}
+
+// Sort in the order of `lt : (a,a) -> bool`
+kk_vector_t kk_vector_sort( kk_vector_t v, kk_function_t lt, kk_context_t* ctx ) {
+  const kk_ssize_t n = kk_vector_len_borrow(v);
+  if (n > 1) {
+    kk_box_t* xs = kk_sort_vector_unique(&v, ctx);
+    if (n >= KK_SORT_PAR_MIN) {
+      // the elements and comparison may be used by other threads
+      kk_block_mark_shared(kk_datatype_as_ptr(v), ctx);
+      kk_block_mark_shared(&lt->_block, ctx);
+    }
+    const kk_sort_cmp_t cmp = { &kk_sort_lt_fun, lt };
+    kk_sort_boxes(xs, n, &cmp, ctx);
+  }
+  kk_function_drop(lt, ctx);
+  return v;
+}
+
+kk_vector_t kk_vector_sort_int( kk_vector_t v, kk_context_t* ctx ) {
+  const kk_ssize_t n = kk_vector_len_borrow(v);
+  if (n <= 1) return v;
+  kk_box_t* xs = kk_sort_vector_unique(&v, ctx);
+  bool all_small = true;
+  for (kk_ssize_t i = 0; i < n; i++) {
+    if (!kk_is_smallint(kk_integer_unbox(xs[i]))) {
+      all_small = false;
+      break;
+    }
+  }
+  if (!all_small) {
+    // compare directly (bigints are only read so they need not be marked as shared)
+    const kk_sort_cmp_t cmp = { &kk_sort_lt_integer, NULL };
+    kk_sort_boxes(xs, n, &cmp, ctx);
+    return v;
+  }
+  uint64_t* keys = (uint64_t*)kk_malloc(n * kk_ssizeof(uint64_t), ctx);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    keys[i] = kk_sort_key_from_smallint(xs[i]);
+  }
+  kk_sort_keys(keys, n, ctx);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    xs[i] = kk_sort_key_to_smallint(keys[i]);
+  }
+  kk_free(keys, ctx);
+  return v;
+}
+
+kk_vector_t kk_vector_sort_float64( kk_vector_t v, kk_context_t* ctx ) {
+  const kk_ssize_t n = kk_vector_len_borrow(v);
+  if (n <= 1) return v;
+  kk_box_t* xs = kk_sort_vector_unique(&v, ctx);
+  uint64_t* keys = (uint64_t*)kk_malloc(n * kk_ssizeof(uint64_t), ctx);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    keys[i] = kk_sort_key_from_double(kk_double_unbox(xs[i], ctx));  // (and frees heap allocated floats)
+  }
+  kk_sort_keys(keys, n, ctx);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    xs[i] = kk_double_box(kk_sort_key_to_double(keys[i]), ctx);
+  }
+  kk_free(keys, ctx);
+  return v;
+}
@@ -20,9 +20,6 @@
 // Allow reading aligned words as long as some bytes in it are part of a valid C object
 #define KK_ARCH_ALLOW_WORD_READS  (1)  
 
-static uint8_t kk_ascii_toupper(uint8_t c) {
-  return (c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
-}
 static uint8_t kk_ascii_tolower(uint8_t c) {
   return (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
 }
@@ -30,11 +27,46 @@ static uint8_t kk_ascii_iswhite(uint8_t c) {
   return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
 }
 
+
+// Word parallel ascii operations: each byte of the result is 0x80 if the corresponding
+// byte in `u` is in the range `[lo,hi]` (or equal to `c`), and 0 otherwise.
+static inline kk_uintx_t kk_ascii_in_range_mask(kk_uintx_t u, uint8_t lo, uint8_t hi) {
+  kk_assert_internal(lo > 0 && lo <= hi && hi < 0x80);
+  const kk_uintx_t x = (u & ~kk_bits_high_mask);             // clear high bits so the additions below cannot carry
+  const kk_uintx_t ge = x + (kk_bits_one_mask * (0x80 - lo)); // high bit set iff x >= lo
+  const kk_uintx_t gt = x + (kk_bits_one_mask * (0x7F - hi)); // high bit set iff x > hi
+  return (ge & ~gt & ~u & kk_bits_high_mask);
+}
+
+static inline kk_uintx_t kk_ascii_eq_mask(kk_uintx_t u, uint8_t c) {
+  const kk_uintx_t x = u ^ (kk_bits_one_mask * c);           // zero bytes where equal to `c`
+  return (~(((x & ~kk_bits_high_mask) + ~kk_bits_high_mask) | x) & kk_bits_high_mask);
+}
+
+static inline kk_uintx_t kk_ascii_white_mask(kk_uintx_t u) {
+  return (kk_ascii_eq_mask(u, ' ') | kk_ascii_in_range_mask(u, '\t', '\n') | kk_ascii_eq_mask(u, '\r'));
+}
+
+static inline kk_uintx_t kk_ascii_tolowerx(kk_uintx_t u) {
+  return (u ^ (kk_ascii_in_range_mask(u, 'A', 'Z') >> 2));  // 0x80 >> 2 == 0x20 == 'a' - 'A'
+}
+
+static inline kk_uintx_t kk_ascii_loadx(const uint8_t* s) {
+  kk_uintx_t u;
+  kk_memcpy(&u, s, kk_ssizeof(kk_uintx_t));
+  return u;
+}
+
 static int kk_memicmp(const uint8_t* s, const uint8_t* t, kk_ssize_t len) {
   if (s==t) return 0;
-  for (kk_ssize_t i = 0; i < len; i++) {
-    uint8_t c = kk_ascii_tolower(*s); s++;
-    uint8_t d = kk_ascii_tolower(*t); t++;
+  kk_ssize_t i = 0;
+  // skip over equal words
+  for (; i + kk_ssizeof(kk_uintx_t) <= len; i += kk_ssizeof(kk_uintx_t)) {
+    if (kk_ascii_tolowerx(kk_ascii_loadx(s + i)) != kk_ascii_tolowerx(kk_ascii_loadx(t + i))) break;
+  }
+  for (; i < len; i++) {
+    uint8_t c = kk_ascii_tolower(s[i]);
+    uint8_t d = kk_ascii_tolower(t[i]);
     if (c != d) return (c < d ? -1 : 1);
   }
   return 0;
@@ -77,7 +109,6 @@ kk_ssize_t kk_decl_pure kk_string_count_borrow(kk_string_t str) {
   kk_ssize_t cont = 0;      // continuation character counts
   const uint8_t* t = s; // current position 
   const uint8_t* end = t + len;
-  kk_assert_internal(*end == 0);
 
   // advance per byte until aligned
   for (; ((((uintptr_t)t) % sizeof(kk_uintx_t)) != 0) && (t < end); t++) {
@@ -278,14 +309,270 @@ kk_char_t kk_utf8_read_validate(const uint8_t* s, kk_ssize_t* count, kk_ssize_t*
   return (KK_RAW_UTF8_OFS + b);
 }
 
+/*--------------------------------------------------------------------------------------------------
+  Vectorized utf-8 validation using the lookup algorithm of John Keiser and Daniel Lemire:
+  "Validating UTF-8 In Less Than One Instruction Per Byte", Software: Practice and Experience, 2021.
+  Each byte is classified using its high nibble, and the high and low nibble of the previous byte,
+  as three 16-entry table lookups whose conjunction gives the errors for a 2-byte window; the 
+  continuation bytes of 3- and 4-byte sequences are checked separately. 
+  These only determine if the input is valid: on an invalid sequence (or a character in the raw 
+  range if `qutf8_identity` is set) we use the scalar code to compute the replacement length.
+  The raw range (KK_RAW_PLANE + 0xD800 to 0xE0FF) is encoded as 0xF3 followed by 0xAD or 0xAE.
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(KK_ARCH_X64_SIMD)
+#include <immintrin.h>
+#elif defined(KK_ARCH_ARM64_SIMD)
+#include <arm_neon.h>
+#endif
+
+#if defined(KK_ARCH_X64_SIMD) || defined(KK_ARCH_ARM64_SIMD)
+#define KK_UTF8_TOO_SHORT      (1<<0)   // 11______ 0_______  or  11______ 11______
+#define KK_UTF8_TOO_LONG       (1<<1)   // 0_______ 10______
+#define KK_UTF8_OVERLONG_3     (1<<2)   // 11100000 100_____
+#define KK_UTF8_TOO_LARGE      (1<<3)   // 11110100 1001____  or  11110100 101_____  or  11110101..11111111
+#define KK_UTF8_SURROGATE      (1<<4)   // 11101101 101_____
+#define KK_UTF8_OVERLONG_2     (1<<5)   // 1100000_ 10______
+#define KK_UTF8_TOO_LARGE_1000 (1<<6)   // 11110101..11111111 1000____
+#define KK_UTF8_OVERLONG_4     (1<<6)   // 11110000 1000____
+#define KK_UTF8_TWO_CONTS      (1<<7)   // 10______ 10______
+#define KK_UTF8_CARRY          (KK_UTF8_TOO_SHORT | KK_UTF8_TOO_LONG | KK_UTF8_TWO_CONTS)
+
+// indexed by the high nibble of the previous byte
+static const uint8_t kk_utf8_byte1_high[16] = {
+  KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG,
+  KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG, KK_UTF8_TOO_LONG,
+  KK_UTF8_TWO_CONTS, KK_UTF8_TWO_CONTS, KK_UTF8_TWO_CONTS, KK_UTF8_TWO_CONTS,
+  KK_UTF8_TOO_SHORT | KK_UTF8_OVERLONG_2,
+  KK_UTF8_TOO_SHORT,
+  KK_UTF8_TOO_SHORT | KK_UTF8_OVERLONG_3 | KK_UTF8_SURROGATE,
+  KK_UTF8_TOO_SHORT | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000 | KK_UTF8_OVERLONG_4
+};
+
+// indexed by the low nibble of the previous byte
+static const uint8_t kk_utf8_byte1_low[16] = {
+  KK_UTF8_CARRY | KK_UTF8_OVERLONG_3 | KK_UTF8_OVERLONG_2 | KK_UTF8_OVERLONG_4,
+  KK_UTF8_CARRY | KK_UTF8_OVERLONG_2,
+  KK_UTF8_CARRY,
+  KK_UTF8_CARRY,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000 | KK_UTF8_SURROGATE,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000,
+  KK_UTF8_CARRY | KK_UTF8_TOO_LARGE | KK_UTF8_TOO_LARGE_1000
+};
+
+// indexed by the high nibble of the current byte
+static const uint8_t kk_utf8_byte2_high[16] = {
+  KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT,
+  KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT,
+  KK_UTF8_TOO_LONG | KK_UTF8_OVERLONG_2 | KK_UTF8_TWO_CONTS | KK_UTF8_OVERLONG_3 | KK_UTF8_TOO_LARGE_1000 | KK_UTF8_OVERLONG_4,
+  KK_UTF8_TOO_LONG | KK_UTF8_OVERLONG_2 | KK_UTF8_TWO_CONTS | KK_UTF8_OVERLONG_3 | KK_UTF8_TOO_LARGE,
+  KK_UTF8_TOO_LONG | KK_UTF8_OVERLONG_2 | KK_UTF8_TWO_CONTS | KK_UTF8_SURROGATE  | KK_UTF8_TOO_LARGE,
+  KK_UTF8_TOO_LONG | KK_UTF8_OVERLONG_2 | KK_UTF8_TWO_CONTS | KK_UTF8_SURROGATE  | KK_UTF8_TOO_LARGE,
+  KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT, KK_UTF8_TOO_SHORT
+};
+
+// a sequence is incomplete at the end of a block if one of the last 3 bytes starts a longer sequence
+static const uint8_t kk_utf8_incomplete_max[32] = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+};
+#endif
+
+#if defined(KK_ARCH_X64_SIMD)
+kk_decl_target("ssse3") static inline __m128i kk_utf8_check16(__m128i input, __m128i prev_input, __m128i t1h, __m128i t1l, __m128i t2h, bool reject_raw) {
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i prev1  = _mm_alignr_epi8(input, prev_input, 15);
+  const __m128i b1h = _mm_shuffle_epi8(t1h, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+  const __m128i b1l = _mm_shuffle_epi8(t1l, _mm_and_si128(prev1, nibble));
+  const __m128i b2h = _mm_shuffle_epi8(t2h, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+  const __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+  const __m128i prev2  = _mm_alignr_epi8(input, prev_input, 14);
+  const __m128i prev3  = _mm_alignr_epi8(input, prev_input, 13);
+  const __m128i third  = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));  // only 111_____ will be >= 0x80
+  const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));  // only 1111____ will be >= 0x80
+  const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+  __m128i err = _mm_xor_si128(must23, special);
+  if (reject_raw) {
+    const __m128i raw = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8((char)0xAD)), _mm_cmpeq_epi8(input, _mm_set1_epi8((char)0xAE)));
+    err = _mm_or_si128(err, _mm_and_si128(raw, _mm_cmpeq_epi8(prev1, _mm_set1_epi8((char)0xF3))));
+  }
+  return err;
+}
+
+kk_decl_target("ssse3") static bool kk_utf8_is_valid_ssse3(const uint8_t* s, kk_ssize_t len, bool reject_raw) {
+  const __m128i t1h = _mm_loadu_si128((const __m128i*)kk_utf8_byte1_high);
+  const __m128i t1l = _mm_loadu_si128((const __m128i*)kk_utf8_byte1_low);
+  const __m128i t2h = _mm_loadu_si128((const __m128i*)kk_utf8_byte2_high);
+  const __m128i incomplete_max = _mm_loadu_si128((const __m128i*)(kk_utf8_incomplete_max + 16));
+  __m128i prev = _mm_setzero_si128();
+  __m128i prev_incomplete = _mm_setzero_si128();
+  __m128i err = _mm_setzero_si128();
+  __m128i input;
+  kk_ssize_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    input = _mm_loadu_si128((const __m128i*)(s + i));
+    if (_mm_movemask_epi8(input) == 0) {   // ascii
+      err = _mm_or_si128(err, prev_incomplete);
+    }
+    else {
+      err = _mm_or_si128(err, kk_utf8_check16(input, prev, t1h, t1l, t2h, reject_raw));
+      prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+    }
+    prev = input;
+  }
+  // check the remaining bytes padded with zeros (which also detects an incomplete sequence at the end)
+  uint8_t buf[16] = { 0 };
+  kk_memcpy(buf, s + i, len - i);
+  input = _mm_loadu_si128((const __m128i*)buf);
+  err = _mm_or_si128(err, kk_utf8_check16(input, prev, t1h, t1l, t2h, reject_raw));
+  return (_mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) == 0xFFFF);
+}
+
+kk_decl_target("avx2") static inline __m256i kk_utf8_check32(__m256i input, __m256i prev_input, __m256i t1h, __m256i t1l, __m256i t2h, bool reject_raw) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);  // previous 16 bytes for each lane
+  const __m256i prev1  = _mm256_alignr_epi8(input, shifted, 15);
+  const __m256i b1h = _mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  const __m256i b1l = _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nibble));
+  const __m256i b2h = _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+  const __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+  const __m256i prev2  = _mm256_alignr_epi8(input, shifted, 14);
+  const __m256i prev3  = _mm256_alignr_epi8(input, shifted, 13);
+  const __m256i third  = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+  const __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+  const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+  __m256i err = _mm256_xor_si256(must23, special);
+  if (reject_raw) {
+    const __m256i raw = _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8((char)0xAD)), _mm256_cmpeq_epi8(input, _mm256_set1_epi8((char)0xAE)));
+    err = _mm256_or_si256(err, _mm256_and_si256(raw, _mm256_cmpeq_epi8(prev1, _mm256_set1_epi8((char)0xF3))));
+  }
+  return err;
+}
+
+kk_decl_target("avx2") static bool kk_utf8_is_valid_avx2(const uint8_t* s, kk_ssize_t len, bool reject_raw) {
+  const __m256i t1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)kk_utf8_byte1_high));
+  const __m256i t1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)kk_utf8_byte1_low));
+  const __m256i t2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)kk_utf8_byte2_high));
+  const __m256i incomplete_max = _mm256_loadu_si256((const __m256i*)kk_utf8_incomplete_max);
+  __m256i prev = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  __m256i err = _mm256_setzero_si256();
+  __m256i input;
+  kk_ssize_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    input = _mm256_loadu_si256((const __m256i*)(s + i));
+    if (_mm256_movemask_epi8(input) == 0) {   // ascii
+      err = _mm256_or_si256(err, prev_incomplete);
+    }
+    else {
+      err = _mm256_or_si256(err, kk_utf8_check32(input, prev, t1h, t1l, t2h, reject_raw));
+      prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+    }
+    prev = input;
+  }
+  // check the remaining bytes padded with zeros (which also detects an incomplete sequence at the end)
+  uint8_t buf[32] = { 0 };
+  kk_memcpy(buf, s + i, len - i);
+  input = _mm256_loadu_si256((const __m256i*)buf);
+  err = _mm256_or_si256(err, kk_utf8_check32(input, prev, t1h, t1l, t2h, reject_raw));
+  return (_mm256_testz_si256(err, err) != 0);
+}
+
+// Returns `true` if `s` is certainly valid, and `false` if it is invalid or we need to use the scalar validation.
+static bool kk_utf8_is_valid_simd(const uint8_t* s, kk_ssize_t len, bool reject_raw) {
+  if (kk_has_avx2) return kk_utf8_is_valid_avx2(s, len, reject_raw);
+  if (kk_has_ssse3) return kk_utf8_is_valid_ssse3(s, len, reject_raw);
+  return false;
+}
+
+#elif defined(KK_ARCH_ARM64_SIMD)
+
+static inline uint8x16_t kk_utf8_check16(uint8x16_t input, uint8x16_t prev_input, uint8x16_t t1h, uint8x16_t t1l, uint8x16_t t2h, bool reject_raw) {
+  const uint8x16_t prev1 = vextq_u8(prev_input, input, 15);
+  const uint8x16_t b1h = vqtbl1q_u8(t1h, vshrq_n_u8(prev1, 4));
+  const uint8x16_t b1l = vqtbl1q_u8(t1l, vandq_u8(prev1, vdupq_n_u8(0x0F)));
+  const uint8x16_t b2h = vqtbl1q_u8(t2h, vshrq_n_u8(input, 4));
+  const uint8x16_t special = vandq_u8(vandq_u8(b1h, b1l), b2h);
+  const uint8x16_t prev2  = vextq_u8(prev_input, input, 14);
+  const uint8x16_t prev3  = vextq_u8(prev_input, input, 13);
+  const uint8x16_t third  = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+  const uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+  const uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+  uint8x16_t err = veorq_u8(must23, special);
+  if (reject_raw) {
+    const uint8x16_t raw = vorrq_u8(vceqq_u8(input, vdupq_n_u8(0xAD)), vceqq_u8(input, vdupq_n_u8(0xAE)));
+    err = vorrq_u8(err, vandq_u8(raw, vceqq_u8(prev1, vdupq_n_u8(0xF3))));
+  }
+  return err;
+}
+
+static bool kk_utf8_is_valid_simd(const uint8_t* s, kk_ssize_t len, bool reject_raw) {
+  const uint8x16_t t1h = vld1q_u8(kk_utf8_byte1_high);
+  const uint8x16_t t1l = vld1q_u8(kk_utf8_byte1_low);
+  const uint8x16_t t2h = vld1q_u8(kk_utf8_byte2_high);
+  const uint8x16_t incomplete_max = vld1q_u8(kk_utf8_incomplete_max + 16);
+  uint8x16_t prev = vdupq_n_u8(0);
+  uint8x16_t prev_incomplete = vdupq_n_u8(0);
+  uint8x16_t err = vdupq_n_u8(0);
+  uint8x16_t input;
+  kk_ssize_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    input = vld1q_u8(s + i);
+    if (vmaxvq_u8(input) < 0x80) {   // ascii
+      err = vorrq_u8(err, prev_incomplete);
+    }
+    else {
+      err = vorrq_u8(err, kk_utf8_check16(input, prev, t1h, t1l, t2h, reject_raw));
+      prev_incomplete = vqsubq_u8(input, incomplete_max);
+    }
+    prev = input;
+  }
+  // check the remaining bytes padded with zeros (which also detects an incomplete sequence at the end)
+  uint8_t buf[16] = { 0 };
+  kk_memcpy(buf, s + i, len - i);
+  input = vld1q_u8(buf);
+  err = vorrq_u8(err, kk_utf8_check16(input, prev, t1h, t1l, t2h, reject_raw));
+  return (vmaxvq_u8(err) == 0);
+}
+
+#else
+
+static bool kk_utf8_is_valid_simd(const uint8_t* s, kk_ssize_t len, bool reject_raw) {
+  kk_unused(s); kk_unused(len); kk_unused(reject_raw);
+  return false;
+}
+#endif
+
 // validate a qutf8 sequence; return in `pvlen` the bytes needed to convert to a valid utf8 sequence.
 static bool kk_qutf8_validate(kk_ssize_t len, const uint8_t* s, bool qutf8_identity, kk_ssize_t* pvlen) {
+  // vectorized fast path; in identity mode characters in the raw range are treated as invalid as well
+  if (len >= 16 && kk_utf8_is_valid_simd(s, len, qutf8_identity)) {
+    if (pvlen != NULL) { *pvlen = len; }
+    return true;
+  }
   const uint8_t* const end = s + len;
   kk_ssize_t vlen = 0;
   const uint8_t* p = s;
   while (p < end) {
     // optimize for ascii
-    // todo: optimize further with word reads?
+    if (p + 8 <= end) {
+      uint64_t w;
+      kk_memcpy(&w, p, 8);
+      if ((w & KK_U64(0x8080808080808080)) == 0) {
+        p += 8;
+        vlen += 8;
+        continue;
+      }
+    }
     if (kk_likely(*p < 0x80)) {
       p++;
       vlen++;
@@ -384,7 +671,7 @@ kk_string_t kk_string_convert_from_qutf8(kk_bytes_t str, kk_context_t* ctx) {
   // to avoid reallocation (to accommodate invalid sequences), we first check if
   // it is already valid utf-8 which should be very common; in that case we return the bytes/string as-is.
   kk_ssize_t len;
-  const uint8_t* const s = kk_bytes_buf_borrow(str, &len);
+  const uint8_t* const s = (const uint8_t*)kk_bytes_cbuf_borrow(str, &len);  // zero terminated so validation cannot read beyond a slice
   kk_ssize_t vlen;
   bool valid = kk_qutf8_validate(len, s, true, &vlen);
   if (valid) {
@@ -425,7 +712,7 @@ const char* kk_string_to_qutf8_borrow(kk_string_t str, bool* should_free, kk_con
   kk_assert_internal(p == end);
   if (extra_count == 0) {
     *should_free = false;
-    return (const char*)s;
+    return kk_string_cbuf_borrow(str, NULL);  // zero terminated
   }
 
   // contains raw bytes, allocate a buffer;
@@ -662,23 +949,8 @@ kk_string_t kk_string_alloc_from_codepage(const uint8_t* bstr, const uint16_t* c
 --------------------------------------------------------------------------------------------------*/
 
 kk_ssize_t kk_decl_pure kk_string_count_pattern_borrow(kk_string_t str, kk_string_t pattern) {
-  kk_ssize_t patlen;
-  const uint8_t* pat = kk_string_buf_borrow(pattern, &patlen);
-  kk_ssize_t len;
-  const uint8_t* s = kk_string_buf_borrow(str, &len);
-  if (patlen <= 0)  return kk_string_count_borrow(str);
-  if (patlen > len) return 0;
-
-  //todo: optimize by doing backward Boyer-Moore? or use forward Knuth-Morris-Pratt?
-  kk_ssize_t count = 0;
-  const uint8_t* end = s + (len - (patlen - 1));
-  for (const uint8_t* p = s; p < end; p++) {
-    if (kk_memcmp(p, pat, patlen) == 0) {
-      count++;
-      p += (patlen - 1);
-    }
-  }
-  return count;
+  if (kk_string_is_empty_borrow(pattern)) return kk_string_count_borrow(str);
+  return kk_bytes_count_pattern_borrow(str.bytes, pattern.bytes);
 }
 
 
@@ -698,13 +970,22 @@ kk_string_t kk_string_from_chars(kk_vector_t v, kk_context_t* ctx) {
     len += kk_utf8_len(kk_char_unbox(cs[i], ctx));
   }
   uint8_t* p;
-  kk_string_t s = kk_unsafe_string_alloc_buf(len + 1, &p, ctx);
-  for (kk_ssize_t i = 0; i < n; i++) {
-    kk_ssize_t count;
-    kk_utf8_write(kk_char_unbox(cs[i], ctx), p, &count);
-    p += count;
+  kk_string_t s = kk_unsafe_string_alloc_buf(len, &p, ctx);
+  if (len == n) {
+    // all ascii
+    for (kk_ssize_t i = 0; i < n; i++) {
+      p[i] = (uint8_t)kk_char_unbox(cs[i], ctx);
+    }
+    p += n;
+  }
+  else {
+    for (kk_ssize_t i = 0; i < n; i++) {
+      kk_ssize_t count;
+      kk_utf8_write(kk_char_unbox(cs[i], ctx), p, &count);
+      p += count;
+    }
   }
-  kk_assert_internal(kk_string_buf_borrow(s, NULL) + n == p);
+  kk_assert_internal(kk_string_buf_borrow(s, NULL) + len == p);
   kk_vector_drop(v, ctx);
   return s;
 }
@@ -715,10 +996,19 @@ kk_vector_t kk_string_to_chars(kk_string_t s, kk_context_t* ctx) {
   kk_vector_t v = kk_vector_alloc_uninit(n, &cs, ctx);
   kk_ssize_t len;
   const uint8_t* p = kk_string_buf_borrow(s, &len);
-  for (kk_ssize_t i = 0; i < n; i++) {
-    kk_ssize_t count;
-    cs[i] = kk_char_box(kk_utf8_read(p, &count), ctx);
-    p += count;
+  if (n == len) {
+    // all ascii
+    for (kk_ssize_t i = 0; i < n; i++) {
+      cs[i] = kk_char_box(p[i], ctx);
+    }
+    p += n;
+  }
+  else {
+    for (kk_ssize_t i = 0; i < n; i++) {
+      kk_ssize_t count;
+      cs[i] = kk_char_box(kk_utf8_read(p, &count), ctx);
+      p += count;
+    }
   }
   kk_assert_internal(p == kk_string_buf_borrow(s, NULL) + len);
   kk_string_drop(s, ctx);
@@ -731,25 +1021,22 @@ kk_vector_t kk_string_splitv(kk_string_t s, kk_string_t sep, kk_context_t* ctx)
 
 kk_vector_t kk_string_splitv_atmost(kk_string_t str, kk_string_t sepstr, kk_ssize_t n, kk_context_t* ctx)
 {
+  // splitting on a separator never splits a code point as both `str` and `sepstr` are valid utf-8
+  if (!kk_string_is_empty_borrow(sepstr)) {
+    return kk_bytes_splitv_atmost(str.bytes, sepstr.bytes, n, ctx);
+  }
+  kk_string_drop(sepstr, ctx);
+
+  // split into code points
   if (n < 1) n = 1;
   kk_ssize_t len;
   const uint8_t* s = kk_string_buf_borrow(str, &len);
   const uint8_t* const end = s + len;
-  kk_ssize_t seplen;
-  const uint8_t* sep = kk_string_buf_borrow(sepstr, &seplen);
-
-  // count parts
   kk_ssize_t count = 1;
-  if (seplen > 0) {
-    const uint8_t* p = s;
-    while (count < n && (p = kk_memmem(p, end - p, sep, seplen)) != NULL) {
-      p += seplen;
-      count++;
-    }
-  }
-  else if (n > 1) {
+  if (n > 1) {
     count = kk_string_count_borrow(str); // todo: or special count upto n?
     if (count > n) count = n;
+    if (count < 1) count = 1;
   }
   kk_assert_internal(count >= 1 && count <= n);
 
@@ -758,174 +1045,267 @@ kk_vector_t kk_string_splitv_atmost(kk_string_t str, kk_string_t sepstr, kk_ssiz
   kk_vector_t vec = kk_vector_alloc_uninit(count, &v, ctx);
   const uint8_t* p = s;
   for (kk_ssize_t i = 0; i < (count-1) && p < end; i++) {
-    const uint8_t* r;
-    if (seplen > 0) {
-      r = kk_memmem(p, end - p, sep, seplen);
-    }
-    else {
-      r = kk_utf8_next(p);
-    }
+    const uint8_t* r = kk_utf8_next(p);
     kk_assert_internal(r != NULL && r >= p && r < end);
-    const kk_ssize_t partlen = (r - p);
-    v[i] = kk_string_box(kk_string_alloc_dupn_valid_utf8(partlen, p, ctx));
-    p = r + seplen;  // advance
+    v[i] = kk_string_box(kk_string_alloc_dupn_valid_utf8(r - p, p, ctx));
+    p = r;  // advance
   }
   kk_assert_internal(p <= end);
   v[count-1] = kk_string_box(kk_string_alloc_dupn_valid_utf8(end - p, p, ctx));  // todo: share string if p == s ?
   kk_string_drop(str, ctx);
-  kk_string_drop(sepstr, ctx);
   return vec;
 }
 
+// Concatenate `n` strings `ss` using the separator `sep` with a single allocation (all borrowed)
+kk_string_t kk_string_cat_n(kk_ssize_t n, const kk_string_t* ss, kk_string_t sep, kk_context_t* ctx) {
+  if (n <= 0) return kk_string_empty();
+  if (n == 1) return kk_string_dup(ss[0]);
+  kk_ssize_t seplen;
+  const uint8_t* sepbuf = kk_string_buf_borrow(sep, &seplen);
+  kk_ssize_t len = seplen * (n - 1);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    len += kk_string_len_borrow(ss[i]);
+  }
+  uint8_t* p;
+  kk_string_t t = kk_unsafe_string_alloc_buf(len, &p, ctx);
+  for (kk_ssize_t i = 0; i < n; i++) {
+    if (i > 0 && seplen > 0) {
+      kk_memcpy(p, sepbuf, seplen);
+      p += seplen;
+    }
+    kk_ssize_t slen;
+    const uint8_t* s = kk_string_buf_borrow(ss[i], &slen);
+    kk_memcpy(p, s, slen);
+    p += slen;
+  }
+  kk_assert_internal(*p == 0);
+  return t;
+}
+
 
 
 /*--------------------------------------------------------------------------------------------------
 
 --------------------------------------------------------------------------------------------------*/
 
-kk_string_t kk_string_to_upper(kk_string_t str, kk_context_t* ctx) {
+// Map ascii characters in the range `[lo,hi]` to the other case (by flipping bit 5), in-place if `str` is unique.
+static kk_string_t kk_string_ascii_map_case(kk_string_t str, uint8_t lo, uint8_t hi, kk_context_t* ctx) {
   kk_ssize_t len;
   const uint8_t* s = kk_string_buf_borrow(str, &len);
+  if (len == 0) return str;
   kk_string_t tstr;
-  if (kk_datatype_is_unique(str.bytes)) {
+  uint8_t* t;
+  if (kk_bytes_is_unique_mutable(str.bytes)) {
     tstr = str;  // update in-place
+    t = (uint8_t*)s;
   }
   else {
-    kk_string_dup(str);  // multi-thread safe as we still reference str with s
-    tstr = kk_string_copy(str, ctx);
-    kk_assert_internal(!kk_datatype_eq(str.bytes, tstr.bytes));
+    tstr = kk_unsafe_string_alloc_buf(len, &t, ctx);
+  }
+  kk_ssize_t i = 0;
+  for (; i + kk_ssizeof(kk_uintx_t) <= len; i += kk_ssizeof(kk_uintx_t)) {
+    kk_uintx_t u = kk_ascii_loadx(s + i);
+    u ^= (kk_ascii_in_range_mask(u, lo, hi) >> 2);  // 0x80 >> 2 == 0x20 == 'a' - 'A'
+    kk_memcpy(t + i, &u, kk_ssizeof(kk_uintx_t));
   }
-  uint8_t* t = (uint8_t*)kk_string_buf_borrow(tstr, NULL);   // t & s may alias!
-  for (kk_ssize_t i = 0; i < len; i++) {
-    t[i] = kk_ascii_toupper(s[i]);
+  for (; i < len; i++) {
+    const uint8_t c = s[i];
+    t[i] = (c >= lo && c <= hi ? (c ^ 0x20) : c);
   }
   if (!kk_datatype_eq(str.bytes, tstr.bytes)) kk_string_drop(str, ctx);  // drop if not reused in-place
   return tstr;
 }
 
+kk_string_t kk_string_to_upper(kk_string_t str, kk_context_t* ctx) {
+  return kk_string_ascii_map_case(str, 'a', 'z', ctx);
+}
+
 kk_string_t  kk_string_to_lower(kk_string_t str, kk_context_t* ctx) {
-  kk_ssize_t len;
-  const uint8_t* s = kk_string_buf_borrow(str, &len);
-  kk_string_t tstr;
-  if (kk_datatype_is_unique(str.bytes)) {
-    tstr = str;  // update in-place
-  }
-  else {
-    kk_string_dup(str);  // multi-thread safe as we still reference str with s
-    tstr = kk_string_copy(str, ctx);
-    kk_assert_internal(!kk_datatype_eq(str.bytes, tstr.bytes));
-  }
-  uint8_t* t = (uint8_t*)kk_string_buf_borrow(tstr, NULL);   // t & s may alias!
-  for (kk_ssize_t i = 0; i < len; i++) {
-    t[i] = kk_ascii_tolower(s[i]);
+  return kk_string_ascii_map_case(str, 'A', 'Z', ctx);
+}
+
+// Return the `tlen` bytes starting at `ofs` in `str`, in-place if `str` is unique.
+static kk_string_t kk_string_trim_to(kk_string_t str, kk_ssize_t ofs, kk_ssize_t tlen, kk_context_t* ctx) {
+  if (kk_bytes_is_unique_mutable(str.bytes)) {
+    uint8_t* s = (uint8_t*)kk_string_buf_borrow(str, NULL);
+    if (ofs > 0) kk_memmove(s, s + ofs, tlen);
+    return kk_string_adjust_length(str, tlen, ctx);
   }
-  if (!kk_datatype_eq(str.bytes, tstr.bytes)) kk_string_drop(str, ctx);  // drop if not reused in-place
+  const uint8_t* s = kk_string_buf_borrow(str, NULL);
+  kk_string_t tstr = kk_string_alloc_dupn_valid_utf8(tlen, s + ofs, ctx);
+  kk_string_drop(str, ctx);
   return tstr;
 }
 
 kk_string_t  kk_string_trim_left(kk_string_t str, kk_context_t* ctx) {
   kk_ssize_t len;
   const uint8_t* s = kk_string_buf_borrow(str, &len);
+  const uint8_t* const end = s + len;
   const uint8_t* p = s;
-  for (; *p != 0 && kk_ascii_iswhite(*p); p++) {}
+  for (; (end - p) >= kk_ssizeof(kk_uintx_t) && kk_ascii_white_mask(kk_ascii_loadx(p)) == kk_bits_high_mask; p += kk_ssizeof(kk_uintx_t)) {}
+  for (; p < end && kk_ascii_iswhite(*p); p++) {}
   if (p == s) return str;           // no trim needed
-  const kk_ssize_t tlen = len - (p - s);      // todo: if s is unique and tlen close to slen, move inplace?
-  kk_string_t tstr = kk_string_alloc_dupn_valid_utf8(tlen, p, ctx);
-  kk_string_drop(str, ctx);
-  return tstr;
+  return kk_string_trim_to(str, p - s, len - (p - s), ctx);
 }
 
 kk_string_t  kk_string_trim_right(kk_string_t str, kk_context_t* ctx) {
   kk_ssize_t len;
   const uint8_t* s = kk_string_buf_borrow(str, &len);
-  const uint8_t* p = s + len - 1;
-  for (; p >= s && kk_ascii_iswhite(*p); p--) {}
-  const kk_ssize_t tlen = (p - s) + 1;
+  const uint8_t* p = s + len;       // one past the last non-white character
+  for (; (p - s) >= kk_ssizeof(kk_uintx_t) && kk_ascii_white_mask(kk_ascii_loadx(p - kk_ssizeof(kk_uintx_t))) == kk_bits_high_mask; p -= kk_ssizeof(kk_uintx_t)) {}
+  for (; p > s && kk_ascii_iswhite(p[-1]); p--) {}
+  const kk_ssize_t tlen = (p - s);
   if (len == tlen) return str;  // no trim needed
-  kk_string_t tstr = kk_string_alloc_dupn_valid_utf8(tlen, s, ctx);
-  kk_string_drop(str, ctx);
-  return tstr;
+  return kk_string_trim_to(str, 0, tlen, ctx);
 }
 
 /*--------------------------------------------------------------------------------------------------
-
+  String builder
 --------------------------------------------------------------------------------------------------*/
 
-kk_unit_t kk_println(kk_string_t s, kk_context_t* ctx) {
-  // TODO: set locale to utf-8?
-  puts(kk_string_cbuf_borrow(s, NULL));  // todo: allow printing embedded 0 characters?
-  kk_string_drop(s, ctx);
-  return kk_Unit;
+void kk_string_builder_init(kk_string_builder_t* sb, kk_ssize_t capacity, kk_context_t* ctx) {
+  if (capacity < 64) capacity = 64;   // always a normal bytes
+  sb->buf = kk_bytes_alloc_buf(capacity, &sb->p, ctx);
+  sb->len = 0;
+  sb->capacity = capacity;
 }
 
-kk_unit_t kk_print(kk_string_t s, kk_context_t* ctx) {
-  // TODO: set locale to utf-8?
-  fputs(kk_string_cbuf_borrow(s, NULL), stdout); // todo: allow printing embedded 0 characters?
-  kk_string_drop(s, ctx);
-  return kk_Unit;
+void kk_string_builder_grow(kk_string_builder_t* sb, kk_ssize_t extra, kk_context_t* ctx) {
+  kk_ssize_t newcap = 2*sb->capacity;
+  if (newcap < sb->len + extra) newcap = sb->len + extra;
+  uint8_t* p;
+  kk_bytes_t buf = kk_bytes_alloc_buf(newcap, &p, ctx);
+  kk_memcpy(p, sb->p, sb->len);
+  kk_bytes_drop(sb->buf, ctx);
+  sb->buf = buf;
+  sb->p = p;
+  sb->capacity = newcap;
 }
 
-kk_unit_t kk_trace(kk_string_t s, kk_context_t* ctx) {
-  fputs(kk_string_cbuf_borrow(s, NULL), stderr); // todo: allow printing embedded 0 characters?
-  fputs("\n", stderr);
-  kk_string_drop(s, ctx);
-  return kk_Unit;
+static kk_bytes_t kk_string_builder_finish_bytes(kk_string_builder_t* sb, kk_context_t* ctx) {
+  kk_bytes_t b = kk_bytes_adjust_length(sb->buf, sb->len, ctx);  // in-place if not too much space is wasted
+  sb->buf = kk_bytes_empty();
+  sb->p = NULL;
+  sb->len = sb->capacity = 0;
+  return b;
 }
 
-kk_unit_t kk_trace_any(kk_string_t s, kk_box_t x, kk_context_t* ctx) {
-  fprintf(stderr, "%s: ", kk_string_cbuf_borrow(s, NULL));
-  kk_string_drop(s, ctx);
-  kk_trace(kk_show_any(x, ctx), ctx);
-  return kk_Unit;
+kk_string_t kk_string_builder_finish(kk_string_builder_t* sb, kk_context_t* ctx) {
+  kk_assert_internal(kk_utf8_is_validn(sb->len, sb->p));
+  return kk_unsafe_bytes_as_string(kk_string_builder_finish_bytes(sb, ctx));
+}
+
+kk_string_t kk_string_builder_finish_qutf8(kk_string_builder_t* sb, kk_context_t* ctx) {
+  return kk_string_convert_from_qutf8(kk_string_builder_finish_bytes(sb, ctx), ctx);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Console output
+  Output is buffered per thread and passed to the output sink whenever a newline is written, when
+  the buffer is full, and at `kk_main_end` (or when the context is freed). Each sink call thus
+  consists of whole lines (if they fit in the buffer) and lines of different threads do not interleave.
+  Lengths are used throughout so embedded zero characters are printed as well.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_OUTPUT_BUF_SIZE  (4*1024)
+
+struct kk_output_s {
+  kk_ssize_t  len;
+  char        buf[KK_OUTPUT_BUF_SIZE];
+};
+
+static void kk_output_default_sink(const char* buf, kk_ssize_t len, bool is_err, void* arg) {
+  kk_unused(arg);
+  FILE* f = (is_err ? stderr : stdout);
+  fwrite(buf, 1, (size_t)len, f);  // a single call takes the stdio lock once
+  if (is_err) { fflush(f); }
+}
+
+// The sink is global and should be set at startup before other threads write output
+static kk_output_sink_t* kk_output_sink = &kk_output_default_sink;
+static void*             kk_output_sink_arg;
+
+void kk_output_set_sink(kk_output_sink_t* sink, void* arg) {
+  kk_output_sink_arg = arg;
+  kk_output_sink = (sink == NULL ? &kk_output_default_sink : sink);
+}
+
+void kk_output_flush(kk_context_t* ctx) {
+  struct kk_output_s* out = ctx->out_buf;
+  if (out == NULL || out->len == 0) return;
+  const kk_ssize_t len = out->len;
+  out->len = 0;
+  (*kk_output_sink)(out->buf, len, false, kk_output_sink_arg);
 }
 
+void kk_output_free(kk_context_t* ctx) {
+  if (ctx->out_buf == NULL) return;
+  kk_output_flush(ctx);
+  kk_free(ctx->out_buf, ctx);
+  ctx->out_buf = NULL;
+}
 
-static kk_string_t kk_double_show_special(double d, kk_context_t* ctx) {
-  if (d == HUGE_VAL) {
-    return kk_string_alloc_dup_valid_utf8("inf", ctx);
+void kk_output_write(const char* s, kk_ssize_t len, kk_context_t* ctx) {
+  if (len <= 0) return;
+  struct kk_output_s* out = ctx->out_buf;
+  if (kk_unlikely(out == NULL)) {
+    out = (struct kk_output_s*)kk_malloc(kk_ssizeof(struct kk_output_s), ctx);
+    out->len = 0;
+    ctx->out_buf = out;
   }
-  else if (d == -HUGE_VAL) {
-    return kk_string_alloc_dup_valid_utf8("-inf", ctx);
+  if (out->len + len > KK_OUTPUT_BUF_SIZE) {
+    kk_output_flush(ctx);
+    if (len > KK_OUTPUT_BUF_SIZE) {
+      // too large to buffer
+      (*kk_output_sink)(s, len, false, kk_output_sink_arg);
+      return;
+    }
   }
-  else {
-    kk_assert(isnan(d));
-    return kk_string_alloc_dup_valid_utf8("nan", ctx);
-  }
-}
-
-static kk_string_t kk_double_show_spec(double d, int32_t prec, char spec, kk_context_t* ctx) {
-  if (!isfinite(d)) return kk_double_show_special(d, ctx);
-  char buf[64];
-  char fmt[16];
-  if (prec < 0)  prec = -prec;
-  if (prec > 48) prec = 48;
-  snprintf(fmt, 16, "%%.%i%c", (int)prec, spec);
-  snprintf(buf, 64, fmt, d);
-  // check if it ends with a 0 exponent and remove if so. 
-  char* p = buf;
-  while (*p != 'e' && *p != 0) { p++; }
-  if (p[0] == 'e'
-    && (p[1] == '+' || p[1] == '-')
-    && (p[2] == '0')
-    && (p[3] == 0 || (p[3] == '0' && (p[4] == 0 || (p[4] == '0' && p[5] == 0)))))
-  {
-    *p = 0; // remove exponent
+  memcpy(out->buf + out->len, s, (size_t)len);
+  out->len += len;
+  if (memchr(s, '\n', (size_t)len) != NULL) {
+    kk_output_flush(ctx);
   }
-  return kk_string_alloc_dup_valid_utf8(buf, ctx);
 }
 
-kk_string_t kk_double_show_fixed(double d, int32_t prec, kk_context_t* ctx) {
-  return kk_double_show_spec(d, prec, prec < 0 ? 'g' : 'f', ctx);
+void kk_output_write_err(const char* s, kk_ssize_t len, kk_context_t* ctx) {
+  kk_output_flush(ctx);  // keep the order with respect to the standard output
+  if (len > 0) { (*kk_output_sink)(s, len, true, kk_output_sink_arg); }
 }
 
-kk_string_t kk_double_show_exp(double d, int32_t prec, kk_context_t* ctx) {
-  return kk_double_show_spec(d, prec, prec < 0 ? 'g' : 'e', ctx);
+kk_unit_t kk_println(kk_string_t s, kk_context_t* ctx) {
+  kk_ssize_t len;
+  const uint8_t* buf = kk_string_buf_borrow(s, &len);
+  kk_output_write((const char*)buf, len, ctx);
+  kk_output_write("\n", 1, ctx);
+  kk_string_drop(s, ctx);
+  return kk_Unit;
 }
 
-kk_string_t kk_double_show(double d, int32_t prec, kk_context_t* ctx) {
-  return kk_double_show_spec(d, prec, 'g', ctx);
+kk_unit_t kk_print(kk_string_t s, kk_context_t* ctx) {
+  kk_ssize_t len;
+  const uint8_t* buf = kk_string_buf_borrow(s, &len);
+  kk_output_write((const char*)buf, len, ctx);
+  kk_string_drop(s, ctx);
+  return kk_Unit;
 }
 
+kk_unit_t kk_trace(kk_string_t s, kk_context_t* ctx) {
+  // write the message and newline in one call so traces of different threads do not interleave
+  s = kk_string_cat_from_valid_utf8(s, "\n", ctx);
+  kk_ssize_t len;
+  const uint8_t* buf = kk_string_buf_borrow(s, &len);
+  kk_output_write_err((const char*)buf, len, ctx);
+  kk_string_drop(s, ctx);
+  return kk_Unit;
+}
+
+kk_unit_t kk_trace_any(kk_string_t s, kk_box_t x, kk_context_t* ctx) {
+  s = kk_string_cat_from_valid_utf8(s, ": ", ctx);
+  kk_trace(kk_string_cat(s, kk_show_any(x, ctx), ctx), ctx);
+  return kk_Unit;
+}
 
 
 kk_string_t kk_show_any(kk_box_t b, kk_context_t* ctx) {
@@ -957,6 +1337,15 @@ kk_string_t kk_show_any(kk_box_t b, kk_context_t* ctx) {
         // todo: add tag
         return kk_string_unbox(b);
       }
+      else if (tag == KK_TAG_BYTES_ROPE || tag == KK_TAG_BYTES_SLICE) {
+        // a string or bytes rope or slice (the tags are shared): flatten and copy (as the bytes may not be valid utf-8)
+        kk_bytes_t bytes = kk_bytes_unbox(b);
+        kk_ssize_t len;
+        const uint8_t* buf = kk_bytes_buf_borrow(bytes, &len);
+        kk_string_t s = kk_string_alloc_from_utf8n(len, (const char*)buf, ctx);
+        kk_bytes_drop(bytes, ctx);
+        return s;
+      }
       else if (tag == KK_TAG_FUNCTION) {
         kk_function_t fun = kk_block_assert(kk_function_t, p, KK_TAG_FUNCTION);
         snprintf(buf, 128, "function(0x%zx)", (uintptr_t)(kk_cptr_unbox(fun->fun)));
@@ -131,6 +131,9 @@ static int pthread_once(pthread_once_t* once, void (*init)(void)) {
 ---------------------------------------------------------------------------*/
 #else
 #include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 static void pthread_join_void(pthread_t thread) {
   pthread_join(thread, NULL);
@@ -138,20 +141,153 @@ static void pthread_join_void(pthread_t thread) {
 #endif
 
 
+/*---------------------------------------------------------------------------
+  Waiting on an address
+  `kk_wait_on_address(p,expect)` blocks while `*p == expect` (and may return
+  spuriously), and `kk_wake_on_address_all(p)` wakes up all threads waiting on `p`.
+  This uses futexes on Linux, `WaitOnAddress` on Windows, and a small table
+  of mutex/condition pairs (a "parking lot") on other platforms.
+  Note: on Linux a futex is 32 bits so we only compare the least significant
+  32 bits of `*p`; callers must ensure these change when `*p` changes from `expect`.
+---------------------------------------------------------------------------*/
+#if defined(_WIN32)
+
+static void kk_wait_on_address( _Atomic(uintptr_t)* p, uintptr_t expect ) {
+  WaitOnAddress((volatile void*)p, &expect, sizeof(uintptr_t), INFINITE);
+}
+
+static void kk_wake_on_address_all( _Atomic(uintptr_t)* p ) {
+  WakeByAddressAll((void*)p);
+}
+
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static int32_t* kk_futex_word( _Atomic(uintptr_t)* p ) {
+  #if KK_ARCH_LITTLE_ENDIAN || (KK_INTPTR_SIZE == 4)
+  return (int32_t*)p;
+  #else
+  return ((int32_t*)p) + (KK_INTPTR_SIZE/4 - 1);   // the least significant 32 bits 
+  #endif
+}
+
+static void kk_wait_on_address( _Atomic(uintptr_t)* p, uintptr_t expect ) {
+  syscall(SYS_futex, kk_futex_word(p), FUTEX_WAIT_PRIVATE, (int32_t)expect, NULL, NULL, 0);
+}
+
+static void kk_wake_on_address_all( _Atomic(uintptr_t)* p ) {
+  syscall(SYS_futex, kk_futex_word(p), FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+#else
+
+#define KK_PARKING_LOT_SIZE  (64)
+
+typedef struct kk_parking_s {
+  pthread_mutex_t lock;
+  pthread_cond_t  wake;
+} kk_parking_t;
+
+static pthread_once_t parking_lot_once = PTHREAD_ONCE_INIT;
+static kk_parking_t   parking_lot[KK_PARKING_LOT_SIZE];
+
+static void kk_parking_lot_init(void) {
+  for (int i = 0; i < KK_PARKING_LOT_SIZE; i++) {
+    pthread_mutex_init(&parking_lot[i].lock, NULL);
+    pthread_cond_init(&parking_lot[i].wake, NULL);
+  }
+}
+
+static kk_parking_t* kk_parking_of( _Atomic(uintptr_t)* p ) {
+  pthread_once(&parking_lot_once, &kk_parking_lot_init);
+  const uintptr_t h = ((uintptr_t)p >> 4) * KK_UP(0x9E3779B97F4A7C15);  // fibonacci hashing 
+  return &parking_lot[kk_shrp(h, KK_INTPTR_BITS - 6) % KK_PARKING_LOT_SIZE];
+}
+
+static void kk_wait_on_address( _Atomic(uintptr_t)* p, uintptr_t expect ) {
+  kk_parking_t* park = kk_parking_of(p);
+  pthread_mutex_lock(&park->lock);
+  if (kk_atomic_load_acquire(p) == expect) {
+    pthread_cond_wait(&park->wake, &park->lock);
+  }
+  pthread_mutex_unlock(&park->lock);
+}
+
+static void kk_wake_on_address_all( _Atomic(uintptr_t)* p ) {
+  kk_parking_t* park = kk_parking_of(p);
+  pthread_mutex_lock(&park->lock);
+  pthread_cond_broadcast(&park->wake);
+  pthread_mutex_unlock(&park->lock);
+}
+
+#endif
+
+
 /*---------------------------------------------------------------------------
   Promise
+  A promise is a raw block that points to the state it shares with its task.
+  This state has a single atomic state word that is either empty, empty with
+  waiting threads, skipped, or the (thread-shared) boxed result.
+  Setting and testing the promise are lock-free; only a thread that
+  actually blocks in `kk_promise_get` waits on the state word.
+
+  The task state is also the cancellation token of the task: a task is
+  cancelled if its own flag or that of any of its ancestors (the tasks that
+  scheduled it) is set. This happens explicitly with `kk_promise_cancel`, or
+  when the promise is freed before the result is available (as nobody can
+  await it anymore). Cancellation is cooperative and does not change the
+  result: a cancelled task that did not start yet is skipped, but if its
+  promise is awaited anyway the awaiting thread runs it; a running task can
+  poll `kk_task_is_cancelled` to stop early. A skipped task that is run by
+  an awaiter is revived: its cancellation is cleared and also shields it
+  (and the tasks it schedules) from the cancellation of its ancestors, so
+  it computes its full result (unless it is cancelled again).
 ---------------------------------------------------------------------------*/
 
+// Neither state can be a boxed value: pointers are aligned and never NULL (or 4), and values are odd.
+#define KK_PROMISE_EMPTY    KK_UP(0)
+#define KK_PROMISE_WAITING  KK_UP(2)
+#define KK_PROMISE_SKIPPED  KK_UP(4)
+
+// The cancellation states
+#define KK_TASK_ACTIVE      KK_UP(0)
+#define KK_TASK_CANCELLED   KK_UP(1)
+#define KK_TASK_REVIVED     KK_UP(2)    // active, and not cancelled by its ancestors either
+
+typedef struct task_state_s {
+  _Atomic(uintptr_t)   state;      // KK_PROMISE_EMPTY, KK_PROMISE_WAITING, KK_PROMISE_SKIPPED, or the boxed result
+  _Atomic(kk_ssize_t)  refcount;   // references from the promise, the task, and the states of child tasks
+  _Atomic(uintptr_t)   cancelled;  // KK_TASK_ACTIVE, KK_TASK_CANCELLED, or KK_TASK_REVIVED
+  struct task_state_s* parent;     // state of the task that scheduled this task (or NULL)
+  kk_function_t        skipped;    // the function of a skipped task (valid if the state is KK_PROMISE_SKIPPED)
+} task_state_t;
+
 typedef struct promise_s {
-  kk_box_t        result;
-  pthread_mutex_t lock;
-  pthread_cond_t  available;
+  struct kk_cptr_raw_s  _raw;    // must be first; `_raw.cptr` points to the promise itself
+  task_state_t*         ts;
 } promise_t;
 
+static inline bool kk_promise_state_is_pending( uintptr_t state ) {
+  return (state == KK_PROMISE_EMPTY || state == KK_PROMISE_WAITING || state == KK_PROMISE_SKIPPED);
+}
 
-static kk_promise_t kk_promise_alloc( kk_context_t* ctx );
-static void         kk_promise_set( kk_promise_t pr, kk_box_t r, kk_context_t* ctx );
-// static bool         kk_promise_available( kk_promise_t pr, kk_context_t* ctx );
+static task_state_t* kk_task_state_alloc( task_state_t* parent, kk_context_t* ctx );
+static void          kk_task_state_release( task_state_t* ts, kk_context_t* ctx );
+static void          kk_task_state_set( task_state_t* ts, kk_box_t r, kk_context_t* ctx );
+static void          kk_task_state_skip( task_state_t* ts, kk_function_t fun, kk_context_t* ctx );
+static kk_promise_t  kk_promise_alloc( task_state_t* ts, kk_context_t* ctx );
+
+// Is a task (or any of its ancestors) cancelled?
+static bool kk_task_state_is_cancelled( const task_state_t* ts ) {
+  for (; ts != NULL; ts = ts->parent) {
+    const uintptr_t cancelled = kk_atomic_load_relaxed(&ts->cancelled);
+    if (cancelled == KK_TASK_CANCELLED) return true;
+    if (cancelled == KK_TASK_REVIVED) return false;
+  }
+  return false;
+}
 
 
 
@@ -159,58 +295,348 @@ static void         kk_promise_set( kk_promise_t pr, kk_box_t r, kk_context_t* c
   cpu-bound task
 ---------------------------------------------------------------------------*/
 
+struct kk_task_pool_s;
+
 typedef struct kk_task_s {
-  struct kk_task_s* next;
-  kk_function_t     fun;
-  kk_promise_t      promise;
+  struct kk_task_s*      next;
+  kk_function_t          fun;
+  task_state_t*          ts;       // shared with the promise (or NULL for a detached task)
+  struct kk_task_pool_s* pool;     // the pool that owns this task node
 } kk_task_t;
 
+
+/*---------------------------------------------------------------------------
+  task node pools
+  Tasks are usually allocated by the scheduling thread but executed and
+  freed by a worker. To avoid a cross-thread free for every task, each thread
+  allocates task nodes from its own pool in chunks. Tasks freed by another
+  thread are collected in a local batch and returned to the owning pool at
+  once through its lock-free `returned` list, which the owner reclaims when
+  its free list is empty. Chunks are never freed: the pool of an exiting
+  thread is abandoned and adopted by the next thread that needs one.
+---------------------------------------------------------------------------*/
+
+#define KK_TASK_CHUNK_COUNT  (256)   // task nodes per chunk
+#define KK_TASK_BATCH_MAX    (64)    // return tasks to another pool in batches of this size
+
+typedef struct kk_task_pool_s {
+  kk_task_t*             free;          // local free list (owner only)
+  _Atomic(kk_task_t*)    returned;      // tasks returned by other threads
+  struct kk_task_pool_s* next;          // next in the abandoned pools
+  struct kk_task_pool_s* batch_pool;    // the owner of the tasks in `batch`
+  kk_task_t*             batch;         // tasks freed by this thread that belong to `batch_pool`
+  kk_task_t*             batch_tail;
+  kk_ssize_t             batch_count;
+} kk_task_pool_t;
+
+static kk_decl_thread kk_task_pool_t* task_pool;
+static _Atomic(kk_task_pool_t*) task_pools_abandoned;
+
+// Push a list of pools or tasks on a lock-free stack (pushing is not subject to ABA)
+#define kk_task_stack_push(stack,head,tail) \
+  do { \
+    (tail)->next = kk_atomic_load_relaxed(stack); \
+  } while (!kk_atomic_cas_weak_acq_rel(stack, &(tail)->next, head))
+
+static void kk_task_pool_flush( kk_task_pool_t* pool ) {
+  if (pool->batch == NULL) return;
+  kk_task_stack_push(&pool->batch_pool->returned, pool->batch, pool->batch_tail);
+  pool->batch = NULL;
+  pool->batch_tail = NULL;
+  pool->batch_pool = NULL;
+  pool->batch_count = 0;
+}
+
+static kk_task_pool_t* kk_task_pool_current( kk_context_t* ctx ) {
+  kk_task_pool_t* pool = task_pool;
+  if (kk_likely(pool != NULL)) return pool;
+  // adopt an abandoned pool: take them all and push back the rest
+  pool = kk_atomic_exchange_acq_rel(&task_pools_abandoned, (kk_task_pool_t*)NULL);
+  if (pool != NULL) {
+    kk_task_pool_t* rest = pool->next;
+    if (rest != NULL) {
+      kk_task_pool_t* last = rest;
+      while (last->next != NULL) { last = last->next; }
+      kk_task_stack_push(&task_pools_abandoned, rest, last);
+    }
+    pool->next = NULL;
+  }
+  else {
+    pool = (kk_task_pool_t*)kk_zalloc(kk_ssizeof(kk_task_pool_t), ctx);
+    if (pool == NULL) return NULL;
+  }
+  task_pool = pool;
+  return pool;
+}
+
+// Abandon the pool of the current thread (called when a thread exits)
+static void kk_task_pool_abandon( void ) {
+  kk_task_pool_t* pool = task_pool;
+  if (pool == NULL) return;
+  task_pool = NULL;
+  kk_task_pool_flush(pool);
+  kk_task_stack_push(&task_pools_abandoned, pool, pool);
+}
+
+static kk_decl_noinline kk_task_t* kk_task_pool_refill( kk_task_pool_t* pool, kk_context_t* ctx ) {
+  kk_task_t* task = kk_atomic_exchange_acq_rel(&pool->returned, (kk_task_t*)NULL);
+  if (task != NULL) return task;
+  kk_task_t* chunk = (kk_task_t*)kk_malloc(KK_TASK_CHUNK_COUNT * kk_ssizeof(kk_task_t), ctx);
+  if (chunk == NULL) return NULL;
+  for (kk_ssize_t i = 0; i < KK_TASK_CHUNK_COUNT; i++) {
+    chunk[i].pool = pool;
+    chunk[i].next = (i + 1 < KK_TASK_CHUNK_COUNT ? &chunk[i+1] : NULL);
+  }
+  return chunk;
+}
+
+static kk_task_t* kk_task_node_alloc( kk_context_t* ctx ) {
+  kk_task_pool_t* pool = kk_task_pool_current(ctx);
+  if (pool == NULL) return NULL;
+  kk_task_t* task = pool->free;
+  if (kk_unlikely(task == NULL)) {
+    task = kk_task_pool_refill(pool, ctx);
+    if (task == NULL) return NULL;
+  }
+  pool->free = task->next;
+  return task;
+}
+
+static void kk_task_node_free( kk_task_t* task, kk_context_t* ctx ) {
+  kk_task_pool_t* owner = task->pool;
+  kk_task_pool_t* pool = task_pool;
+  if (kk_likely(owner == pool)) {
+    task->next = pool->free;
+    pool->free = task;
+    return;
+  }
+  if (pool == NULL) pool = kk_task_pool_current(ctx);
+  if (pool == NULL) {
+    kk_task_stack_push(&owner->returned, task, task);
+    return;
+  }
+  if (pool->batch_pool != owner) {
+    kk_task_pool_flush(pool);
+    pool->batch_pool = owner;
+    pool->batch_tail = task;
+  }
+  task->next = pool->batch;
+  pool->batch = task;
+  if (++pool->batch_count >= KK_TASK_BATCH_MAX) {
+    kk_task_pool_flush(pool);
+  }
+}
+
 static void kk_task_free( kk_task_t* task, kk_context_t* ctx ) {
-  kk_function_drop(task->fun,ctx);
-  kk_box_drop(task->promise,ctx);
-  kk_free(task,ctx);
+  if (task->fun != NULL) kk_function_drop(task->fun,ctx);
+  if (task->ts != NULL) kk_task_state_release(task->ts,ctx);
+  kk_task_node_free(task,ctx);
 }
 
-static kk_task_t* kk_task_alloc( kk_function_t fun, kk_promise_t p, kk_context_t* ctx ) {
-  kk_task_t* task = (kk_task_t*)kk_zalloc(kk_ssizeof(kk_task_t), ctx);
+static kk_task_t* kk_task_alloc( kk_function_t fun, task_state_t* ts, kk_context_t* ctx ) {
+  kk_task_t* task = kk_task_node_alloc(ctx);
   if (task == NULL) {
     kk_function_drop(fun,ctx);
-    kk_box_drop(p,ctx);
+    if (ts != NULL) kk_task_state_release(ts,ctx);
     return NULL;
   }
-  task->promise = p;
+  task->ts   = ts;
   task->fun  = fun;
   task->next = NULL;
   return task;
 }
 
 static void kk_task_exec( kk_task_t* task, kk_context_t* ctx ) {
+  task_state_t* ts = task->ts;
   if (task->fun != NULL) {
-    kk_function_dup(task->fun);      
-    kk_box_t res = kk_function_call(kk_box_t,(kk_function_t,kk_context_t*),task->fun,(task->fun,ctx));
-    kk_box_dup(task->promise);
-    kk_promise_set( task->promise, res, ctx );
+    if (kk_unlikely(ts != NULL && kk_task_state_is_cancelled(ts))) {
+      kk_task_state_skip(ts, task->fun, ctx);
+      task->fun = NULL;
+    }
+    else {
+      task_state_t* prev = ctx->task_current;
+      ctx->task_current = ts;
+      kk_probe1(task_start, task);
+      kk_function_dup(task->fun);
+      kk_box_t res = kk_function_call(kk_box_t,(kk_function_t,kk_context_t*),task->fun,(task->fun,ctx));
+      kk_probe1(task_done, task);
+      ctx->task_current = prev;
+      if (ts == NULL) {
+        kk_box_drop(res,ctx);           // detached task
+      }
+      else {
+        kk_task_state_set(ts, res, ctx);
+      }
+    }
   }
-  kk_task_free(task,ctx);  
+  kk_task_free(task,ctx);
 }
 
 
 /*---------------------------------------------------------------------------
-  task group (thread pool with task queue)
+  Work-stealing deque (Chase-Lev)
+  Each worker thread owns a deque of tasks; the owner pushes and pops at
+  the bottom (LIFO) while other workers steal from the top (FIFO).
+  We follow the C11 formulation of "Correct and Efficient Work-Stealing
+  for Weak Memory Models", Lê et al., PPoPP'13. Arrays that are replaced
+  when the deque grows may still be read by concurrent thieves, so they
+  are retired to a list and only freed with the task group.
 ---------------------------------------------------------------------------*/
 
+#define KK_TASK_DEQUE_INIT_SIZE  (64)   // must be a power of 2
+
+typedef struct kk_task_array_s {
+  struct kk_task_array_s* retired;   // previous (smaller) array
+  kk_ssize_t              mask;      // size - 1
+  _Atomic(kk_task_t*)     buf[1];    // buf[mask+1]
+} kk_task_array_t;
+
+typedef struct kk_task_deque_s {
+  _Atomic(kk_ssize_t)        top;
+  _Atomic(kk_ssize_t)        bottom;
+  _Atomic(kk_task_array_t*)  array;
+} kk_task_deque_t;
+
+static kk_task_array_t* kk_task_array_alloc( kk_ssize_t size, kk_task_array_t* retired, kk_context_t* ctx ) {
+  kk_assert((size & (size-1)) == 0);
+  kk_task_array_t* a = (kk_task_array_t*)kk_zalloc( kk_ssizeof(kk_task_array_t) + (size-1)*kk_ssizeof(kk_task_t*), ctx );
+  if (a == NULL) return NULL;
+  a->retired = retired;
+  a->mask = size - 1;
+  return a;
+}
+
+static bool kk_task_deque_init( kk_task_deque_t* q, kk_context_t* ctx ) {
+  kk_task_array_t* a = kk_task_array_alloc(KK_TASK_DEQUE_INIT_SIZE, NULL, ctx);
+  if (a == NULL) return false;
+  kk_atomic_store_relaxed(&q->top, 0);
+  kk_atomic_store_relaxed(&q->bottom, 0);
+  kk_atomic_store_relaxed(&q->array, a);
+  return true;
+}
+
+// Free the deque arrays; assumes no concurrent access and that the deque is empty.
+static void kk_task_deque_done( kk_task_deque_t* q, kk_context_t* ctx ) {
+  kk_task_array_t* a = kk_atomic_load_relaxed(&q->array);
+  while (a != NULL) {
+    kk_task_array_t* prev = a->retired;
+    kk_free(a,ctx);
+    a = prev;
+  }
+  kk_atomic_store_relaxed(&q->array, (kk_task_array_t*)NULL);
+}
+
+static kk_decl_noinline kk_task_array_t* kk_task_deque_grow( kk_task_deque_t* q, kk_task_array_t* a, kk_ssize_t top, kk_ssize_t bottom, kk_context_t* ctx ) {
+  kk_task_array_t* b = kk_task_array_alloc( 2*(a->mask+1), a, ctx );
+  if (b == NULL) return NULL;
+  for (kk_ssize_t i = top; i < bottom; i++) {
+    kk_atomic_store_relaxed(&b->buf[i & b->mask], kk_atomic_load_relaxed(&a->buf[i & a->mask]));
+  }
+  kk_atomic_store_release(&q->array, b);
+  return b;
+}
+
+// Push a task at the bottom (only called by the owner). Returns false if out of memory.
+static bool kk_task_deque_push( kk_task_deque_t* q, kk_task_t* task, kk_context_t* ctx ) {
+  const kk_ssize_t b = kk_atomic_load_relaxed(&q->bottom);
+  const kk_ssize_t t = kk_atomic_load_acquire(&q->top);
+  kk_task_array_t* a = kk_atomic_load_relaxed(&q->array);
+  if (kk_unlikely(b - t > a->mask)) {
+    a = kk_task_deque_grow(q, a, t, b, ctx);
+    if (a == NULL) return false;
+  }
+  kk_atomic_store_relaxed(&a->buf[b & a->mask], task);
+  kk_atomic_store_release(&q->bottom, b+1);   // publish the task to thieves
+  return true;
+}
+
+// Pop a task from the bottom (only called by the owner)
+static kk_task_t* kk_task_deque_pop( kk_task_deque_t* q ) {
+  const kk_ssize_t b = kk_atomic_load_relaxed(&q->bottom) - 1;
+  kk_task_array_t* a = kk_atomic_load_relaxed(&q->array);
+  kk_atomic_store_relaxed(&q->bottom, b);
+  kk_atomic_fence_seq_cst();
+  kk_ssize_t t = kk_atomic_load_relaxed(&q->top);
+  kk_task_t* task = NULL;
+  if (t <= b) {
+    task = kk_atomic_load_relaxed(&a->buf[b & a->mask]);
+    if (t == b) {
+      // last element: race against thieves
+      if (!kk_atomic_cas_strong_seq_cst(&q->top, &t, t+1)) {
+        task = NULL;  // lost the race
+      }
+      kk_atomic_store_relaxed(&q->bottom, b+1);
+    }
+  }
+  else {
+    // empty
+    kk_atomic_store_relaxed(&q->bottom, b+1);
+  }
+  return task;
+}
+
+// Steal a task from the top (called by any thread).
+// Returns NULL if the deque is empty, or if we lost a race (in which case `*retry` is set).
+static kk_task_t* kk_task_deque_steal( kk_task_deque_t* q, bool* retry ) {
+  kk_ssize_t t = kk_atomic_load_acquire(&q->top);
+  kk_atomic_fence_seq_cst();
+  const kk_ssize_t b = kk_atomic_load_acquire(&q->bottom);
+  if (t >= b) return NULL;  // empty
+  kk_task_array_t* a = kk_atomic_load_acquire(&q->array);
+  kk_task_t* task = kk_atomic_load_relaxed(&a->buf[t & a->mask]);
+  if (!kk_atomic_cas_strong_seq_cst(&q->top, &t, t+1)) {
+    *retry = true;
+    return NULL;
+  }
+  return task;
+}
+
+
+/*---------------------------------------------------------------------------
+  task group (thread pool with work-stealing task deques)
+  Each worker has its own deque. Tasks scheduled from a worker are pushed
+  on its own deque, while tasks scheduled from other threads (like the main
+  thread) go into a shared injection queue protected by `tasks_lock`.
+  Idle workers first pop from their own deque, then the injection queue,
+  and finally try to steal from other workers starting at a random victim.
+  When workers are pinned to cores, each worker also knows its NUMA node
+  and steals from workers on the same node first so that tasks (and the
+  memory they allocate) tend to stay local.
+  If no work is found, workers sleep on `tasks_available`; a scheduling
+  thread only takes the lock to wake up a worker if there are sleepers.
+---------------------------------------------------------------------------*/
+
+typedef struct kk_task_worker_s {
+  kk_task_deque_t   deque;
+  kk_task_group_t*  group;
+  uint32_t          rnd;          // random state for victim selection
+  int               cpu;          // the cpu to pin to (or -1)
+  int               node;         // NUMA node (0 if not pinned)
+  _Atomic(int64_t)  executed;     // statistics (only written by the worker, see `kk_task_stats`)
+  _Atomic(int64_t)  busy;         // usecs executing tasks
+  _Atomic(int64_t)  idle;         // usecs looking for tasks or sleeping
+} kk_task_worker_t;
+
 typedef struct kk_task_group_s {
-  bool            done;
-  kk_task_t*      tasks;
-  kk_task_t*      tasks_tail;
-  pthread_cond_t  tasks_available;
-  pthread_mutex_t tasks_lock;
-  pthread_t*      threads;
-  kk_ssize_t      thread_count;
+  _Atomic(bool)       done;
+  kk_task_t*          tasks;      // injection queue for non-worker threads
+  kk_task_t*          tasks_tail;
+  _Atomic(kk_ssize_t) tasks_count;
+  _Atomic(kk_ssize_t) sleepers;   // number of workers waiting on `tasks_available`
+  pthread_cond_t      tasks_available;
+  pthread_mutex_t     tasks_lock;
+  pthread_t*          threads;
+  kk_task_worker_t*   workers;
+  kk_ssize_t          thread_count;
+  int                 node_count; // number of NUMA nodes (1 if not pinned)
 } kk_task_group_t;
 
-static bool kk_tasks_is_empty( kk_task_group_t* tg ) {
-  return (tg->tasks == NULL);
+// The worker structure of the current thread (or NULL if this is not a worker thread)
+static kk_decl_thread kk_task_worker_t* task_worker;
+
+static kk_task_worker_t* kk_task_worker_current( kk_task_group_t* tg ) {
+  kk_task_worker_t* w = task_worker;
+  return (w != NULL && w->group == tg ? w : NULL);
 }
 
 static kk_task_t* kk_tasks_dequeue( kk_task_group_t* tg ) {
@@ -221,12 +647,12 @@ static kk_task_t* kk_tasks_dequeue( kk_task_group_t* tg ) {
       kk_assert(tg->tasks_tail == task);
       tg->tasks_tail = NULL; 
     }
+    kk_atomic_dec_relaxed(&tg->tasks_count);
   }
-  kk_assert(task != NULL || tg->done);
   return task;
 }
 
-static void kk_tasks_enqueue_n( kk_task_group_t* tg, kk_task_t* thead, kk_task_t* ttail, kk_context_t*  ctx ) {
+static void kk_tasks_enqueue_n( kk_task_group_t* tg, kk_task_t* thead, kk_task_t* ttail, kk_ssize_t count, kk_context_t*  ctx ) {
   kk_unused(ctx);
   if (tg->tasks_tail != NULL) {
     kk_assert(tg->tasks_tail->next == NULL);
@@ -236,42 +662,170 @@ static void kk_tasks_enqueue_n( kk_task_group_t* tg, kk_task_t* thead, kk_task_t
     tg->tasks = thead;
   }
   tg->tasks_tail = ttail;
+  kk_atomic_add_relaxed(&tg->tasks_count, count);
 }
 
 static void kk_tasks_enqueue( kk_task_group_t* tg, kk_task_t* task, kk_context_t* ctx ) {
-  kk_tasks_enqueue_n( tg, task, task, ctx );
+  kk_tasks_enqueue_n( tg, task, task, 1, ctx );
 }
 
-static kk_promise_t kk_task_group_schedule( kk_task_group_t* tg, kk_function_t fun, kk_context_t* ctx ) {
-  kk_promise_t p = kk_promise_alloc(ctx);
-  kk_task_t* task = kk_task_alloc(fun, kk_box_dup(p), ctx);
+// Dequeue from the injection queue (taking the lock only if it looks non-empty)
+static kk_task_t* kk_tasks_try_dequeue( kk_task_group_t* tg ) {
+  if (kk_atomic_load_relaxed(&tg->tasks_count) <= 0) return NULL;
   pthread_mutex_lock(&tg->tasks_lock);
-  kk_tasks_enqueue(tg,task,ctx);
+  kk_task_t* task = kk_tasks_dequeue(tg);
   pthread_mutex_unlock(&tg->tasks_lock);
-  pthread_cond_signal(&tg->tasks_available);  
+  return task;
+}
+
+static uint32_t kk_task_worker_random( kk_task_worker_t* w ) {
+  // xorshift32
+  uint32_t x = w->rnd;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  w->rnd = x;
+  return x;
+}
+
+// Try to steal a task from another worker, starting at a random victim.
+// With multiple NUMA nodes, a worker first tries the victims on its own node.
+static kk_task_t* kk_task_group_steal( kk_task_group_t* tg, kk_task_worker_t* self ) {
+  const kk_ssize_t n = tg->thread_count;
+  if (n <= 0) return NULL;
+  static _Atomic(uint32_t) steal_seed;   // random start for non-worker threads
+  const uint32_t r = (self != NULL ? kk_task_worker_random(self) : kk_atomic_inc_relaxed(&steal_seed));
+  const kk_ssize_t start = (kk_ssize_t)(r % (uint32_t)n);
+  const bool local_first = (self != NULL && tg->node_count > 1);
+  bool retry;
+  do {
+    retry = false;
+    for (int pass = (local_first ? 0 : 1); pass < 2; pass++) {
+      for (kk_ssize_t i = 0; i < n; i++) {
+        kk_task_worker_t* victim = &tg->workers[(start + i) % n];
+        if (victim == self) continue;
+        if (pass == 0 && victim->node != self->node) continue;
+        kk_task_t* task = kk_task_deque_steal(&victim->deque, &retry);
+        if (task != NULL) return task;
+      }
+    }
+  } while (retry);
+  return NULL;
+}
+
+// Find a task to run: first our own deque (LIFO), then the injection queue, and finally steal.
+static kk_task_t* kk_task_group_find( kk_task_group_t* tg, kk_task_worker_t* self ) {
+  kk_task_t* task = NULL;
+  if (self != NULL) {
+    task = kk_task_deque_pop(&self->deque);
+    if (task != NULL) return task;
+  }
+  task = kk_tasks_try_dequeue(tg);
+  if (task != NULL) return task;
+  return kk_task_group_steal(tg, self);
+}
+
+// Is there possibly any task available? (used before going to sleep)
+static bool kk_task_group_has_tasks( kk_task_group_t* tg ) {
+  if (kk_atomic_load_relaxed(&tg->tasks_count) > 0) return true;
+  for (kk_ssize_t i = 0; i < tg->thread_count; i++) {
+    kk_task_deque_t* q = &tg->workers[i].deque;
+    if (kk_atomic_load_acquire(&q->top) < kk_atomic_load_acquire(&q->bottom)) return true;
+  }
+  return false;
+}
+
+// Run a single pending task if one is available (used while waiting on a promise or lvar).
+static bool kk_task_group_try_exec( kk_task_group_t* tg, kk_context_t* ctx ) {
+  if (kk_atomic_load_relaxed(&tg->done)) return false;
+  kk_task_t* task = kk_task_group_find(tg, kk_task_worker_current(tg));
+  if (task == NULL) return false;
+  kk_task_exec(task, ctx);
+  return true;
+}
+
+static void kk_task_group_push( kk_task_group_t* tg, kk_task_t* task, kk_context_t* ctx ) {
+  if (task == NULL) return;
+  kk_task_worker_t* self = kk_task_worker_current(tg);
+  if (self == NULL || !kk_task_deque_push(&self->deque, task, ctx)) {
+    pthread_mutex_lock(&tg->tasks_lock);
+    kk_tasks_enqueue(tg,task,ctx);
+    pthread_mutex_unlock(&tg->tasks_lock);
+  }
+  // wake up a sleeping worker (pairs with the increment of `sleepers` in the worker)
+  kk_atomic_fence_seq_cst();
+  if (kk_atomic_load_relaxed(&tg->sleepers) > 0) {
+    pthread_mutex_lock(&tg->tasks_lock);
+    pthread_cond_signal(&tg->tasks_available);
+    pthread_mutex_unlock(&tg->tasks_lock);
+  }
+}
+
+// Schedule a task as a child of `parent` (for cancellation)
+static kk_promise_t kk_task_group_schedule( kk_task_group_t* tg, kk_function_t fun, task_state_t* parent, kk_context_t* ctx ) {
+  task_state_t* ts = kk_task_state_alloc(parent, ctx);
+  kk_promise_t p = kk_promise_alloc(ts, ctx);
+  kk_task_t* task = kk_task_alloc(fun, ts, ctx);
+  kk_probe1(task_schedule, task);
+  kk_task_group_push(tg, task, ctx);
   return p;
 }
 
-static void* kk_task_group_worker( void* vtg ) {
-  kk_task_group_t* tg = (kk_task_group_t*)vtg;
+// Pin the current thread to a cpu
+static void kk_thread_pin_to_cpu( int cpu ) {
+  if (cpu < 0) return;
+  #if defined(_WIN32)
+  if (cpu < 8*(int)sizeof(DWORD_PTR)) {
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+  }
+  #elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+  #endif
+}
+
+static void* kk_task_group_worker( void* vw ) {
+  kk_task_worker_t* w  = (kk_task_worker_t*)vw;
+  kk_task_group_t*  tg = w->group;
+  kk_thread_pin_to_cpu(w->cpu);       // before creating the context so its heap memory is first touched locally
   kk_context_t*    ctx = kk_get_context();
   ctx->task_group = tg;
-  while(true) {
-     // deqeue task
-     kk_task_t* task = NULL;
-     pthread_mutex_lock(&tg->tasks_lock);
-     while (kk_tasks_is_empty(tg) && !tg->done) {
-       pthread_cond_wait(&tg->tasks_available, &tg->tasks_lock);
-     }
-     task = kk_tasks_dequeue(tg);
-     pthread_mutex_unlock(&tg->tasks_lock);
-     if (task == NULL) {  // due to tg->done
-       break;
-     }
-     kk_task_exec(task,ctx);
-     // todo: ensure context is cleared again?
+  task_worker = w;
+  kk_timer_t t = kk_timer_start();
+  while(!kk_atomic_load_relaxed(&tg->done)) {
+    // find a task
+    kk_task_t* task = kk_task_group_find(tg, w);
+    if (task == NULL) {
+      // nothing found: apply our deferred drops (which may free blocks or schedule tasks)
+      // and return the tasks we freed to their pools
+      kk_block_drop_deferred_flush(ctx);
+      if (task_pool != NULL) kk_task_pool_flush(task_pool);
+      if (kk_task_group_has_tasks(tg)) continue;
+      // and go to sleep unless a task became available in the meantime
+      pthread_mutex_lock(&tg->tasks_lock);
+      kk_atomic_inc_relaxed(&tg->sleepers);
+      kk_atomic_fence_seq_cst();
+      if (!kk_task_group_has_tasks(tg) && !kk_atomic_load_relaxed(&tg->done)) {
+        pthread_cond_wait(&tg->tasks_available, &tg->tasks_lock);
+      }
+      kk_atomic_dec_relaxed(&tg->sleepers);
+      pthread_mutex_unlock(&tg->tasks_lock);
+      continue;
+    }
+    const kk_timer_t start = kk_timer_start();
+    kk_task_exec(task,ctx);
+    // todo: ensure context is cleared again?
+    const kk_timer_t end = kk_timer_start();
+    kk_atomic_store_relaxed(&w->idle, kk_atomic_load_relaxed(&w->idle) + (start - t));
+    kk_atomic_store_relaxed(&w->busy, kk_atomic_load_relaxed(&w->busy) + (end - start));
+    kk_atomic_store_relaxed(&w->executed, kk_atomic_load_relaxed(&w->executed) + 1);
+    t = end;
   }
+  task_worker = NULL;
   ctx->task_group = NULL;
+  kk_task_pool_abandon();
   kk_free_context();
   return NULL;
 }
@@ -279,35 +833,82 @@ static void* kk_task_group_worker( void* vtg ) {
 
 void kk_task_group_free( kk_task_group_t* tg, kk_context_t* ctx ) {
   if (tg==NULL) return;  
-  // set done state
-  kk_task_t* task = NULL;
-  tg->done = true;
+  // set done state and stop the threads
   pthread_mutex_lock(&tg->tasks_lock);
-  task = tg->tasks;
+  kk_atomic_store_release(&tg->done, true);
+  pthread_cond_broadcast(&tg->tasks_available);  // wake up all threads to make them exit
+  pthread_mutex_unlock(&tg->tasks_lock);
+  for( kk_ssize_t i = 0; i < tg->thread_count; i++) {
+    if (tg->threads[i] != 0) {
+      pthread_join_void(tg->threads[i]);
+    }
+  }
+  // free remaining tasks
+  kk_task_t* task = tg->tasks;
   tg->tasks = NULL;
   tg->tasks_tail = NULL;
-  tg->done = true;
-  pthread_mutex_unlock(&tg->tasks_lock);
-  // free tasks
   while( task != NULL ) {
     kk_task_t* next = task->next;
     kk_task_free(task,ctx);
     task = next;  
   }
-  // stop threads
-  pthread_cond_broadcast(&tg->tasks_available);  // pretend there are tasks to make the threads exit;
-  for( kk_ssize_t i = 0; i < tg->thread_count; i++) {
-    if (tg->threads[i] != 0) {
-      pthread_join_void(tg->threads[i]);
+  for (kk_ssize_t i = 0; i < tg->thread_count; i++) {
+    kk_task_deque_t* q = &tg->workers[i].deque;
+    while ((task = kk_task_deque_pop(q)) != NULL) {
+      kk_task_free(task,ctx);
     }
+    kk_task_deque_done(q,ctx);
   }
   pthread_cond_destroy(&tg->tasks_available);
   pthread_mutex_destroy(&tg->tasks_lock);
+  kk_free(tg->workers,ctx);
   kk_free(tg->threads,ctx);
   kk_free(tg,ctx);
 }
 
 static _Atomic(kk_ssize_t) default_concurrency;  // = 0
+static _Atomic(bool)       task_pin_workers;     // = false
+
+// Pin the task workers to cores (in NUMA node order); must be set before the first task is scheduled.
+void kk_task_set_pinning(bool pin, kk_context_t* ctx) {
+  kk_unused(ctx);
+  kk_atomic_store_release(&task_pin_workers, pin);
+}
+
+// Assign a cpu and NUMA node to each worker; consecutive workers fill up one node at a time.
+static void kk_task_group_assign_cpus( kk_task_group_t* tg, kk_ssize_t cpu_count, kk_context_t* ctx ) {
+  tg->node_count = 1;
+  if (!kk_atomic_load_acquire(&task_pin_workers) || cpu_count <= 1) {
+    for (kk_ssize_t i = 0; i < tg->thread_count; i++) { tg->workers[i].cpu = -1; }
+    return;
+  }
+  int* cpu_node = (int*)kk_malloc(cpu_count * kk_ssizeof(int), ctx);
+  int* cpus = (int*)kk_malloc(cpu_count * kk_ssizeof(int), ctx);
+  if (cpu_node == NULL || cpus == NULL) {
+    if (cpu_node != NULL) kk_free(cpu_node,ctx);
+    if (cpus != NULL) kk_free(cpus,ctx);
+    for (kk_ssize_t i = 0; i < tg->thread_count; i++) { tg->workers[i].cpu = -1; }
+    return;
+  }
+  const int node_count = kk_cpu_numa_nodes(cpu_node, (int)cpu_count, ctx);
+  kk_ssize_t k = 0;
+  for (int node = 0; node < node_count; node++) {
+    for (int cpu = 0; cpu < cpu_count; cpu++) {
+      if (cpu_node[cpu] == node) cpus[k++] = cpu;
+    }
+  }
+  for (int cpu = 0; cpu < cpu_count; cpu++) {  // cpus on nodes we did not find
+    if (cpu_node[cpu] < 0 || cpu_node[cpu] >= node_count) cpus[k++] = cpu;
+  }
+  for (kk_ssize_t i = 0; i < tg->thread_count; i++) {
+    kk_task_worker_t* w = &tg->workers[i];
+    w->cpu = cpus[i % k];
+    w->node = cpu_node[w->cpu];
+  }
+  tg->node_count = node_count;
+  kk_free(cpu_node,ctx);
+  kk_free(cpus,ctx);
+}
 
 void kk_task_set_default_concurrency(kk_ssize_t thread_cnt, kk_context_t* ctx) {
   const kk_ssize_t cpu_count = kk_cpu_count(ctx);
@@ -321,30 +922,46 @@ static kk_task_group_t* kk_task_group_alloc( kk_ssize_t thread_cnt, kk_context_t
     thread_cnt = kk_atomic_load_acquire(&default_concurrency);
   }
   const kk_ssize_t cpu_count = kk_cpu_count(ctx);
-  if (thread_cnt <= 0) { thread_cnt = cpu_count + (cpu_count > 16 ? cpu_count/4 : cpu_count/2); }
+  if (thread_cnt <= 0) { 
+    // oversubscribe a bit, except when pinning workers to cores
+    thread_cnt = (kk_atomic_load_acquire(&task_pin_workers) ? cpu_count : cpu_count + (cpu_count > 16 ? cpu_count/4 : cpu_count/2)); 
+  }
   if (thread_cnt > 8*cpu_count) { thread_cnt = 8*cpu_count; };  
   kk_task_group_t* tg = (kk_task_group_t*)kk_zalloc( kk_ssizeof(kk_task_group_t), ctx );
   if (tg==NULL) return NULL;
-  tg->threads = (pthread_t*)kk_zalloc( (thread_cnt+1) * sizeof(pthread_t), ctx );
+  tg->threads = (pthread_t*)kk_zalloc( (thread_cnt+1) * kk_ssizeof(pthread_t), ctx );
   if (tg->threads == NULL) goto err;
-  tg->thread_count = thread_cnt;
+  tg->workers = (kk_task_worker_t*)kk_zalloc( (thread_cnt+1) * kk_ssizeof(kk_task_worker_t), ctx );
+  if (tg->workers == NULL) goto err;
   tg->tasks = NULL;
   tg->tasks_tail = NULL;
+  for (kk_ssize_t i = 0; i < thread_cnt; i++) {
+    kk_task_worker_t* w = &tg->workers[i];
+    w->group = tg;
+    w->rnd = (uint32_t)(2654435761U * (uint32_t)(i+1));  // any non-zero seed
+    if (!kk_task_deque_init(&w->deque, ctx)) goto err;
+  }
+  tg->thread_count = thread_cnt;
+  kk_task_group_assign_cpus(tg, cpu_count, ctx);
   if (pthread_cond_init(&tg->tasks_available, NULL) != 0) goto err;
   if (pthread_mutex_init(&tg->tasks_lock, NULL) != 0) goto err;
   for (kk_ssize_t i = 0; i < tg->thread_count; i++) {
-    if (pthread_create(&tg->threads[i], NULL, &kk_task_group_worker, tg) != 0) {
+    if (pthread_create(&tg->threads[i], NULL, &kk_task_group_worker, &tg->workers[i]) != 0) {
       goto err_threads;
     };
   }
   return tg;
 
 err_threads:
-  tg->done = true;
+  kk_atomic_store_release(&tg->done, true);
   pthread_cond_broadcast(&tg->tasks_available); // makes threads exit
   
 err:
   if (tg != NULL) {
+    if (tg->workers != NULL) { 
+      for (kk_ssize_t i = 0; i < thread_cnt; i++) { kk_task_deque_done(&tg->workers[i].deque, ctx); }
+      kk_free(tg->workers,ctx); 
+    }
     if (tg->threads != NULL) { kk_free(tg->threads,ctx); }
     kk_free(tg,ctx); 
   }
@@ -358,6 +975,30 @@ static void kk_task_group_init(void) {
   task_group = kk_task_group_alloc(0,kk_get_context());
 }
 
+static _Atomic(int64_t) promise_waits;      // number of `kk_promise_get` calls on a pending promise
+static _Atomic(int64_t) promise_wait_usecs; // and the total time until the result was available
+
+// Statistics of the task group; these are read without synchronization and may be slightly off.
+void kk_task_stats( kk_task_stats_t* stats, kk_context_t* ctx ) {
+  kk_unused(ctx);
+  memset(stats, 0, sizeof(*stats));
+  stats->promise_waits = kk_atomic_load_relaxed(&promise_waits);
+  stats->promise_wait  = kk_atomic_load_relaxed(&promise_wait_usecs);
+  kk_task_group_t* tg = task_group;
+  if (tg == NULL) return;
+  stats->workers = tg->thread_count;
+  stats->queued  = kk_atomic_load_relaxed(&tg->tasks_count);
+  stats->sleeping = kk_atomic_load_relaxed(&tg->sleepers);
+  for (kk_ssize_t i = 0; i < tg->thread_count; i++) {
+    kk_task_worker_t* w = &tg->workers[i];
+    const kk_ssize_t n = kk_atomic_load_relaxed(&w->deque.bottom) - kk_atomic_load_relaxed(&w->deque.top);
+    if (n > 0) { stats->queued += n; }
+    stats->executed += kk_atomic_load_relaxed(&w->executed);
+    stats->busy     += kk_atomic_load_relaxed(&w->busy);
+    stats->idle     += kk_atomic_load_relaxed(&w->idle);
+  }
+}
+
 kk_promise_t kk_task_schedule( kk_function_t fun, kk_context_t* ctx ) {
   pthread_once( &task_group_once, &kk_task_group_init );
   kk_assert(task_group != NULL);
@@ -365,7 +1006,246 @@ kk_promise_t kk_task_schedule( kk_function_t fun, kk_context_t* ctx ) {
   if (ctx->task_group == NULL) { 
     ctx->task_group = task_group; // let main thread participate instead of blocking on a promise.get
   }
-  return kk_task_group_schedule( task_group, fun, ctx );
+  return kk_task_group_schedule( task_group, fun, (task_state_t*)ctx->task_current, ctx );
+}
+
+// Schedule a task without a promise; the result of the task is dropped.
+void kk_task_schedule_detached( kk_function_t fun, kk_context_t* ctx ) {
+  pthread_once( &task_group_once, &kk_task_group_init );
+  kk_assert(task_group != NULL);
+  kk_block_mark_shared( &fun->_block, ctx );
+  if (ctx->task_group == NULL) { 
+    ctx->task_group = task_group; 
+  }
+  kk_task_group_push( task_group, kk_task_alloc(fun, NULL, ctx), ctx );
+}
+
+
+/*---------------------------------------------------------------------------
+  parallel operations over vectors
+  The range of the vector is split into chunks where each chunk (but the
+  first) is scheduled as a task; the calling thread runs the first chunk
+  itself and then awaits the others (running other tasks in the meantime).
+  Unless a chunk size is given, we aim for about 8 chunks per thread so
+  that work-stealing can balance chunks of uneven cost. The job state is
+  shared by all chunk tasks; the input and functions are marked as shared
+  once up front instead of per task.
+---------------------------------------------------------------------------*/
+
+typedef enum kk_vector_par_kind_e {
+  KK_VECTOR_PAR_MAP,
+  KK_VECTOR_PAR_FOR,
+  KK_VECTOR_PAR_REDUCE
+} kk_vector_par_kind_t;
+
+typedef struct kk_vector_par_job_s {
+  kk_vector_par_kind_t kind;
+  kk_vector_t    v;          // input vector
+  kk_function_t  f;          // element function
+  kk_function_t  combine;    // reduce: combine two results (or NULL)
+  kk_box_t*      out;        // map: the elements of the result vector
+  kk_ssize_t     len;
+  kk_ssize_t     chunk;      // chunk size
+} kk_vector_par_job_t;
+
+static void kk_vector_par_job_free( void* p, kk_block_t* b, kk_context_t* ctx ) {
+  kk_unused(b);
+  kk_vector_par_job_t* job = (kk_vector_par_job_t*)p;
+  kk_vector_drop(job->v,ctx);
+  kk_function_drop(job->f,ctx);
+  if (job->combine != NULL) kk_function_drop(job->combine,ctx);
+  kk_free(job,ctx);
+}
+
+static kk_box_t kk_vector_par_apply( kk_vector_par_job_t* job, kk_box_t x, kk_context_t* ctx ) {
+  kk_function_dup(job->f);
+  return kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_context_t*),job->f,(job->f,x,ctx));
+}
+
+// Run chunk `i` of a job; for a reduction returns the combined result of the chunk.
+static kk_box_t kk_vector_par_run_chunk( kk_vector_par_job_t* job, kk_ssize_t i, bool shared, kk_context_t* ctx ) {
+  const kk_box_t* xs = kk_vector_buf_borrow(job->v, NULL);
+  const kk_ssize_t lo = i * job->chunk;
+  const kk_ssize_t hi = (lo + job->chunk > job->len ? job->len : lo + job->chunk);
+  kk_box_t acc = kk_box_null;
+  for (kk_ssize_t j = lo; j < hi; j++) {
+    kk_box_t y = kk_vector_par_apply(job, kk_box_dup(xs[j]), ctx);
+    switch (job->kind) {
+      case KK_VECTOR_PAR_MAP:
+        if (shared) kk_box_mark_shared(y,ctx);  // the result becomes visible to the calling thread
+        job->out[j] = y;
+        break;
+      case KK_VECTOR_PAR_FOR:
+        kk_box_drop(y,ctx);
+        break;
+      case KK_VECTOR_PAR_REDUCE:
+        if (j == lo) {
+          acc = y;
+        }
+        else {
+          kk_function_dup(job->combine);
+          acc = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),job->combine,(job->combine,acc,y,ctx));
+        }
+        break;
+    }
+  }
+  return (job->kind == KK_VECTOR_PAR_REDUCE ? acc : kk_unit_box(kk_Unit));
+}
+
+struct kk_vector_par_task_s {
+  struct kk_function_s _base;
+  kk_box_t   job;
+  kk_ssize_t chunk_index;   // not scanned
+};
+
+static kk_box_t kk_vector_par_task_fun( kk_function_t fself, kk_context_t* ctx ) {
+  struct kk_vector_par_task_s* t = kk_function_as(struct kk_vector_par_task_s*, fself);
+  kk_vector_par_job_t* job = (kk_vector_par_job_t*)kk_cptr_raw_unbox(t->job);
+  kk_box_t res = kk_vector_par_run_chunk(job, t->chunk_index, true, ctx);
+  kk_function_drop(fself,ctx);
+  return res;
+}
+
+// Run a job in parallel; for a reduction returns the combined results of all chunks
+// with `init` as the first (and consumes `init`).
+static kk_box_t kk_vector_par_run( kk_vector_par_job_t* job, kk_ssize_t chunk, kk_box_t init, kk_context_t* ctx ) {
+  pthread_once( &task_group_once, &kk_task_group_init );
+  kk_assert(task_group != NULL);
+  if (chunk <= 0) {
+    const kk_ssize_t parts = 8 * (task_group->thread_count + 1);
+    chunk = (job->len + parts - 1) / parts;
+    if (chunk <= 0) chunk = 1;
+  }
+  job->chunk = chunk;
+  const kk_ssize_t nchunks = (job->len + chunk - 1) / chunk;
+  kk_box_t jobbox = kk_cptr_raw_box(&kk_vector_par_job_free, job, ctx);
+  kk_box_t acc = init;
+  if (nchunks <= 1) {
+    // run sequentially
+    if (nchunks == 1) {
+      kk_box_t res = kk_vector_par_run_chunk(job, 0, false, ctx);
+      if (job->kind == KK_VECTOR_PAR_REDUCE) {
+        kk_function_dup(job->combine);
+        acc = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),job->combine,(job->combine,acc,res,ctx));
+      }
+      else {
+        kk_box_drop(res,ctx);
+      }
+    }
+    kk_box_drop(jobbox,ctx);
+    return acc;
+  }
+  // mark the input and functions as shared once (instead of traversing them for every task)
+  kk_block_mark_shared(kk_datatype_as_ptr(job->v), ctx);
+  kk_block_mark_shared(&job->f->_block, ctx);
+  if (job->combine != NULL) kk_block_mark_shared(&job->combine->_block, ctx);
+  kk_box_mark_shared(jobbox, ctx);
+  if (ctx->task_group == NULL) {
+    ctx->task_group = task_group;
+  }
+  kk_promise_t* ps = (kk_promise_t*)kk_malloc((nchunks - 1) * kk_ssizeof(kk_promise_t), ctx);
+  for (kk_ssize_t i = 1; i < nchunks; i++) {
+    struct kk_vector_par_task_s* t = kk_function_alloc_as(struct kk_vector_par_task_s, 2, ctx);
+    t->_base.fun = kk_cfun_ptr_box((kk_cfun_ptr_t)&kk_vector_par_task_fun, ctx);
+    t->job = kk_box_dup(jobbox);
+    t->chunk_index = i;
+    kk_block_mark_shared(&t->_base._block, ctx);  // only the closure itself (its fields are already shared)
+    ps[i-1] = kk_task_group_schedule(task_group, &t->_base, (task_state_t*)ctx->task_current, ctx);
+  }
+  kk_box_t res = kk_vector_par_run_chunk(job, 0, false, ctx);
+  for (kk_ssize_t i = 0; i < nchunks; i++) {
+    if (i > 0) res = kk_promise_get(ps[i-1], ctx);
+    if (job->kind == KK_VECTOR_PAR_REDUCE) {
+      kk_function_dup(job->combine);
+      acc = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),job->combine,(job->combine,acc,res,ctx));
+    }
+    else {
+      kk_box_drop(res,ctx);
+    }
+  }
+  kk_free(ps,ctx);
+  kk_box_drop(jobbox,ctx);
+  return acc;
+}
+
+static kk_vector_par_job_t* kk_vector_par_job_alloc( kk_vector_par_kind_t kind, kk_vector_t v, kk_function_t f, kk_function_t combine, kk_context_t* ctx ) {
+  kk_vector_par_job_t* job = (kk_vector_par_job_t*)kk_zalloc(kk_ssizeof(kk_vector_par_job_t), ctx);
+  job->kind = kind;
+  job->v = v;
+  job->f = f;
+  job->combine = combine;
+  job->len = kk_vector_len_borrow(v);
+  return job;
+}
+
+// Map `f` over the elements of `v` in parallel.
+kk_vector_t kk_vector_parallel_map( kk_vector_t v, kk_function_t f, kk_ssize_t chunk, kk_context_t* ctx ) {
+  kk_vector_par_job_t* job = kk_vector_par_job_alloc(KK_VECTOR_PAR_MAP, v, f, NULL, ctx);
+  kk_vector_t w = kk_vector_alloc_uninit(job->len, &job->out, ctx);
+  kk_vector_par_run(job, chunk, kk_box_null, ctx);
+  return w;
+}
+
+// Apply `f` to each element of `v` in parallel (and drop the results).
+void kk_vector_parallel_for( kk_vector_t v, kk_function_t f, kk_ssize_t chunk, kk_context_t* ctx ) {
+  kk_vector_par_job_t* job = kk_vector_par_job_alloc(KK_VECTOR_PAR_FOR, v, f, NULL, ctx);
+  kk_vector_par_run(job, chunk, kk_box_null, ctx);
+}
+
+// Map `f` over the elements of `v` in parallel and combine the results in order starting with `init`;
+// `combine` should be associative.
+kk_box_t kk_vector_parallel_reduce( kk_vector_t v, kk_box_t init, kk_function_t f, kk_function_t combine, kk_ssize_t chunk, kk_context_t* ctx ) {
+  kk_vector_par_job_t* job = kk_vector_par_job_alloc(KK_VECTOR_PAR_REDUCE, v, f, combine, ctx);
+  return kk_vector_par_run(job, chunk, init, ctx);
+}
+
+// The number of threads that run tasks (including the current one)
+kk_ssize_t kk_task_concurrency( kk_context_t* ctx ) {
+  kk_unused(ctx);
+  pthread_once( &task_group_once, &kk_task_group_init );
+  return (task_group->thread_count + 1);
+}
+
+struct kk_task_raw_s {
+  struct kk_function_s _base;
+  kk_task_raw_fun_t*   fun;     // not scanned
+  void*                env;
+  kk_ssize_t           index;
+};
+
+static kk_box_t kk_task_raw_fun( kk_function_t fself, kk_context_t* ctx ) {
+  struct kk_task_raw_s* t = kk_function_as(struct kk_task_raw_s*, fself);
+  (t->fun)(t->env, t->index, ctx);
+  kk_function_drop(fself,ctx);
+  return kk_unit_box(kk_Unit);
+}
+
+// Run `fun(env,i)` for `0 <= i < n` in parallel and wait for all of them. This is for C code
+// that does its own synchronization: `env` is passed as is to the other threads.
+void kk_task_parallel_for_raw( kk_ssize_t n, kk_task_raw_fun_t* fun, void* env, kk_context_t* ctx ) {
+  if (n <= 1) {
+    if (n == 1) fun(env, 0, ctx);
+    return;
+  }
+  pthread_once( &task_group_once, &kk_task_group_init );
+  if (ctx->task_group == NULL) {
+    ctx->task_group = task_group;
+  }
+  kk_promise_t* ps = (kk_promise_t*)kk_malloc((n - 1) * kk_ssizeof(kk_promise_t), ctx);
+  for (kk_ssize_t i = 1; i < n; i++) {
+    struct kk_task_raw_s* t = kk_function_alloc_as(struct kk_task_raw_s, 1, ctx);
+    t->_base.fun = kk_cfun_ptr_box((kk_cfun_ptr_t)&kk_task_raw_fun, ctx);
+    t->fun = fun;
+    t->env = env;
+    t->index = i;
+    kk_block_mark_shared(&t->_base._block, ctx);
+    ps[i-1] = kk_task_group_schedule(task_group, &t->_base, (task_state_t*)ctx->task_current, ctx);
+  }
+  fun(env, 0, ctx);
+  for (kk_ssize_t i = 1; i < n; i++) {
+    kk_box_drop(kk_promise_get(ps[i-1], ctx), ctx);
+  }
+  kk_free(ps,ctx);
 }
 
 
@@ -374,103 +1254,135 @@ kk_promise_t kk_task_schedule( kk_function_t fun, kk_context_t* ctx ) {
   blocking promise
 ---------------------------------------------------------------------------*/
 
+static task_state_t* kk_task_state_alloc( task_state_t* parent, kk_context_t* ctx ) {
+  task_state_t* ts = (task_state_t*)kk_malloc(kk_ssizeof(task_state_t), ctx);
+  if (ts == NULL) kk_fatal_error(ENOMEM, "unable to allocate a task");
+  kk_atomic_store_relaxed(&ts->state, KK_PROMISE_EMPTY);
+  kk_atomic_store_relaxed(&ts->refcount, 2);  // the promise and the task
+  kk_atomic_store_relaxed(&ts->cancelled, KK_TASK_ACTIVE);
+  ts->skipped = NULL;
+  ts->parent = parent;
+  if (parent != NULL) { kk_atomic_inc_relaxed(&parent->refcount); }
+  return ts;
+}
+
+static void kk_task_state_release( task_state_t* ts, kk_context_t* ctx ) {
+  while (ts != NULL && kk_atomic_sub_acq_rel(&ts->refcount, 1) == 1) {
+    const uintptr_t state = kk_atomic_load_acquire(&ts->state);
+    if (!kk_promise_state_is_pending(state)) {
+      kk_box_t result = { state };
+      kk_box_drop(result,ctx);
+    }
+    else if (state == KK_PROMISE_SKIPPED) {
+      kk_function_drop(ts->skipped,ctx);
+    }
+    task_state_t* parent = ts->parent;
+    kk_free(ts,ctx);
+    ts = parent;   // release the parent as well (without recursion)
+  }
+}
+
+static void kk_task_state_set( task_state_t* ts, kk_box_t r, kk_context_t* ctx ) {
+  kk_box_mark_shared(r,ctx);
+  const uintptr_t prev = kk_atomic_exchange_acq_rel(&ts->state, r.box);
+  kk_assert(prev == KK_PROMISE_EMPTY || prev == KK_PROMISE_WAITING);
+  if (prev == KK_PROMISE_WAITING) {
+    kk_wake_on_address_all(&ts->state);  // only make a system call if someone is blocked
+  }
+}
+
+// Skip a cancelled task but keep its function in case the promise is awaited anyway
+static void kk_task_state_skip( task_state_t* ts, kk_function_t fun, kk_context_t* ctx ) {
+  kk_unused(ctx);
+  ts->skipped = fun;
+  const uintptr_t prev = kk_atomic_exchange_acq_rel(&ts->state, KK_PROMISE_SKIPPED);
+  kk_assert(prev == KK_PROMISE_EMPTY || prev == KK_PROMISE_WAITING);
+  if (prev == KK_PROMISE_WAITING) {
+    kk_wake_on_address_all(&ts->state);  // so a waiting thread runs the task
+  }
+}
+
 static void kk_promise_free( void* vp, kk_block_t* b, kk_context_t* ctx ) {
   kk_unused(b);
   promise_t* p = (promise_t*)(vp);
-  pthread_cond_destroy(&p->available);
-  pthread_mutex_destroy(&p->lock);  
-  kk_box_drop(p->result,ctx);
-  kk_free(p,ctx);
-}
-
-static kk_promise_t kk_promise_alloc(kk_context_t* ctx) {
-  kk_promise_t pr;
-  promise_t* p = (promise_t*)kk_zalloc(kk_ssizeof(promise_t),ctx);
-  if (p == NULL) goto err;
-  p->result = kk_box_any(ctx);
-  if (pthread_mutex_init(&p->lock, NULL) != 0) goto err;
-  if (pthread_cond_init(&p->available, NULL) != 0) goto err;
-  pr = kk_cptr_raw_box( &kk_promise_free, p, ctx );
+  if (kk_promise_state_is_pending(kk_atomic_load_acquire(&p->ts->state))) {
+    kk_atomic_store_relaxed(&p->ts->cancelled, KK_TASK_CANCELLED);  // nobody can await the result anymore
+  }
+  kk_task_state_release(p->ts,ctx);
+  // note: the promise block itself is freed by the caller
+}
+
+static kk_promise_t kk_promise_alloc( task_state_t* ts, kk_context_t* ctx ) {
+  promise_t* p = kk_block_alloc_as(promise_t, 0, KK_TAG_CPTR_RAW, ctx);
+  p->_raw.free = &kk_promise_free;
+  p->_raw.cptr = p; 
+  p->ts = ts;
+  kk_promise_t pr = kk_ptr_box(&p->_raw._block);
   kk_box_mark_shared(pr,ctx);
   return pr;
-err:
-  kk_free(p,ctx);
-  return kk_box_any(ctx);
 }
 
-
-static void kk_promise_set( kk_promise_t pr, kk_box_t r, kk_context_t* ctx ) {
+bool kk_promise_available( kk_promise_t pr, kk_context_t* ctx ) {
   promise_t* p = (promise_t*)kk_cptr_raw_unbox(pr);
-  kk_box_mark_shared(r,ctx);
-  pthread_mutex_lock(&p->lock);
-  kk_box_drop(p->result,ctx);
-  p->result = r;
-  pthread_mutex_unlock(&p->lock);
-  pthread_cond_signal(&p->available);
+  const bool available = !kk_promise_state_is_pending(kk_atomic_load_acquire(&p->ts->state));
   kk_box_drop(pr,ctx);
+  return available;
 }
 
-/*
-static bool kk_promise_available( kk_promise_t pr, kk_context_t* ctx ) {
+// Cancel the task of a promise (and the tasks it scheduled)
+void kk_promise_cancel( kk_promise_t pr, kk_context_t* ctx ) {
   promise_t* p = (promise_t*)kk_cptr_raw_unbox(pr);
-  pthread_mutex_lock(&p->lock);
-  bool available = !kk_box_is_any(p->result);
-  pthread_mutex_unlock(&p->lock);
+  kk_atomic_store_relaxed(&p->ts->cancelled, KK_TASK_CANCELLED);
   kk_box_drop(pr,ctx);
-  return available;
 }
-*/
+
+// Is the currently running task cancelled? (always false outside a task)
+bool kk_task_is_cancelled( kk_context_t* ctx ) {
+  return kk_task_state_is_cancelled((const task_state_t*)ctx->task_current);
+}
 
 kk_box_t kk_promise_get( kk_promise_t pr, kk_context_t* ctx ) {  
   promise_t* p = (promise_t*)kk_cptr_raw_unbox(pr);
-  pthread_mutex_lock(&p->lock);
-  while (kk_box_is_any(p->result)) {
-    // if part of a task group, run other tasks while waiting
-    if (ctx->task_group != NULL) {
-      pthread_mutex_unlock(&p->lock);
-      // try to get a task
-      kk_task_group_t* tg = ctx->task_group;
-      kk_task_t* task = NULL;
-      pthread_mutex_lock(&tg->tasks_lock);
-      if (!kk_tasks_is_empty(tg) && !tg->done) {
-        task = kk_tasks_dequeue(tg);
-      }
-      pthread_mutex_unlock(&tg->tasks_lock);
-      // run task
-      if (task != NULL) { 
-        kk_task_exec(task, ctx);
-        pthread_mutex_lock(&p->lock);        
-      }
-      else {        
-        pthread_mutex_lock(&p->lock);
-        if (kk_box_is_any(p->result)) {
-          pthread_cond_wait( &p->available, &p->lock);
-        }
-        /*
-        // no task, block for a while
-        struct timespec tm;
-        clock_gettime(CLOCK_REALTIME, &tm);
-        tm.tv_nsec     +=  100000000;  // 0.1s
-        if (tm.tv_nsec >= 1000000000) {
-          tm.tv_nsec   -= 1000000000;
-          tm.tv_sec += 1;
-        }
-        pthread_mutex_lock(&p->lock);
-        if (kk_box_is_any(p->result)) {
-          if (pthread_cond_timedwait( &p->available, &p->lock, &tm) == ETIMEDOUT) {
-            pthread_mutex_lock(&p->lock); 
-          }
-        }
-        */        
+  task_state_t* ts = p->ts;
+  uintptr_t state = kk_atomic_load_acquire(&ts->state);
+  kk_timer_t start = 0;
+  if (kk_promise_state_is_pending(state)) {
+    kk_atomic_inc_relaxed(&promise_waits);
+    kk_probe1(promise_wait_start, ts);
+    start = kk_timer_start();
+  }
+  while (kk_promise_state_is_pending(state = kk_atomic_load_acquire(&ts->state))) {
+    // a skipped task is run by the first thread that awaits it
+    if (state == KK_PROMISE_SKIPPED) {
+      if (kk_atomic_cas_strong_acq_rel(&ts->state, &state, KK_PROMISE_EMPTY)) {
+        kk_function_t fun = ts->skipped;
+        ts->skipped = NULL;
+        kk_atomic_store_relaxed(&ts->cancelled, KK_TASK_REVIVED);  // we need the full result
+        task_state_t* prev = ctx->task_current;  // run as the task itself (as in `kk_task_exec`)
+        ctx->task_current = ts;
+        kk_box_t res = kk_function_call(kk_box_t,(kk_function_t,kk_context_t*),fun,(fun,ctx));
+        ctx->task_current = prev;
+        kk_task_state_set(ts, res, ctx);
       }
+      continue;
     }
-    // if in the main thread do a blocking wait
-    else {
-      pthread_cond_wait( &p->available, &p->lock );
+    // if part of a task group, run other tasks while waiting
+    if (ctx->task_group != NULL && kk_task_group_try_exec(ctx->task_group, ctx)) {
+      continue;
     }
+    // otherwise block until the result is set; first announce we are waiting
+    if (state == KK_PROMISE_EMPTY && !kk_atomic_cas_strong_acq_rel(&ts->state, &state, KK_PROMISE_WAITING)) {
+      continue;  // the state changed in the meantime
+    }
+    kk_wait_on_address(&ts->state, KK_PROMISE_WAITING);
+  }
+  if (start != 0) {
+    const kk_usecs_t usecs = kk_timer_end(start);
+    kk_atomic_add_relaxed(&promise_wait_usecs, usecs);
+    kk_probe2(promise_wait_done, ts, usecs);
   }
-  pthread_mutex_unlock(&p->lock);  
-  const kk_box_t result = kk_box_dup( p->result );
+  kk_box_t result = { state };
+  kk_box_dup(result);
   kk_box_drop(pr,ctx);
   return result;
 }
@@ -478,12 +1390,30 @@ kk_box_t kk_promise_get( kk_promise_t pr, kk_context_t* ctx ) {
 
 /*---------------------------------------------------------------------------
    Lvar
+   An lvar holds a thread-shared value in a single atomic word. A put reads
+   the current value, applies the monotonic combine, and installs the result
+   with a CAS (retrying if another put came first). A get only blocks (on the
+   `version` word) if the threshold is not reached yet; each put that changes
+   the value wakes up all waiters at once, and only if there are any.
+
+   Since a reader duplicates the value after loading it, a replaced value
+   cannot be dropped right away: it is retired instead and the retired values
+   are dropped once there are no readers in progress. (We take the retired
+   list before checking the readers, so any reader that could have loaded
+   a value in that list has finished.)
 ---------------------------------------------------------------------------*/
 
+typedef struct lvar_retired_s {
+  struct lvar_retired_s* next;
+  kk_box_t               value;
+} lvar_retired_t;
+
 typedef struct lvar_s {
-  kk_box_t        result;
-  pthread_mutex_t lock;
-  pthread_cond_t  available;
+  _Atomic(uintptr_t)       result;    // the boxed current value
+  _Atomic(uintptr_t)       version;   // incremented on every change of `result`
+  _Atomic(kk_ssize_t)      readers;   // readers in progress
+  _Atomic(kk_ssize_t)      waiters;   // threads blocked on `version`
+  _Atomic(lvar_retired_t*) retired;   // replaced values that may still be read
 } lvar_t;
 
 typedef kk_box_t kk_lvar_t;
@@ -493,40 +1423,108 @@ void      kk_lvar_put( kk_lvar_t lvar, kk_box_t val, kk_function_t monotonic_com
 kk_box_t  kk_lvar_get( kk_lvar_t lvar, kk_box_t bot, kk_function_t is_gte, kk_context_t* ctx );
 
 
+static void kk_lvar_retired_drop( lvar_retired_t* r, kk_context_t* ctx ) {
+  while (r != NULL) {
+    lvar_retired_t* next = r->next;
+    kk_box_drop(r->value,ctx);
+    kk_free(r,ctx);
+    r = next;
+  }
+}
+
 static void kk_lvar_free( void* lvar, kk_block_t* b, kk_context_t* ctx ) {
   kk_unused(b);
   lvar_t* lv = (lvar_t*)(lvar);
-  pthread_cond_destroy(&lv->available);
-  pthread_mutex_destroy(&lv->lock);  
-  kk_box_drop(lv->result,ctx);
+  kk_box_t result = { kk_atomic_load_acquire(&lv->result) };
+  kk_box_drop(result,ctx);
+  kk_lvar_retired_drop(kk_atomic_load_acquire(&lv->retired),ctx);
   kk_free(lv,ctx);
 }
 
 kk_lvar_t kk_lvar_alloc(kk_box_t init, kk_context_t* ctx) {
-  kk_lvar_t lvar;
   lvar_t* lv = (lvar_t*)kk_zalloc(kk_ssizeof(lvar_t),ctx);
-  if (lv == NULL) goto err;
-  lv->result = init;
-  if (pthread_mutex_init(&lv->lock, NULL) != 0) goto err;
-  if (pthread_cond_init(&lv->available, NULL) != 0) goto err;
-  lvar = kk_cptr_raw_box( &kk_lvar_free, lv, ctx );
+  if (lv == NULL) {
+    kk_box_drop(init,ctx);
+    return kk_box_any(ctx);
+  }
   kk_box_mark_shared(init,ctx);
+  kk_atomic_store_relaxed(&lv->result, init.box);
+  kk_lvar_t lvar = kk_cptr_raw_box( &kk_lvar_free, lv, ctx );
   kk_box_mark_shared(lvar,ctx);
   return lvar;
-err:
-  kk_free(lv,ctx);
-  kk_box_drop(init,ctx);
-  return kk_box_any(ctx);
 }
 
+// Drop the retired values if there are no readers in progress
+static void kk_lvar_reclaim( lvar_t* lv, kk_context_t* ctx ) {
+  if (kk_atomic_load_relaxed(&lv->retired) == NULL) return;
+  lvar_retired_t* r = kk_atomic_exchange_acq_rel(&lv->retired, (lvar_retired_t*)NULL);
+  if (r == NULL) return;
+  kk_atomic_fence_seq_cst();
+  if (kk_atomic_load_relaxed(&lv->readers) == 0) {
+    kk_lvar_retired_drop(r,ctx);
+  }
+  else {
+    // put them back
+    lvar_retired_t* last = r;
+    while (last->next != NULL) { last = last->next; }
+    kk_task_stack_push(&lv->retired, r, last);
+  }
+}
+
+// Read (and dup) the current value
+static kk_box_t kk_lvar_read( lvar_t* lv, kk_context_t* ctx ) {
+  kk_atomic_inc_relaxed(&lv->readers);
+  kk_atomic_fence_seq_cst();
+  kk_box_t v = { kk_atomic_load_acquire(&lv->result) };
+  kk_box_dup(v);
+  if (kk_atomic_sub_release(&lv->readers, 1) == 1) {
+    kk_lvar_reclaim(lv,ctx);
+  }
+  return v;
+}
+
+static void kk_lvar_retire( lvar_t* lv, kk_box_t v, kk_context_t* ctx ) {
+  if (!kk_box_is_ptr(v)) return;
+  lvar_retired_t* r = (lvar_retired_t*)kk_malloc(kk_ssizeof(lvar_retired_t),ctx);
+  r->value = v;
+  kk_task_stack_push(&lv->retired, r, r);
+  kk_lvar_reclaim(lv,ctx);
+}
 
 void kk_lvar_put( kk_lvar_t lvar, kk_box_t val, kk_function_t monotonic_combine, kk_context_t* ctx ) {
   lvar_t* lv = (lvar_t*)kk_cptr_raw_unbox(lvar);
-  pthread_mutex_lock(&lv->lock);
-  lv->result = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),monotonic_combine,(monotonic_combine,val,lv->result,ctx));
-  kk_box_mark_shared(lv->result,ctx);  // todo: can we mark outside the mutex?
-  pthread_mutex_unlock(&lv->lock);
-  pthread_cond_signal(&lv->available);
+  kk_box_mark_shared(val,ctx);
+  while (true) {
+    kk_box_t cur = kk_lvar_read(lv,ctx);
+    kk_box_dup(cur);     // keep `cur` alive until the CAS so its address cannot be reused
+    kk_box_dup(val);
+    kk_function_dup(monotonic_combine);
+    kk_box_t x = kk_function_call(kk_box_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),monotonic_combine,(monotonic_combine,val,cur,ctx));
+    if (x.box == cur.box) {
+      // no change
+      kk_box_drop(x,ctx);
+      kk_box_drop(cur,ctx);
+      break;
+    }
+    kk_box_mark_shared(x,ctx);
+    uintptr_t expect = cur.box;
+    if (kk_atomic_cas_strong_acq_rel(&lv->result, &expect, x.box)) {
+      kk_box_drop(cur,ctx);
+      kk_lvar_retire(lv,cur,ctx);   // the reference that was held by the lvar
+      // wake up all waiters (pairs with the increment of `waiters` in `kk_lvar_get`)
+      kk_atomic_inc_release(&lv->version);
+      kk_atomic_fence_seq_cst();
+      if (kk_atomic_load_relaxed(&lv->waiters) > 0) {
+        kk_wake_on_address_all(&lv->version);
+      }
+      break;
+    }
+    // another put came first: retry
+    kk_box_drop(x,ctx);
+    kk_box_drop(cur,ctx);
+  }
+  kk_box_drop(val,ctx);
+  kk_function_drop(monotonic_combine,ctx);
   kk_box_drop(lvar,ctx);
 }
 
@@ -534,63 +1532,261 @@ void kk_lvar_put( kk_lvar_t lvar, kk_box_t val, kk_function_t monotonic_combine,
 kk_box_t kk_lvar_get( kk_lvar_t lvar, kk_box_t bot, kk_function_t is_gte, kk_context_t* ctx ) {
   lvar_t* lv = (lvar_t*)kk_cptr_raw_unbox(lvar);
   kk_box_t result;
-  pthread_mutex_lock(&lv->lock);
   while (true) {
+    const uintptr_t version = kk_atomic_load_acquire(&lv->version);
+    result = kk_lvar_read(lv,ctx);
     kk_function_dup(is_gte);
-    kk_box_dup(lv->result);
+    kk_box_dup(result);
     kk_box_dup(bot);
-    int32_t done = kk_function_call(int32_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),is_gte,(is_gte,lv->result,bot,ctx));
-    if (done != 0) {
-      result = kk_box_dup(lv->result);
-      break;
-    }
+    int32_t done = kk_function_call(int32_t,(kk_function_t,kk_box_t,kk_box_t,kk_context_t*),is_gte,(is_gte,result,bot,ctx));
+    if (done != 0) break;
+    kk_box_drop(result,ctx);
     // if part of a task group, run other tasks while waiting
-    if (ctx->task_group != NULL) {
-      pthread_mutex_unlock(&lv->lock);
-      // try to get a task
-      kk_task_group_t* tg = ctx->task_group;
-      kk_task_t* task = NULL;
-      pthread_mutex_lock(&tg->tasks_lock);
-      if (!kk_tasks_is_empty(tg) && !tg->done) {
-        task = kk_tasks_dequeue(tg);
-      }
-      pthread_mutex_unlock(&tg->tasks_lock);
-      // run task
-      if (task != NULL) { 
-        kk_task_exec(task, ctx);
-        pthread_mutex_lock(&lv->lock);        
-      }
-      else {
-        pthread_mutex_lock(&lv->lock);
-        if (kk_box_is_any(lv->result)) {
-          pthread_cond_wait( &lv->available, &lv->lock);
-        }
-        /*
-        // no task, block for a while
-        struct timespec tm;
-        clock_gettime(CLOCK_REALTIME, &tm);
-        tm.tv_nsec     +=  100000000;  // 0.1s
-        if (tm.tv_nsec >= 1000000000) {
-          tm.tv_nsec   -= 1000000000;
-          tm.tv_sec += 1;
-        }
-        pthread_mutex_lock(&lv->lock);
-        if (kk_box_is_any(lv->result)) {
-          if (pthread_cond_timedwait( &lv->available, &lv->lock, &tm) == ETIMEDOUT) {
-            pthread_mutex_lock(&lv->lock); 
-          }
-        }
-        */        
-      }
+    if (ctx->task_group != NULL && kk_task_group_try_exec(ctx->task_group, ctx)) {
+      continue;
     }
-    // if in the main thread do a blocking wait
-    else {
-      pthread_cond_wait( &lv->available, &lv->lock );
+    // otherwise block until the value changes
+    kk_atomic_inc_relaxed(&lv->waiters);
+    kk_atomic_fence_seq_cst();
+    if (kk_atomic_load_relaxed(&lv->version) == version) {
+      kk_wait_on_address(&lv->version, version);
     }
+    kk_atomic_dec_relaxed(&lv->waiters);
   }
-  pthread_mutex_unlock(&lv->lock);  
   kk_box_drop(bot,ctx);
   kk_function_drop(is_gte,ctx);
   kk_box_drop(lvar,ctx);
   return result;
 }
+
+
+/*---------------------------------------------------------------------------
+   Channels
+   A channel is a bounded multi-producer multi-consumer queue of thread-shared
+   values. It is a ring buffer where each cell has a sequence number that tells
+   whether the cell is free for the sender at a position, or filled for the
+   receiver at that position (as in Dmitry Vyukov's bounded MPMC queue);
+   a position is claimed with a CAS on the send or receive position.
+   A batch claims a run of consecutive cells with a single CAS.
+   A blocked send or receive runs other tasks if it is part of a task group, and
+   otherwise waits on the `received` or `sent` counter that is incremented after
+   each operation (which only wakes up threads if there are any waiting).
+---------------------------------------------------------------------------*/
+
+#define KK_CHANNEL_MAX_CAPACITY  (KK_IP(1) << 30)
+#define KK_CHANNEL_HELP_MAX      (8)   // maximal tasks run by a blocked send or receive (see `kk_channel_wait`)
+
+typedef struct channel_cell_s {
+  _Atomic(size_t)     seq;
+  kk_box_t            value;
+} channel_cell_t;
+
+typedef struct channel_s {
+  size_t              mask;          // capacity - 1
+  _Atomic(size_t)     send_pos;
+  uint8_t             _pad1[64];     // keep the positions on separate cache lines
+  _Atomic(size_t)     recv_pos;
+  uint8_t             _pad2[64];
+  _Atomic(uintptr_t)  sent;          // incremented after each send (for blocked receivers)
+  _Atomic(uintptr_t)  received;      // incremented after each receive (for blocked senders)
+  _Atomic(kk_ssize_t) send_waiters;  // threads blocked on `received`
+  _Atomic(kk_ssize_t) recv_waiters;  // threads blocked on `sent`
+  channel_cell_t      cells[1];      // cells[mask+1]
+} channel_t;
+
+static void kk_channel_free( void* p, kk_block_t* b, kk_context_t* ctx ) {
+  kk_unused(b);
+  channel_t* ch = (channel_t*)p;
+  const size_t end = kk_atomic_load_acquire(&ch->send_pos);
+  for (size_t pos = kk_atomic_load_acquire(&ch->recv_pos); pos != end; pos++) {
+    kk_box_drop(ch->cells[pos & ch->mask].value, ctx);
+  }
+  kk_free(ch,ctx);
+}
+
+kk_channel_t kk_channel_alloc( kk_ssize_t capacity, kk_context_t* ctx ) {
+  kk_ssize_t cap = 2;
+  while (cap < capacity && cap < KK_CHANNEL_MAX_CAPACITY) { cap *= 2; }
+  channel_t* ch = (channel_t*)kk_zalloc(kk_ssizeof(channel_t) + (cap - 1)*kk_ssizeof(channel_cell_t), ctx);
+  if (ch == NULL) kk_fatal_error(ENOMEM, "unable to allocate a channel");
+  ch->mask = (size_t)cap - 1;
+  for (size_t i = 0; i < (size_t)cap; i++) {
+    kk_atomic_store_relaxed(&ch->cells[i].seq, i);
+  }
+  kk_channel_t channel = kk_cptr_raw_box( &kk_channel_free, ch, ctx );
+  kk_box_mark_shared(channel,ctx);
+  return channel;
+}
+
+// Claim up to `n` consecutive cells at `*pos` that are ready (sequence `pos + ready`, where
+// `ready` is 0 for sending and 1 for receiving). Returns the count, or 0 if the channel is full (or empty).
+static kk_ssize_t kk_channel_claim( channel_t* ch, _Atomic(size_t)* posp, size_t ready, kk_ssize_t n, size_t* first ) {
+  size_t pos = kk_atomic_load_relaxed(posp);
+  while (true) {
+    kk_ssize_t k = 0;
+    intptr_t dif = 0;
+    for (; k < n; k++) {
+      const size_t p = pos + (size_t)k;
+      dif = (intptr_t)(kk_atomic_load_acquire(&ch->cells[p & ch->mask].seq) - (p + ready));
+      if (dif != 0) break;
+    }
+    if (k > 0) {
+      if (kk_atomic_cas_weak_acq_rel(posp, &pos, pos + (size_t)k)) {
+        *first = pos;
+        return k;
+      }
+      // `pos` is updated: retry
+    }
+    else if (dif < 0) {
+      return 0;  // full (or empty)
+    }
+    else {
+      pos = kk_atomic_load_relaxed(posp);  // another thread claimed the position first
+    }
+  }
+}
+
+static void kk_channel_notify( _Atomic(uintptr_t)* counter, _Atomic(kk_ssize_t)* waiters ) {
+  // (pairs with the increment of `waiters` in `kk_channel_wait`)
+  kk_atomic_inc_release(counter);
+  kk_atomic_fence_seq_cst();
+  if (kk_atomic_load_relaxed(waiters) > 0) {
+    kk_wake_on_address_all(counter);
+  }
+}
+
+// A blocked send or receive runs other tasks in the meantime, but such task may itself wait
+// on the blocked thread (like a producer sending to a full channel that only the blocked
+// thread receives from) which then deadlocks. To limit this, a blocked operation runs at most
+// `KK_CHANNEL_HELP_MAX` tasks, and a task that is run this way does not run other tasks
+// when it blocks on a channel itself; otherwise we wait on the counter.
+static kk_decl_thread bool channel_helping;   // running a task from within `kk_channel_wait`
+
+// Run another task (if `*helped` is below the maximum), or block until `counter` is no longer `seen`
+static void kk_channel_wait( _Atomic(uintptr_t)* counter, uintptr_t seen, _Atomic(kk_ssize_t)* waiters, kk_ssize_t* helped, kk_context_t* ctx ) {
+  if (ctx->task_group != NULL && !channel_helping && *helped < KK_CHANNEL_HELP_MAX) {
+    channel_helping = true;
+    const bool ran = kk_task_group_try_exec(ctx->task_group, ctx);
+    channel_helping = false;
+    if (ran) {
+      (*helped)++;
+      return;
+    }
+  }
+  kk_atomic_inc_relaxed(waiters);
+  kk_atomic_fence_seq_cst();
+  if (kk_atomic_load_relaxed(counter) == seen) {
+    kk_wait_on_address(counter, seen);
+  }
+  kk_atomic_dec_relaxed(waiters);
+}
+
+// Send up to `n` values (that are thread-shared); returns the number sent (consuming those)
+static kk_ssize_t kk_channel_send_some( channel_t* ch, const kk_box_t* vs, kk_ssize_t n, bool block, kk_context_t* ctx ) {
+  size_t first = 0;
+  kk_ssize_t k;
+  kk_ssize_t helped = 0;
+  while (true) {
+    const uintptr_t seen = kk_atomic_load_acquire(&ch->received);
+    k = kk_channel_claim(ch, &ch->send_pos, 0, n, &first);
+    if (k > 0 || !block) break;
+    kk_channel_wait(&ch->received, seen, &ch->send_waiters, &helped, ctx);
+  }
+  if (k == 0) return 0;
+  for (kk_ssize_t i = 0; i < k; i++) {
+    channel_cell_t* cell = &ch->cells[(first + (size_t)i) & ch->mask];
+    cell->value = vs[i];
+    kk_atomic_store_release(&cell->seq, first + (size_t)i + 1);
+  }
+  kk_channel_notify(&ch->sent, &ch->recv_waiters);
+  return k;
+}
+
+// Receive up to `n` values into `vs`; returns the number received
+static kk_ssize_t kk_channel_recv_some( channel_t* ch, kk_box_t* vs, kk_ssize_t n, bool block, kk_context_t* ctx ) {
+  size_t first = 0;
+  kk_ssize_t k;
+  kk_ssize_t helped = 0;
+  while (true) {
+    const uintptr_t seen = kk_atomic_load_acquire(&ch->sent);
+    k = kk_channel_claim(ch, &ch->recv_pos, 1, n, &first);
+    if (k > 0 || !block) break;
+    kk_channel_wait(&ch->sent, seen, &ch->recv_waiters, &helped, ctx);
+  }
+  if (k == 0) return 0;
+  for (kk_ssize_t i = 0; i < k; i++) {
+    channel_cell_t* cell = &ch->cells[(first + (size_t)i) & ch->mask];
+    vs[i] = cell->value;
+    kk_atomic_store_release(&cell->seq, first + (size_t)i + ch->mask + 1);
+  }
+  kk_channel_notify(&ch->received, &ch->send_waiters);
+  return k;
+}
+
+void kk_channel_send( kk_channel_t channel, kk_box_t v, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  kk_box_mark_shared(v,ctx);
+  kk_channel_send_some(ch, &v, 1, true, ctx);
+  kk_box_drop(channel,ctx);
+}
+
+// Send without blocking; returns false (and drops `v`) if the channel is full
+bool kk_channel_try_send( kk_channel_t channel, kk_box_t v, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  kk_box_mark_shared(v,ctx);
+  const bool sent = (kk_channel_send_some(ch, &v, 1, false, ctx) == 1);
+  if (!sent) { kk_box_drop(v,ctx); }
+  kk_box_drop(channel,ctx);
+  return sent;
+}
+
+kk_box_t kk_channel_recv( kk_channel_t channel, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  kk_box_t v;
+  kk_channel_recv_some(ch, &v, 1, true, ctx);
+  kk_box_drop(channel,ctx);
+  return v;
+}
+
+// Receive without blocking; returns false if the channel is empty
+bool kk_channel_try_recv( kk_channel_t channel, kk_box_t* v, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  const bool received = (kk_channel_recv_some(ch, v, 1, false, ctx) == 1);
+  kk_box_drop(channel,ctx);
+  return received;
+}
+
+// Send all elements of a vector (in order, but possibly interleaved with other senders)
+void kk_channel_send_vector( kk_channel_t channel, kk_vector_t v, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  kk_ssize_t len;
+  kk_box_t* xs = kk_vector_buf_borrow(v, &len);
+  for (kk_ssize_t i = 0; i < len; i++) {
+    kk_box_dup(xs[i]);
+    kk_box_mark_shared(xs[i],ctx);
+  }
+  for (kk_ssize_t i = 0; i < len; ) {
+    i += kk_channel_send_some(ch, xs + i, len - i, true, ctx);
+  }
+  kk_vector_drop(v,ctx);
+  kk_box_drop(channel,ctx);
+}
+
+// Receive at least one and at most `max` elements (as available)
+kk_vector_t kk_channel_recv_vector( kk_channel_t channel, kk_ssize_t max, kk_context_t* ctx ) {
+  channel_t* ch = (channel_t*)kk_cptr_raw_unbox(channel);
+  kk_box_t buf[64];
+  kk_box_t* xs = buf;
+  if (max <= 0) { max = 1; }
+  if (max > 64) {
+    if (max > (kk_ssize_t)ch->mask + 1) { max = (kk_ssize_t)ch->mask + 1; }  // at most a full channel
+    xs = (kk_box_t*)kk_malloc(max * kk_ssizeof(kk_box_t), ctx);
+  }
+  const kk_ssize_t n = kk_channel_recv_some(ch, xs, max, true, ctx);
+  kk_box_t* elems;
+  kk_vector_t v = kk_vector_alloc_uninit(n, &elems, ctx);
+  kk_memcpy(elems, xs, n * kk_ssizeof(kk_box_t));
+  if (xs != buf) { kk_free(xs,ctx); }
+  kk_box_drop(channel,ctx);
+  return v;
+}
@@ -126,6 +126,135 @@ kk_decl_export kk_asecs_t kk_timer_resolution(kk_context_t* ctx) {
   return (KK_ASECS_PER_SEC / ctx->timer_freq);
 }
 
+/*--------------------------------------------------------------------------------------------------
+  Fast timer ticks
+  An opt-in cheap clock for fine grained instrumentation that returns raw ticks at `kk_timer_fast_freq`
+  ticks per second. It reads the time stamp counter on x64 (if it is invariant, and calibrated once
+  per process against `kk_timer_ticks_prim`) or the virtual counter on arm64. Otherwise it uses
+  a coarse monotonic clock (if available). Unlike `kk_timer_ticks` there is no monotonicity
+  adjustment through the context, and ticks are only comparable within the same process.
+--------------------------------------------------------------------------------------------------*/
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define KK_TIMER_FAST_COUNTER
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+static inline int64_t kk_timer_fast_counter(void) {
+  return (int64_t)__rdtsc();
+}
+
+static bool kk_timer_fast_counter_init(int64_t* freq, kk_context_t* ctx) {
+  // is the time stamp counter invariant? (CPUID.80000007H:EDX[8])
+  #if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, (int)0x80000000);
+  if ((unsigned)info[0] < 0x80000007) return false;
+  __cpuid(info, (int)0x80000007);
+  if ((info[3] & (1 << 8)) == 0) return false;
+  #else
+  unsigned int a, b, c, d;
+  if (__get_cpuid(0x80000007, &a, &b, &c, &d) == 0 || (d & (1 << 8)) == 0) return false;
+  #endif
+  // calibrate by measuring the counter against the high resolution timer for about 10ms
+  kk_asecs_t asecs0;
+  const kk_secs_t secs0 = kk_timer_ticks_prim(&asecs0, ctx);
+  const int64_t   t0 = kk_timer_fast_counter();
+  int64_t t1;
+  double  elapsed;
+  do {
+    kk_asecs_t asecs1;
+    const kk_secs_t secs1 = kk_timer_ticks_prim(&asecs1, ctx);
+    t1 = kk_timer_fast_counter();
+    elapsed = (double)(secs1 - secs0) + (double)(asecs1 - asecs0) * 1e-18;
+  } while (elapsed < 0.01);
+  if (t1 <= t0) return false;
+  *freq = (int64_t)((double)(t1 - t0) / elapsed);
+  return (*freq > 0);
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define KK_TIMER_FAST_COUNTER
+
+static inline int64_t kk_timer_fast_counter(void) {
+  uint64_t t;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+  return (int64_t)t;
+}
+
+static bool kk_timer_fast_counter_init(int64_t* freq, kk_context_t* ctx) {
+  kk_unused(ctx);
+  uint64_t f;
+  __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(f));
+  *freq = (int64_t)f;
+  return (*freq > 0);
+}
+#endif
+
+// used if there is no (invariant) counter
+static int64_t kk_timer_fast_fallback(int64_t* freq, kk_context_t* ctx) {
+  #if defined(WIN32)
+  kk_unused(ctx);
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  if (freq != NULL) {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    *freq = (f.QuadPart > 0 ? f.QuadPart : 1000);
+  }
+  return t.QuadPart;
+  #elif defined(CLOCK_MONOTONIC_COARSE)
+  kk_unused(ctx);
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+  if (freq != NULL) { *freq = KK_NSECS_PER_SEC; }
+  return ((int64_t)t.tv_sec * KK_NSECS_PER_SEC) + t.tv_nsec;
+  #else
+  kk_asecs_t asecs;
+  const kk_secs_t secs = kk_timer_ticks_prim(&asecs, ctx);
+  if (freq != NULL) { *freq = KK_NSECS_PER_SEC; }
+  return (secs * KK_NSECS_PER_SEC) + (asecs / KK_ASECS_PER_NSEC);
+  #endif
+}
+
+// The fast timer is process wide: `kk_timer_fast_kind` is 0 if uninitialized, 1 for the counter, and 2 for the fallback.
+static _Atomic(int64_t) kk_timer_fast_frequency; // = 0
+static _Atomic(int)     kk_timer_fast_kind;      // = 0
+
+static void kk_timer_fast_init(kk_context_t* ctx) {
+  int64_t freq = 0;
+  int kind = 2;
+  #if defined(KK_TIMER_FAST_COUNTER)
+  if (kk_timer_fast_counter_init(&freq, ctx)) { kind = 1; }
+  #endif
+  if (kind == 2) { kk_timer_fast_fallback(&freq, ctx); }
+  // racing threads compute the same kind (and a nearly equal frequency)
+  kk_atomic_store_relaxed(&kk_timer_fast_frequency, freq);
+  kk_atomic_store_release(&kk_timer_fast_kind, kind);
+}
+
+kk_decl_export int64_t kk_timer_fast_ticks(kk_context_t* ctx) {
+  int kind = kk_atomic_load_relaxed(&kk_timer_fast_kind);
+  #if defined(KK_TIMER_FAST_COUNTER)
+  if (kk_likely(kind == 1)) return kk_timer_fast_counter();
+  #endif
+  if (kk_unlikely(kind == 0)) {
+    kk_timer_fast_init(ctx);
+    return kk_timer_fast_ticks(ctx);
+  }
+  return kk_timer_fast_fallback(NULL, ctx);
+}
+
+kk_decl_export int64_t kk_timer_fast_freq(kk_context_t* ctx) {
+  if (kk_atomic_load_acquire(&kk_timer_fast_kind) == 0) { kk_timer_fast_init(ctx); }
+  return kk_atomic_load_relaxed(&kk_timer_fast_frequency);
+}
+
+
 /*--------------------------------------------------------------------------------------------------
   Current Time
 --------------------------------------------------------------------------------------------------*/
@@ -31,7 +31,45 @@ void kk_vector_init_borrow(kk_vector_t _v, kk_ssize_t start, kk_box_t def, kk_co
   }
 }
 
+// Set the length of a unique vector (with `len <= capacity`)
+static void kk_vector_set_length_borrow(kk_vector_large_t v, kk_ssize_t len) {
+  kk_assert_internal(len > 0 && len <= (kk_ssize_t)kk_intf_unbox(v->capacity));
+  const kk_ssize_t scan_fsize = len + 2;
+  v->_base._block.header.scan_fsize = (scan_fsize >= KK_SCAN_FSIZE_MAX ? KK_SCAN_FSIZE_MAX : (uint8_t)scan_fsize);
+  v->_base.large_scan_fsize = kk_intf_box(scan_fsize);
+}
+
+// Grow the capacity geometrically so repeatedly pushing an element takes amortized constant time
+static kk_ssize_t kk_vector_grow_capacity(kk_ssize_t capacity, kk_ssize_t newlen) {
+  const kk_ssize_t grow = (capacity < 1024 ? 2*capacity : capacity + capacity/2);
+  return (grow > newlen ? grow : newlen);
+}
+
 kk_vector_t kk_vector_realloc(kk_vector_t vec, kk_ssize_t newlen, kk_box_t def, kk_context_t* ctx) {
+  kk_vector_large_t v = kk_vector_as_large_borrow(vec);
+  if (v != NULL && newlen > 0 && kk_datatype_is_unique(vec)) {
+    // fast path: resize in place and move the elements without touching their reference counts
+    kk_ssize_t len;
+    kk_box_t* src = kk_vector_buf_borrow(vec, &len);
+    if (newlen <= len) {
+      for (kk_ssize_t i = newlen; i < len; i++) {
+        kk_box_drop(src[i], ctx);
+      }
+      kk_vector_set_length_borrow(v, newlen);
+      kk_box_drop(def, ctx);
+      return vec;
+    }
+    const kk_ssize_t capacity = (kk_ssize_t)kk_intf_unbox(v->capacity);
+    if (newlen > capacity) {
+      const kk_ssize_t newcap = kk_vector_grow_capacity(capacity, newlen);
+      v = (kk_vector_large_t)kk_block_realloc(&v->_base._block, kk_ssizeof(struct kk_vector_large_s) + (newcap-1)*kk_ssizeof(kk_box_t), ctx);
+      v->capacity = kk_intf_box(newcap);
+      vec = kk_datatype_from_base(&v->_base);
+    }
+    kk_vector_set_length_borrow(v, newlen);
+    kk_vector_init_borrow(vec, len, def, ctx); // set extra entries to default value
+    return vec;
+  }
   kk_ssize_t len;
   kk_box_t* src = kk_vector_buf_borrow(vec, &len);
   kk_box_t* dest;
@@ -45,6 +83,7 @@ kk_vector_t kk_vector_realloc(kk_vector_t vec, kk_ssize_t newlen, kk_box_t def,
   return vdest;
 }
 
+// Returns `vec` itself if it is unique and only copies when it is shared
 kk_vector_t kk_vector_copy(kk_vector_t vec, kk_context_t* ctx) {
   kk_ssize_t len = kk_vector_len_borrow(vec);
   return kk_vector_realloc(vec, len, kk_box_null, ctx);
@@ -72,4 +111,201 @@ kk_unit_t kk_ref_vector_assign_borrow(kk_ref_t r, kk_integer_t idx, kk_box_t val
     kk_unsupported_external("kk_ref_vector_assign with a thread-shared reference");
   }
   return kk_Unit;
-}
\ No newline at end of file
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Unboxed vectors (see `kklib/uvector.h`)
+  Sums and dot products use four independent accumulators so the loops can be vectorized
+  (and pipelined) without reassociating the floating point operations across the whole vector;
+  the result is deterministic for a given length.
+--------------------------------------------------------------------------------------------------*/
+
+kk_box_t kk_uvector_alloc_uninit(kk_ssize_t len, kk_ssize_t elem_size, void** buf, kk_context_t* ctx) {
+  if (len < 0) len = 0;
+  kk_uvector_t u = (kk_uvector_t)kk_block_alloc(kk_ssizeof(struct kk_uvector_s) - kk_ssizeof(uint64_t) + len*elem_size, 0, KK_TAG_UVECTOR, ctx);
+  u->length = len;
+  u->elem_size = elem_size;
+  if (buf != NULL) *buf = &u->data[0];
+  return kk_ptr_box(&u->_block);
+}
+
+kk_box_t kk_uvector_slice(kk_box_t v, kk_ssize_t start, kk_ssize_t len, kk_context_t* ctx) {
+  kk_uvector_t u = kk_uvector_unbox_borrow(v);
+  if (start < 0) start = 0;
+  if (start > u->length) start = u->length;
+  if (len > u->length - start) len = u->length - start;
+  if (len < 0) len = 0;
+  if (start == 0 && len == u->length) return v;
+  void* buf;
+  kk_box_t w = kk_uvector_alloc_uninit(len, u->elem_size, &buf, ctx);
+  kk_memcpy(buf, (const uint8_t*)&u->data[0] + start*u->elem_size, len*u->elem_size);
+  kk_box_drop(v, ctx);
+  return w;
+}
+
+kk_box_t kk_uvector_copy(kk_box_t v, kk_context_t* ctx) {
+  kk_uvector_t u = kk_uvector_unbox_borrow(v);
+  void* buf;
+  kk_box_t w = kk_uvector_alloc_uninit(u->length, u->elem_size, &buf, ctx);
+  kk_memcpy(buf, &u->data[0], u->length*u->elem_size);
+  kk_box_drop(v, ctx);
+  return w;
+}
+
+kk_box_t kk_uvector_append(kk_box_t v, kk_box_t w, kk_context_t* ctx) {
+  kk_uvector_t u1 = kk_uvector_unbox_borrow(v);
+  kk_uvector_t u2 = kk_uvector_unbox_borrow(w);
+  kk_assert(u1->elem_size == u2->elem_size);
+  uint8_t* buf;
+  kk_box_t r = kk_uvector_alloc_uninit(u1->length + u2->length, u1->elem_size, (void**)&buf, ctx);
+  kk_memcpy(buf, &u1->data[0], u1->length*u1->elem_size);
+  kk_memcpy(buf + u1->length*u1->elem_size, &u2->data[0], u2->length*u2->elem_size);
+  kk_box_drop(v, ctx);
+  kk_box_drop(w, ctx);
+  return r;
+}
+
+// Koka functions over elements take and return the (unboxed) Koka element type `ktp`;
+// the elements of a `uint8` vector are an `int` in Koka (clamped to [0,255])
+#define kk_uvector_id(x,ctx)  (x)
+
+static inline kk_integer_t kk_uint8_to_integer(uint8_t x, kk_context_t* ctx) {
+  kk_unused(ctx);
+  return kk_integer_from_small(x);
+}
+
+static inline uint8_t kk_uint8_from_integer(kk_integer_t i, kk_context_t* ctx) {
+  return kk_uint8_clamp32(kk_integer_clamp32(i, ctx));
+}
+
+static inline kk_box_t kk_uint8_box(uint8_t x, kk_context_t* ctx) {
+  return kk_integer_box(kk_uint8_to_integer(x, ctx));
+}
+
+static inline uint8_t kk_uint8_unbox(kk_box_t b, kk_context_t* ctx) {
+  return kk_uint8_from_integer(kk_integer_unbox(b), ctx);
+}
+
+#define kk_uvector_define(name,tp,ktp,to_ktp,from_ktp,box,unbox) \
+  kk_box_t kk_uvector_##name##_alloc(kk_ssize_t len, tp init, kk_context_t* ctx) { \
+    tp* p; \
+    kk_box_t v = kk_uvector_alloc_uninit(len, kk_ssizeof(tp), (void**)&p, ctx); \
+    for (kk_ssize_t i = 0; i < len; i++) { p[i] = init; } \
+    return v; \
+  } \
+  kk_box_t kk_uvector_##name##_fill(kk_box_t v, tp x, kk_context_t* ctx) { \
+    v = kk_uvector_unique(v, ctx); \
+    kk_ssize_t len; \
+    tp* p = (tp*)kk_uvector_buf_borrow(v, &len); \
+    for (kk_ssize_t i = 0; i < len; i++) { p[i] = x; } \
+    return v; \
+  } \
+  kk_box_t kk_uvector_##name##_map(kk_box_t v, kk_function_t f, kk_context_t* ctx) { \
+    v = kk_uvector_unique(v, ctx); \
+    kk_ssize_t len; \
+    tp* p = (tp*)kk_uvector_buf_borrow(v, &len); \
+    for (kk_ssize_t i = 0; i < len; i++) { \
+      kk_function_dup(f); \
+      p[i] = from_ktp(kk_function_call(ktp,(kk_function_t,ktp,kk_context_t*),f,(f,to_ktp(p[i],ctx),ctx)),ctx); \
+    } \
+    kk_function_drop(f, ctx); \
+    return v; \
+  } \
+  kk_box_t kk_uvector_##name##_init(kk_ssize_t len, kk_function_t f, kk_context_t* ctx) { \
+    tp* p; \
+    kk_box_t v = kk_uvector_alloc_uninit(len, kk_ssizeof(tp), (void**)&p, ctx); \
+    for (kk_ssize_t i = 0; i < len; i++) { \
+      kk_function_dup(f); \
+      p[i] = from_ktp(kk_function_call(ktp,(kk_function_t,kk_ssize_t,kk_context_t*),f,(f,i,ctx)),ctx); \
+    } \
+    kk_function_drop(f, ctx); \
+    return v; \
+  } \
+  kk_box_t kk_uvector_##name##_from_vector(kk_vector_t vec, kk_context_t* ctx) { \
+    kk_ssize_t len; \
+    kk_box_t* src = kk_vector_buf_borrow(vec, &len); \
+    tp* p; \
+    kk_box_t v = kk_uvector_alloc_uninit(len, kk_ssizeof(tp), (void**)&p, ctx); \
+    for (kk_ssize_t i = 0; i < len; i++) { p[i] = unbox(kk_box_dup(src[i]),ctx); } \
+    kk_vector_drop(vec, ctx); \
+    return v; \
+  } \
+  kk_vector_t kk_uvector_##name##_to_vector(kk_box_t v, kk_context_t* ctx) { \
+    kk_ssize_t len; \
+    const tp* p = (const tp*)kk_uvector_buf_borrow(v, &len); \
+    kk_box_t* dest; \
+    kk_vector_t vec = kk_vector_alloc_uninit(len, &dest, ctx); \
+    for (kk_ssize_t i = 0; i < len; i++) { dest[i] = box(p[i],ctx); } \
+    kk_box_drop(v, ctx); \
+    return vec; \
+  }
+
+kk_uvector_define(float64, double, double, kk_uvector_id, kk_uvector_id, kk_double_box, kk_double_unbox)
+kk_uvector_define(int64, int64_t, int64_t, kk_uvector_id, kk_uvector_id, kk_int64_box, kk_int64_unbox)
+kk_uvector_define(int32, int32_t, int32_t, kk_uvector_id, kk_uvector_id, kk_int32_box, kk_int32_unbox)
+kk_uvector_define(uint8, uint8_t, kk_integer_t, kk_uint8_to_integer, kk_uint8_from_integer, kk_uint8_box, kk_uint8_unbox)
+
+#define kk_uvector_define_sum(name,tp,acctp) \
+  acctp kk_uvector_##name##_sum_borrow(kk_box_t v) { \
+    kk_ssize_t len; \
+    const tp* p = (const tp*)kk_uvector_buf_borrow(v, &len); \
+    acctp s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+    kk_ssize_t i = 0; \
+    for (; i + 4 <= len; i += 4) { \
+      s0 += (acctp)p[i]; s1 += (acctp)p[i+1]; s2 += (acctp)p[i+2]; s3 += (acctp)p[i+3]; \
+    } \
+    for (; i < len; i++) { s0 += (acctp)p[i]; } \
+    return ((s0 + s1) + (s2 + s3)); \
+  }
+
+#define kk_uvector_define_dot(name,tp,acctp) \
+  acctp kk_uvector_##name##_dot_borrow(kk_box_t v, kk_box_t w) { \
+    kk_ssize_t len1, len2; \
+    const tp* p = (const tp*)kk_uvector_buf_borrow(v, &len1); \
+    const tp* q = (const tp*)kk_uvector_buf_borrow(w, &len2); \
+    const kk_ssize_t len = (len1 < len2 ? len1 : len2); \
+    acctp s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+    kk_ssize_t i = 0; \
+    for (; i + 4 <= len; i += 4) { \
+      s0 += (acctp)p[i]*(acctp)q[i];     s1 += (acctp)p[i+1]*(acctp)q[i+1]; \
+      s2 += (acctp)p[i+2]*(acctp)q[i+2]; s3 += (acctp)p[i+3]*(acctp)q[i+3]; \
+    } \
+    for (; i < len; i++) { s0 += (acctp)p[i]*(acctp)q[i]; } \
+    return ((s0 + s1) + (s2 + s3)); \
+  }
+
+// integer sums wrap around, so we accumulate as unsigned to avoid undefined behavior
+kk_uvector_define_sum(float64, double, double)
+kk_uvector_define_dot(float64, double, double)
+
+#define kk_uvector_define_isum(name,tp) \
+  static kk_uvector_define_sum(name##_u, tp, uint64_t) \
+  int64_t kk_uvector_##name##_sum_borrow(kk_box_t v) { return (int64_t)kk_uvector_##name##_u_sum_borrow(v); }
+#define kk_uvector_define_idot(name,tp) \
+  static kk_uvector_define_dot(name##_u, tp, uint64_t) \
+  int64_t kk_uvector_##name##_dot_borrow(kk_box_t v, kk_box_t w) { return (int64_t)kk_uvector_##name##_u_dot_borrow(v, w); }
+
+kk_uvector_define_isum(int64, int64_t)
+kk_uvector_define_idot(int64, int64_t)
+kk_uvector_define_isum(int32, int32_t)
+kk_uvector_define_idot(int32, int32_t)
+kk_uvector_define_isum(uint8, uint8_t)
+
+kk_box_t kk_uvector_float64_scale(kk_box_t v, double a, kk_context_t* ctx) {
+  v = kk_uvector_unique(v, ctx);
+  kk_ssize_t len;
+  double* p = (double*)kk_uvector_buf_borrow(v, &len);
+  for (kk_ssize_t i = 0; i < len; i++) { p[i] *= a; }
+  return v;
+}
+
+kk_box_t kk_uvector_float64_axpy(double a, kk_box_t v, kk_box_t w, kk_context_t* ctx) {
+  w = kk_uvector_unique(w, ctx);
+  kk_ssize_t len1, len2;
+  const double* p = (const double*)kk_uvector_buf_borrow(v, &len1);
+  double* q = (double*)kk_uvector_buf_borrow(w, &len2);
+  const kk_ssize_t len = (len1 < len2 ? len1 : len2);
+  for (kk_ssize_t i = 0; i < len; i++) { q[i] += a*p[i]; }
+  kk_box_drop(v, ctx);
+  return w;
+}
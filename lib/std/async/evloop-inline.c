@@ -0,0 +1,45 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+static kk_std_core__error kk_evloop_result( int err, kk_context_t* ctx ) {
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_evloop_read_error( kk_integer_t fd, kk_ssize_t max, kk_function_t cb, kk_context_t* ctx ) {
+  return kk_evloop_result(kk_evloop_read(kk_integer_clamp32(fd,ctx),max,cb,ctx),ctx);
+}
+
+static kk_std_core__error kk_evloop_write_error( kk_integer_t fd, kk_string_t content, kk_function_t cb, kk_context_t* ctx ) {
+  return kk_evloop_result(kk_evloop_write(kk_integer_clamp32(fd,ctx),content.bytes,cb,ctx),ctx);
+}
+
+static kk_std_core__error kk_evloop_accept_error( kk_integer_t fd, kk_function_t cb, kk_context_t* ctx ) {
+  return kk_evloop_result(kk_evloop_accept(kk_integer_clamp32(fd,ctx),cb,ctx),ctx);
+}
+
+static kk_std_core__error kk_evloop_timer_error( kk_integer_t ms, kk_function_t cb, kk_context_t* ctx ) {
+  return kk_evloop_result(kk_evloop_timer(kk_integer_clamp64(ms,ctx),cb,ctx),ctx);
+}
+
+static kk_integer_t kk_evloop_poll_prim( kk_integer_t ms, kk_context_t* ctx ) {
+  return kk_integer_from_ssize_t(kk_evloop_poll(kk_integer_clamp64(ms,ctx),ctx),ctx);
+}
+
+static kk_unit_t kk_evloop_run_prim( kk_context_t* ctx ) {
+  kk_evloop_run(ctx);
+  return kk_Unit;
+}
+
+static kk_integer_t kk_evloop_pending_prim( kk_context_t* ctx ) {
+  return kk_integer_from_ssize_t(kk_evloop_pending(ctx),ctx);
+}
+
+static kk_std_core__error kk_evloop_errno_error( kk_integer_t err, kk_context_t* ctx ) {
+  return kk_evloop_result(kk_integer_clamp32(err,ctx),ctx);
+}
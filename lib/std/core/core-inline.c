@@ -8,34 +8,25 @@
 ---------------------------------------------------------------------------*/
 
 kk_std_core__list kk_vector_to_list(kk_vector_t v, kk_std_core__list tail, kk_context_t* ctx) {
-  // todo: avoid boxed_dup if v is unique
   kk_ssize_t n;
   kk_box_t* p = kk_vector_buf_borrow(v, &n);
   if (n <= 0) {
     kk_vector_drop(v,ctx);
     return tail;
   }
-  kk_std_core__list nil  = kk_std_core__new_Nil(ctx);
-  struct kk_std_core_Cons* cons = NULL;
-  kk_std_core__list list = kk_std_core__new_Nil(ctx);
+  // if `v` is unique we move the elements into the list and free the vector without dropping them
+  const bool unique = kk_datatype_is_unique(v);
+  kk_std_core_types__ctail b = kk_list_builder_init();
   for( kk_ssize_t i = 0; i < n; i++ ) {
-    kk_std_core__list hd = kk_std_core__new_Cons(kk_reuse_null,kk_box_dup(p[i]), nil, ctx);
-    if (cons==NULL) {
-      list = hd;
-    }
-    else {
-      cons->tail = hd;
-    }
-    cons = kk_std_core__as_Cons(hd);
+    b = kk_list_builder_append(b, (unique ? p[i] : kk_box_dup(p[i])), ctx);
   }
-  if (cons == NULL) { list = tail; } 
-               else { cons->tail = tail; }
-  kk_vector_drop(v,ctx);
+  kk_std_core__list list = kk_list_builder_finish(b, tail, ctx);
+  if (unique) { kk_block_free(&kk_vector_as_large_borrow(v)->_base._block, ctx); }
+         else { kk_vector_drop(v,ctx); }
   return list;
 }
 
 kk_vector_t kk_list_to_vector(kk_std_core__list xs, kk_context_t* ctx) {
-  // todo: avoid boxed_dup if xs is unique
   // find the length
   kk_ssize_t len = 0;
   kk_std_core__list ys = xs;
@@ -44,16 +35,26 @@ kk_vector_t kk_list_to_vector(kk_std_core__list xs, kk_context_t* ctx) {
     len++;
     ys = cons->tail;
   }
-  // alloc the vector and copy
+  // alloc the vector and copy; as long as the cons cells are unique we move
+  // the elements and free the cells while visiting
   kk_box_t* p;
   kk_vector_t v = kk_vector_alloc_uninit(len, &p, ctx);  
   ys = xs;
-  for( kk_ssize_t i = 0; i < len; i++) {
+  kk_ssize_t i = 0;
+  while (i < len && kk_datatype_is_unique(ys)) {
     struct kk_std_core_Cons* cons = kk_std_core__as_Cons(ys);
     ys = cons->tail;
+    p[i++] = cons->head;
+    kk_constructor_free(cons, ctx);
+  }
+  // the remaining list is shared
+  kk_std_core__list zs = ys;
+  for( ; i < len; i++) {
+    struct kk_std_core_Cons* cons = kk_std_core__as_Cons(zs);
+    zs = cons->tail;
     p[i] = kk_box_dup(cons->head);
   }
-  kk_std_core__list_drop(xs,ctx);  // todo: drop while visiting?
+  kk_std_core__list_drop(ys,ctx);
   return v;
 }
 
@@ -77,50 +78,86 @@ kk_std_core__list kk_string_to_list(kk_string_t s, kk_context_t* ctx) {
   kk_ssize_t len;
   const uint8_t* p = kk_string_buf_borrow(s,&len);
   const uint8_t* const end = p + len;
-  kk_std_core__list nil  = kk_std_core__new_Nil(ctx);
-  kk_std_core__list list = nil;
-  struct kk_std_core_Cons* tl = NULL;
+  kk_std_core_types__ctail b = kk_list_builder_init();
   kk_ssize_t count;
   while( p < end ) {
+    if (end - p >= 8) {
+      // ascii fast path: 8 bytes at a time without utf-8 decoding
+      uint64_t w;
+      memcpy(&w, p, sizeof(w));
+      if ((w & KK_U64(0x8080808080808080)) == 0) {
+        for (const uint8_t* q = p + 8; p < q; p++) {
+          b = kk_list_builder_append(b, kk_char_box(*p,ctx), ctx);
+        }
+        continue;
+      }
+    }
     kk_char_t c = kk_utf8_read(p,&count);
     p += count;
-    kk_std_core__list cons = kk_std_core__new_Cons(kk_reuse_null,kk_char_box(c,ctx), nil, ctx);
-    if (tl!=NULL) {
-      tl->tail = cons;
-    }
-    else {
-      list = cons;
-    }
-    tl = kk_std_core__as_Cons(cons);
+    b = kk_list_builder_append(b, kk_char_box(c,ctx), ctx);
   }
   kk_string_drop(s,ctx);
-  return list;
+  return kk_list_builder_finish(b, kk_std_core__new_Nil(ctx), ctx);
+}
+
+static inline void kk_string_builder_append_list_char(kk_string_builder_t* sb, kk_box_t b, kk_context_t* ctx) {
+  const kk_char_t c = kk_char_unbox(b,ctx);
+  if (kk_likely(c < 0x80 && sb->len < sb->capacity)) {
+    sb->p[sb->len++] = (uint8_t)c;  // ascii fast path
+  }
+  else {
+    kk_string_builder_append_char(sb, c, ctx);
+  }
 }
 
 kk_string_t kk_string_from_list(kk_std_core__list cs, kk_context_t* ctx) {
-  // TODO: optimize for short strings to write directly into a local buffer?
-  // find total UTF8 length
-  kk_ssize_t len = 0;
+  // write the characters in a single pass; as long as the cons cells are unique
+  // we free them while visiting
+  kk_string_builder_t sb;
+  kk_string_builder_init(&sb, 0, ctx);
   kk_std_core__list xs = cs;
-  while (kk_std_core__is_Cons(xs)) {
+  while (kk_std_core__is_Cons(xs) && kk_datatype_is_unique(xs)) {
     struct kk_std_core_Cons* cons = kk_std_core__as_Cons(xs);
-    len += kk_utf8_len(kk_char_unbox(cons->head,ctx));
     xs = cons->tail;
+    kk_string_builder_append_list_char(&sb, cons->head, ctx);
+    kk_box_drop(cons->head, ctx);
+    kk_constructor_free(cons, ctx);
   }
-  // allocate and copy the characters
-  uint8_t* p;
-  kk_string_t s = kk_unsafe_string_alloc_buf(len,&p,ctx);  // must be initialized
-  xs = cs;
-  while (kk_std_core__is_Cons(xs)) {
-    struct kk_std_core_Cons* cons = kk_std_core__as_Cons(xs);
-    kk_ssize_t count;
-    kk_utf8_write( kk_char_unbox(cons->head,ctx), p, &count );
-    p += count;
-    xs = cons->tail;
+  // the remaining list is shared
+  kk_std_core__list ys = xs;
+  while (kk_std_core__is_Cons(ys)) {
+    struct kk_std_core_Cons* cons = kk_std_core__as_Cons(ys);
+    kk_string_builder_append_list_char(&sb, cons->head, ctx);
+    ys = cons->tail;
+  }
+  kk_std_core__list_drop(xs,ctx);
+  return kk_string_builder_finish(&sb, ctx);
+}
+
+kk_string_t kk_string_join_with(kk_vector_t v, kk_string_t sep, kk_context_t* ctx) {
+  kk_ssize_t n;
+  kk_box_t* p = kk_vector_buf_borrow(v, &n);
+  // the boxed strings are borrowed from the vector
+  kk_string_t res;
+  if (n == 1) {
+    res = kk_string_dup(kk_string_unbox(p[0]));
+  }
+  else {
+    kk_string_t  buf[16];
+    kk_string_t* ss = (n <= 16 ? buf : (kk_string_t*)kk_malloc(n * kk_ssizeof(kk_string_t), ctx));
+    for (kk_ssize_t i = 0; i < n; i++) {
+      ss[i] = kk_string_unbox(p[i]);
+    }
+    res = kk_string_cat_n(n, ss, sep, ctx);
+    if (ss != buf) { kk_free(ss, ctx); }
   }
-  kk_assert_internal(*p == 0 && (p - kk_string_buf_borrow(s,NULL)) == len);
-  kk_std_core__list_drop(cs,ctx);  // todo: drop while visiting?
-  return s;
+  kk_vector_drop(v, ctx);
+  kk_string_drop(sep, ctx);
+  return res;
+}
+
+kk_string_t kk_string_join(kk_vector_t v, kk_context_t* ctx) {
+  return kk_string_join_with(v, kk_string_empty(), ctx);
 }
 
 static inline void kk_sslice_start_end_borrowx( kk_std_core__sslice sslice, const uint8_t** start, const uint8_t** end, const uint8_t** sstart, const uint8_t** send) {
@@ -163,8 +200,8 @@ kk_string_t kk_slice_to_string( kk_std_core__sslice  sslice, kk_context_t* ctx )
     return sslice.str;
   }
   else {
-    // if not, we copy len bytes
-    kk_string_t s = kk_string_alloc_dupn_valid_utf8(sslice.len, start, ctx);
+    // if not, we share or copy len bytes
+    kk_string_t s = kk_unsafe_bytes_as_string(kk_bytes_slice_borrow(sslice.str.bytes, sslice.start, sslice.len, ctx));
     kk_std_core__sslice_drop(sslice,ctx);
     return s;
   }
@@ -215,22 +252,38 @@ kk_std_core_types__maybe kk_slice_next( struct kk_std_core_Sslice slice, kk_cont
   return kk_std_core_types__new_Just( kk_std_core_types__tuple2__box(res,ctx), ctx );
 }
 
+/* Borrow slice; returns the first character and the position after it without allocating, or a negative position if the slice is empty */
+struct kk_std_core_Cursor kk_slice_cursor_borrow( struct kk_std_core_Sslice slice, kk_context_t* ctx ) {
+  if (slice.len <= 0) return kk_std_core__new_Cursor(0, -1, ctx);
+  const uint8_t* start;
+  const uint8_t* end;
+  kk_sslice_start_end_borrow(slice, &start, &end);
+  kk_ssize_t clen;
+  const kk_char_t c = kk_utf8_read(start,&clen);
+  kk_assert_internal(clen > 0 && clen <= slice.len);
+  if (clen > slice.len) clen = slice.len;
+  return kk_std_core__new_Cursor(c, slice.start + clen, ctx);
+}
+
 /* Borrow count */
 struct kk_std_core_Sslice kk_slice_extend_borrow( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx ) {
   kk_ssize_t cnt = kk_integer_clamp_borrow(count,ctx);
   if (cnt==0 || (slice.len <= 0 && cnt<0)) return slice;
+  const uint8_t* sstart;
   const uint8_t* s0;
   const uint8_t* s1;
-  kk_sslice_start_end_borrow(slice,&s0,&s1);
+  const uint8_t* send;
+  kk_sslice_start_end_borrowx(slice,&s0,&s1,&sstart,&send);
   const uint8_t* t  = s1;
   if (cnt >= 0) {
-    do {
+    // bounded by the end of the string (which is not zero terminated if it is a slice itself)
+    while (cnt > 0 && t < send) {
       t = kk_utf8_next(t);
       cnt--;
-    } while (cnt > 0 && *t != 0);
+    }
+    if (t > send) t = send;
   }
   else {  // cnt < 0
-    const uint8_t* sstart = s0 - slice.start;
     do {
       t = kk_utf8_prev(t);
       cnt++;
@@ -287,8 +340,8 @@ struct kk_std_core_Sslice kk_slice_advance_borrow( struct kk_std_core_Sslice sli
 
 /* Borrow iupto */
 struct kk_std_core_Sslice kk_slice_common_prefix_borrow( kk_string_t str1, kk_string_t str2, kk_integer_t iupto, kk_context_t* ctx ) {
-  const uint8_t* s1 = kk_string_buf_borrow(str1,NULL);
-  const uint8_t* s2 = kk_string_buf_borrow(str2,NULL);
+  const uint8_t* s1 = (const uint8_t*)kk_string_cbuf_borrow(str1,NULL);
+  const uint8_t* s2 = (const uint8_t*)kk_string_cbuf_borrow(str2,NULL);
   kk_ssize_t upto = kk_integer_clamp_ssize_t_borrow(iupto,ctx);
   kk_ssize_t count;
   for(count = 0; count < upto && *s1 != 0 && *s2 != 0; count++, s1++, s2++ ) {
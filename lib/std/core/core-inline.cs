@@ -351,6 +351,15 @@ public static class Primitive
                     (int)c, new __std_core._sslice(slice.str, slice.start + n, slice.len - n)));
   }
 
+  public static __std_core._cursor SliceCursor(__std_core._sslice slice) {
+    if (slice.len <= 0) return new __std_core._cursor(0, -1);
+    char c = slice.str[slice.start];
+    if (Char.IsHighSurrogate(c) && slice.len > 1 && Char.IsLowSurrogate(slice.str[slice.start + 1])) {
+      return new __std_core._cursor(Char.ConvertToUtf32(slice.str, slice.start), slice.start + 2);
+    }
+    return new __std_core._cursor((int)c, slice.start + 1);
+  }
+
   //---------------------------------------
   // Trace
   //---------------------------------------
@@ -616,6 +625,10 @@ public static class Primitive
     else return i * BigInteger.Pow(10, (int)n);
   }
 
+  public static BigInteger IntAddPow10(BigInteger i, BigInteger j, BigInteger n) {
+    return i + IntMulPow10(j, n);
+  }
+
   public static double DoubleParse(string s) {
     double res;
     bool ok = Double.TryParse(s, NumberStyles.Float, CultureInfo.InvariantCulture, out res);
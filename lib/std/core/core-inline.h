@@ -27,6 +27,7 @@ static inline kk_std_core_types__maybe kk_integer_xparse( kk_string_t s, bool he
 }
 
 struct kk_std_core_Sslice;
+struct kk_std_core_Cursor;
 
 kk_datatype_t kk_string_to_list(kk_string_t s, kk_context_t* ctx);
 kk_string_t   kk_string_from_list(kk_datatype_t cs, kk_context_t* ctx);
@@ -61,6 +62,7 @@ struct kk_std_core_Sslice kk_slice_common_prefix_borrow( kk_string_t str1, kk_st
 struct kk_std_core_Sslice kk_slice_advance_borrow( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx );
 struct kk_std_core_Sslice kk_slice_extend_borrow( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx );
 kk_std_core_types__maybe kk_slice_next( struct kk_std_core_Sslice slice, kk_context_t* ctx );
+struct kk_std_core_Cursor kk_slice_cursor_borrow( struct kk_std_core_Sslice slice, kk_context_t* ctx );
 
 
 static inline kk_unit_t kk_vector_unsafe_assign( kk_vector_t v, kk_ssize_t i, kk_box_t x, kk_context_t* ctx  ) {
@@ -514,6 +514,10 @@ export function _int_cdiv_pow10(i,n) {
   return (_is_small(i) && n <= 14 ? _int_cdiv(i,Math.pow(10,n)) : _integer_cdiv_pow10(i,n) );
 }
 
+export function _int_add_pow10(i,j,n) {
+  return _int_add(i, _int_mul_pow10(j,n));
+}
+
 
 function _count_pow10( x ) {
   var j = 0;
@@ -0,0 +1,31 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020-2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  List builder for primitives that construct lists (like `kk_string_to_list` or the regex matches).
+  A builder is a constructor context (`ctail`, see `types-ctail-inline.h`) whose hole is the
+  tail field of the last cons cell, so a list is built in one forward pass without reversal:
+
+    kk_std_core_types__ctail b = kk_list_builder_init();
+    b = kk_list_builder_append(b, x, ctx);   // for each element `x` (owned) in order
+    kk_std_core__list xs = kk_list_builder_finish(b, kk_std_core__new_Nil(ctx), ctx);
+--------------------------------------------------------------------------------------*/
+
+static inline kk_std_core_types__ctail kk_list_builder_init(void) {
+  return kk_ctail_nil();
+}
+
+static inline kk_std_core_types__ctail kk_list_builder_append( kk_std_core_types__ctail b, kk_box_t x, kk_context_t* ctx ) {
+  kk_std_core__list cons = kk_std_core__new_Cons(kk_reuse_null, x, kk_std_core__new_Nil(ctx), ctx);
+  return kk_ctail_link(b, kk_std_core__list_box(cons,ctx), (kk_box_t*)&kk_std_core__as_Cons(cons)->tail);
+}
+
+// Plug the final hole with `tail` (usually `Nil`) and return the list
+static inline kk_std_core__list kk_list_builder_finish( kk_std_core_types__ctail b, kk_std_core__list tail, kk_context_t* ctx ) {
+  return kk_std_core__list_unbox(kk_ctail_resolve(b, kk_std_core__list_box(tail,ctx)), ctx);
+}
@@ -213,6 +213,21 @@ function _sslice_next( slice ) {
   return $std_core_types.Just( {fst: c, snd: { str: slice.str, start: slice.start+n, len: slice.len-n }} );
 }
 
+// a cursor to the first character of a slice
+function _sslice_cursor( slice ) {
+  if (slice.len <= 0) return { chr: 0, pos: -1 };
+  var c = slice.str.charCodeAt(slice.start);
+  var n = 1;
+  if (_is_high_surrogate(c) && slice.len > 1) {
+    var lo = slice.str.charCodeAt(slice.start+1);
+    if (_is_low_surrogate(lo)) {
+      c = _from_surrogate(c,lo);
+      n = 2;
+    }
+  }
+  return { chr: c, pos: slice.start+n };
+}
+
 // return the common prefix of two strings
 function _sslice_common_prefix( s, t, upto ) {
   var i;
@@ -18,9 +18,20 @@ struct kk_std_core_hnd_Ev {
 };
 */
 
+/*-----------------------------------------------------------------------
+  Evidence vectors are sorted on the tag name. After the evidence fields
+  an evidence vector has a (non-scanned) array with a hash of the tag name 
+  of each evidence. This way `kk_evv_index` can find the evidence by comparing
+  integers instead of doing a string comparison with every tag name (which 
+  tend to share long prefixes like `std/core/...`). The hashes are computed
+  when a vector is created (in `kk_evv_insert`, `kk_evv_delete`, and `kk_evv_create`)
+  so code without handlers never pays for it.
+-----------------------------------------------------------------------*/
+
 static kk_evv_vector_t kk_evv_vector_alloc(kk_ssize_t length, int32_t cfc, kk_context_t* ctx) {
   kk_assert_internal(length>=0);
-  kk_evv_vector_t v = (kk_evv_vector_t)kk_block_alloc(kk_ssizeof(struct kk_evv_vector_s) + (length-1)*kk_ssizeof(void*), length + 1 /* cfc */, KK_TAG_EVV_VECTOR, ctx);
+  kk_evv_vector_t v = (kk_evv_vector_t)kk_block_alloc(kk_ssizeof(struct kk_evv_vector_s) + (length-1)*kk_ssizeof(void*) + length*kk_ssizeof(uint32_t) /* tag hashes */, 
+                                                      length + 1 /* cfc */, KK_TAG_EVV_VECTOR, ctx);
   v->cfc = kk_integer_from_int32(cfc,ctx);
   return v;
 }
@@ -30,6 +41,49 @@ static kk_std_core_hnd__ev* kk_evv_vector_buf(kk_evv_vector_t vec, kk_ssize_t* l
   return &vec->vec[0];
 }
 
+static uint32_t* kk_evv_vector_tag_hashes(kk_evv_vector_t vec, kk_ssize_t len) {
+  kk_assert_internal(len == kk_block_scan_fsize(&vec->_block) - 1);
+  return (uint32_t*)(&vec->vec[len]);
+}
+
+// FNV-1a hash of a tag name
+static uint32_t kk_evv_tag_hash_compute(kk_string_t tagname) {
+  kk_ssize_t len;
+  const uint8_t* s = kk_string_buf_borrow(tagname, &len);
+  uint32_t h = KK_U32(2166136261);
+  for (kk_ssize_t i = 0; i < len; i++) {
+    h = (h ^ s[i]) * KK_U32(16777619);
+  }
+  return h;
+}
+
+// Tag names are usually static string literals that are never freed; for those
+// we cache the hash by the address of the string.
+#define KK_EVV_TAG_CACHE_SIZE (64)
+static kk_decl_thread struct kk_evv_tag_cache_s {
+  uintptr_t tag;
+  uint32_t  hash;
+} kk_evv_tag_cache[KK_EVV_TAG_CACHE_SIZE];
+
+static uint32_t kk_evv_tag_hash(kk_string_t tagname) {
+  const uintptr_t tag = tagname.bytes.dbox;
+  struct kk_evv_tag_cache_s* entry = &kk_evv_tag_cache[(tag >> 4) % KK_EVV_TAG_CACHE_SIZE];
+  if (kk_likely(entry->tag == tag)) return entry->hash;
+  const uint32_t h = kk_evv_tag_hash_compute(tagname);
+  if (kk_datatype_is_ptr(tagname.bytes)) {
+    const kk_refcount_t rc = kk_block_refcount(kk_datatype_as_ptr(tagname.bytes));
+    if (rc >= KK_U32(0x80000000) && rc <= KK_U32(0x90000000)) {  // static or sticky: never freed
+      entry->tag = tag;
+      entry->hash = h;
+    }
+  }
+  return h;
+}
+
+static uint32_t kk_evv_ev_tag_hash(kk_std_core_hnd__ev ev) {
+  return kk_evv_tag_hash(kk_std_core_hnd__as_Ev(ev)->htag.tagname);
+}
+
 static kk_std_core_hnd__ev* kk_evv_as_vec(kk_evv_t evv, kk_ssize_t* len, kk_std_core_hnd__ev* single) {
   if (kk_evv_is_vector(evv)) {
     kk_evv_vector_t vec = kk_evv_as_vector(evv);
@@ -56,6 +110,7 @@ kk_std_core_hnd__ev kk_ev_none(kk_context_t* ctx) {
       kk_evv_empty(ctx),
       ctx
     );
+    kk_block_make_immortal(&ev_none_singleton->_block, ctx);  // avoid reference counting on the singleton
   }
   return kk_std_core_hnd__ev_dup(ev_none_singleton);
 }
@@ -66,6 +121,18 @@ kk_ssize_t kk_evv_index( struct kk_std_core_hnd_Htag htag, kk_context_t* ctx ) {
   kk_ssize_t len;
   kk_std_core_hnd__ev single;
   kk_std_core_hnd__ev* vec = kk_evv_as_vec(ctx->evv,&len,&single);
+  if (len > 1) {
+    // find the first evidence with an equal hash and tag name; since the vector is sorted this
+    // is also the insertion point. (If the tag is not present we fall through to the slow path)
+    const uint32_t* hashes = kk_evv_vector_tag_hashes(kk_evv_as_vector(ctx->evv), len);
+    const uint32_t h = kk_evv_tag_hash(htag.tagname);
+    for (kk_ssize_t i = 0; i < len; i++) {
+      if (hashes[i] == h) {
+        kk_string_t tagname = kk_std_core_hnd__as_Ev(vec[i])->htag.tagname;
+        if (tagname.bytes.dbox == htag.tagname.bytes.dbox || kk_string_cmp_borrow(htag.tagname, tagname) == 0) return i;
+      }
+    }
+  }
   for(kk_ssize_t i = 0; i < len; i++) {
     struct kk_std_core_hnd_Ev* ev = kk_std_core_hnd__as_Ev(vec[i]);
     if (kk_string_cmp_borrow(htag.tagname,ev->htag.tagname) <= 0) return i; // break on insertion point
@@ -148,15 +215,20 @@ kk_evv_t kk_evv_insert(kk_evv_t evvd, kk_std_core_hnd__ev evd, kk_context_t* ctx
     ev->cfc = cfc; // update in place
     kk_evv_vector_t vec2 = kk_evv_vector_alloc(n+1, cfc, ctx);
     kk_std_core_hnd__ev* const evv2 = kk_evv_vector_buf(vec2, NULL);
+    uint32_t* const hashes2 = kk_evv_vector_tag_hashes(vec2, n+1);
+    const uint32_t* const hashes1 = (n > 1 ? kk_evv_vector_tag_hashes(kk_evv_as_vector(evvd), n) : NULL);
     kk_ssize_t i;
     for (i = 0; i < n; i++) {
       struct kk_std_core_hnd_Ev* ev1 = kk_std_core_hnd__as_Ev(evv1[i]);
       if (kk_string_cmp_borrow(ev->htag.tagname, ev1->htag.tagname) <= 0) break;
       evv2[i] = kk_std_core_hnd__ev_dup(&ev1->_base);
+      hashes2[i] = (hashes1 != NULL ? hashes1[i] : kk_evv_ev_tag_hash(evv1[i]));
     }
     evv2[i] = evd;
+    hashes2[i] = kk_evv_tag_hash(ev->htag.tagname);
     for (; i < n; i++) {
       evv2[i+1] = kk_std_core_hnd__ev_dup(evv1[i]);
+      hashes2[i+1] = (hashes1 != NULL ? hashes1[i] : kk_evv_ev_tag_hash(evv1[i]));
     }
     kk_evv_drop(evvd, ctx);  // assigned to evidence already
     return &vec2->_block;
@@ -177,12 +249,16 @@ kk_evv_t kk_evv_delete(kk_evv_t evvd, kk_ssize_t index, bool behind, kk_context_
   const int32_t cfc1 = kk_evv_cfc_of_borrow(evvd,ctx);
   kk_evv_vector_t const vec2 = kk_evv_vector_alloc(n-1,cfc1,ctx);
   kk_std_core_hnd__ev* const evv2 = kk_evv_vector_buf(vec2,NULL);
+  uint32_t* const hashes2 = kk_evv_vector_tag_hashes(vec2, n-1);
+  const uint32_t* const hashes1 = kk_evv_vector_tag_hashes(kk_evv_as_vector(evvd), n);
   kk_ssize_t i;
   for(i = 0; i < index; i++) {
     evv2[i] = kk_std_core_hnd__ev_dup(evv1[i]);
+    hashes2[i] = hashes1[i];
   }
   for(; i < n-1; i++) {
     evv2[i] = kk_std_core_hnd__ev_dup(evv1[i+1]);
+    hashes2[i] = hashes1[i+1];
   }
   struct kk_std_core_hnd_Ev* ev = kk_std_core_hnd__as_Ev(evv1[index]);
   if (ev->cfc >= cfc1) {
@@ -205,10 +281,13 @@ kk_evv_t kk_evv_create(kk_evv_t evv1, kk_vector_t indices, kk_context_t* ctx) {
   kk_ssize_t len1;
   kk_std_core_hnd__ev single;
   kk_std_core_hnd__ev* buf1 = kk_evv_as_vec(evv1,&len1,&single);
+  uint32_t* hashes2 = kk_evv_vector_tag_hashes(evv2,len);
+  const uint32_t* hashes1 = kk_evv_vector_tag_hashes(kk_evv_as_vector(evv1),len1);
   for(kk_ssize_t i = 0; i < len; i++) {
     kk_ssize_t idx = kk_ssize_unbox(elems[i],ctx);
     kk_assert_internal(idx < len1);
     buf2[i] = kk_std_core_hnd__ev_dup( buf1[idx] );
+    hashes2[i] = hashes1[idx];
   }
   kk_vector_drop(indices,ctx);
   kk_evv_drop(evv1,ctx);
@@ -271,9 +350,11 @@ static kk_box_t kcompose( kk_function_t fself, kk_box_t x, kk_context_t* ctx) {
   return x;
 }
 
-static kk_function_t new_kcompose( kk_function_t* conts, kk_ssize_t count, kk_context_t* ctx ) {
-  if (count==0) return kk_function_id(ctx);
-  if (count==1) return conts[0];
+// maximal number of continuations in a single `kcompose` closure (as the scan size must fit in 8 bits)
+#define KCOMPOSE_MAX  (KK_SCAN_FSIZE_MAX - 3)
+
+static kk_function_t new_kcompose_chunk( kk_function_t* conts, kk_ssize_t count, kk_context_t* ctx ) {
+  kk_assert_internal(count > 1 && count <= KCOMPOSE_MAX);
   struct kcompose_fun_s* f = kk_block_as(struct kcompose_fun_s*,
                                kk_block_alloc(kk_ssizeof(struct kcompose_fun_s) - kk_ssizeof(kk_function_t) + (count*kk_ssizeof(kk_function_t)),
                                  2 + count /* scan size */, KK_TAG_FUNCTION, ctx));
@@ -283,10 +364,48 @@ static kk_function_t new_kcompose( kk_function_t* conts, kk_ssize_t count, kk_co
   return (&f->_base);
 }
 
+// Compose the continuations in `conts` (which may be overwritten).
+static kk_function_t new_kcompose( kk_function_t* conts, kk_ssize_t count, kk_context_t* ctx ) {
+  if (count==0) return kk_function_id(ctx);
+  if (count==1) return conts[0];
+  while (count > KCOMPOSE_MAX) {
+    // compose a prefix and replace its last entry by the composition
+    kk_function_t f = new_kcompose_chunk(conts, KCOMPOSE_MAX, ctx);
+    conts += KCOMPOSE_MAX - 1;
+    count -= KCOMPOSE_MAX - 1;
+    conts[0] = f;
+  }
+  return new_kcompose_chunk(conts, count, ctx);
+}
+
 /*-----------------------------------------------------------------------
   Yield extension
 -----------------------------------------------------------------------*/
 
+// Grow the continuation array (which is kept for later yields)
+static kk_decl_noinline void kk_yield_conts_grow( kk_yield_t* yield, kk_context_t* ctx ) {
+  kk_assert_internal(yield->conts_count >= yield->conts_size);
+  const kk_ssize_t newsize = 2*yield->conts_size;
+  kk_function_t* conts;
+  if (yield->conts == yield->conts_inline) {
+    conts = (kk_function_t*)kk_malloc(newsize * kk_ssizeof(kk_function_t), ctx);
+    if (conts != NULL) { kk_memcpy(conts, yield->conts, yield->conts_count * kk_ssizeof(kk_function_t)); }
+  }
+  else {
+    conts = (kk_function_t*)kk_realloc(yield->conts, newsize * kk_ssizeof(kk_function_t), ctx);
+  }
+  if (conts == NULL) {
+    // out of memory: compose all continuations in the array instead
+    kk_function_t comp = new_kcompose( yield->conts, yield->conts_count, ctx );
+    yield->conts[0] = comp;
+    yield->conts_count = 1;
+  }
+  else {
+    yield->conts = conts;
+    yield->conts_size = newsize;
+  }
+}
+
 kk_box_t kk_yield_extend( kk_function_t next, kk_context_t* ctx ) {
   kk_yield_t* yield = &ctx->yield;
   kk_assert_internal(kk_yielding(ctx));  // cannot extend if not yielding
@@ -295,11 +414,8 @@ kk_box_t kk_yield_extend( kk_function_t next, kk_context_t* ctx ) {
     kk_function_drop(next,ctx); // ignore extension if never resuming
   }
   else {
-    if (kk_unlikely(yield->conts_count >= KK_YIELD_CONT_MAX)) {
-      // alloc a function to compose all continuations in the array
-      kk_function_t comp = new_kcompose( yield->conts, yield->conts_count, ctx );
-      yield->conts[0] = comp;
-      yield->conts_count = 1;
+    if (kk_unlikely(yield->conts_count >= yield->conts_size)) {
+      kk_yield_conts_grow(yield, ctx);
     }
     yield->conts[yield->conts_count++] = next;
   }
@@ -347,6 +463,7 @@ kk_box_t kk_yield_cont( kk_function_t f, kk_context_t* ctx ) {
 kk_function_t kk_yield_to( struct kk_std_core_hnd_Marker m, kk_function_t clause, kk_context_t* ctx ) {
   kk_yield_t* yield = &ctx->yield;
   kk_assert_internal(!kk_yielding(ctx)); // already yielding
+  kk_probe1(yield_to, m.m);
   ctx->yielding = KK_YIELD_NORMAL;
   yield->marker = m.m;
   yield->clause = clause;
@@ -356,6 +473,7 @@ kk_function_t kk_yield_to( struct kk_std_core_hnd_Marker m, kk_function_t clause
 
 kk_box_t kk_yield_final( struct kk_std_core_hnd_Marker m, kk_function_t clause, kk_context_t* ctx ) {
   kk_yield_to(m,clause,ctx);
+  kk_probe1(yield_final, m.m);
   ctx->yielding = KK_YIELD_FINAL;
   return kk_box_any(ctx);
 }
@@ -388,7 +506,9 @@ struct kk_std_core_hnd_yld_s kk_yield_prompt( struct kk_std_core_hnd_Marker m, k
     kk_function_t clause = yield->clause;
     ctx->yielding = KK_YIELD_NONE;
     #ifndef NDEBUG
-    kk_memset(yield,0,kk_ssizeof(kk_yield_t));
+    yield->marker = 0;
+    yield->clause = NULL;
+    yield->conts_count = 0;
     #endif
     return kk_std_core_hnd__new_Yield(clause, cont, ctx);
   }
@@ -417,6 +537,12 @@ kk_std_core_hnd__yield_info kk_yield_capture(kk_context_t* ctx) {
   kk_assert_internal(kk_yielding(ctx));
   yield_info_t yld = kk_block_alloc_as(struct yield_info_s, 1 + KK_YIELD_CONT_MAX, (kk_tag_t)1, ctx);
   yld->clause = ctx->yield.clause;
+  if (ctx->yield.conts_count > KK_YIELD_CONT_MAX) {
+    // compose into a single continuation to fit in the yield info
+    kk_function_t comp = new_kcompose( ctx->yield.conts, ctx->yield.conts_count, ctx );
+    ctx->yield.conts[0] = comp;
+    ctx->yield.conts_count = 1;
+  }
   kk_ssize_t i = 0;
   for( ; i < ctx->yield.conts_count; i++) {
     yld->conts[i] = ctx->yield.conts[i];
@@ -0,0 +1,40 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+// The dictionary itself is implemented in `kklib/src/hashmap.c`
+
+static kk_std_core_types__maybe kk_data_dict_lookup( kk_box_t d, kk_box_t key, kk_hash_key_t kind, kk_context_t* ctx ) {
+  kk_box_t* value = kk_swiss_lookup_borrow(d, key, kind, ctx);
+  if (value == NULL) return kk_std_core_types__new_Nothing(ctx);
+  return kk_std_core_types__new_Just(kk_box_dup(*value), ctx);
+}
+
+typedef struct kk_data_dict_entries_s {
+  kk_box_t*  keys;
+  kk_box_t*  values;
+  kk_ssize_t count;
+} kk_data_dict_entries_t;
+
+static void kk_data_dict_entry_visit( kk_box_t key, kk_box_t value, void* arg, kk_context_t* ctx ) {
+  kk_unused(ctx);
+  kk_data_dict_entries_t* entries = (kk_data_dict_entries_t*)arg;
+  entries->keys[entries->count] = kk_box_dup(key);
+  entries->values[entries->count] = kk_box_dup(value);
+  entries->count++;
+}
+
+static kk_std_core_types__tuple2_ kk_data_dict_entries( kk_box_t d, kk_context_t* ctx ) {
+  const kk_ssize_t count = kk_swiss_count_borrow(d);
+  kk_data_dict_entries_t entries = { NULL, NULL, 0 };
+  kk_vector_t keys   = kk_vector_alloc_uninit(count, &entries.keys, ctx);
+  kk_vector_t values = kk_vector_alloc_uninit(count, &entries.values, ctx);
+  kk_swiss_foreach_borrow(d, &kk_data_dict_entry_visit, &entries, ctx);
+  kk_assert_internal(entries.count == count);
+  kk_box_drop(d, ctx);
+  return kk_std_core_types__new_dash__lp__comma__rp_(kk_vector_box(keys,ctx), kk_vector_box(values,ctx), ctx);
+}
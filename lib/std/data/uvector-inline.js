@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------------
+-- Copyright 2021, Microsoft Research, Daan Leijen.
+--
+-- This is free software; you can redistribute it and/or modify it under the
+-- terms of the Apache License, Version 2.0. A copy of the License can be
+-- found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+// Unboxed vectors are represented as typed arrays
+function $uvector_alloc(Arr,n,x) {
+  const v = new Arr(n);
+  if (x) v.fill(x);
+  return v;
+}
+
+function $uvector_init(Arr,n,f) {
+  const v = new Arr(n);
+  for(let i = 0; i < n; i++) {
+    v[i] = f(i);
+  }
+  return v;
+}
+
+function $uvector_copy(v) {
+  return v.slice();
+}
+
+function $uvector_set(v,i,x) {
+  const w = v.slice();
+  w[i] = x;
+  return w;
+}
+
+// clamp to the vector bounds as in C (and never count from the end as `slice` does for negative indices)
+function $uvector_slice(v,start,len) {
+  const i = Math.min(Math.max(start,0), v.length);
+  const n = Math.min(Math.max(len,0), v.length - i);
+  return v.slice(i,i + n);
+}
+
+function $uvector_append(v,w) {
+  const u = new v.constructor(v.length + w.length);
+  u.set(v,0);
+  u.set(w,v.length);
+  return u;
+}
+
+// integer sums are a `BigInt` (and wrap around at 64-bits)
+function $uvector_sum(v,zero) {
+  let sum = zero;
+  if (typeof zero === "bigint") {
+    for(const x of v) { sum += BigInt(x); }
+    return BigInt.asIntN(64,sum);
+  }
+  for(const x of v) { sum += x; }
+  return sum;
+}
+
+function $uvector_dot(v,w,zero) {
+  const n = (v.length < w.length ? v.length : w.length);
+  let sum = zero;
+  if (typeof zero === "bigint") {
+    for(let i = 0; i < n; i++) { sum += BigInt(v[i]) * BigInt(w[i]); }
+    return BigInt.asIntN(64,sum);
+  }
+  for(let i = 0; i < n; i++) { sum += v[i]*w[i]; }
+  return sum;
+}
+
+function $uvector_axpy(a,v,w) {
+  const n = (v.length < w.length ? v.length : w.length);
+  const u = w.slice();
+  for(let i = 0; i < n; i++) { u[i] += a*v[i]; }
+  return u;
+}
+
+// clamp an integer to a byte
+function $uvector_byte(x) {
+  const i = Number(x);
+  return (i < 0 ? 0 : (i > 255 ? 255 : i));
+}
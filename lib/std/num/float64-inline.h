@@ -17,9 +17,10 @@ static inline double kk_double_from_bits( int64_t i, kk_context_t* ctx ) {
 }
 
 static inline double kk_prim_parse_double( kk_string_t str, kk_context_t* ctx) {
-  const char* s = kk_string_cbuf_borrow(str,NULL);
-  char* end;
-  double d = strtod(s,&end);
+  kk_ssize_t len;
+  const char* s = kk_string_cbuf_borrow(str,&len);
+  double d;
+  kk_double_parse(s,len,&d,NULL);  // parses the longest decimal prefix (and 0.0 if there is none)
   kk_string_drop(str,ctx);  
   return d;
 }
@@ -82,4 +82,46 @@ function _srandom_range_int32(lo,hi) {
   var delta = hi - lo;
   var x = _srandom_range_uint32(delta);
   return (lo + x);
-}
\ No newline at end of file
+}
+// sfc32 pseudo random numbers (see `kklib/src/random.c`)
+function _prandom_int32(s) {
+  var x = (s.a + s.b + s.counter)|0;
+  s.counter = (s.counter + 1)|0;
+  s.a = s.b ^ (s.b >>> 9);
+  s.b = (s.c + (s.c << 3))|0;
+  s.c = (((s.c << 21) | (s.c >>> 11)) + x)|0;
+  return x;
+}
+
+function _prandom_create(lo,hi) {
+  var s = { a: 0, b: lo|0, c: hi|0, counter: 1 };
+  for(var i = 0; i < 12; i++) { _prandom_int32(s); }
+  return s;
+}
+
+// use 52-bits for a double in the range [0,1) (as `kk_prandom_double`)
+function _prandom_double(s) {
+  var lo = _prandom_int32(s);
+  var hi = _prandom_int32(s);
+  return ((hi >>> 0) * 1048576.0 + (lo >>> 12)) / 4503599627370496.0;  // (hi*2^20 + lo/2^12) / 2^52
+}
+
+function _prandom_range_int32(s,lo,hi) {
+  if (lo > hi) {
+    var x = lo;
+    lo = hi;
+    hi = x;
+  }
+  var delta = (hi - lo) >>> 0;
+  if (delta === 0) return lo;
+  // unbiased by Daniel Lemire (as `kk_prandom_range_uint32` so it gives the same results)
+  var d = BigInt(delta);
+  var m = BigInt(_prandom_int32(s) >>> 0) * d;
+  if (Number(m & 0xFFFFFFFFn) < delta) {
+    var threshold = (0x100000000 - delta) % delta;
+    while (Number(m & 0xFFFFFFFFn) < threshold) {
+      m = BigInt(_prandom_int32(s) >>> 0) * d;
+    }
+  }
+  return (lo + Number(m >> 32n))|0;
+}
@@ -25,3 +25,28 @@ static kk_std_core__error kk_os_list_directory_prim( kk_string_t dir, kk_context
   if (err != 0) return kk_error_from_errno(err,ctx);
            else return kk_error_ok(kk_vector_box(contents,ctx),ctx);
 }
+
+static kk_std_core__error kk_os_dir_info_result( int err, kk_vector_t names, kk_vector_t infos, kk_context_t* ctx ) {
+  if (err != 0) {
+    kk_vector_drop(names,ctx);
+    kk_vector_drop(infos,ctx);
+    return kk_error_from_errno(err,ctx);
+  }
+  else {
+    return kk_error_ok(kk_std_core_types__tuple2__box(kk_std_core_types__new_dash__lp__comma__rp_( kk_vector_box(names,ctx), kk_vector_box(infos,ctx), ctx ),ctx),ctx);
+  }
+}
+
+static kk_std_core__error kk_os_list_directory_info_prim( kk_string_t dir, bool with_stat, kk_context_t* ctx ) {
+  kk_vector_t names;
+  kk_vector_t infos;
+  const int err = kk_os_list_directory_info(dir,with_stat,&names,&infos,ctx);
+  return kk_os_dir_info_result(err,names,infos,ctx);
+}
+
+static kk_std_core__error kk_os_walk_directory_prim( kk_string_t dir, kk_integer_t max_depth, bool with_stat, bool parallel, kk_context_t* ctx ) {
+  kk_vector_t names;
+  kk_vector_t infos;
+  const int err = kk_os_walk_directory(dir,kk_integer_clamp_ssize_t(max_depth,ctx),with_stat,parallel,&names,&infos,ctx);
+  return kk_os_dir_info_result(err,names,infos,ctx);
+}
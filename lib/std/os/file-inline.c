@@ -13,8 +13,47 @@ static kk_std_core__error kk_os_read_text_file_error( kk_string_t path, kk_conte
            else return kk_error_ok(kk_string_box(content),ctx);
 }
 
+static kk_std_core__error kk_os_read_text_file_mapped_error( kk_string_t path, kk_context_t* ctx ) {
+  kk_string_t content;
+  const int err = kk_os_read_text_file_mapped(path,&content,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_string_box(content),ctx);
+}
+
 static kk_std_core__error kk_os_write_text_file_error( kk_string_t path, kk_string_t content, kk_context_t* ctx ) {
   const int err = kk_os_write_text_file(path,content,ctx);
   if (err != 0) return kk_error_from_errno(err,ctx);
            else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
 }
+
+static kk_std_core__error kk_os_file_open_error( kk_string_t path, bool write, bool append, kk_context_t* ctx ) {
+  kk_box_t file;
+  const int err = kk_os_file_open(path,write,append,&file,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(file,ctx);
+}
+
+static kk_std_core__error kk_os_file_read_text_chunk_error( kk_box_t file, kk_ssize_t max, kk_context_t* ctx ) {
+  kk_bytes_t chunk;
+  const int err = kk_os_file_read_chunk(file,max,true,&chunk,ctx);
+  if (err != 0) { kk_bytes_drop(chunk,ctx); return kk_error_from_errno(err,ctx); }
+           else return kk_error_ok(kk_string_box(kk_string_convert_from_qutf8(chunk,ctx)),ctx);
+}
+
+static kk_std_core__error kk_os_file_write_text_error( kk_box_t file, kk_string_t content, kk_context_t* ctx ) {
+  const int err = kk_os_file_write(file,content.bytes,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_os_file_flush_error( kk_box_t file, kk_context_t* ctx ) {
+  const int err = kk_os_file_flush(file,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_os_file_close_error( kk_box_t file, kk_context_t* ctx ) {
+  const int err = kk_os_file_close(file,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
+}
@@ -0,0 +1,20 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+static kk_std_core__error kk_os_write_image_file_error( kk_string_t path, kk_box_t x, kk_context_t* ctx ) {
+  const int err = kk_os_write_image_file(path,x,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_os_read_image_file_error( kk_string_t path, kk_context_t* ctx ) {
+  kk_box_t x;
+  const int err = kk_os_read_image_file(path,&x,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(x,ctx);
+}
@@ -17,3 +17,60 @@ static kk_integer_t kk_os_run_system_prim( kk_string_t cmd, kk_context_t* ctx )
   const int exitcode = kk_os_run_system(cmd,ctx);
   return kk_integer_from_int(exitcode,ctx);
 }
+
+static kk_std_core__error kk_os_process_open_error( kk_string_t cmd, kk_context_t* ctx ) {
+  kk_box_t proc;
+  const int err = kk_os_process_open(cmd,&proc,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(proc,ctx);
+}
+
+static kk_std_core__error kk_os_process_read_chunk_error( kk_box_t proc, kk_ssize_t max, kk_context_t* ctx ) {
+  kk_bytes_t chunk;
+  const int err = kk_os_file_read_chunk(proc,max,true,&chunk,ctx);
+  if (err != 0) { kk_bytes_drop(chunk,ctx); return kk_error_from_errno(err,ctx); }
+           else return kk_error_ok(kk_string_box(kk_string_convert_from_qutf8(chunk,ctx)),ctx);
+}
+
+static kk_std_core__error kk_os_process_close_error( kk_box_t proc, kk_context_t* ctx ) {
+  int exitcode = 0;
+  const int err = kk_os_process_close(proc,&exitcode,ctx);
+  if (err != 0) return kk_error_from_errno(err,ctx);
+           else return kk_error_ok(kk_integer_box(kk_integer_from_int(exitcode,ctx)),ctx);
+}
+
+#define KK_RUNTIME_STATS_LIVE_MAX  (128)
+
+// Returns a tuple of a vector with the statistics (in the order of the `runtime-stats` fields)
+// followed by the live blocks per tag, and a vector with the names of those tags.
+static kk_std_core_types__tuple2_ kk_os_runtime_stats_prim( kk_context_t* ctx ) {
+  kk_runtime_stats_t s;
+  kk_runtime_stats(&s, ctx);
+  const int64_t fields[] = {
+    s.user_time, s.sys_time, (int64_t)s.rss, (int64_t)s.peak_rss, (int64_t)s.peak_commit,
+    (int64_t)s.page_faults, (int64_t)s.page_reclaims,
+    (int64_t)s.heap_committed, (int64_t)s.heap_used, s.heap_blocks, s.delayed_free,
+    s.live_blocks, s.shared_blocks,
+    s.task_workers, s.task_sleeping, s.task_queued, s.task_executed, s.task_busy, s.task_idle,
+    s.promise_waits, s.promise_wait
+  };
+  const kk_ssize_t nfields = kk_ssizeof(fields) / kk_ssizeof(fields[0]);
+  kk_ssize_t tags[KK_RUNTIME_STATS_LIVE_MAX];
+  const char* names[KK_RUNTIME_STATS_LIVE_MAX];
+  int64_t live[KK_RUNTIME_STATS_LIVE_MAX];
+  const kk_ssize_t nlive = kk_runtime_stats_live(tags, names, live, KK_RUNTIME_STATS_LIVE_MAX, ctx);
+  kk_box_t* values;
+  kk_vector_t vvalues = kk_vector_alloc_uninit(nfields + nlive, &values, ctx);
+  for (kk_ssize_t i = 0; i < nfields; i++) {
+    values[i] = kk_integer_box(kk_integer_from_int64(fields[i], ctx));
+  }
+  kk_box_t* tagnames;
+  kk_vector_t vnames = kk_vector_alloc_uninit(nlive, &tagnames, ctx);
+  for (kk_ssize_t i = 0; i < nlive; i++) {
+    values[nfields + i] = kk_integer_box(kk_integer_from_int64(live[i], ctx));
+    char buf[32];
+    if (names[i] == NULL) { snprintf(buf, sizeof(buf), "tag %d", (int)tags[i]); }
+    tagnames[i] = kk_string_box(kk_string_alloc_from_utf8(names[i] != NULL ? names[i] : buf, ctx));
+  }
+  return kk_std_core_types__new_dash__lp__comma__rp_(kk_vector_box(vvalues,ctx), kk_vector_box(vnames,ctx), ctx);
+}
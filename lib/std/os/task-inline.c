@@ -0,0 +1,15 @@
+/*---------------------------------------------------------------------------
+  Copyright 2021, Microsoft Research, Daan Leijen.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the LICENSE file at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+// Channels are implemented in `kklib/src/thread.c`
+
+static kk_std_core_types__maybe kk_os_channel_try_recv( kk_box_t ch, kk_context_t* ctx ) {
+  kk_box_t v;
+  if (!kk_channel_try_recv(ch, &v, ctx)) return kk_std_core_types__new_Nothing(ctx);
+  return kk_std_core_types__new_Just(v, ctx);
+}
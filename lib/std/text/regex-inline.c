@@ -15,58 +15,121 @@
 
 /* -----------------------------------------------------------------------
   Init/Done
+
+  The PCRE2 contexts are per thread so that regular expressions scale when
+  used from many tasks: memory is allocated through the context of the
+  thread itself (instead of looking it up with `kk_get_context()` on every
+  allocation), and each thread has its own JIT stack.
+  The contexts are created on the first use of a regular expression in a
+  thread (and not in the module initialization) to keep startup fast for
+  programs that import `std/text/regex` but do not use it.
+  The state of a thread is freed when the thread frees its context (and
+  for the main thread also at exit).
 ------------------------------------------------------------------------*/
-#define KK_CUSTOM_INIT  kk_regex_custom_init
 #define KK_CUSTOM_DONE  kk_regex_custom_done
 
-static pcre2_general_context* gen_ctx;
-static pcre2_compile_context* cmp_ctx;
-static pcre2_match_context*   match_ctx; 
+#define KK_REGEX_JIT_STACK_START  (32*1024)
+#define KK_REGEX_JIT_STACK_MAX    (1024*1024)
+
+typedef struct kk_regex_thread_s {
+  pcre2_general_context* gen_ctx;
+  pcre2_compile_context* cmp_ctx;
+  pcre2_match_context*   match_ctx;
+  pcre2_jit_stack*       jit_stack;
+  size_t                 slot;       // index of the cached match data of this thread in a regex
+} kk_regex_thread_t;
+
+static kk_decl_thread kk_regex_thread_t* regex_thread;
+static _Atomic(size_t) kk_regex_thread_count;  // = 0
 
 static void* kk_pcre2_malloc( PCRE2_SIZE size, void* data ) {
-  return kk_malloc( kk_to_ssize_t(size), kk_get_context() );  
+  return kk_malloc( kk_to_ssize_t(size), (kk_context_t*)data );
 }
 static void kk_pcre2_free( void* p, void* data ) {
-  kk_free(p,kk_get_context());
+  kk_unused(data);  // `data` may be the context of another thread (that may have terminated)
+  if (p != NULL) kk_free(p,kk_get_context());
 }
 
-static void kk_regex_custom_init( kk_context_t* ctx ) {
-  gen_ctx = pcre2_general_context_create( &kk_pcre2_malloc, &kk_pcre2_free, NULL );
-  if (gen_ctx != NULL) {
-    match_ctx = pcre2_match_context_create( gen_ctx );
-    cmp_ctx = pcre2_compile_context_create( gen_ctx );
-    if (cmp_ctx != NULL) {
-      pcre2_set_newline( cmp_ctx, PCRE2_NEWLINE_ANYCRLF );
-      pcre2_set_bsr( cmp_ctx, PCRE2_BSR_ANYCRLF );
+static void kk_regex_thread_free( kk_regex_thread_t* rt ) {
+  if (rt->jit_stack != NULL) pcre2_jit_stack_free(rt->jit_stack);
+  if (rt->match_ctx != NULL) pcre2_match_context_free(rt->match_ctx);
+  if (rt->cmp_ctx != NULL)   pcre2_compile_context_free(rt->cmp_ctx);
+  if (rt->gen_ctx != NULL)   pcre2_general_context_free(rt->gen_ctx);
+  free(rt);
+}
+
+static void kk_regex_thread_done( kk_context_t* ctx ) {
+  kk_unused(ctx);
+  if (regex_thread != NULL) {
+    kk_regex_thread_free(regex_thread);
+    regex_thread = NULL;
+  }
+}
+
+static kk_regex_thread_t* kk_regex_thread( kk_context_t* ctx ) {
+  kk_regex_thread_t* rt = regex_thread;
+  if (kk_likely(rt != NULL)) return rt;
+  rt = (kk_regex_thread_t*)calloc(1, sizeof(kk_regex_thread_t));   // not in the heap of the thread as it may outlive it
+  if (rt == NULL) return NULL;
+  rt->slot = kk_atomic_inc_relaxed(&kk_regex_thread_count);  // threads use the slots round robin (see `kk_regex_match_data_slot`)
+  rt->gen_ctx = pcre2_general_context_create( &kk_pcre2_malloc, &kk_pcre2_free, ctx );
+  if (rt->gen_ctx != NULL) {
+    rt->match_ctx = pcre2_match_context_create( rt->gen_ctx );
+    rt->cmp_ctx = pcre2_compile_context_create( rt->gen_ctx );
+    if (rt->cmp_ctx != NULL) {
+      pcre2_set_newline( rt->cmp_ctx, PCRE2_NEWLINE_ANYCRLF );
+      pcre2_set_bsr( rt->cmp_ctx, PCRE2_BSR_ANYCRLF );
+    }
+    rt->jit_stack = pcre2_jit_stack_create( KK_REGEX_JIT_STACK_START, KK_REGEX_JIT_STACK_MAX, rt->gen_ctx );
+    if (rt->match_ctx != NULL && rt->jit_stack != NULL) {
+      pcre2_jit_stack_assign( rt->match_ctx, NULL, rt->jit_stack );
     }
   }
+  regex_thread = rt;
+  kk_thread_done_register(&kk_regex_thread_done);  // if there is no room, the state lives as long as the thread
+  return rt;
 }
 
 static void kk_regex_custom_done( kk_context_t* ctx ) {
-  if (cmp_ctx != NULL) {
-    pcre2_compile_context_free(cmp_ctx);
-    cmp_ctx = NULL;
-  }
-  if (match_ctx != NULL) {
-    pcre2_match_context_free(match_ctx);
-    match_ctx = NULL;
-  }
-  if (gen_ctx != NULL) {
-    pcre2_general_context_free(gen_ctx);
-    gen_ctx = NULL;
-  }
+  kk_regex_thread_done(ctx);
 }
 
 
 /* -----------------------------------------------------------------------
   Compile
+
+  A regex is compiled with the JIT (if available) on its first use. Many
+  regular expressions are top-level values that are created when a module
+  is initialized but may never be used. The compiled code is published with
+  a CAS; if two threads race, the loser frees its code. A regex also caches
+  a few match data blocks: a match takes one from the slot for its thread
+  (or creates a fresh one) and puts it back afterwards. Each thread gets the
+  next slot index when its state is created so concurrent threads use
+  different slots.
 ------------------------------------------------------------------------*/
 
+#define KK_REGEX_MATCH_DATA_SLOTS  (8)
+#define KK_REGEX_INVALID           ((pcre2_code*)KK_UP(1))   // the pattern could not be compiled
+
+typedef struct kk_regex_s {
+  uint32_t                    options;
+  _Atomic(pcre2_code*)        code;      // NULL if not yet compiled
+  _Atomic(pcre2_match_data*)  match_data[KK_REGEX_MATCH_DATA_SLOTS];
+  char                        pattern[1];  // copied so the regex does not reference a (possibly shared) string
+} kk_regex_t;
+
 static void kk_regex_free( void* pre, kk_block_t* b, kk_context_t* ctx ) {
-  kk_unused(ctx);
-  pcre2_code* re = (pcre2_code*)pre;
+  kk_unused(b);
+  kk_regex_t* re = (kk_regex_t*)pre;
   //kk_info_message( "free regex at %p\n", re );
-  if (re != NULL) pcre2_code_free(re);
+  if (re == NULL) return;
+  for (int i = 0; i < KK_REGEX_MATCH_DATA_SLOTS; i++) {
+    pcre2_match_data* md = kk_atomic_load_relaxed(&re->match_data[i]);
+    if (md != NULL) pcre2_match_data_free(md);
+  }
+  pcre2_code* code = kk_atomic_load_relaxed(&re->code);
+  if (code != NULL && code != KK_REGEX_INVALID) pcre2_code_free(code);
+  kk_free(re,ctx);
 }
 
 #define KK_REGEX_OPTIONS  (PCRE2_ALT_BSUX | PCRE2_EXTRA_ALT_BSUX | PCRE2_MATCH_UNSET_BACKREF /* javascript compat */ \
@@ -74,17 +137,73 @@ static void kk_regex_free( void* pre, kk_block_t* b, kk_context_t* ctx ) {
                           )
 
 static kk_box_t kk_regex_create( kk_string_t pat, bool ignore_case, bool multi_line, kk_context_t* ctx ) {
-  kk_ssize_t len;
-  const uint8_t* cpat = kk_string_buf_borrow( pat, &len );
-  PCRE2_SIZE errofs = 0;
-  int        errnum = 0;
-  uint32_t   options = KK_REGEX_OPTIONS;
+  uint32_t options = KK_REGEX_OPTIONS;
   if (ignore_case) options |= PCRE2_CASELESS;
   if (multi_line)  options |= PCRE2_MULTILINE;
-  pcre2_code* re = pcre2_compile( cpat, PCRE2_ZERO_TERMINATED, options, &errnum, &errofs, cmp_ctx);
-  //kk_info_message( "create regex: err:%i, at %p\n", (re==NULL ? 0 : errnum), re );
+  kk_ssize_t len;
+  const char* cpat = kk_string_cbuf_borrow( pat, &len );
+  kk_regex_t* re = (kk_regex_t*)kk_zalloc( kk_ssizeof(kk_regex_t) + len, ctx );
+  if (re != NULL) {
+    memcpy(re->pattern, cpat, kk_to_size_t(len));
+    re->pattern[len] = 0;
+    re->options = options;
+  }
   kk_string_drop(pat,ctx);
-  return kk_cptr_raw_box( &kk_regex_free, re, ctx );
+  return kk_cptr_raw_box( &kk_regex_free, re, ctx );   // `re` is NULL if out of memory
+}
+
+// Get the compiled code (compiling it on first use); returns NULL if the pattern is invalid.
+static pcre2_code* kk_regex_code( kk_regex_t* re, kk_regex_thread_t* rt ) {
+  pcre2_code* code = kk_atomic_load_acquire(&re->code);
+  if (kk_likely(code != NULL)) return (code == KK_REGEX_INVALID ? NULL : code);
+  const uint8_t* cpat = (const uint8_t*)re->pattern;
+  PCRE2_SIZE errofs = 0;
+  int        errnum = 0;
+  code = pcre2_compile( cpat, PCRE2_ZERO_TERMINATED, re->options, &errnum, &errofs, rt->cmp_ctx);
+  //kk_info_message( "compile regex: err:%i, at %p\n", (code==NULL ? 0 : errnum), code );
+  if (code == NULL) {
+    code = KK_REGEX_INVALID;
+  }
+  else {
+    pcre2_jit_compile( code, PCRE2_JIT_COMPLETE );  // on failure (or without JIT support) we use the interpreter
+  }
+  pcre2_code* expect = NULL;
+  if (!kk_atomic_cas_strong_acq_rel(&re->code, &expect, code)) {
+    // another thread compiled it first
+    if (code != KK_REGEX_INVALID) pcre2_code_free(code);
+    code = expect;
+  }
+  return (code == KK_REGEX_INVALID ? NULL : code);
+}
+
+static _Atomic(pcre2_match_data*)* kk_regex_match_data_slot( kk_regex_t* re, kk_regex_thread_t* rt ) {
+  return &re->match_data[rt->slot % KK_REGEX_MATCH_DATA_SLOTS];
+}
+
+static pcre2_match_data* kk_regex_match_data_acquire( kk_regex_t* re, pcre2_code* code, kk_regex_thread_t* rt ) {
+  pcre2_match_data* md = kk_atomic_exchange_acq_rel( kk_regex_match_data_slot(re,rt), (pcre2_match_data*)NULL );
+  if (md != NULL) return md;
+  return pcre2_match_data_create_from_pattern( code, rt->gen_ctx );
+}
+
+static void kk_regex_match_data_release( kk_regex_t* re, pcre2_match_data* md, kk_regex_thread_t* rt ) {
+  pcre2_match_data* expect = NULL;
+  if (!kk_atomic_cas_strong_acq_rel( kk_regex_match_data_slot(re,rt), &expect, md )) {
+    pcre2_match_data_free(md);  // the slot is taken
+  }
+}
+
+// The number of match data blocks cached in a regex (used for testing)
+static kk_integer_t kk_regex_cached_match_data( kk_box_t bre, kk_context_t* ctx ) {
+  kk_regex_t* re = (kk_regex_t*)kk_cptr_raw_unbox(bre);
+  kk_ssize_t n = 0;
+  if (re != NULL) {
+    for (int i = 0; i < KK_REGEX_MATCH_DATA_SLOTS; i++) {
+      if (kk_atomic_load_acquire(&re->match_data[i]) != NULL) n++;
+    }
+  }
+  kk_box_drop(bre,ctx);
+  return kk_integer_from_ssize_t(n,ctx);
 }
 
 
@@ -100,12 +219,12 @@ static void kk_match_data_free( void* pmd, kk_block_t* b ) {
 }
 */
 
-static kk_std_core__list kk_regex_exec_ex( pcre2_code* re, pcre2_match_data* match_data, 
+static kk_std_core__list kk_regex_exec_ex( pcre2_code* re, pcre2_match_data* match_data, pcre2_match_context* match_ctx,
                                            kk_string_t str_borrow, const uint8_t* cstr, kk_ssize_t len, bool allow_empty, 
                                            kk_ssize_t start, kk_ssize_t* mstart, kk_ssize_t* end, int* res, kk_context_t* ctx ) 
 {
   // match
-  kk_std_core__list hd  = kk_std_core__new_Nil(ctx);
+  kk_std_core_types__ctail hd = kk_list_builder_init();
   uint32_t options = 0;
   if (!allow_empty) options |= (PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED);
   int rc = pcre2_match( re, cstr, len, start, options, match_data, match_ctx );
@@ -114,20 +233,19 @@ static kk_std_core__list kk_regex_exec_ex( pcre2_code* re, pcre2_match_data* mat
     // extract captures
     uint32_t    gcount = pcre2_get_ovector_count(match_data);
     PCRE2_SIZE* groups = pcre2_get_ovector_pointer(match_data);
-    for( uint32_t i = gcount; i > 0; ) {
-      i--;
+    for( uint32_t i = 0; i < gcount; i++) {
       kk_ssize_t sstart = groups[i*2];       // on no-match, sstart and send == -1.
       kk_ssize_t send   = groups[i*2 + 1];
       kk_assert(send >= sstart);
       kk_std_core__sslice sslice = kk_std_core__new_Sslice( kk_string_dup(str_borrow), sstart, send - sstart, ctx ); 
-      hd = kk_std_core__new_Cons(kk_reuse_null,kk_std_core__sslice_box(sslice,ctx), hd, ctx);
+      hd = kk_list_builder_append(hd, kk_std_core__sslice_box(sslice,ctx), ctx);
       if (i == 0) {
         if (mstart != NULL) { *mstart = sstart; }
         if (end    != NULL) { *end = send; }
       }
     }
   }
-  return hd;
+  return kk_list_builder_finish(hd, kk_std_core__new_Nil(ctx), ctx);
 }
 
 
@@ -136,21 +254,24 @@ static kk_std_core__list kk_regex_exec( kk_box_t bre, kk_string_t str, kk_ssize_
   // unpack
   pcre2_match_data* match_data = NULL;
   kk_std_core__list res = kk_std_core__new_Nil(ctx);
-  pcre2_code* re = (pcre2_code*)kk_cptr_raw_unbox(bre);
+  kk_regex_t* re = (kk_regex_t*)kk_cptr_raw_unbox(bre);
+  kk_regex_thread_t* rt = kk_regex_thread(ctx);
   kk_ssize_t len = 0;
   const uint8_t* cstr = NULL;
-  if (re == NULL) goto done;    
-  match_data = pcre2_match_data_create_from_pattern(re, gen_ctx);
+  pcre2_code* code = NULL;
+  if (re == NULL || rt == NULL) goto done;    
+  code = kk_regex_code(re, rt);
+  if (code == NULL) goto done;
+  match_data = kk_regex_match_data_acquire(re, code, rt);
   if (match_data==NULL) goto done;  
   cstr = kk_string_buf_borrow(str, &len );  
 
   // and match
-  res = kk_regex_exec_ex( re, match_data, str, cstr, len, true, start, NULL, NULL, NULL, ctx );
+  res = kk_regex_exec_ex( code, match_data, rt->match_ctx, str, cstr, len, true, start, NULL, NULL, NULL, ctx );
 
 done:  
   if (match_data != NULL) {
-    //kk_info_message( "free match data: %p\n", match_data );
-    pcre2_match_data_free(match_data);
+    kk_regex_match_data_release(re, match_data, rt);
   }
   kk_string_drop(str,ctx);
   kk_box_drop(bre,ctx);
@@ -162,16 +283,20 @@ static kk_std_core__list kk_regex_exec_all( kk_box_t bre, kk_string_t str, kk_ss
   if (atmost < 0) atmost = KK_SSIZE_MAX;
   pcre2_match_data* match_data = NULL;
   kk_std_core__list res = kk_std_core__new_Nil(ctx);
-  pcre2_code* re = (pcre2_code*)kk_cptr_raw_unbox(bre);
-  if (re == NULL) goto done;    
-  match_data = pcre2_match_data_create_from_pattern(re, gen_ctx);
+  kk_regex_t* re = (kk_regex_t*)kk_cptr_raw_unbox(bre);
+  kk_regex_thread_t* rt = kk_regex_thread(ctx);
+  pcre2_code* code = NULL;
+  if (re == NULL || rt == NULL) goto done;    
+  code = kk_regex_code(re, rt);
+  if (code == NULL) goto done;
+  match_data = kk_regex_match_data_acquire(re, code, rt);
   if (match_data==NULL) goto done;  
   {
     kk_ssize_t len;
     const uint8_t* cstr = kk_string_buf_borrow(str, &len );  
 
     // and match
-    kk_std_core__list* tail = NULL;
+    kk_std_core_types__ctail matches = kk_list_builder_init();
     bool allow_empty = true;
     int rc = 1;    
     kk_ssize_t next = start;
@@ -179,17 +304,14 @@ static kk_std_core__list kk_regex_exec_all( kk_box_t bre, kk_string_t str, kk_ss
       atmost--;
       rc = 0;
       kk_ssize_t mstart = start;
-      kk_std_core__list cap = kk_regex_exec_ex( re, match_data, str, cstr, len, allow_empty, start, &mstart, &next, &rc, ctx );
+      kk_std_core__list cap = kk_regex_exec_ex( code, match_data, rt->match_ctx, str, cstr, len, allow_empty, start, &mstart, &next, &rc, ctx );
       if (rc > 0) {
         // found a match; 
         // push string up to match, and the actual matched regex
         kk_std_core__sslice pre = kk_std_core__new_Sslice( kk_string_dup(str), start, mstart - start, ctx ); 
         kk_std_core__list   prelist = kk_std_core__new_Cons( kk_reuse_null, kk_std_core__sslice_box(pre,ctx), kk_std_core__new_Nil(ctx), ctx );
-        kk_std_core__list   capcons = kk_std_core__new_Cons( kk_reuse_null, kk_std_core__list_box(cap,ctx), kk_std_core__new_Nil(ctx) /*tail*/, ctx );
-        kk_std_core__list   cons = kk_std_core__new_Cons( kk_reuse_null, kk_std_core__list_box(prelist,ctx), capcons, ctx );
-        if (tail==NULL) res = cons;
-                  else *tail = cons;
-        tail = &kk_std_core__as_Cons(capcons)->tail;
+        matches = kk_list_builder_append( matches, kk_std_core__list_box(prelist,ctx), ctx );
+        matches = kk_list_builder_append( matches, kk_std_core__list_box(cap,ctx), ctx );
         allow_empty = (next > start);
         start = next;
       }
@@ -206,15 +328,13 @@ static kk_std_core__list kk_regex_exec_all( kk_box_t bre, kk_string_t str, kk_ss
     // push final string part as well and end the list
     kk_std_core__sslice post    = kk_std_core__new_Sslice( kk_string_dup(str), next, len - next, ctx ); 
     kk_std_core__list   postlist= kk_std_core__new_Cons( kk_reuse_null, kk_std_core__sslice_box(post,ctx), kk_std_core__new_Nil(ctx), ctx );
-    kk_std_core__list   cons    = kk_std_core__new_Cons( kk_reuse_null, kk_std_core__list_box(postlist,ctx), kk_std_core__new_Nil(ctx), ctx );
-    if (tail==NULL) res = cons;
-              else *tail = cons;  
+    matches = kk_list_builder_append( matches, kk_std_core__list_box(postlist,ctx), ctx );
+    res = kk_list_builder_finish( matches, kk_std_core__new_Nil(ctx), ctx );
   }
 
 done:  
   if (match_data != NULL) {
-    //kk_info_message( "free match data: %p\n", match_data );
-    pcre2_match_data_free(match_data);
+    kk_regex_match_data_release(re, match_data, rt);
   }
   kk_string_drop(str,ctx);
   kk_box_drop(bre,ctx);
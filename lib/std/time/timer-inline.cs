@@ -23,4 +23,12 @@ static class _Timer {
   public static double TicksResolution() {
     return resolution;
   }
+
+  public static long FastTicks() {
+    return Stopwatch.GetTimestamp();
+  }
+
+  public static long FastTicksFrequency() {
+    return frequency;
+  }
 }
@@ -43,3 +43,20 @@ else {
     return $std_core_types._Tuple2_( (t + _ticks_delta) * _ticks_resolution, 0.0); 
   };
 }
+
+// fast ticks are an integer number of nano seconds (or micro seconds if we only have a performance counter)
+var _fast_ticks;
+var _fast_ticks_frequency;
+
+if (typeof process !== 'undefined' && typeof process.hrtime === 'function' && typeof process.hrtime.bigint === 'function') {
+  _fast_ticks = function() { return BigInt.asIntN(64,process.hrtime.bigint()); };
+  _fast_ticks_frequency = function() { return BigInt(1000000000); };
+}
+else if (typeof performance !== 'undefined' && typeof performance.now === 'function') {
+  _fast_ticks = function() { return BigInt(Math.round(performance.now() * 1000.0)); };
+  _fast_ticks_frequency = function() { return BigInt(1000000); };
+}
+else {
+  _fast_ticks = function() { return BigInt(Math.round(_ticks().fst * 1000.0)); };
+  _fast_ticks_frequency = function() { return BigInt(1000); };
+}
@@ -66,9 +66,9 @@ externalNames
 -- Generate C code from System-F core language
 --------------------------------------------------------------------------
 
-cFromCore :: CTarget -> BuildType -> FilePath -> Pretty.Env -> Platform -> Newtypes -> Borrowed -> Int -> Bool -> Bool -> Bool -> Bool -> Int -> Maybe (Name,Bool) -> Core -> (Doc,Doc,Core)
-cFromCore ctarget buildType sourceDir penv0 platform newtypes borrowed uniq enableReuse enableSpecialize enableReuseSpecialize enableBorrowInference stackSize mbMain core
-  = case runAsm uniq (Env moduleName moduleName False penv externalNames newtypes platform False)
+cFromCore :: CTarget -> BuildType -> FilePath -> Pretty.Env -> Platform -> Newtypes -> Borrowed -> Int -> Bool -> Bool -> Bool -> Bool -> Bool -> Int -> Maybe (Name,Bool) -> Core -> (Doc,Doc,Core)
+cFromCore ctarget buildType sourceDir penv0 platform newtypes borrowed uniq enableReuse enableSpecialize enableReuseSpecialize enableBorrowInference enableProfile stackSize mbMain core
+  = case runAsm uniq (Env moduleName moduleName False penv externalNames newtypes platform False enableProfile)
            (genModule ctarget buildType sourceDir penv platform newtypes borrowed enableReuse enableSpecialize enableReuseSpecialize enableBorrowInference stackSize mbMain core) of
       (bcore,cdoc,hdoc) -> (cdoc,hdoc,bcore)
   where
@@ -394,18 +394,28 @@ genTopDefDecl genSig inlineC def@(Def name tp defBody vis sort inl rng comm)
            bodyDoc <- (if isTailCall then withStatement else id)
                       (genStat (ResultReturn (Just (TName name resTp)) params) body)
            penv <- getPrettyEnv
+           profile <- getEnableProfile
            let tpDoc = typeComment (Pretty.ppType penv tp)
            let sig = genLamSig inlineC vis name params body
            when (genSig && not inlineC {-&& isPublic (defVis def)-}) $ emitToH (linebreak <.> sig <.> semi <+> tpDoc)
            top <- getTop -- get top level decls generated by body (for functions etc)
-           emit $ linebreak
-                  <.> top
-                  <.> sig
-                  <+> ( if isTailCall
-                          then tcoBlock tpDoc bodyDoc
-                          else debugComment ("genFunDef: no tail calls to " ++ showName name ++ " found")
-                            <.> tblock tpDoc bodyDoc
-                      )
+           let funBlock = if isTailCall
+                            then tcoBlock tpDoc bodyDoc
+                            else debugComment ("genFunDef: no tail calls to " ++ showName name ++ " found")
+                              <.> tblock tpDoc bodyDoc
+           if (not profile || inlineC)
+             then emit $ linebreak <.> top <.> sig <+> funBlock
+             else -- the body becomes a static function that is called between a `kk_profile_enter` and `kk_profile_leave`;
+                  -- (recursive calls go through the wrapper while tail calls to itself stay a loop in the body)
+                  do let bodyName = makeHiddenName "profiled" name
+                         bodySig  = text "static" <+> genLamSig inlineC vis bodyName params body
+                         (cname,_) = cstring (showName name)
+                     emit $ linebreak <.> top <.> bodySig <+> funBlock
+                     emit $ linebreak <.> sig <+> block (vcat
+                              [text "kk_profile_enter" <.> arguments [cname] <.> semi
+                              ,ppType (typeOf body) <+> text "_res =" <+> ppName bodyName <.> arguments args <.> semi
+                              ,text "kk_profile_leave" <.> arguments [] <.> semi
+                              ,text "return _res;"])
 
 unitSemi :: Type -> Doc
 unitSemi tp
@@ -2194,6 +2204,7 @@ data Env = Env { moduleName        :: Name                    -- | current modul
                , newtypes          :: Newtypes
                , platform          :: Platform
                , inStatement       :: Bool                    -- | for generating correct function declarations in strict mode
+               , enableProfile     :: Bool                    -- | emit shadow stack frames for the profiler (see `kklib/include/kklib/profile.h`)
                }
 
 data Result = ResultReturn (Maybe TName) [TName] -- first field carries function name if not anonymous and second the arguments which are always known
@@ -2291,6 +2302,11 @@ getPrettyEnv
   = do env <- getEnv
        return (prettyEnv env)
 
+getEnableProfile :: Asm Bool
+getEnableProfile
+  = do env <- getEnv
+       return (enableProfile env)
+
 withTypeVars :: [TypeVar] -> Asm a -> Asm a
 withTypeVars vars asm
   = withEnv (\env -> env{ prettyEnv = Pretty.niceEnv (prettyEnv env) vars }) asm
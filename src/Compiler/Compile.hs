@@ -1222,7 +1222,7 @@ codeGenC sourceFile newtypes borrowed0 unique0 term flags modules compileTarget
                       _         -> CDefault         
           (cdoc,hdoc,bcore) = cFromCore ctarget (buildType flags) sourceDir (prettyEnvFromFlags flags) (platform flags)
                                 newtypes borrowed0 unique0 (parcReuse flags) (parcSpecialize flags) (parcReuseSpec flags)
-                                (parcBorrowInference flags) (stackSize flags) mbEntry core0
+                                (parcBorrowInference flags) (genProfile flags) (stackSize flags) mbEntry core0
           bcoreDoc  = Core.Pretty.prettyCore (prettyEnvFromFlags flags){ coreIface = False, coreShowDef = True } (C CDefault) [] bcore
       -- writeDocW 120 (outBase ++ ".c.kkc") bcoreDoc
       when (showFinalCore flags) $
@@ -1262,7 +1262,7 @@ codeGenC sourceFile newtypes borrowed0 unique0 term flags modules compileTarget
                 syslibs= concat [csyslibsFromCore flags mcore | mcore <- map modCore modules]
                          ++ ccompLinkSysLibs flags
                          ++ (if onWindows && not (isTargetWasm (target flags))
-                              then ["bcrypt","psapi","advapi32"]
+                              then ["bcrypt","psapi","advapi32","synchronization"]
                               else ["m","pthread"])
                 libs   = -- ["kklib"] -- [normalizeWith '/' (outName flags (ccLibFile cc "kklib"))] ++ ccompLinkLibs flags
                          -- ++ 
@@ -183,6 +183,7 @@ data Flags
          , asan             :: Bool
          , useStdAlloc      :: Bool -- don't use mimalloc for better asan and valgrind support
          , optSpecialize    :: Bool
+         , genProfile       :: Bool -- emit shadow stack frames for the sampling profiler (C backend)
          }
 
 flagsNull :: Flags
@@ -276,6 +277,7 @@ flagsNull
           False -- use asan
           False -- use stdalloc
           True  -- use specialization (only used if optimization level >= 1)
+          False -- emit profiler frames
 
 isHelp Help = True
 isHelp _    = False
@@ -379,6 +381,7 @@ options = (\(xss,yss) -> (concat xss, concat yss)) $ unzip
  , hide $ fflag       ["opttrmc"]      (\b f -> f{optctail=b})              "enable tail-recursion-modulo-cons optimization"
  , hide $ fflag       ["opttrmcinline"] (\b f -> f{optctailInline=b})  "enable trmc inlining (increases code size)"
  , hide $ fflag       ["specialize"]  (\b f -> f{optSpecialize=b})      "enable inline specialization"
+ , hide $ fflag       ["profile"]     (\b f -> f{genProfile=b})         "emit shadow stack frames for --kkprofile (C)"
 
  -- deprecated
  , hide $ option []    ["cmake"]           (ReqArg cmakeFlag "cmd")        "use <cmd> to invoke cmake"
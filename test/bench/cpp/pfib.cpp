@@ -0,0 +1,118 @@
+// Fork-join fibonacci in C++ with a small work-stealing task pool (in the style of TBB
+// or Cilk: a waiting thread runs other tasks until the task it waits for is done).
+// The reference version of `koka/pfib.kk`.
+#include <iostream>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+struct task {
+  void (*fun)(void* arg);
+  void* arg;
+  std::atomic<bool> done{false};
+  task(void (*f)(void*), void* a) : fun(f), arg(a) { }
+  void run() { fun(arg); done.store(true, std::memory_order_release); }
+};
+
+class pool {
+  struct worker {
+    std::mutex lock;
+    std::deque<task*> tasks;
+  };
+  std::vector<worker> workers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stop{false};
+  static thread_local size_t self;
+
+  task* pop_or_steal() {
+    worker& w = workers[self];
+    {
+      std::lock_guard<std::mutex> guard(w.lock);
+      if (!w.tasks.empty()) { task* t = w.tasks.back(); w.tasks.pop_back(); return t; }
+    }
+    for(size_t i = 1; i < workers.size(); i++) {
+      worker& v = workers[(self + i) % workers.size()];
+      std::lock_guard<std::mutex> guard(v.lock);
+      if (!v.tasks.empty()) { task* t = v.tasks.front(); v.tasks.pop_front(); return t; }
+    }
+    return nullptr;
+  }
+
+public:
+  pool(size_t n) : workers(n) {
+    self = 0;  // the main thread
+    for(size_t i = 1; i < n; i++) {
+      threads.emplace_back([this,i]() {
+        self = i;
+        while(!stop.load(std::memory_order_relaxed)) {
+          task* t = pop_or_steal();
+          if (t != nullptr) t->run(); else std::this_thread::yield();
+        }
+      });
+    }
+  }
+
+  ~pool() {
+    stop = true;
+    for(auto& t : threads) t.join();
+  }
+
+  void spawn(task* t) {
+    worker& w = workers[self];
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.tasks.push_back(t);
+  }
+
+  void wait(task* t) {
+    while(!t->done.load(std::memory_order_acquire)) {
+      task* u = pop_or_steal();
+      if (u != nullptr) u->run(); else std::this_thread::yield();
+    }
+  }
+};
+
+thread_local size_t pool::self = 0;
+
+static pool* tasks;
+static long cutoff = 1;
+
+static long fib(long n) {
+  return (n < 2 ? n : fib(n-1) + fib(n-2));
+}
+
+struct fib_arg {
+  long n;
+  long result;
+};
+
+static long pfib(long n);
+
+static void pfib_task(void* arg) {
+  fib_arg* a = (fib_arg*)arg;
+  a->result = pfib(a->n);
+}
+
+static long pfib(long n) {
+  if (n <= cutoff) return fib(n);
+  fib_arg arg = { n - 1, 0 };
+  task t(&pfib_task, &arg);
+  tasks->spawn(&t);
+  long y = pfib(n - 2);
+  tasks->wait(&t);
+  return y + arg.result;
+}
+
+// usage: pfib [n (=32)] [cutoff (=1)] [threads]
+int main(int argc, char ** argv) {
+  long n = (argc >= 2 ? atol(argv[1]) : 32);
+  cutoff = (argc >= 3 ? atol(argv[2]) : 1);
+  long threads = (argc >= 4 ? atol(argv[3]) : (long)std::thread::hardware_concurrency());
+  if (threads <= 0) threads = 1;
+  pool p((size_t)threads);
+  tasks = &p;
+  std::cout << "fib(" << n << ") = " << pfib(n) << "\n";
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Parallel NQueens in C++: one thread per position of the queen in the first row
+// (using the same list based algorithm as `nqueens.cpp`).
+// Note: does not free memory as that is difficult to do
+// since many subsolutions are shared
+#include <iostream>
+#include <thread>
+#include <vector>
+
+template <typename T>
+class list {
+public:
+  T head;
+  list<T>* tail;
+  list(T hd, list<T>* tl) {
+    head = hd;
+    tail = tl;
+  }
+};
+
+template <typename T>
+list<T>* Cons( T hd, list<T>* tl ) {
+  return new list<T>(hd,tl);
+}
+
+template <typename T>
+int len(list<T>* xs) {
+  int n = 0;
+  while(xs != NULL) {
+    n++;
+    xs = xs->tail;
+  }
+  return n;
+}
+
+bool safe( int queen, list<int>* xs ) {
+  list<int>* cur = xs;
+  int diag = 1;
+  while(cur != NULL) {
+    int q = cur->head;
+    if (queen == q || queen == (q+diag) || queen == (q-diag)) {
+      return false;
+    }
+    diag++;
+    cur = cur->tail;
+  }
+  return true;
+}
+
+list<list<int>*>* append_safe( int k, list<int>* soln, list<list<int>*>* solns ) {
+  list<list<int>*>* acc = solns;
+  int n = k;
+  while(n > 0) {
+    if (safe(n,soln)) {
+      acc = Cons(Cons(n,soln),acc);
+    }
+    n--;
+  }
+  return acc;
+}
+
+list<list<int>*>* extend( int n, list<list<int>*>* solns ) {
+  list<list<int>*>* acc = NULL;
+  list<list<int>*>* cur = solns;
+  while(cur != NULL) {
+    list<int>* soln = cur->head;
+    acc = append_safe(n,soln,acc);
+    cur = cur->tail;
+  }
+  return acc;
+}
+
+// all solutions with the first queen at `q`
+list<list<int>*>* find_solutions_from( int n, int q ) {
+  list<list<int>*>* acc = Cons<list<int>*>(Cons<int>(q,NULL),NULL);
+  for(int k = 1; k < n; k++) {
+    acc = extend(n,acc);
+  }
+  return acc;
+}
+
+int pnqueens(int n) {
+  std::vector<int> counts(n);
+  std::vector<std::thread> threads;
+  for(int q = 1; q <= n; q++) {
+    threads.emplace_back([n,q,&counts]() { counts[q-1] = len(find_solutions_from(n,q)); });
+  }
+  int total = 0;
+  for(int i = 0; i < n; i++) {
+    threads[i].join();
+    total += counts[i];
+  }
+  return total;
+}
+
+int main(int argc, char ** argv) {
+    int n = 13;
+    if (argc >= 2) {
+      n = atoi(argv[1]);
+    }
+    std::cout << pnqueens(n) << "\n";
+    return 0;
+}
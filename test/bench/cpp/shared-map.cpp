@@ -0,0 +1,40 @@
+// Many threads look up keys in one large shared (read-only) `std::map`.
+// (The reference version of `koka/shared-map.kk`; here reads need no synchronization at all.)
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+static long reader( const std::map<long,long>& m, long size, long n, uint64_t x ) {
+  long acc = 0;
+  for(long i = 0; i < n; i++) {
+    x = (x * 69069 + 1) % 4294967296;
+    auto it = m.find((long)(x % (uint64_t)size));
+    if (it != m.end()) acc += it->second;
+  }
+  return acc;
+}
+
+int main(int argc, char ** argv) {
+  long tasks = (argc >= 2 ? atol(argv[1]) : 8);
+  long n     = (argc >= 3 ? atol(argv[2]) : 1000000);
+  long size  = (argc >= 4 ? atol(argv[3]) : 1000000);
+  std::map<long,long> m;
+  for(long k = 0; k < size; k++) {
+    m.emplace_hint(m.end(), k, 2*k);
+  }
+  std::vector<long> sums(tasks);
+  std::vector<std::thread> threads;
+  for(long i = 0; i < tasks; i++) {
+    threads.emplace_back([&m,&sums,size,n,i]() { sums[i] = reader(m, size, n, (uint64_t)(i+1)); });
+  }
+  long total = 0;
+  for(long i = 0; i < tasks; i++) {
+    threads[i].join();
+    total += sums[i];
+  }
+  std::cout << total << "\n";
+  return 0;
+}
@@ -0,0 +1,36 @@
+// Sort a vector of pseudo random integers, the same keys as doubles, and the integers again
+// with a comparison function (in decreasing order). (The reference version of `koka/sort.kk`.)
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+static long key( long i ) {
+  return (long)((((uint64_t)i * 69069 + 1) % 4294967296) % 1000000);
+}
+
+// the first, middle, and last element
+template <typename T>
+static T check( const std::vector<T>& v ) {
+  size_t n = v.size();
+  return (n == 0 ? T(0) : v[0] + v[n/2] + v[n-1]);
+}
+
+int main(int argc, char ** argv) {
+  long n = (argc >= 2 ? atol(argv[1]) : 1000000);
+  std::vector<long> ints(n);
+  std::vector<double> floats(n);
+  std::vector<long> custom(n);
+  for(long i = 0; i < n; i++) {
+    ints[i] = custom[i] = key(i);
+    floats[i] = (double)key(i);
+  }
+  std::sort(ints.begin(), ints.end());
+  std::sort(floats.begin(), floats.end());
+  std::sort(custom.begin(), custom.end(), std::greater<long>());
+  std::cout << check(ints) + check(custom) << "\n";
+  std::cout << check(floats) << "\n";
+  return 0;
+}